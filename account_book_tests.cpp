@@ -1,64 +1,42 @@
 ﻿#include <gtest/gtest.h>
 
+// 单元测试在启用指标的配置下编译，覆盖埋点；集成测试与基准保持默认的关闭配置
+#define ACCOUNT_BOOK_METRICS 1
+
+#include "bounded_queue.h"
+#include "category_recognizer.h"
+#include "category_registry.h"
+#include "date_column.h"
+#include "date_utils.h"
+#include "fuzzy_recognizer.h"
+#include "keyword_prefilter.h"
+#include "live_recognizer.h"
+#include "metrics.h"
+#include "note_memo_cache.h"
+#include "recognizer_cache.h"
+#include "recognizer_snapshot.h"
+#include "static_recognizer.h"
+#include "transaction.h"
+
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <filesystem>
 #include <map>
+#include <memory>
+#include <new>
+#include <random>
 #include <regex>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
-// ===================== 被测子功能：工具函数（最小实现） =====================
-static std::string GetCurrentDate() {
-    std::time_t now = std::time(nullptr);
-
-    std::tm ltm{};
-#if defined(_WIN32)
-    localtime_s(&ltm, &now);
-#else
-    localtime_r(&now, &ltm);
-#endif
-
-    char buf[20];
-    std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d",
-                  1900 + ltm.tm_year, 1 + ltm.tm_mon, ltm.tm_mday);
-    return std::string(buf);
-}
-
-// ===================== 被测子功能：分类识别（最小实现） =====================
-struct Category {
-    int id;
-    std::string name;
-    std::string description;
-};
-
-class CategoryRecognizer {
- public:
-    explicit CategoryRecognizer(const std::vector<Category>& categories)
-        : categories_(categories) {}
-
-    int RecognizeCategory(const std::string& note) {
-        // 简单关键词匹配：命中分类名即返回对应 id
-        std::map<std::string, int> keyword_map;
-        for (const auto& c : categories_) keyword_map[c.name] = c.id;
-
-        for (const auto& kv : keyword_map) {
-            if (note.find(kv.first) != std::string::npos) return kv.second;
-        }
-
-        // 默认“其他”
-        for (const auto& c : categories_) {
-            if (c.name == "其他") return c.id;
-        }
-
-        // 再退化：无“其他”则返回第一个；无分类返回 0
-        return categories_.empty() ? 0 : categories_[0].id;
-    }
-
- private:
-    std::vector<Category> categories_;
-};
-
 // ===================== 单元测试：GetCurrentDate() =====================
 TEST(GetCurrentDateTests, FormatIsYYYYMMDD) {
     std::string d = GetCurrentDate();
@@ -98,6 +76,189 @@ TEST(GetCurrentDateTests, MultipleCallsStillValid) {
     }
 }
 
+// ===================== 单元测试：DateProvider（当天日期缓存） =====================
+static std::time_t g_fake_now = 0;
+static std::time_t FakeNow() { return g_fake_now; }
+
+// 临时切换 TZ，析构时恢复
+class ScopedTimeZone {
+ public:
+    explicit ScopedTimeZone(const char* tz) {
+        const char* old = std::getenv("TZ");
+        had_old_ = old != nullptr;
+        if (had_old_) old_ = old;
+        Set(tz);
+    }
+    ~ScopedTimeZone() {
+        if (had_old_) {
+            Set(old_.c_str());
+        } else {
+#if defined(_WIN32)
+            _putenv_s("TZ", "");
+#else
+            unsetenv("TZ");
+#endif
+        }
+    }
+    static void Set(const char* tz) {
+#if defined(_WIN32)
+        _putenv_s("TZ", tz);
+#else
+        setenv("TZ", tz, 1);
+#endif
+    }
+
+ private:
+    bool had_old_ = false;
+    std::string old_;
+};
+
+TEST(DateProviderTests, MatchesGetCurrentDateFormat) {
+    DateProvider provider;
+    std::string d(ToStringView(provider.Today()));
+    EXPECT_TRUE(std::regex_match(d, std::regex(R"(^\d{4}-\d{2}-\d{2}$)")));
+}
+
+TEST(DateProviderTests, RollsOverAtMidnight) {
+    ScopedTimeZone tz("UTC0");
+    DateProvider provider(&FakeNow);
+    g_fake_now = 1769903999;  // 2026-01-31 23:59:59 UTC
+    EXPECT_EQ(ToStringView(provider.Today()), "2026-01-31");
+    EXPECT_EQ(ToStringView(provider.Today()), "2026-01-31");
+    g_fake_now += 1;
+    EXPECT_EQ(ToStringView(provider.Today()), "2026-02-01");
+}
+
+TEST(DateProviderTests, ClockGoingBackwardsRefreshes) {
+    ScopedTimeZone tz("UTC0");
+    DateProvider provider(&FakeNow);
+    g_fake_now = 1769904000;  // 2026-02-01 00:00:00 UTC
+    EXPECT_EQ(ToStringView(provider.Today()), "2026-02-01");
+    g_fake_now -= 1;
+    EXPECT_EQ(ToStringView(provider.Today()), "2026-01-31");
+}
+
+TEST(DateProviderTests, FollowsTimeZoneChanges) {
+    ScopedTimeZone tz("UTC0");
+    DateProvider provider(&FakeNow);
+    g_fake_now = 1767225600 + 20 * 3600;  // 2026-01-01 20:00 UTC
+    EXPECT_EQ(ToStringView(provider.Today()), "2026-01-01");
+
+    ScopedTimeZone::Set("CST-8");  // UTC+8：已是 1 月 2 日凌晨
+    provider.Invalidate();
+    EXPECT_EQ(ToStringView(provider.Today()), "2026-01-02");
+
+    // 不调用 Invalidate 时，缓存窗口到期后也会跟随时区
+    ScopedTimeZone::Set("UTC0");
+    g_fake_now += DateProvider::kMaxCacheSeconds;
+    EXPECT_EQ(ToStringView(provider.Today()), "2026-01-01");
+}
+
+// ===================== 单元测试：PackedDate =====================
+TEST(PackedDateTests, RoundTripsThroughString) {
+    PackedDate d = PackedDate::Parse("2026-01-31");
+    ASSERT_TRUE(d.valid());
+    EXPECT_EQ(d.year(), 2026);
+    EXPECT_EQ(d.month(), 1);
+    EXPECT_EQ(d.day(), 31);
+    EXPECT_EQ(d.ToString(), "2026-01-31");
+}
+
+TEST(PackedDateTests, RejectsMalformedAndImpossibleDates) {
+    for (const char* s : {"", "2026-1-01", "2026/01/01", "2026-13-01", "2026-00-10", "2026-04-31",
+                          "2026-02-29", "0000-01-01", "20x6-01-01", "2026-01-01 "}) {
+        EXPECT_FALSE(PackedDate::Parse(s).valid()) << s;
+    }
+    EXPECT_TRUE(PackedDate::Parse("2024-02-29").valid());
+    EXPECT_TRUE(PackedDate::Parse("2000-02-29").valid());
+    EXPECT_FALSE(PackedDate::Parse("1900-02-29").valid());
+}
+
+TEST(PackedDateTests, IntegerOrderMatchesCalendarOrder) {
+    EXPECT_LT(PackedDate(2025, 12, 31), PackedDate(2026, 1, 1));
+    EXPECT_LT(PackedDate(2026, 1, 31), PackedDate(2026, 2, 1));
+    EXPECT_EQ(PackedDate(2026, 3, 5).value() >> 5, PackedDate(2026, 3, 28).value() >> 5);
+}
+
+TEST(PackedDateTests, TodayMatchesGetCurrentDate) {
+    EXPECT_EQ(GetCurrentPackedDate().ToString(), GetCurrentDate());
+}
+
+// ===================== 单元测试：ParseDateColumn（批量日期解析） =====================
+// 全部合法日期之外，再对每个字符位置做替换与长度变化，覆盖各种非法输入
+static std::vector<std::string> DateCorpus() {
+    std::vector<std::string> corpus = {"", "0000-01-01", "0001-01-01", "9999-12-31", "2024-02-29", "2100-02-29",
+                                       "2000-02-29", "2026-02-29", "2026-00-10", "2026-13-01", "2026-04-31",
+                                       "2026-01-00", "2026-01-32", "2026/01/01", "2026-1-01", "2026-01-011",
+                                       "20260101", "abcd-ef-gh", "2026-01-01 ", " 2026-01-01"};
+    for (int y : {1999, 2023, 2024}) {
+        for (int m = 1; m <= 12; ++m) {
+            for (int d = 1; d <= 31; ++d) {
+                char buf[16];
+                std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d", y, m, d);
+                corpus.push_back(buf);
+            }
+        }
+    }
+    const std::string base = "2024-02-29";
+    for (std::size_t pos = 0; pos < base.size(); ++pos) {
+        for (char c : {'/', '0', '9', ':', '-', 'a', ' ', '\0', '\x80', '\xff'}) {
+            std::string s = base;
+            s[pos] = c;
+            corpus.push_back(s);
+        }
+    }
+    return corpus;
+}
+
+static std::vector<SimdLevel> DateColumnLevels() {
+    std::vector<SimdLevel> levels = {SimdLevel::kScalar};
+    if (ActiveSimdLevel() != SimdLevel::kScalar) levels.push_back(ActiveSimdLevel());
+    return levels;
+}
+
+TEST(DateColumnTests, MatchesPackedDateParseForEveryLevel) {
+    const std::vector<std::string> corpus = DateCorpus();
+    std::vector<std::string_view> views(corpus.begin(), corpus.end());
+    const PackedDate today(2026, 1, 15);
+    std::size_t expected_bad = 0;
+    for (const auto& s : corpus) expected_bad += !s.empty() && !PackedDate::Parse(s).valid();
+    ASSERT_GT(expected_bad, 50u);
+    for (SimdLevel level : DateColumnLevels()) {
+        // 各种长度覆盖 4 行一组与 64 行一字的尾部
+        for (std::size_t n : {views.size(), views.size() - 1, std::size_t(3), std::size_t(64), std::size_t(65)}) {
+            std::vector<uint32_t> out(n, 0xDEADBEEF);
+            std::vector<uint64_t> errors(DateErrorWords(n), ~0ull);
+            std::size_t bad = ParseDateColumn(views.data(), n, today, out.data(), errors.data(), level);
+            std::size_t want_bad = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                const bool empty = views[i].empty();
+                const PackedDate want = empty ? today : PackedDate::Parse(views[i]);
+                ASSERT_EQ(out[i], want.value()) << views[i] << " level " << static_cast<int>(level);
+                ASSERT_EQ(IsDateError(errors.data(), i), !empty && !want.valid()) << views[i];
+                want_bad += !empty && !want.valid();
+            }
+            EXPECT_EQ(bad, want_bad);
+            if (n % 64 != 0) {
+                EXPECT_EQ(errors.back() >> (n % 64), 0u);  // 尾部多余的位清零
+            }
+        }
+        std::vector<uint32_t> out(views.size());
+        EXPECT_EQ(ParseDateColumn(views.data(), views.size(), today, out.data(), nullptr, level), expected_bad);
+    }
+}
+
+TEST(DateColumnTests, ReadsTransactionInputDates) {
+    const std::vector<TransactionInput> inputs = {
+        {"餐饮", "2026-03-04"}, {"娱乐", ""}, {"工资", "2026-02-30"}, {"其他", "2024-02-29"}, {"水电费", "x"}};
+    std::vector<uint32_t> out(inputs.size());
+    uint64_t errors = 0;
+    EXPECT_EQ(ParseDateColumn(inputs.data(), inputs.size(), PackedDate(2026, 1, 1), out.data(), &errors), 2u);
+    EXPECT_EQ(out, (std::vector<uint32_t>{PackedDate(2026, 3, 4).value(), PackedDate(2026, 1, 1).value(), 0,
+                                          PackedDate(2024, 2, 29).value(), 0}));
+    EXPECT_EQ(errors, 0b10100u);
+}
+
 // ===================== 单元测试：CategoryRecognizer::RecognizeCategory() =====================
 static std::vector<Category> DefaultCats() {
     return {
@@ -170,6 +331,1216 @@ TEST(CategoryRecognizerTests, NoteContainsOtherKeywordShouldReturnOther) {
     EXPECT_EQ(cr.RecognizeCategory("其他: 杂项支出"), 5);
 }
 
+TEST(CategoryRecognizerTests, OverlappingKeywordsFollowFailureLinks) {
+    // “水电费”的前缀“水电”不完整时，必须沿失败链接继续命中“电费”
+    std::vector<Category> cats = {
+        {1, "水电费", ""},
+        {2, "电费", ""},
+        {3, "其他", ""},
+    };
+    CategoryRecognizer cr(cats);
+    EXPECT_EQ(cr.RecognizeCategory("缴水电 电费"), 2);
+    EXPECT_EQ(cr.RecognizeCategory("水电 费"), 3);
+    EXPECT_EQ(cr.RecognizeCategory("水水电费"), 1);
+}
+
+TEST(CategoryRecognizerTests, MultipleKeywordsPreferSmallestNameByteOrder) {
+    // 与旧实现遍历 std::map 的顺序一致：按名字字节序取最小者
+    std::vector<Category> cats = {
+        {1, "b", ""},
+        {2, "ab", ""},
+        {3, "c", ""},
+    };
+    CategoryRecognizer cr(cats);
+    EXPECT_EQ(cr.RecognizeCategory("c b ab"), 2);
+    EXPECT_EQ(cr.RecognizeCategory("c b"), 1);
+}
+
+TEST(CategoryRecognizerTests, DuplicateNamesUseLastCategory) {
+    std::vector<Category> cats = {
+        {1, "餐饮", ""},
+        {2, "餐饮", ""},
+    };
+    CategoryRecognizer cr(cats);
+    EXPECT_EQ(cr.RecognizeCategory("餐饮 晚饭"), 2);
+}
+
+TEST(CategoryRecognizerTests, ManyCategoriesStillMatch) {
+    std::vector<Category> cats;
+    for (int i = 0; i < 2000; ++i) cats.push_back({i + 1, "商户" + std::to_string(i) + "号", ""});
+    cats.push_back({9999, "其他", ""});
+    CategoryRecognizer cr(cats);
+    EXPECT_EQ(cr.RecognizeCategory("在商户1234号消费"), 1235);
+    EXPECT_EQ(cr.RecognizeCategory("在商户号消费"), 9999);
+}
+
+TEST(CategoryRecognizerTests, StringViewAndPointerLengthOverloads) {
+    CategoryRecognizer cr(DefaultCats());
+    const std::string buffer = "娱乐 电影票|工资 发放";
+    const std::size_t bar = buffer.find('|');
+    std::string_view whole(buffer);
+    EXPECT_EQ(cr.RecognizeCategory(whole.substr(0, bar)), 2);
+    EXPECT_EQ(cr.RecognizeCategory(whole.substr(bar + 1)), 4);
+    // 长度截断在“工资”之前：不能越过 len 读取
+    EXPECT_EQ(cr.RecognizeCategory(buffer.data(), bar + 1), 2);
+    EXPECT_EQ(cr.RecognizeCategory(buffer.data() + bar + 1, 3), 5);
+}
+
+TEST(CategoryRecognizerTests, KeywordAliasesMatchTheirCategory) {
+    std::vector<Category> cats = DefaultCats();
+    cats[0].keywords = {"午饭", "外卖", "美团", "饿了么"};
+    cats[1].keywords = {"电影", "KTV"};
+    CategoryRecognizer cr(cats);
+    EXPECT_EQ(cr.RecognizeCategory("美团 黄焖鸡"), 1);
+    EXPECT_EQ(cr.RecognizeCategory("晚上饿了么点单"), 1);
+    EXPECT_EQ(cr.RecognizeCategory("周末KTV"), 2);
+    EXPECT_EQ(cr.RecognizeCategory("餐饮"), 1);  // 名字仍然是关键词
+    EXPECT_EQ(cr.RecognizeCategory("买书"), 5);
+}
+
+TEST(CategoryRecognizerTests, AliasesShareOneIndexWithNamesAcrossPolicies) {
+    std::vector<Category> cats = {
+        {1, "餐饮", "", 1, {"外卖", "外卖平台"}},
+        {2, "娱乐", "", 5, {"电影"}},
+        {3, "其他", "", 0, {""}},  // 空别名被忽略，不会命中所有备注
+    };
+    EXPECT_EQ(CategoryRecognizer(cats).RecognizeCategory("看电影点外卖"), 1);  // “外卖” < “电影”
+    EXPECT_EQ(CategoryRecognizer(cats, MatchPolicy::kFirstOccurrence).RecognizeCategory("看电影点外卖"), 2);
+    EXPECT_EQ(CategoryRecognizer(cats, MatchPolicy::kLongestKeyword).RecognizeCategory("电影 外卖平台"), 1);
+    EXPECT_EQ(CategoryRecognizer(cats, MatchPolicy::kPriority).RecognizeCategory("外卖平台 电影"), 2);
+    EXPECT_EQ(CategoryRecognizer(cats).RecognizeCategory("随便"), 3);
+
+    // 同一别名出现在多个分类时以最后出现者为准，与同名分类一致
+    cats.push_back({4, "外卖", ""});
+    EXPECT_EQ(CategoryRecognizer(cats).RecognizeCategory("外卖"), 4);
+}
+
+// 由关键词碎片与填充字拼出的长备注，覆盖 SIMD 整块、块边界与尾部
+static std::vector<std::string> LongMixedNotes(const std::vector<std::string>& pieces, int count) {
+    std::mt19937 rng(11);
+    std::vector<std::string> notes;
+    for (int n = 0; n < count; ++n) {
+        std::string note;
+        const std::size_t target = rng() % 320;
+        while (note.size() < target) note += pieces[rng() % pieces.size()];
+        notes.push_back(note);
+    }
+    return notes;
+}
+
+TEST(CategoryRecognizerTests, LongNotesMatchBruteForceReference) {
+    std::vector<Category> cats = DefaultCats();
+    cats.push_back({6, "x", ""});
+    cats.push_back({7, "电影票", ""});
+    const CategoryRecognizer by_order(cats);
+    const CategoryRecognizer first(cats, MatchPolicy::kFirstOccurrence);
+    const auto notes = LongMixedNotes({"今天", "在", "餐", "饮", "水电", "费", "工资", "电影", "票", "x", "y", " "}, 400);
+    for (const auto& note : notes) {
+        const Category* smallest = nullptr;
+        const Category* leftmost = nullptr;
+        std::size_t leftmost_at = std::string::npos;
+        for (const auto& c : cats) {
+            const std::size_t at = note.find(c.name);
+            if (at == std::string::npos) continue;
+            if (smallest == nullptr || c.name < smallest->name) smallest = &c;
+            if (at < leftmost_at || (at == leftmost_at && c.name.size() > leftmost->name.size())) {
+                leftmost = &c;
+                leftmost_at = at;
+            }
+        }
+        EXPECT_EQ(by_order.RecognizeCategory(note), smallest ? smallest->id : 5) << note;
+        EXPECT_EQ(first.RecognizeCategory(note), leftmost ? leftmost->id : 5) << note;
+    }
+}
+
+// ===================== 单元测试：KeywordPrefilter（SIMD 字节对预过滤） =====================
+TEST(KeywordPrefilterTests, EverySimdLevelFindsExactCandidates) {
+    const std::vector<std::string_view> keywords = {"餐饮", "水电费", "工资", "x", "ab"};
+    std::vector<SimdLevel> levels = {SimdLevel::kScalar, ActiveSimdLevel()};
+    if (ActiveSimdLevel() == SimdLevel::kAvx2) levels.push_back(SimdLevel::kSsse3);
+    const auto notes = LongMixedNotes({"今天", "餐", "饮", "水", "电费", "工", "资", "a", "b", "x", " "}, 200);
+    for (SimdLevel level : levels) {
+        const KeywordPrefilter filter(keywords, level);
+        for (const auto& note : notes) {
+            const auto* p = reinterpret_cast<const unsigned char*>(note.data());
+            std::size_t expected = 0;
+            for (std::size_t i = 0; i <= note.size(); i = expected + 1) {
+                expected = note.size();
+                for (std::size_t at = i; at < note.size() && expected == note.size(); ++at) {
+                    for (std::string_view k : keywords) {
+                        if (note[at] == k[0] && (k.size() == 1 || (at + 1 < note.size() && note[at + 1] == k[1]))) {
+                            expected = at;
+                            break;
+                        }
+                    }
+                }
+                ASSERT_EQ(filter.Next(p, i, note.size()), expected) << note << " from " << i;
+            }
+        }
+    }
+}
+
+TEST(KeywordPrefilterTests, ManyDistinctPairsFallBackToScalar) {
+    std::vector<std::string> names;
+    for (int i = 0; i < 100; ++i) names.push_back(std::string(1, static_cast<char>('A' + i % 26)) + static_cast<char>('0' + i / 26));
+    const std::vector<std::string_view> keywords(names.begin(), names.end());
+    EXPECT_EQ(KeywordPrefilter(keywords, ActiveSimdLevel()).level(), SimdLevel::kScalar);
+    EXPECT_EQ(KeywordPrefilter({"餐饮"}, ActiveSimdLevel()).level(), ActiveSimdLevel());
+}
+
+// ===================== 单元测试：MatchPolicy（多关键词命中的确定性选择） =====================
+static std::vector<Category> PolicyCats() {
+    return {
+        {1, "餐饮", "", 1},
+        {2, "娱乐", "", 5},
+        {3, "餐饮娱乐城", "", 0},
+        {4, "其他", "", 0},
+    };
+}
+
+TEST(MatchPolicyTests, ByteOrderIsDefaultAndUnchanged) {
+    CategoryRecognizer cr(PolicyCats());
+    EXPECT_EQ(cr.policy(), MatchPolicy::kByteOrder);
+    // “娱乐”(E5A8..) 的字节序小于“餐饮”(E9A4..)
+    EXPECT_EQ(cr.RecognizeCategory("餐饮+娱乐"), 2);
+}
+
+TEST(MatchPolicyTests, FirstOccurrencePrefersLeftmostThenLongest) {
+    CategoryRecognizer cr(PolicyCats(), MatchPolicy::kFirstOccurrence);
+    EXPECT_EQ(cr.RecognizeCategory("餐饮+娱乐"), 1);
+    EXPECT_EQ(cr.RecognizeCategory("娱乐+餐饮"), 2);
+    EXPECT_EQ(cr.RecognizeCategory("去餐饮娱乐城吃饭"), 3);  // 同起点取更长者
+    EXPECT_EQ(cr.RecognizeCategory("娱乐 餐饮娱乐城"), 2);
+    EXPECT_EQ(cr.RecognizeCategory("买书"), 4);
+}
+
+TEST(MatchPolicyTests, LongestKeywordWins) {
+    CategoryRecognizer cr(PolicyCats(), MatchPolicy::kLongestKeyword);
+    EXPECT_EQ(cr.RecognizeCategory("娱乐 餐饮娱乐城"), 3);
+    EXPECT_EQ(cr.RecognizeCategory("餐饮+娱乐"), 1);  // 等长取先出现者
+    EXPECT_EQ(cr.RecognizeCategory("娱乐+餐饮"), 2);
+}
+
+TEST(MatchPolicyTests, PriorityWinsRegardlessOfPosition) {
+    CategoryRecognizer cr(PolicyCats(), MatchPolicy::kPriority);
+    EXPECT_EQ(cr.RecognizeCategory("餐饮+娱乐"), 2);
+    EXPECT_EQ(cr.RecognizeCategory("餐饮娱乐城"), 2);  // 内含的“娱乐”优先级最高
+    EXPECT_EQ(cr.RecognizeCategory("餐饮 午饭"), 1);
+    EXPECT_EQ(cr.RecognizeCategory(""), 4);
+}
+
+TEST(MatchPolicyTests, PoliciesAgreeWhenOnlyOneKeywordMatches) {
+    for (MatchPolicy policy : {MatchPolicy::kByteOrder, MatchPolicy::kFirstOccurrence,
+                               MatchPolicy::kLongestKeyword, MatchPolicy::kPriority}) {
+        CategoryRecognizer cr(DefaultCats(), policy);
+        EXPECT_EQ(cr.RecognizeCategory("水电费 1月账单"), 3);
+        EXPECT_EQ(cr.RecognizeCategory("买书"), 5);
+    }
+}
+
+// ===================== 单元测试：识别器二进制快照 =====================
+static std::vector<Category> SnapshotCats(std::size_t extra) {
+    std::vector<Category> cats = PolicyCats();
+    for (const auto& c : DefaultCats()) cats.push_back({c.id + 10, c.name, "", static_cast<int>(c.id)});
+    for (std::size_t i = 0; i < extra; ++i) cats.push_back({static_cast<int>(100 + i), std::to_string(i) + "号", ""});
+    return cats;
+}
+
+TEST(RecognizerSnapshotTests, LoadedCopyMatchesBuiltRecognizerForEveryPolicy) {
+    // extra = 100 时字节对超过 SIMD 粗筛上限，覆盖预过滤的标量路径
+    for (std::size_t extra : {std::size_t{0}, std::size_t{100}}) {
+        const auto cats = SnapshotCats(extra);
+        const auto notes = LongMixedNotes({"今天", "餐饮", "娱乐城", "水电", "费", "工资", "1", "7号", "x", " "}, 200);
+        for (MatchPolicy policy : {MatchPolicy::kByteOrder, MatchPolicy::kFirstOccurrence,
+                                   MatchPolicy::kLongestKeyword, MatchPolicy::kPriority}) {
+            const CategoryRecognizer built(cats, policy);
+            const std::string saved = SaveRecognizerSnapshot(built);
+            const std::string moved = saved;  // 换一个地址加载：快照内没有指针
+            std::string error;
+            const auto loaded = LoadRecognizerSnapshot(moved, &error);
+            ASSERT_NE(loaded, nullptr) << error;
+            EXPECT_EQ(loaded->policy(), policy);
+            const CategoryRecognizer copy = *loaded;  // 拷贝共享同一块快照内存
+            for (const auto& note : notes) {
+                ASSERT_EQ(loaded->RecognizeCategory(note), built.RecognizeCategory(note)) << note;
+                ASSERT_EQ(copy.RecognizeCategory(note), built.RecognizeCategory(note)) << note;
+            }
+            EXPECT_EQ(SaveRecognizerSnapshot(*loaded), saved);
+        }
+    }
+    const std::string empty_blob = SaveRecognizerSnapshot(CategoryRecognizer(std::vector<Category>()));
+    const auto empty = LoadRecognizerSnapshot(empty_blob);
+    ASSERT_NE(empty, nullptr);
+    EXPECT_EQ(empty->RecognizeCategory("任何备注"), 0);
+}
+
+TEST(RecognizerSnapshotTests, TemporaryBlobIsOwnedByLoadedRecognizer) {
+    const CategoryRecognizer built(DefaultCats());
+    std::shared_ptr<const CategoryRecognizer> loaded;
+    {
+        std::string blob = SaveRecognizerSnapshot(built);
+        loaded = LoadRecognizerSnapshot(std::move(blob));
+        blob.assign(blob.capacity(), '\xff');  // 若仍借用原缓冲区，这里会把它写坏
+    }
+    ASSERT_NE(loaded, nullptr);
+    const CategoryRecognizer copy = *loaded;
+    loaded.reset();  // 拷贝同样持有 blob
+    EXPECT_EQ(copy.RecognizeCategory("中午吃饭 餐饮"), 1);
+    EXPECT_EQ(copy.RecognizeCategory("没有关键词"), 5);
+}
+
+TEST(RecognizerSnapshotTests, MappedSnapshotSurvivesFileReplacement) {
+    const auto path = (std::filesystem::temp_directory_path() / "account_book_recognizer.snap").string();
+    std::string error;
+    ASSERT_TRUE(SaveRecognizerSnapshot(CategoryRecognizer(DefaultCats()), path, &error)) << error;
+    const auto old_version = MapRecognizerSnapshot(path, &error);
+    ASSERT_NE(old_version, nullptr) << error;
+    EXPECT_EQ(old_version->RecognizeCategory("水电费 1月账单"), 3);
+
+    std::vector<Category> cats = DefaultCats();
+    cats.push_back({9, "电费", ""});
+    ASSERT_TRUE(SaveRecognizerSnapshot(CategoryRecognizer(cats, MatchPolicy::kLongestKeyword), path, &error));
+    const auto new_version = MapRecognizerSnapshot(path, &error, SnapshotCheck::kLayout);
+    ASSERT_NE(new_version, nullptr) << error;
+    EXPECT_EQ(new_version->RecognizeCategory("电费"), 9);
+    EXPECT_EQ(old_version->RecognizeCategory("水电费 1月账单"), 3);  // 旧映射仍指向被替换前的文件
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(MapRecognizerSnapshot(path, &error), nullptr);
+    EXPECT_FALSE(error.empty());
+}
+
+TEST(RecognizerSnapshotTests, ConcurrentSaversToSamePathLeaveOneCompleteSnapshot) {
+    const auto dir = std::filesystem::temp_directory_path() / "account_book_concurrent_snap";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::string path = (dir / "recognizer.snap").string();
+    std::vector<std::thread> savers;
+    std::atomic<int> failures{0};
+    for (int t = 0; t < 4; ++t) {
+        savers.emplace_back([&, t] {
+            std::vector<Category> cats = DefaultCats();
+            for (int i = 0; i < 50 * (t + 1); ++i) cats.push_back({100 + i, "商户" + std::to_string(i) + "号", ""});
+            const CategoryRecognizer cr(cats);
+            for (int round = 0; round < 20; ++round) {
+                if (!SaveRecognizerSnapshot(cr, path, nullptr)) failures.fetch_add(1);
+            }
+        });
+    }
+    for (auto& t : savers) t.join();
+    EXPECT_EQ(failures.load(), 0);
+    std::string error;
+    const auto loaded = MapRecognizerSnapshot(path, &error);
+    ASSERT_NE(loaded, nullptr) << error;
+    EXPECT_EQ(loaded->RecognizeCategory("商户7号"), 107);
+    std::size_t files = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        ++files;
+        EXPECT_EQ(entry.path().filename(), "recognizer.snap");  // 临时文件均已改名或删除
+    }
+    EXPECT_EQ(files, 1u);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(RecognizerSnapshotTests, RejectsCorruptTruncatedAndForeignBlobs) {
+    const std::string good = SaveRecognizerSnapshot(CategoryRecognizer(DefaultCats()));
+    std::string error;
+    auto expect_rejected = [&error](const std::string& blob, SnapshotCheck check, const char* reason) {
+        error.clear();
+        EXPECT_EQ(LoadRecognizerSnapshot(blob, &error, check), nullptr) << reason;
+        EXPECT_FALSE(error.empty()) << reason;
+    };
+    expect_rejected("", SnapshotCheck::kLayout, "empty");
+    expect_rejected(good.substr(0, good.size() - 64), SnapshotCheck::kLayout, "truncated");
+    expect_rejected(std::string(good.size(), 'x'), SnapshotCheck::kLayout, "foreign");
+
+    std::string wrong_version = good;
+    wrong_version[8] = static_cast<char>(kRecognizerSnapshotVersion + 1);
+    expect_rejected(wrong_version, SnapshotCheck::kLayout, "version");
+
+    std::string flipped = good;
+    flipped[flipped.size() / 2] ^= 1;
+    expect_rejected(flipped, SnapshotCheck::kFull, "checksum");
+
+    // 头部字段（回退 id、策略）同样在校验和覆盖范围内
+    namespace d = recognizer_snapshot_detail;
+    std::string header_flipped = good;
+    header_flipped[offsetof(d::Header, fallback_id)] ^= 1;
+    expect_rejected(header_flipped, SnapshotCheck::kFull, "header checksum");
+    header_flipped = good;
+    header_flipped[offsetof(d::Header, policy)] ^= 1;
+    expect_rejected(header_flipped, SnapshotCheck::kFull, "header checksum");
+
+    // 转移表写入越界状态并重算校验和：仍须被逐项范围检查拒绝
+    d::Header h;
+    std::memcpy(&h, good.data(), sizeof(h));
+    const d::Layout l = d::ComputeLayout(h.num_states, static_cast<uint64_t>(h.num_classes), h.num_keywords);
+    std::string corrupt = good;
+    const int32_t bad_state = static_cast<int32_t>(h.num_states);
+    std::memcpy(&corrupt[static_cast<std::size_t>(l.next)], &bad_state, sizeof(bad_state));
+    h.checksum = d::Checksum(corrupt.data(), corrupt.size());
+    std::memcpy(&corrupt[0], &h, sizeof(h));
+    expect_rejected(corrupt, SnapshotCheck::kFull, "out-of-range transition");
+
+    // 改小 max_len 并重算校验和：与关键词表不符，须被拒绝
+    std::memcpy(&h, good.data(), sizeof(h));
+    corrupt = good;
+    h.max_len -= 1;
+    std::memcpy(&corrupt[0], &h, sizeof(h));
+    h.checksum = d::Checksum(corrupt.data(), corrupt.size());
+    std::memcpy(&corrupt[0], &h, sizeof(h));
+    expect_rejected(corrupt, SnapshotCheck::kFull, "max_len disagrees with keywords");
+    EXPECT_NE(LoadRecognizerSnapshot(good, &error), nullptr) << error;
+}
+
+// ===================== 单元测试：LiveCategoryRecognizer（运行时增量更新） =====================
+TEST(LiveCategoryRecognizerTests, AddRemoveRenamePublishNewVersions) {
+    LiveCategoryRecognizer live(DefaultCats());
+    const uint64_t v0 = live.version();
+    EXPECT_EQ(live.RecognizeCategory("美团外卖"), 5);
+
+    EXPECT_TRUE(live.AddCategory({6, "外卖", ""}));
+    EXPECT_EQ(live.RecognizeCategory("美团外卖"), 6);
+    EXPECT_FALSE(live.AddCategory({6, "重复", ""}));
+
+    EXPECT_TRUE(live.RenameCategory(6, "美团"));
+    EXPECT_EQ(live.RecognizeCategory("美团外卖"), 6);
+    EXPECT_EQ(live.RecognizeCategory("饿了么外卖"), 5);
+
+    EXPECT_TRUE(live.RemoveCategory(5));
+    EXPECT_EQ(live.RecognizeCategory("买书"), 1);  // 无“其他”时回退第一个
+    EXPECT_FALSE(live.RemoveCategory(42));
+    EXPECT_FALSE(live.RenameCategory(42, "x"));
+    EXPECT_EQ(live.version(), v0 + 3);
+}
+
+TEST(LiveCategoryRecognizerTests, SetKeywordsPublishesAliases) {
+    LiveCategoryRecognizer live(DefaultCats());
+    const uint64_t v0 = live.version();
+    EXPECT_EQ(live.RecognizeCategory("美团外卖"), 5);
+    EXPECT_TRUE(live.SetKeywords(1, {"美团", "外卖"}));
+    EXPECT_EQ(live.RecognizeCategory("美团外卖"), 1);
+    EXPECT_FALSE(live.SetKeywords(1, {"美团", "外卖"}));  // 没有变化
+    EXPECT_FALSE(live.SetKeywords(42, {"x"}));
+    EXPECT_EQ(live.version(), v0 + 1);
+}
+
+TEST(LiveCategoryRecognizerTests, OldSnapshotStaysValidAfterUpdate) {
+    LiveCategoryRecognizer live(DefaultCats());
+    auto before = live.Snapshot();
+    live.RenameCategory(1, "吃饭");
+    EXPECT_EQ(before->recognizer.RecognizeCategory("餐饮 午饭"), 1);
+    EXPECT_EQ(live.RecognizeCategory("餐饮 午饭"), 5);
+    EXPECT_EQ(live.RecognizeCategory("吃饭"), 1);
+}
+
+TEST(LiveCategoryRecognizerTests, BatchedUpdateCompilesOnce) {
+    LiveCategoryRecognizer live(DefaultCats());
+    const uint64_t v0 = live.version();
+    live.Update([](std::vector<Category>& cats) {
+        for (int i = 0; i < 100; ++i) cats.push_back({100 + i, "商户" + std::to_string(i) + "号", ""});
+        return true;
+    });
+    EXPECT_EQ(live.version(), v0 + 1);
+    EXPECT_EQ(live.RecognizeCategory("商户42号"), 142);
+    EXPECT_FALSE(live.Update([](std::vector<Category>&) { return false; }));
+    EXPECT_EQ(live.version(), v0 + 1);
+}
+
+TEST(LiveCategoryRecognizerTests, ConcurrentReadersSeeCompleteVersions) {
+    LiveCategoryRecognizer live(DefaultCats());
+    std::atomic<bool> stop{false};
+    std::atomic<int> bad{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            while (!stop.load()) {
+                // 每个版本里 id 7 要么不存在，要么名为“外卖”——不会出现其他结果
+                const int id = live.RecognizeCategory("美团外卖");
+                if (id != 5 && id != 7) bad.fetch_add(1);
+            }
+        });
+    }
+    for (int i = 0; i < 200; ++i) {
+        live.AddCategory({7, "外卖", ""});
+        live.RemoveCategory(7);
+    }
+    stop.store(true);
+    for (auto& r : readers) r.join();
+    EXPECT_EQ(bad.load(), 0);
+}
+
+// 叠加层与用当前分类表整体重建的识别器逐条比较
+static void ExpectMatchesRebuild(const LiveCategoryRecognizer& live, MatchPolicy policy,
+                                 const std::vector<std::string>& notes) {
+    const auto snapshot = live.Snapshot();
+    const std::vector<Category> cats = snapshot->categories();
+    ASSERT_EQ(snapshot->size(), cats.size());
+    const CategoryRecognizer rebuilt(cats, policy);
+    for (const std::string& note : notes) {
+        ASSERT_EQ(snapshot->recognizer.RecognizeCategory(note), rebuilt.RecognizeCategory(note))
+            << "policy " << static_cast<int>(policy) << " note " << note;
+    }
+    for (const Category& c : cats) EXPECT_EQ(snapshot->Find(c.id)->name, live.Snapshot()->Name(c.id));
+}
+
+TEST(LiveCategoryRecognizerTests, EditsApplyWithoutRebuildingBase) {
+    auto cats = DefaultCats();
+    for (int i = 0; i < 200; ++i) cats.push_back({100 + i, "商户" + std::to_string(i) + "号", ""});
+    LiveCategoryRecognizer live(cats);
+    const auto base = live.Snapshot();
+    EXPECT_EQ(base->pending_edits(), 0u);
+
+    ASSERT_TRUE(live.RenameCategory(1, "吃饭"));
+    ASSERT_TRUE(live.AddCategory({7, "外卖", ""}));
+    const auto edited = live.Snapshot();
+    EXPECT_GT(edited->pending_edits(), 0u);
+    EXPECT_TRUE(edited->recognizer.layered());
+    EXPECT_EQ(edited->Name(1), "吃饭");
+    EXPECT_EQ(edited->Find(7)->name, "外卖");
+    EXPECT_EQ(edited->size(), cats.size() + 1);
+    EXPECT_EQ(live.RecognizeCategory("吃饭 外卖"), 1);
+    EXPECT_EQ(live.RecognizeCategory("餐饮"), 5);
+    EXPECT_EQ(live.RecognizeCategory("商户42号"), 142);
+    EXPECT_EQ(SaveRecognizerSnapshot(edited->recognizer), "");
+
+    ASSERT_TRUE(live.RemoveCategory(5));  // 回退改为第一个分类
+    EXPECT_EQ(live.RecognizeCategory("买书"), 1);
+
+    const uint64_t before = live.version();
+    EXPECT_TRUE(live.Compact());
+    EXPECT_EQ(live.version(), before + 1);
+    EXPECT_EQ(live.Snapshot()->pending_edits(), 0u);
+    EXPECT_FALSE(live.Snapshot()->recognizer.layered());
+    EXPECT_FALSE(live.Compact());
+    EXPECT_EQ(live.RecognizeCategory("吃饭 外卖"), 1);
+    EXPECT_EQ(live.RecognizeCategory("买书"), 1);
+}
+
+TEST(LiveCategoryRecognizerTests, SharedKeywordsResolveLikeFullRebuild) {
+    // 同一关键词在多个分类里时以最后出现者为准；改动其中一个不能丢掉另一个的归属
+    std::vector<Category> cats = {
+        {1, "餐饮", "", 0, {"外卖", "午饭"}},
+        {2, "外卖", "", 0, {}},
+        {3, "娱乐", "", 0, {"午饭"}},
+        {4, "其他", "", 0, {}},
+    };
+    const std::vector<std::string> notes = {"外卖", "午饭", "餐饮外卖", "娱乐", "午饭外卖", "无关", "吃饭"};
+    for (MatchPolicy policy : {MatchPolicy::kByteOrder, MatchPolicy::kFirstOccurrence, MatchPolicy::kLongestKeyword,
+                               MatchPolicy::kPriority}) {
+        LiveCategoryRecognizer live(cats, policy);
+        ASSERT_TRUE(live.RemoveCategory(3));
+        ExpectMatchesRebuild(live, policy, notes);
+        EXPECT_EQ(live.RecognizeCategory("午饭"), 1);
+        ASSERT_TRUE(live.SetKeywords(1, {"吃饭"}));
+        ExpectMatchesRebuild(live, policy, notes);
+        EXPECT_EQ(live.RecognizeCategory("外卖"), 2);
+        ASSERT_TRUE(live.AddCategory({5, "购物", "", 0, {"吃饭"}}));
+        ExpectMatchesRebuild(live, policy, notes);
+        EXPECT_EQ(live.RecognizeCategory("吃饭"), 5);
+        ASSERT_TRUE(live.RenameCategory(4, "杂项"));
+        ExpectMatchesRebuild(live, policy, notes);
+        EXPECT_EQ(live.RecognizeCategory("无关"), 1);
+    }
+}
+
+TEST(LiveCategoryRecognizerTests, RandomEditsMatchFullRebuildForEveryPolicy) {
+    static const char* const kChars[] = {"餐", "饮", "外", "卖", "娱", "乐", "水", "电", "费", "其", "他"};
+    std::mt19937 rng(7);
+    auto word = [&](int max_len) {
+        std::string w;
+        for (int n = 1 + static_cast<int>(rng() % max_len); n > 0; --n) w += kChars[rng() % std::size(kChars)];
+        return w;
+    };
+    std::vector<std::string> notes;
+    for (int i = 0; i < 300; ++i) notes.push_back(word(8));
+    notes.push_back("");
+
+    for (MatchPolicy policy : {MatchPolicy::kByteOrder, MatchPolicy::kFirstOccurrence, MatchPolicy::kLongestKeyword,
+                               MatchPolicy::kPriority}) {
+        std::vector<Category> cats;
+        for (int i = 0; i < 40; ++i) {
+            cats.push_back({i, word(3), "", static_cast<int>(rng() % 4), {word(3)}});
+        }
+        cats.push_back({40, "其他", "其他"});
+        cats.push_back({3, "重复id", ""});
+        LiveCategoryRecognizer live(cats, policy);
+        for (int step = 0; step < 120; ++step) {
+            const int id = static_cast<int>(rng() % 50);
+            switch (rng() % 4) {
+                case 0: live.AddCategory({id, word(3), "", static_cast<int>(rng() % 4), {word(2)}}); break;
+                case 1: live.RemoveCategory(id); break;
+                case 2: live.RenameCategory(id, rng() % 8 == 0 ? "其他" : word(3)); break;
+                default: live.SetKeywords(id, {word(2), word(3)}); break;
+            }
+            if (step % 10 == 0) ExpectMatchesRebuild(live, policy, notes);
+        }
+        ExpectMatchesRebuild(live, policy, notes);
+    }
+}
+
+TEST(LiveCategoryRecognizerTests, OverlayRejectsSnapshotOrLayeredBase) {
+    const CategoryRecognizer base(DefaultCats());
+    auto overlay = std::make_shared<const CategoryOverlay>(
+        CategoryOverlay{{2}, CategoryRecognizer(std::vector<Category>{{2, "外卖", ""}}), 5, MetricCounter::kFallbackOther});
+    const CategoryRecognizer layered(base, overlay);  // 分类 2 改名为“外卖”
+    EXPECT_EQ(layered.RecognizeCategory("美团外卖"), 2);
+    EXPECT_EQ(layered.RecognizeCategory("娱乐"), 5);
+    EXPECT_THROW(CategoryRecognizer(layered, overlay), std::invalid_argument);
+
+    const auto loaded = LoadRecognizerSnapshot(SaveRecognizerSnapshot(base));
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_THROW(CategoryRecognizer(*loaded, overlay), std::invalid_argument);
+    EXPECT_THROW(CategoryRecognizer(base, nullptr), std::invalid_argument);
+}
+
+// ===================== 单元测试：RecognizerCache（按分类集合缓存） =====================
+TEST(RecognizerCacheTests, FingerprintCoversIdsNamesAndPolicy) {
+    auto cats = DefaultCats();
+    const uint64_t base = CategoryFingerprint(cats);
+    EXPECT_EQ(base, CategoryFingerprint(DefaultCats()));
+    EXPECT_NE(base, CategoryFingerprint(cats, MatchPolicy::kLongestKeyword));
+    cats[0].name = "吃饭";
+    EXPECT_NE(base, CategoryFingerprint(cats));
+    cats = DefaultCats();
+    cats[0].id = 99;
+    EXPECT_NE(base, CategoryFingerprint(cats));
+    std::vector<Category> a = {{1, "ab", ""}, {2, "c", ""}};
+    std::vector<Category> b = {{1, "a", ""}, {2, "bc", ""}};
+    EXPECT_NE(CategoryFingerprint(a), CategoryFingerprint(b));
+    cats = DefaultCats();
+    cats[0].keywords = {"外卖"};
+    EXPECT_NE(base, CategoryFingerprint(cats));
+    cats[0].keywords = {"外", "卖"};
+    EXPECT_NE(CategoryFingerprint(cats), CategoryFingerprint({{1, "餐饮", "", 0, {"外卖"}}}));
+}
+
+TEST(RecognizerCacheTests, RepeatTenantHitsCache) {
+    RecognizerCache cache(8, 2);
+    auto first = cache.Get(DefaultCats());
+    auto second = cache.Get(DefaultCats());
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_EQ(second->RecognizeCategory("工资 发放"), 4);
+    auto stats = cache.Stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.size, 1u);
+    EXPECT_DOUBLE_EQ(stats.HitRate(), 0.5);
+}
+
+TEST(RecognizerCacheTests, LeastRecentlyUsedIsEvicted) {
+    RecognizerCache cache(2, 1);
+    auto tenant = [](int i) { return std::vector<Category>{{i, "租户" + std::to_string(i), ""}}; };
+    auto kept = cache.Get(tenant(1));
+    cache.Get(tenant(2));
+    cache.Get(tenant(1));  // 1 变为最近使用
+    cache.Get(tenant(3));  // 淘汰 2
+    auto stats = cache.Stats();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.size, 2u);
+    cache.Get(tenant(1));
+    EXPECT_EQ(cache.Stats().hits, 2u);
+    cache.Get(tenant(2));
+    EXPECT_EQ(cache.Stats().misses, 4u);
+    // 被淘汰条目的识别器仍可继续使用
+    cache.Clear();
+    EXPECT_EQ(kept->RecognizeCategory("租户1"), 1);
+}
+
+// ===================== 单元测试：NoteMemoCache（备注级记忆化） =====================
+TEST(NoteMemoCacheTests, RepeatedNotesHitAndMatchRecognizer) {
+    const CategoryRecognizer cr(DefaultCats());
+    NoteMemoCache memo(64);
+    const std::vector<std::string> notes = {"美团外卖 午饭 餐饮", "国家电网 水电费", "看电影 娱乐", "随便"};
+    for (int round = 0; round < 4; ++round) {
+        for (const auto& note : notes) {
+            EXPECT_EQ(memo.Recognize(cr, note), cr.RecognizeCategory(note));
+        }
+    }
+    const auto stats = memo.Stats();
+    EXPECT_EQ(stats.misses, notes.size());
+    EXPECT_EQ(stats.hits, 3 * notes.size());
+    EXPECT_DOUBLE_EQ(stats.HitRate(), 0.75);
+}
+
+TEST(NoteMemoCacheTests, CategoryChangeInvalidatesEntries) {
+    LiveCategoryRecognizer live(DefaultCats());
+    NoteMemoCache memo(64);
+    EXPECT_EQ(memo.Recognize(live, "午饭 吃饭"), 5);
+    EXPECT_EQ(memo.Recognize(live, "午饭 吃饭"), 5);
+    live.RenameCategory(1, "吃饭");
+    EXPECT_EQ(memo.Recognize(live, "午饭 吃饭"), 1);
+    const auto stats = memo.Stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+}
+
+TEST(NoteMemoCacheTests, SwappedRecognizerNeedsNoVersionBump) {
+    std::vector<Category> cats = DefaultCats();
+    const CategoryRecognizer before(cats);
+    cats[0].keywords = {"午饭"};
+    const CategoryRecognizer after(cats);
+    NoteMemoCache memo(64);
+    EXPECT_EQ(memo.Recognize(before, "午饭"), 5);
+    EXPECT_EQ(memo.Recognize(after, "午饭"), 1);  // 分类集合变了，指纹不同，不会读到旧结果
+    EXPECT_EQ(memo.Recognize(before, "午饭"), 5);
+
+    const CategoryRecognizer copy = after;
+    const CategoryRecognizer rebuilt(cats);
+    EXPECT_EQ(copy.fingerprint(), after.fingerprint());
+    EXPECT_EQ(rebuilt.fingerprint(), after.fingerprint());
+    EXPECT_EQ(memo.Recognize(rebuilt, "午饭"), 1);
+    EXPECT_EQ(memo.Stats().hits, 2u);  // 第二次 before 与 rebuilt 命中
+
+    EXPECT_NE(CategoryRecognizer(cats, MatchPolicy::kLongestKeyword).fingerprint(), after.fingerprint());
+    cats[0].priority = 7;
+    EXPECT_NE(CategoryRecognizer(cats).fingerprint(), after.fingerprint());
+    cats.pop_back();  // 去掉“其他”，回退 id 随之变化
+    cats[0].priority = 0;
+    EXPECT_NE(CategoryRecognizer(cats).fingerprint(), after.fingerprint());
+
+    const std::string blob = SaveRecognizerSnapshot(after);
+    const auto loaded = LoadRecognizerSnapshot(blob);
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_EQ(LoadRecognizerSnapshot(blob)->fingerprint(), loaded->fingerprint());
+    EXPECT_NE(LoadRecognizerSnapshot(SaveRecognizerSnapshot(before))->fingerprint(), loaded->fingerprint());
+    EXPECT_EQ(memo.Recognize(*loaded, "午饭"), 1);
+}
+
+TEST(NoteMemoCacheTests, BoundedCapacityStaysCorrectUnderContention) {
+    const auto cats = DefaultCats();
+    const CategoryRecognizer cr(cats);
+    NoteMemoCache memo(8);
+    EXPECT_EQ(memo.capacity(), 8u);
+    std::vector<std::string> notes;
+    for (int i = 0; i < 200; ++i) {
+        notes.push_back("商户" + std::to_string(i) + (i % 3 == 0 ? " 工资" : i % 3 == 1 ? " 娱乐" : ""));
+    }
+    std::atomic<int> bad{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&] {
+            for (int round = 0; round < 50; ++round) {
+                for (const auto& note : notes) {
+                    if (memo.Recognize(cr, note) != cr.RecognizeCategory(note)) bad.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    EXPECT_EQ(bad.load(), 0);
+    const auto stats = memo.Stats();
+    EXPECT_EQ(stats.hits + stats.misses, 4u * 50u * notes.size());
+}
+
+// ===================== 单元测试：热路径指标 =====================
+static uint64_t CounterDelta(const MetricsSnapshot& before, const MetricsSnapshot& after, MetricCounter c) {
+    return after.counter(c) - before.counter(c);
+}
+
+TEST(MetricsTests, CountsOutcomesAndDateAutofills) {
+    const CategoryRecognizer with_other(DefaultCats());
+    const CategoryRecognizer without_other({{7, "餐饮", ""}, {8, "娱乐", ""}});
+    const CategoryRecognizer empty(std::vector<Category>{});
+    const MetricsSnapshot before = TakeMetricsSnapshot();
+
+    ProcessedTransaction out;
+    const PackedDate today = GetCurrentPackedDate();
+    ProcessTransactionInto(with_other, "餐饮 午饭", "", today, out);
+    ProcessTransactionInto(with_other, "买书", "2026-01-01", today, out);
+    ProcessTransactionInto(without_other, "买书", "", today, out);
+    ProcessTransactionInto(empty, "餐饮", "2026-01-01", today, out);
+
+    const MetricsSnapshot after = TakeMetricsSnapshot();
+    EXPECT_EQ(CounterDelta(before, after, MetricCounter::kTransactions), 4u);
+    EXPECT_EQ(CounterDelta(before, after, MetricCounter::kKeywordHits), 1u);
+    EXPECT_EQ(CounterDelta(before, after, MetricCounter::kFallbackOther), 1u);
+    EXPECT_EQ(CounterDelta(before, after, MetricCounter::kFallbackFirst), 1u);
+    EXPECT_EQ(CounterDelta(before, after, MetricCounter::kNoCategories), 1u);
+    EXPECT_EQ(CounterDelta(before, after, MetricCounter::kDateAutofills), 2u);
+    EXPECT_EQ(after.histogram(MetricHistogram::kClassify).count() -
+                  before.histogram(MetricHistogram::kClassify).count(),
+              4u);
+    EXPECT_GE(after.histogram(MetricHistogram::kRecognizerBuild).count(), 3u);
+
+    // 快照加载后的识别器保留回退类别
+    const auto loaded = LoadRecognizerSnapshot(SaveRecognizerSnapshot(without_other));
+    ASSERT_NE(loaded, nullptr);
+    loaded->RecognizeCategory("买书");
+    EXPECT_EQ(CounterDelta(after, TakeMetricsSnapshot(), MetricCounter::kFallbackFirst), 1u);
+}
+
+TEST(MetricsTests, HistogramQuantilesWithinBucketPrecision) {
+    LatencyHistogram h;
+    EXPECT_EQ(h.Quantile(0.5), 0u);
+    for (uint64_t v = 1; v <= 100000; ++v) h.Record(v);
+    EXPECT_EQ(h.count(), 100000u);
+    EXPECT_EQ(h.sum(), 100000ull * 100001ull / 2);
+    for (double q : {0.5, 0.9, 0.99, 0.999}) {
+        const double exact = q * 100000;
+        const double got = static_cast<double>(h.Quantile(q));
+        EXPECT_GE(got, exact) << q;
+        EXPECT_LE(got, exact * (1.0 + 1.0 / 16)) << q;
+    }
+    EXPECT_EQ(h.Quantile(1.0), LatencyHistogram::BucketLowerBound(LatencyHistogram::BucketIndex(100000) + 1) - 1);
+    // 相邻桶首尾相接，值域上限之外的值落入最后一桶
+    for (std::size_t i = 0; i + 1 < LatencyHistogram::kBuckets; ++i) {
+        ASSERT_EQ(LatencyHistogram::BucketIndex(LatencyHistogram::BucketLowerBound(i)), i);
+        ASSERT_EQ(LatencyHistogram::BucketIndex(LatencyHistogram::BucketLowerBound(i + 1) - 1), i);
+    }
+    EXPECT_EQ(LatencyHistogram::BucketIndex(UINT64_MAX), LatencyHistogram::kBuckets - 1);
+}
+
+TEST(MetricsTests, ExitedThreadsAreKeptAndPrometheusTextIsCumulative) {
+    const MetricsSnapshot before = TakeMetricsSnapshot();
+    std::thread worker([] {
+        for (int i = 0; i < 10; ++i) CountMetric(MetricCounter::kTransactions);
+        RecordLatency(MetricHistogram::kClassify, 1500);
+    });
+    worker.join();
+    const MetricsSnapshot after = TakeMetricsSnapshot();
+    EXPECT_EQ(CounterDelta(before, after, MetricCounter::kTransactions), 10u);
+
+    const std::string text = FormatPrometheus(after);
+    EXPECT_NE(text.find("# TYPE account_book_transactions_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("account_book_transactions_total " +
+                        std::to_string(after.counter(MetricCounter::kTransactions)) + "\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("account_book_classifications_total{result=\"fallback_other\"} "), std::string::npos);
+    EXPECT_NE(text.find("# TYPE account_book_classify_seconds histogram\n"), std::string::npos);
+    const uint64_t count = after.histogram(MetricHistogram::kClassify).count();
+    EXPECT_NE(text.find("account_book_classify_seconds_bucket{le=\"+Inf\"} " + std::to_string(count) + "\n"),
+              std::string::npos);
+    // 各 le 桶单调不减
+    uint64_t last = 0;
+    std::size_t at = 0;
+    const std::string prefix = "account_book_classify_seconds_bucket{le=\"";
+    while ((at = text.find(prefix, at)) != std::string::npos) {
+        const std::size_t space = text.find(' ', at);
+        const uint64_t v = std::stoull(text.substr(space + 1));
+        EXPECT_GE(v, last);
+        last = v;
+        at = space;
+    }
+    EXPECT_EQ(last, count);
+}
+
+TEST(MetricsTests, PrometheusBucketBoundsAreInclusive) {
+    LatencyHistogram h;
+    h.Record(2047);
+    h.Record(2048);  // 恰为 2^11 ns：按 le 的“<=”语义不属于 le=2047ns 的桶
+    std::string text;
+    metrics_detail::AppendHistogram(text, "t", "test", h);
+    EXPECT_NE(text.find("t_bucket{le=\"0.000002047\"} 1\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("t_bucket{le=\"0.000004095\"} 2\n"), std::string::npos) << text;
+    EXPECT_EQ(text.find("le=\"0.000002048\""), std::string::npos);
+}
+
+// ===================== 单元测试：ClassificationContext（零分配热路径） =====================
+// 替换全局 operator new 统计本线程的堆分配次数；只在比较前后差值时使用
+static thread_local std::size_t g_thread_allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++g_thread_allocations;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+static std::size_t AllocationsNow() { return g_thread_allocations; }
+
+static const char* const kWarmNotes[] = {"餐饮 午饭", "娱乐 电影票", "水电费 1月账单", "工资 发放", "买书", ""};
+
+TEST(ClassificationContextTests, MatchesPlainProcessTransaction) {
+    ClassificationContext ctx;
+    const std::vector<Category> cats = DefaultCats();
+    const CategoryRecognizer cr(cats);
+    for (const char* note : kWarmNotes) {
+        for (const char* date : {"2024-03-15", "", "2024-02-30"}) {
+            const ProcessedTransaction expected = ProcessTransaction(note, date, cats);
+            const ProcessedTransaction& got = ProcessTransaction(ctx, note, date, cats);
+            EXPECT_EQ(got.note, expected.note);
+            EXPECT_EQ(got.category_id, expected.category_id);
+            EXPECT_EQ(got.date, expected.date);
+            const ProcessedTransaction& prebuilt = ProcessTransaction(ctx, note, date, cr);
+            EXPECT_EQ(prebuilt.note, expected.note);
+            EXPECT_EQ(prebuilt.category_id, expected.category_id);
+            EXPECT_EQ(prebuilt.date, expected.date);
+        }
+    }
+    const ProcessedTransaction& with_amount =
+        ctx.Process(ctx.Recognizer(cats), TransactionInput{"工资 发放", "2024-03-15", "8000.50"});
+    EXPECT_EQ(with_amount.category_id, 4);
+    EXPECT_EQ(with_amount.amount_cents, 800050);
+}
+
+TEST(ClassificationContextTests, RebuildsRecognizerOnlyWhenCategoriesChange) {
+    ClassificationContext ctx;
+    std::vector<Category> cats = DefaultCats();
+    const CategoryRecognizer* first = &ctx.Recognizer(cats);
+    EXPECT_EQ(ProcessTransaction(ctx, "新番 会员", "", cats).category_id, 5);
+
+    cats[1].keywords = {"新番"};
+    EXPECT_EQ(ProcessTransaction(ctx, "新番 会员", "", cats).category_id, 2);
+    cats[1].description = "只改描述不影响识别";
+    EXPECT_EQ(&ctx.Recognizer(cats), first);  // 上下文只保留一个识别器，地址不变
+    EXPECT_EQ(ctx.Recognizer(cats, MatchPolicy::kLongestKeyword).policy(), MatchPolicy::kLongestKeyword);
+}
+
+TEST(ClassificationContextTests, MovedNoteKeepsBuffer) {
+    ClassificationContext ctx;
+    CategoryRecognizer cr(DefaultCats());
+    std::string note = "娱乐 这条备注足够长，不会落进短字符串优化的内联缓冲";
+    const char* buffer = note.data();
+    ProcessedTransaction out = ctx.Process(cr, std::move(note), "2024-03-15", "12.30");
+    EXPECT_EQ(out.note.data(), buffer);
+    EXPECT_EQ(out.category_id, 2);
+    EXPECT_EQ(out.amount_cents, 1230);
+    EXPECT_EQ(out.date, PackedDate::Parse("2024-03-15"));
+}
+
+TEST(ClassificationContextTests, SteadyStateDoesNotAllocate) {
+    std::vector<Category> cats = DefaultCats();
+    cats[1].keywords = {"电影", "游戏"};
+    ClassificationContext ctx(64);
+    std::vector<std::string> owned;
+    for (int i = 0; i < 64; ++i) owned.push_back(std::string(kWarmNotes[i % 6]) + " 这是一条不走短字符串优化的长备注");
+
+    // 预热：构建识别器、取当天日期、创建本线程的指标块
+    for (const char* note : kWarmNotes) ProcessTransaction(ctx, note, "", cats);
+
+    const std::size_t before = AllocationsNow();
+    int checksum = 0;
+    for (int round = 0; round < 1000; ++round) {
+        const char* note = kWarmNotes[round % 6];
+        checksum += ProcessTransaction(ctx, note, round % 2 ? "" : "2024-03-15", cats).category_id;
+        checksum += ctx.Process(ctx.Recognizer(cats), TransactionInput{note, "", "99.99"}).category_id;
+    }
+    for (int i = 0; i < 64; ++i) {
+        ProcessedTransaction out = ctx.Process(ctx.Recognizer(cats), std::move(owned[i]), "");
+        checksum += out.category_id;
+    }
+    EXPECT_EQ(AllocationsNow() - before, 0u);
+    EXPECT_GT(checksum, 0);
+
+    // 对照：不带上下文的入口每次都重建识别器
+    const std::size_t plain_before = AllocationsNow();
+    ProcessTransaction(kWarmNotes[0], "", cats);
+    EXPECT_GT(AllocationsNow() - plain_before, 0u);
+}
+
+// ===================== 单元测试：CategoryRegistry（分类注册表） =====================
+// 线性扫描的参照实现：同 id / 同名取第一个
+static const Category* ScanById(const std::vector<Category>& cats, int id) {
+    for (const auto& c : cats) {
+        if (c.id == id) return &c;
+    }
+    return nullptr;
+}
+
+static const Category* ScanByName(const std::vector<Category>& cats, std::string_view name) {
+    for (const auto& c : cats) {
+        if (c.name == name) return &c;
+    }
+    return nullptr;
+}
+
+TEST(CategoryRegistryTests, MatchesLinearScanForDenseAndSparseIds) {
+    std::mt19937 rng(11);
+    for (int spread : {1, 1000000}) {  // 稠密数组 / 哈希表两种 id 索引
+        std::vector<Category> cats;
+        for (int i = 0; i < 500; ++i) {
+            const int id = static_cast<int>(rng() % 400) * spread - 200 * spread;
+            cats.push_back({id, "分类" + std::to_string(rng() % 450), ""});
+        }
+        cats.push_back({cats[3].id, "重复id", ""});
+        const CategoryRegistry registry(cats);
+        ASSERT_EQ(registry.size(), cats.size());
+        for (int probe = -250; probe < 250; ++probe) {
+            const int id = probe * spread;
+            const Category* want = ScanById(cats, id);
+            const std::size_t want_index = want == nullptr ? CategoryRegistry::npos : want - cats.data();
+            EXPECT_EQ(registry.IndexOf(id), want_index) << id;
+            EXPECT_EQ(registry.Name(id), want == nullptr ? "" : want->name);
+        }
+        for (int k = 0; k < 500; ++k) {
+            const std::string name = "分类" + std::to_string(k);
+            const Category* want = ScanByName(cats, name);
+            const Category* got = registry.FindByName(name);
+            ASSERT_EQ(got == nullptr, want == nullptr) << name;
+            if (want != nullptr) {
+                EXPECT_EQ(registry.IndexOfName(name), static_cast<std::size_t>(want - cats.data()));
+                EXPECT_EQ(got, &registry.categories()[registry.IndexOfName(name)]);
+            }
+        }
+        EXPECT_EQ(registry.FindByName("重复id")->id, cats[3].id);
+        EXPECT_EQ(registry.Name(cats[3].id), cats[3].name);  // 同 id 取第一个
+    }
+}
+
+TEST(CategoryRegistryTests, FallbackAgreesWithRecognizer) {
+    const std::vector<std::vector<Category>> tables = {
+        {}, {{7, "餐饮", ""}, {9, "娱乐", ""}}, {{7, "餐饮", ""}, {5, "其他", ""}, {6, "其他", ""}}};
+    for (const auto& cats : tables) {
+        const CategoryRegistry registry(cats);
+        const CategoryRecognizer from_vector(cats);
+        const CategoryRecognizer from_registry = registry.Compile();
+        EXPECT_EQ(registry.fallback_id(), from_vector.RecognizeCategory("没有关键词"));
+        for (const char* note : {"没有关键词", "餐饮费", "娱乐活动", "其他支出", ""}) {
+            EXPECT_EQ(from_registry.RecognizeCategory(note), from_vector.RecognizeCategory(note)) << note;
+        }
+    }
+    const CategoryRegistry empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.Find(0), nullptr);
+    EXPECT_EQ(empty.IndexOfName(""), CategoryRegistry::npos);
+    EXPECT_EQ(empty.fallback_metric(), MetricCounter::kNoCategories);
+}
+
+TEST(CategoryRegistryTests, ContextRebuildsOnlyForNewRegistry) {
+    const CategoryRegistry registry(DefaultCats());
+    const CategoryRegistry copy = registry;
+    EXPECT_EQ(copy.serial(), registry.serial());
+    ClassificationContext ctx;
+    const CategoryRecognizer* first = &ctx.Recognizer(registry);
+    EXPECT_EQ(&ctx.Recognizer(copy), first);
+    EXPECT_EQ(ProcessTransaction(ctx, "午饭 餐饮", "2026-05-01", registry).category_id,
+              ProcessTransaction("午饭 餐饮", "2026-05-01", DefaultCats()).category_id);
+
+    // 预热后按注册表逐条分类不再分配
+    for (const char* note : kWarmNotes) ProcessTransaction(ctx, note, "", registry);
+    const std::size_t before = AllocationsNow();
+    int checksum = 0;
+    for (const char* note : kWarmNotes) checksum += ProcessTransaction(ctx, note, "2026-05-01", registry).category_id;
+    EXPECT_EQ(AllocationsNow() - before, 0u);
+    EXPECT_GT(checksum, 0);
+
+    // 内容相同的新注册表序号不同，重建一次；回到分类表入口也重建
+    const CategoryRegistry rebuilt(DefaultCats());
+    EXPECT_NE(rebuilt.serial(), registry.serial());
+    EXPECT_EQ(ctx.Recognizer(rebuilt).RecognizeCategory("电影"),
+              CategoryRecognizer(DefaultCats()).RecognizeCategory("电影"));
+    EXPECT_EQ(ctx.Recognizer(DefaultCats(), MatchPolicy::kByteOrder).RecognizeCategory("电影"),
+              ctx.Recognizer(rebuilt).RecognizeCategory("电影"));
+}
+
+// ===================== 单元测试：FuzzyCategoryRecognizer（近似识别） =====================
+static std::vector<Category> FuzzyCats() {
+    std::vector<Category> cats = DefaultCats();
+    cats.push_back({6, "房屋租金", "", 0, {"物业费"}});
+    cats.push_back({7, "ABC超市", ""});
+    return cats;
+}
+
+TEST(FuzzyRecognizerTests, FoldsSpacesTraditionalAndWidth) {
+    const FuzzyCategoryRecognizer fr(FuzzyCats());
+    FuzzyCategoryRecognizer::Scratch scratch;
+    const struct {
+        const char* note;
+        int id;
+        FuzzyMatchKind kind;
+    } cases[] = {
+        {"餐饮 午饭", 1, FuzzyMatchKind::kExact},      {"餐 饮", 1, FuzzyMatchKind::kFolded},
+        {"餐飲", 1, FuzzyMatchKind::kFolded},          {"交 水電費", 3, FuzzyMatchKind::kFolded},
+        {"娛　樂", 2, FuzzyMatchKind::kFolded},        {"ａｂｃ超市 购物", 7, FuzzyMatchKind::kFolded},
+        {"本月物業費", 6, FuzzyMatchKind::kFolded},    {"随便买点", 5, FuzzyMatchKind::kFallback},
+        {"\xff\xfe餐\x80饮", 5, FuzzyMatchKind::kFallback},  // 非法字节不被丢弃，不会把两边拼起来
+    };
+    for (const auto& c : cases) {
+        const FuzzyMatch m = fr.Match(c.note, scratch);
+        EXPECT_EQ(m.category_id, c.id) << c.note;
+        EXPECT_EQ(m.kind, c.kind) << c.note;
+        EXPECT_EQ(fr.RecognizeCategory(c.note), c.id) << c.note;
+    }
+}
+
+TEST(FuzzyRecognizerTests, BoundedEditDistanceOnLongKeywordsOnly) {
+    const FuzzyCategoryRecognizer fr(FuzzyCats());
+    FuzzyCategoryRecognizer::Scratch scratch;
+    const FuzzyMatch typo = fr.Match("交 房屋租今 给房东", scratch);  // 替换一个字
+    EXPECT_EQ(typo.category_id, 6);
+    EXPECT_EQ(typo.kind, FuzzyMatchKind::kApproximate);
+    EXPECT_EQ(typo.edits, 1);
+    EXPECT_EQ(fr.RecognizeCategory("水電废", scratch), 3);  // 折叠后再差一个字
+    EXPECT_EQ(fr.RecognizeCategory("房屋金", scratch), 6);    // 少一个字
+    EXPECT_EQ(fr.RecognizeCategory("房租", scratch), 5);      // 差两个字
+    EXPECT_EQ(fr.RecognizeCategory("餐厅", scratch), 5);      // 两个字的关键词不做近似
+
+    FuzzyOptions strict;
+    strict.max_edits = 0;
+    EXPECT_EQ(FuzzyCategoryRecognizer(FuzzyCats(), strict).RecognizeCategory("房屋租今"), 5);
+    FuzzyOptions no_budget;
+    no_budget.max_candidates = 0;
+    EXPECT_EQ(FuzzyCategoryRecognizer(FuzzyCats(), no_budget).RecognizeCategory("房屋租今"), 5);
+    FuzzyOptions wider;
+    wider.max_edits = 2;
+    EXPECT_EQ(FuzzyCategoryRecognizer(FuzzyCats(), wider).Match("房租", scratch).edits, 2);
+}
+
+TEST(FuzzyRecognizerTests, SubstringDistanceMatchesNaiveLevenshtein) {
+    auto levenshtein = [](const std::u32string& a, const std::u32string& b) {
+        std::vector<int> prev(b.size() + 1), cur(b.size() + 1);
+        for (std::size_t j = 0; j <= b.size(); ++j) prev[j] = static_cast<int>(j);
+        for (std::size_t i = 1; i <= a.size(); ++i) {
+            cur[0] = static_cast<int>(i);
+            for (std::size_t j = 1; j <= b.size(); ++j) {
+                cur[j] = std::min({prev[j - 1] + (a[i - 1] != b[j - 1]), prev[j] + 1, cur[j - 1] + 1});
+            }
+            std::swap(prev, cur);
+        }
+        return prev[b.size()];
+    };
+    std::mt19937 rng(5);
+    int column[fuzzy_detail::kMaxFuzzyKeyword + 1];
+    for (int round = 0; round < 300; ++round) {
+        std::u32string note(rng() % 12, U'a');
+        std::u32string kw(1 + rng() % 5, U'a');
+        for (auto& c : note) c = U'a' + rng() % 3;
+        for (auto& c : kw) c = U'a' + rng() % 3;
+        int want = static_cast<int>(kw.size());
+        for (std::size_t i = 0; i <= note.size(); ++i) {
+            for (std::size_t j = i; j <= note.size(); ++j) {
+                want = std::min(want, levenshtein(note.substr(i, j - i), kw));
+            }
+        }
+        for (int limit : {0, 1, 2, 8}) {
+            EXPECT_EQ(fuzzy_detail::SubstringDistance(note.data(), note.size(), kw.data(), kw.size(), limit, column),
+                      std::min(want, limit + 1));
+        }
+    }
+}
+
+TEST(FuzzyRecognizerTests, ExtraFoldsAndSteadyStateDoesNotAllocate) {
+    FuzzyOptions opt;
+    opt.extra_folds = {{U'喫', U'吃'}, {U'飲', U'饮'}};
+    std::vector<Category> cats = FuzzyCats();
+    cats.push_back({8, "吃饭", ""});
+    const FuzzyCategoryRecognizer fr(cats, opt);
+    FuzzyCategoryRecognizer::Scratch scratch;
+    EXPECT_EQ(fr.RecognizeCategory("喫飯", scratch), 8);
+    EXPECT_EQ(fr.FoldCodepoint(U'Ｚ'), U'z');
+
+    // 很长、全是常用字的备注：预算封顶，照样返回
+    std::string long_note;
+    std::string long_miss;
+    for (int i = 0; i < 2000; ++i) {
+        long_note += "房屋租今";
+        long_miss += "房屋费租";
+    }
+    EXPECT_EQ(fr.Match(long_note, scratch).kind, FuzzyMatchKind::kApproximate);
+    EXPECT_EQ(fr.Match(long_miss, scratch).kind, FuzzyMatchKind::kFallback);
+
+    const char* notes[] = {"餐 饮", "房屋租今", "随便买点", "水電废", "餐饮"};
+    for (const char* note : notes) fr.RecognizeCategory(note, scratch);
+    const std::size_t before = AllocationsNow();
+    int checksum = 0;
+    for (int round = 0; round < 200; ++round) checksum += fr.RecognizeCategory(notes[round % 5], scratch);
+    EXPECT_EQ(AllocationsNow() - before, 0u);
+    EXPECT_GT(checksum, 0);
+}
+
+// ===================== 单元测试：BoundedQueue（有界无锁队列） =====================
+TEST(BoundedQueueTests, FifoAcrossWrapAroundWithFullAndEmpty) {
+    BoundedQueue<std::string> q(3);
+    EXPECT_EQ(q.capacity(), 4u);
+    EXPECT_TRUE(q.Empty());
+    std::string out;
+    EXPECT_FALSE(q.TryPop(out));
+    int next_in = 0;
+    int next_out = 0;
+    for (int round = 0; round < 10; ++round) {
+        std::size_t pos = 0;
+        while (true) {
+            std::string v = std::to_string(next_in);
+            if (!q.TryPush(std::move(v), &pos)) {
+                EXPECT_EQ(v, std::to_string(next_in));  // 满时不移走
+                break;
+            }
+            EXPECT_EQ(pos, static_cast<std::size_t>(next_in));
+            ++next_in;
+        }
+        EXPECT_EQ(q.SizeApprox(), 4u);
+        for (int k = 0; k < 3 && q.TryPop(out); ++k) EXPECT_EQ(out, std::to_string(next_out++));
+    }
+    while (q.TryPop(out)) EXPECT_EQ(out, std::to_string(next_out++));
+    EXPECT_EQ(next_out, next_in);
+    EXPECT_TRUE(q.Empty());
+}
+
+TEST(BoundedQueueTests, ConcurrentProducersAndConsumersDeliverEachItemOnce) {
+    BoundedQueue<uint64_t> q(64);
+    constexpr int kProducers = 4;
+    constexpr int kConsumers = 3;
+    constexpr uint64_t kPerProducer = 20000;
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> popped{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < kProducers; ++p) {
+        threads.emplace_back([&, p] {
+            for (uint64_t i = 1; i <= kPerProducer; ++i) {
+                uint64_t v = i * kProducers + static_cast<uint64_t>(p);
+                while (!q.TryPush(std::move(v))) std::this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < kConsumers; ++c) {
+        threads.emplace_back([&] {
+            uint64_t v = 0;
+            while (popped.load() < kProducers * kPerProducer) {
+                if (q.TryPop(v)) {
+                    sum += v;
+                    ++popped;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    uint64_t expected = 0;
+    for (int p = 0; p < kProducers; ++p) {
+        for (uint64_t i = 1; i <= kPerProducer; ++i) expected += i * kProducers + static_cast<uint64_t>(p);
+    }
+    EXPECT_EQ(popped.load(), kProducers * kPerProducer);
+    EXPECT_EQ(sum.load(), expected);
+    EXPECT_TRUE(q.Empty());
+}
+
+// ===================== 单元测试：StaticCategoryRecognizer（编译期分类表） =====================
+inline constexpr StaticCategory kDefaultTable[] = {
+    {1, "餐饮"}, {2, "娱乐"}, {3, "水电费"}, {4, "工资"}, {5, "其他"},
+};
+using DefaultStaticRecognizer = StaticCategoryRecognizer<kDefaultTable>;
+
+inline constexpr StaticCategory kNoOtherTable[] = {{10, "餐饮"}, {11, "娱乐"}};
+
+// 识别结果在编译期即可求值
+static_assert(DefaultStaticRecognizer::kFallbackId == 5, "fallback resolved statically");
+static_assert(DefaultStaticRecognizer::RecognizeCategory("今天去餐饮店吃饭") == 1, "");
+static_assert(DefaultStaticRecognizer::RecognizeCategory("水电费 1月账单") == 3, "");
+static_assert(DefaultStaticRecognizer::RecognizeCategory("买书") == 5, "");
+static_assert(StaticCategoryRecognizer<kNoOtherTable>::RecognizeCategory("完全不匹配") == 10, "");
+
+TEST(StaticCategoryRecognizerTests, MatchesRuntimeRecognizer) {
+    CategoryRecognizer cr(DefaultCats());
+    for (const char* note : {"餐饮 午饭", "娱乐 电影票", "水电费 1月账单", "工资 发放", "买书", "",
+                             "餐饮+娱乐", "娱乐+餐饮", "其他: 杂项支出", "水电 费", "工资餐饮"}) {
+        EXPECT_EQ(DefaultStaticRecognizer::RecognizeCategory(note), cr.RecognizeCategory(note)) << note;
+    }
+}
+
+inline constexpr StaticCategory kOverlapTable[] = {{1, "水电费"}, {2, "电费"}, {3, "电费"}, {4, "其他"}};
+
+TEST(StaticCategoryRecognizerTests, OverlapAndDuplicateNamesFollowRuntimeSemantics) {
+    using R = StaticCategoryRecognizer<kOverlapTable>;
+    EXPECT_EQ(R::RecognizeCategory("缴水电 电费"), 3);
+    EXPECT_EQ(R::RecognizeCategory("水水电费"), 1);
+    EXPECT_EQ(R::RecognizeCategory("水电 费"), 4);
+    const std::string buffer = "电费|";
+    EXPECT_EQ(R::RecognizeCategory(buffer.data(), 3), 4);
+}
+
 // ===================== GTest 入口（保证此文件可单独编译运行） =====================
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
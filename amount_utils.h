@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// ===================== 组件C：金额（定点分） =====================
+// 金额统一存为 int64 的“分”，避免浮点误差；解析失败的金额记为 kInvalidAmount，
+// 聚合时跳过（与无效日期记为无效 PackedDate 的做法一致）。
+constexpr int64_t kInvalidAmount = INT64_MIN;
+
+// 接受 [+-]整数[.1~2 位小数]，如 "12"、"-3.5"、"0.01"；空串视为 0。
+// 其余形式（千分位、货币符号、空白、多于两位小数、溢出）均返回 kInvalidAmount。
+constexpr int64_t ParseAmountCents(std::string_view s) {
+    if (s.empty()) return 0;
+    std::size_t i = 0;
+    const bool negative = s[0] == '-';
+    if (s[0] == '-' || s[0] == '+') ++i;
+    const std::size_t int_begin = i;
+    int64_t cents = 0;
+    constexpr int64_t kMaxYuan = (INT64_MAX - 99) / 100;
+    while (i < s.size() && s[i] >= '0' && s[i] <= '9') {
+        const int64_t digit = s[i] - '0';
+        if (cents > (kMaxYuan - digit) / 10) return kInvalidAmount;
+        cents = cents * 10 + digit;
+        ++i;
+    }
+    if (i == int_begin) return kInvalidAmount;
+    cents *= 100;
+    if (i < s.size()) {
+        if (s[i] != '.') return kInvalidAmount;
+        ++i;
+        const std::size_t frac = s.size() - i;
+        if (frac == 0 || frac > 2) return kInvalidAmount;
+        for (std::size_t k = 0; k < frac; ++k) {
+            if (s[i + k] < '0' || s[i + k] > '9') return kInvalidAmount;
+        }
+        cents += (s[i] - '0') * 10 + (frac == 2 ? s[i + 1] - '0' : 0);
+    }
+    return negative ? -cents : cents;
+}
+
+static_assert(ParseAmountCents("12.34") == 1234 && ParseAmountCents("-0.5") == -50, "constexpr parse");
+static_assert(ParseAmountCents("1,000") == kInvalidAmount, "no thousands separators");
+
+// "-12.30" 形式；kInvalidAmount 格式化为空串
+inline std::string FormatAmountCents(int64_t cents) {
+    if (cents == kInvalidAmount) return std::string();
+    const bool negative = cents < 0;
+    const uint64_t magnitude = negative ? 0 - static_cast<uint64_t>(cents) : static_cast<uint64_t>(cents);
+    std::string out = std::to_string(magnitude / 100);
+    const unsigned frac = static_cast<unsigned>(magnitude % 100);
+    out += '.';
+    out += static_cast<char>('0' + frac / 10);
+    out += static_cast<char>('0' + frac % 10);
+    return negative ? "-" + out : out;
+}
@@ -0,0 +1,723 @@
+﻿#include <benchmark/benchmark.h>
+
+#include "category_recognizer.h"
+#include "category_registry.h"
+#include "date_column.h"
+#include "date_utils.h"
+#include "fuzzy_recognizer.h"
+#include "ledger_aggregate.h"
+#include "ledger_index.h"
+#include "live_recognizer.h"
+#include "micro_batch_classifier.h"
+#include "note_memo_cache.h"
+#include "recognizer_snapshot.h"
+#include "sharded_ledger.h"
+#include "stream_classifier.h"
+#include "thread_pool.h"
+#include "transaction.h"
+#include "transaction_log.h"
+#include "transaction_batch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ===================== 基准数据：可复现的中文分类与备注 =====================
+// 分类名用的常见汉字；备注填充用另一组不相交的汉字，避免填充意外拼出关键词
+static const char* const kNameChars[] = {
+    "餐", "饮", "娱", "乐", "水", "电", "费", "工", "资", "交", "通", "房", "租", "医", "疗",
+    "教", "育", "购", "物", "旅", "游", "话", "网", "络", "保", "险", "投", "资", "宠", "服",
+    "装", "美", "容", "运", "动", "书", "籍", "数", "码", "家", "具", "维", "修", "快", "递",
+};
+static const char* const kFillerChars[] = {
+    "今", "天", "在", "的", "了", "和", "去", "我", "们", "一", "个", "上", "下", "午",
+    "晚", "中", "心", "店", "里", "用", "卡", "支", "付", "元", "号", "月", "日", "笔",
+};
+
+static std::vector<Category> MakeCategories(std::size_t count) {
+    // 前 4 个与 DefaultCats() 一致，其余随机合成 2~4 字的名字
+    std::vector<Category> cats = {
+        {1, "餐饮", "饮食相关"},
+        {2, "娱乐", "娱乐消费"},
+        {3, "水电费", "生活缴费"},
+        {4, "工资", "收入"},
+    };
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<std::size_t> pick(0, std::size(kNameChars) - 1);
+    std::uniform_int_distribution<int> len(2, 4);
+    while (cats.size() + 1 < count) {
+        std::string name;
+        for (int i = len(rng); i > 0; --i) name += kNameChars[pick(rng)];
+        cats.push_back({static_cast<int>(cats.size()) + 1, name, ""});
+    }
+    cats.push_back({static_cast<int>(cats.size()) + 1, "其他", "其他"});
+    return cats;
+}
+
+// 生成 rows 条约 note_bytes 字节的备注，其中 hit_percent% 含某个分类名
+static std::vector<std::string> MakeNotes(const std::vector<Category>& cats, std::size_t rows,
+                                          std::size_t note_bytes, int hit_percent) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<std::size_t> filler(0, std::size(kFillerChars) - 1);
+    std::uniform_int_distribution<std::size_t> cat(0, cats.size() - 2);  // 不选“其他”
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::vector<std::string> notes;
+    notes.reserve(rows);
+    for (std::size_t r = 0; r < rows; ++r) {
+        std::string note;
+        const bool hit = percent(rng) < hit_percent;
+        const std::size_t keyword_at = note_bytes / 2;
+        while (note.size() < note_bytes) {
+            if (hit && note.size() >= keyword_at && note.size() < keyword_at + 3) {
+                note += cats[cat(rng)].name;
+            } else {
+                note += kFillerChars[filler(rng)];
+            }
+        }
+        notes.push_back(std::move(note));
+    }
+    return notes;
+}
+
+static std::vector<TransactionInput> MakeInputs(const std::vector<std::string>& notes) {
+    std::vector<TransactionInput> inputs;
+    inputs.reserve(notes.size());
+    for (std::size_t i = 0; i < notes.size(); ++i) {
+        inputs.push_back({notes[i], i % 4 == 0 ? "" : "2026-01-15"});
+    }
+    return inputs;
+}
+
+// ===================== 基准：日期 =====================
+static void BM_GetCurrentDate(benchmark::State& state) {
+    for (auto _ : state) benchmark::DoNotOptimize(GetCurrentDate());
+}
+BENCHMARK(BM_GetCurrentDate);
+
+static void BM_DateProviderToday(benchmark::State& state) {
+    DateProvider provider;
+    for (auto _ : state) benchmark::DoNotOptimize(provider.Today());
+}
+BENCHMARK(BM_DateProviderToday)->ThreadRange(1, 8);
+
+// 4096 行日期，约 1/16 为空、1/32 不合法
+static std::vector<std::string> MakeDateColumn() {
+    std::mt19937 rng(7);
+    std::vector<std::string> dates;
+    dates.reserve(4096);
+    for (int i = 0; i < 4096; ++i) {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d", 2020 + static_cast<int>(rng() % 7),
+                      1 + static_cast<int>(rng() % 12), 1 + static_cast<int>(rng() % 28));
+        const unsigned r = rng() % 32;
+        dates.push_back(r < 2 ? std::string() : r == 2 ? std::string("2026-02-30") : std::string(buf));
+    }
+    return dates;
+}
+
+static void BM_ParseDatePerRow(benchmark::State& state) {
+    const auto dates = MakeDateColumn();
+    const PackedDate today(2026, 1, 15);
+    std::vector<uint32_t> out(dates.size());
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < dates.size(); ++i) {
+            out[i] = (dates[i].empty() ? today : PackedDate::Parse(dates[i])).value();
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * dates.size()));
+}
+BENCHMARK(BM_ParseDatePerRow);
+
+static void BM_ParseDateRegex(benchmark::State& state) {
+    const auto dates = MakeDateColumn();
+    const std::regex pattern(R"((\d{4})-(\d{2})-(\d{2}))");
+    std::vector<uint32_t> out(dates.size());
+    std::smatch m;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < dates.size(); ++i) {
+            out[i] = std::regex_match(dates[i], m, pattern)
+                         ? PackedDate(std::stoi(m[1]), std::stoi(m[2]), std::stoi(m[3])).value()
+                         : 0;
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * dates.size()));
+}
+BENCHMARK(BM_ParseDateRegex);
+
+// Arg: 0 = 标量，1 = ActiveSimdLevel()
+static void BM_ParseDateColumn(benchmark::State& state) {
+    const auto dates = MakeDateColumn();
+    const std::vector<std::string_view> views(dates.begin(), dates.end());
+    const SimdLevel level = state.range(0) != 0 ? ActiveSimdLevel() : SimdLevel::kScalar;
+    std::vector<uint32_t> out(views.size());
+    std::vector<uint64_t> errors(DateErrorWords(views.size()));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            ParseDateColumn(views.data(), views.size(), PackedDate(2026, 1, 15), out.data(), errors.data(), level));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * views.size()));
+}
+BENCHMARK(BM_ParseDateColumn)->Arg(0)->Arg(1);
+
+// ===================== 基准：分类识别 =====================
+// Args: {分类数, 备注字节数, 命中率%}
+static void RecognizerArgs(benchmark::internal::Benchmark* b) {
+    for (int cats : {5, 100, 1000, 10000}) {
+        for (int bytes : {24, 96, 300}) {
+            for (int hit : {0, 60, 100}) b->Args({cats, bytes, hit});
+        }
+    }
+}
+
+static void BM_RecognizeCategory(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const auto notes = MakeNotes(cats, 1024, static_cast<std::size_t>(state.range(1)),
+                                 static_cast<int>(state.range(2)));
+    const CategoryRecognizer cr(cats);
+    std::size_t i = 0;
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        const std::string& note = notes[i++ & 1023];
+        bytes += note.size();
+        benchmark::DoNotOptimize(cr.RecognizeCategory(note));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_RecognizeCategory)->Apply(RecognizerArgs);
+
+// 100 个分类、每个分类带若干别名（Args: {每类别名数, 0 共享自动机 / 1 逐个关键词 find}）
+static void BM_RecognizeCategoryAliases(benchmark::State& state) {
+    auto cats = MakeCategories(100);
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<std::size_t> pick(0, std::size(kNameChars) - 1);
+    std::vector<std::pair<std::string, int>> flat;
+    for (auto& c : cats) {
+        for (int a = 0; a < state.range(0); ++a) {
+            std::string alias;
+            for (int i = 2 + a % 3; i > 0; --i) alias += kNameChars[pick(rng)];
+            c.keywords.push_back(alias);
+        }
+        flat.emplace_back(c.name, c.id);
+        for (const auto& k : c.keywords) flat.emplace_back(k, c.id);
+    }
+    const auto notes = MakeNotes(cats, 1024, 96, 60);
+    const CategoryRecognizer cr(cats);
+    const bool naive = state.range(1) != 0;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::string& note = notes[i++ & 1023];
+        if (!naive) {
+            benchmark::DoNotOptimize(cr.RecognizeCategory(note));
+            continue;
+        }
+        int id = 0;
+        for (const auto& kw : flat) {
+            if (note.find(kw.first) != std::string::npos) {
+                id = kw.second;
+                break;
+            }
+        }
+        benchmark::DoNotOptimize(id);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_RecognizeCategoryAliases)->ArgsProduct({{0, 10, 50}, {0, 1}});
+
+static void BM_RecognizerBuild(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        CategoryRecognizer cr(cats);
+        benchmark::DoNotOptimize(&cr);
+    }
+}
+BENCHMARK(BM_RecognizerBuild)->Arg(5)->Arg(100)->Arg(1000)->Arg(10000);
+
+// 从快照冷启动（Args: {分类数, 0 完整校验 / 1 只查布局}），与 BM_RecognizerBuild 对照
+static void BM_RecognizerSnapshotLoad(benchmark::State& state) {
+    const std::string blob =
+        SaveRecognizerSnapshot(CategoryRecognizer(MakeCategories(static_cast<std::size_t>(state.range(0)))));
+    const SnapshotCheck check = state.range(1) != 0 ? SnapshotCheck::kLayout : SnapshotCheck::kFull;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(LoadRecognizerSnapshot(blob, nullptr, check));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * blob.size()));
+}
+BENCHMARK(BM_RecognizerSnapshotLoad)->ArgsProduct({{100, 1000, 10000}, {0, 1}});
+
+// 记忆化缓存在前（Args: {分类数, 不同备注数}）：不同备注越少，重复率越高
+static void BM_RecognizeCategoryMemo(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const auto notes = MakeNotes(cats, static_cast<std::size_t>(state.range(1)), 96, 60);
+    const CategoryRecognizer cr(cats);
+    NoteMemoCache memo;
+    std::mt19937 rng(3);
+    std::vector<std::size_t> order(4096);
+    for (auto& k : order) k = rng() % notes.size();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(memo.Recognize(cr, notes[order[i++ & 4095]]));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["hit_rate"] = memo.Stats().HitRate();
+}
+BENCHMARK(BM_RecognizeCategoryMemo)->ArgsProduct({{100, 10000}, {64, 1024, 65536}});
+
+// 近似识别（Args: {分类数, 备注种类}）：0 = 原文即命中，1 = 名字中间插空格，2 = 错一个字，3 = 全不命中
+static void BM_FuzzyRecognize(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const FuzzyCategoryRecognizer fr(cats);
+    const int kind = static_cast<int>(state.range(1));
+    std::vector<std::string> notes;
+    std::mt19937 rng(3);
+    for (int i = 0; i < 1024; ++i) {
+        std::string name = cats[rng() % (cats.size() - 1)].name;  // 不选“其他”
+        if (name.size() < 9) name += kNameChars[rng() % std::size(kNameChars)];  // 近似只对不少于 3 字的名字
+        std::string note = "今天在店里用卡支付";
+        if (kind == 0) note += name;
+        if (kind == 1) note += name.substr(0, 3) + " " + name.substr(3);
+        if (kind == 2) note += name.substr(0, name.size() - 3) + "笔";
+        notes.push_back(note);
+    }
+    FuzzyCategoryRecognizer::Scratch scratch;
+    std::size_t i = 0;
+    for (auto _ : state) benchmark::DoNotOptimize(fr.RecognizeCategory(notes[i++ & 1023], scratch));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_FuzzyRecognize)->ArgsProduct({{100, 10000}, {0, 1, 2, 3}});
+
+// 运行时改名一个分类的摊还代价（含到达阈值时的并入重建），与 BM_RecognizerBuild 对照
+static void BM_LiveRenameCategory(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    LiveCategoryRecognizer live(cats);
+    std::mt19937 rng(3);
+    int round = 0;
+    for (auto _ : state) {
+        const int id = cats[rng() % cats.size()].id;
+        benchmark::DoNotOptimize(live.RenameCategory(id, "改名" + std::to_string(round++)));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_LiveRenameCategory)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+// 带待合并修改时的识别（Args: {分类数, 改过的分类数}）：0 即整体编译的识别器
+static void BM_LiveRecognizeLayered(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const auto notes = MakeNotes(cats, 1024, 96, 60);
+    LiveCategoryRecognizer live(cats);
+    for (int i = 0; i < state.range(1); ++i) live.RenameCategory(cats[static_cast<std::size_t>(i) * 7 % cats.size()].id,
+                                                                 "改名" + std::to_string(i));
+    const auto snapshot = live.Snapshot();
+    std::size_t i = 0;
+    for (auto _ : state) benchmark::DoNotOptimize(snapshot->recognizer.RecognizeCategory(notes[i++ & 1023]));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["pending"] = static_cast<double>(snapshot->pending_edits());
+}
+BENCHMARK(BM_LiveRecognizeLayered)->ArgsProduct({{100, 10000}, {0, 8, 64}});
+
+// ===================== 基准：交易处理 =====================
+// 逐行接口：每行都重新构建识别器（Args: {分类数}）
+static void BM_ProcessTransaction(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const auto notes = MakeNotes(cats, 1024, 96, 60);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::size_t k = i++ & 1023;
+        benchmark::DoNotOptimize(ProcessTransaction(notes[k], k % 4 == 0 ? "" : "2026-01-15", cats));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ProcessTransaction)->Arg(5)->Arg(100)->Arg(1000);
+
+// 同样的逐条调用，识别器与结果缓冲留在按线程持有的上下文里
+static void BM_ProcessTransactionContext(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const auto notes = MakeNotes(cats, 1024, 96, 60);
+    ClassificationContext ctx;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::size_t k = i++ & 1023;
+        benchmark::DoNotOptimize(ProcessTransaction(ctx, notes[k], k % 4 == 0 ? "" : "2026-01-15", cats).category_id);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ProcessTransactionContext)->Arg(5)->Arg(100)->Arg(1000)->Arg(10000);
+
+// 同上，识别器在循环外取一次，逐行不再比较分类表
+static void BM_ProcessTransactionContextRecognizer(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const auto notes = MakeNotes(cats, 1024, 96, 60);
+    ClassificationContext ctx;
+    const CategoryRecognizer& cr = ctx.Recognizer(cats);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::size_t k = i++ & 1023;
+        benchmark::DoNotOptimize(ProcessTransaction(ctx, notes[k], k % 4 == 0 ? "" : "2026-01-15", cr).category_id);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ProcessTransactionContextRecognizer)->Arg(5)->Arg(100)->Arg(1000)->Arg(10000);
+
+// 同上，识别器按注册表序号复用，不必每次比较整张分类表
+static void BM_ProcessTransactionRegistry(benchmark::State& state) {
+    const CategoryRegistry registry(MakeCategories(static_cast<std::size_t>(state.range(0))));
+    const auto notes = MakeNotes(registry.categories(), 1024, 96, 60);
+    ClassificationContext ctx;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::size_t k = i++ & 1023;
+        benchmark::DoNotOptimize(
+            ProcessTransaction(ctx, notes[k], k % 4 == 0 ? "" : "2026-01-15", registry).category_id);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ProcessTransactionRegistry)->Arg(5)->Arg(100)->Arg(1000)->Arg(10000);
+
+// 报表按 id 取名字 + 按名字取 id（Args: {分类数}）：线性扫描 vs 注册表
+static void BM_CategoryLookupScan(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const Category& probe = cats[(i++ * 7919) % cats.size()];
+        const auto by_id = std::find_if(cats.begin(), cats.end(), [&](const Category& c) { return c.id == probe.id; });
+        const auto by_name =
+            std::find_if(cats.begin(), cats.end(), [&](const Category& c) { return c.name == probe.name; });
+        benchmark::DoNotOptimize(by_id->name.size() + static_cast<std::size_t>(by_name->id));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_CategoryLookupScan)->Arg(100)->Arg(10000);
+
+static void BM_CategoryLookupRegistry(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const CategoryRegistry registry(cats);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const Category& probe = cats[(i++ * 7919) % cats.size()];
+        benchmark::DoNotOptimize(registry.Name(probe.id).size() +
+                                 static_cast<std::size_t>(registry.FindByName(probe.name)->id));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_CategoryLookupRegistry)->Arg(100)->Arg(10000);
+
+// 批量串行（Args: {分类数}），每次迭代处理 kBatchRows 行
+constexpr std::size_t kBatchRows = 1 << 16;
+
+static void BM_ProcessTransactionsBatch(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const auto notes = MakeNotes(cats, kBatchRows, 96, 60);
+    const auto inputs = MakeInputs(notes);
+    const CategoryRecognizer cr(cats);
+    std::vector<ProcessedTransaction> out(inputs.size());
+    for (auto _ : state) {
+        ProcessTransactions(inputs.data(), inputs.size(), cr, out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * inputs.size()));
+}
+BENCHMARK(BM_ProcessTransactionsBatch)->Arg(5)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+static void BM_ProcessTransactionsArenaBatch(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const auto notes = MakeNotes(cats, kBatchRows, 96, 60);
+    const auto inputs = MakeInputs(notes);
+    const CategoryRecognizer cr(cats);
+    TransactionBatch batch;
+    for (auto _ : state) {
+        batch.Clear();
+        ProcessTransactions(inputs.data(), inputs.size(), cr, batch);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * inputs.size()));
+}
+BENCHMARK(BM_ProcessTransactionsArenaBatch)->Arg(5)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+// ===================== 基准：请求服务路径 =====================
+// 一批并发请求（Arg: 请求数）从提交到全部拿到结果的耗时。ThreadPerRequest 为
+// 每个请求起一个线程同步处理的旧做法；MicroBatch 经 MicroBatchClassifier 合批。
+static void BM_ClassifyBurstThreadPerRequest(benchmark::State& state) {
+    const auto cats = MakeCategories(100);
+    const auto notes = MakeNotes(cats, static_cast<std::size_t>(state.range(0)), 48, 80);
+    const CategoryRecognizer cr(cats);
+    std::vector<ProcessedTransaction> out(notes.size());
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        threads.reserve(notes.size());
+        const PackedDate today = GetCurrentPackedDate();
+        for (std::size_t i = 0; i < notes.size(); ++i) {
+            threads.emplace_back([&, i] { ProcessTransactionInto(cr, notes[i], "", today, out[i]); });
+        }
+        for (auto& t : threads) t.join();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * notes.size()));
+}
+BENCHMARK(BM_ClassifyBurstThreadPerRequest)->Arg(64)->Arg(512)->UseRealTime();
+
+static void BM_ClassifyBurstMicroBatch(benchmark::State& state) {
+    const auto cats = MakeCategories(100);
+    const auto notes = MakeNotes(cats, static_cast<std::size_t>(state.range(0)), 48, 80);
+    MicroBatchClassifier classifier(std::make_shared<const CategoryRecognizer>(cats));
+    std::vector<std::future<ProcessedTransaction>> pending(notes.size());
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < notes.size(); ++i) pending[i] = classifier.Submit({notes[i], "", ""});
+        for (auto& f : pending) benchmark::DoNotOptimize(f.get());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * notes.size()));
+    state.counters["avg_batch"] = classifier.Stats().AverageBatch();
+}
+BENCHMARK(BM_ClassifyBurstMicroBatch)->Arg(64)->Arg(512)->UseRealTime();
+
+// 实时流（Arg: 分类线程数）：每次迭代推入 4096 条并等全部按序交给 sink
+static void BM_StreamClassifier(benchmark::State& state) {
+    const auto cats = MakeCategories(100);
+    const auto notes = MakeNotes(cats, 4096, 48, 80);
+    StreamOptions opt;
+    opt.workers = static_cast<std::size_t>(state.range(0));
+    int64_t checksum = 0;
+    StreamClassifier stream(std::make_shared<const CategoryRecognizer>(cats),
+                            [&](uint64_t, ProcessedTransaction row) { checksum += row.category_id; }, opt);
+    for (auto _ : state) {
+        for (const auto& note : notes) stream.Push({note, "", "9.90"});
+        stream.Flush();
+    }
+    benchmark::DoNotOptimize(checksum);
+    const StreamStats stats = stream.Stats();
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * notes.size()));
+    state.counters["queue_wait_us"] = stats.queue_wait.MeanNanos() / 1000.0;
+    state.counters["reorder_wait_us"] = stats.reorder_wait.MeanNanos() / 1000.0;
+    state.counters["backpressure_waits"] = static_cast<double>(stats.backpressure_waits);
+}
+BENCHMARK(BM_StreamClassifier)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// ===================== 基准：并发写入账本 =====================
+// 每次迭代每个线程追加 kLedgerAppendRows 行；迭代次数固定，以免账本无限增长。
+// Mutex 为一把全局锁保护 std::vector 的旧做法
+constexpr std::size_t kLedgerAppendRows = 1024;
+constexpr int kLedgerAppendIterations = 200;
+
+static std::mutex g_ledger_mu;
+static std::vector<ProcessedTransaction> g_locked_ledger;
+static std::unique_ptr<ShardedLedger> g_sharded_ledger;
+
+static void BM_LedgerAppendMutex(benchmark::State& state) {
+    if (state.thread_index() == 0) g_locked_ledger = std::vector<ProcessedTransaction>();
+    const ProcessedTransaction row{PackedDate(2026, 1, 15), 1, "午饭", 3500};
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < kLedgerAppendRows; ++i) {
+            std::lock_guard<std::mutex> lock(g_ledger_mu);
+            g_locked_ledger.push_back(row);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kLedgerAppendRows));
+}
+BENCHMARK(BM_LedgerAppendMutex)->ThreadRange(1, 8)->Iterations(kLedgerAppendIterations)->UseRealTime();
+
+// 上一轮的写者都已随线程结束归还，所以在下一轮开始时才重建账本
+static void BM_LedgerAppendSharded(benchmark::State& state) {
+    if (state.thread_index() == 0) g_sharded_ledger = std::make_unique<ShardedLedger>();
+    const ProcessedTransaction row{PackedDate(2026, 1, 15), 1, "午饭", 3500};
+    ShardedLedger::Writer writer;
+    for (auto _ : state) {
+        if (!writer.valid()) writer = g_sharded_ledger->AcquireWriter();
+        for (std::size_t i = 0; i < kLedgerAppendRows; ++i) writer.Append(row);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kLedgerAppendRows));
+}
+BENCHMARK(BM_LedgerAppendSharded)->ThreadRange(1, 8)->Iterations(kLedgerAppendIterations)->UseRealTime();
+
+// ===================== 基准：持久化 =====================
+// 逐行 write + fsync 的旧做法，与 TransactionLog 的组提交对比；文件放在临时目录
+static std::string BenchLogPath(const char* name) {
+    const std::string path = (std::filesystem::temp_directory_path() / name).string();
+    std::filesystem::remove(path);
+    return path;
+}
+
+static void BM_LogAppendFsyncPerRow(benchmark::State& state) {
+    const std::string path = BenchLogPath("account_book_bench_fsync.log");
+    transaction_log_detail::AppendFile file;
+    if (!file.Open(path, 0, nullptr)) {
+        state.SkipWithError("cannot open log");
+        return;
+    }
+    const ProcessedTransaction row{PackedDate(2026, 1, 15), 1, "餐饮 午饭", 3500};
+    std::string buf;
+    for (auto _ : state) {
+        buf.clear();
+        transaction_log_detail::EncodeRecord(row, buf);
+        file.Write(buf.data(), buf.size());
+        file.Sync();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    file.Close();
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_LogAppendFsyncPerRow)->UseRealTime();
+
+// 每次迭代每个线程追加 kLogRowsPerWait 行并等待最后一行落盘
+constexpr int kLogRowsPerWait = 256;
+static std::unique_ptr<TransactionLog> g_bench_log;
+
+static void BM_TransactionLogGroupCommit(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        g_bench_log.reset();
+        g_bench_log = TransactionLog::Open(BenchLogPath("account_book_bench_wal.log"));
+    }
+    const ProcessedTransaction row{PackedDate(2026, 1, 15), 1, "餐饮 午饭", 3500};
+    for (auto _ : state) {
+        uint64_t lsn = 0;
+        for (int i = 0; i < kLogRowsPerWait; ++i) lsn = g_bench_log->Append(row);
+        g_bench_log->WaitDurable(lsn);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kLogRowsPerWait));
+    if (state.thread_index() == 0) state.counters["avg_group"] = g_bench_log->Stats().AverageGroup();
+}
+BENCHMARK(BM_TransactionLogGroupCommit)->ThreadRange(1, 8)->UseRealTime();
+
+// 重放 kBatchRows 行到列式批量结果
+static void BM_TransactionLogReplay(benchmark::State& state) {
+    const std::string path = BenchLogPath("account_book_bench_replay.log");
+    {
+        TransactionLogOptions opt;
+        opt.sync = false;
+        auto log = TransactionLog::Open(path, opt);
+        const auto notes = MakeNotes(MakeCategories(100), kBatchRows, 48, 80);
+        for (std::size_t i = 0; i < notes.size(); ++i) {
+            log->Append({PackedDate(2026, 1, 1 + static_cast<int>(i % 28)), static_cast<int>(i % 100), notes[i],
+                         static_cast<int64_t>(i)});
+        }
+    }
+    TransactionBatch batch;
+    for (auto _ : state) {
+        batch.Clear();
+        ReplayTransactionLog(path, batch);
+        benchmark::DoNotOptimize(batch.size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch.size()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * std::filesystem::file_size(path)));
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_TransactionLogReplay)->Unit(benchmark::kMillisecond);
+
+// ===================== 基准：报表聚合 =====================
+// 月度报表：按 (分类, 月) 计数求和。Rows 为逐行遍历结构体 + std::map 的旧做法
+static std::vector<ProcessedTransaction> MakeLedgerRows(std::size_t rows, int num_cats) {
+    std::mt19937 rng(5);
+    std::vector<ProcessedTransaction> out(rows);
+    for (auto& t : out) {
+        t.date = PackedDate(2026, static_cast<int>(rng() % 12) + 1, static_cast<int>(rng() % 28) + 1);
+        t.category_id = static_cast<int>(rng() % static_cast<unsigned>(num_cats)) + 1;
+        t.note = "备注";
+        t.amount_cents = static_cast<int64_t>(rng() % 100000) - 20000;
+    }
+    return out;
+}
+
+static void BM_GroupByCategoryMonthRows(benchmark::State& state) {
+    const auto rows = MakeLedgerRows(kBatchRows, static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        std::map<std::pair<int, int>, std::pair<uint64_t, int64_t>> groups;
+        for (const auto& t : rows) {
+            auto& g = groups[{t.category_id, t.date.year() * 12 + t.date.month()}];
+            g.first += 1;
+            g.second += t.amount_cents;
+        }
+        benchmark::DoNotOptimize(groups.size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * rows.size()));
+}
+BENCHMARK(BM_GroupByCategoryMonthRows)->Arg(10)->Arg(1000);
+
+static void BM_GroupByCategoryMonthColumnar(benchmark::State& state) {
+    const auto rows = MakeLedgerRows(kBatchRows, static_cast<int>(state.range(0)));
+    TransactionBatch batch;
+    for (const auto& t : rows) batch.Append(t.date, t.category_id, t.note, t.amount_cents);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(GroupByCategory(batch, DateGrain::kMonth));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch.size()));
+}
+BENCHMARK(BM_GroupByCategoryMonthColumnar)->Arg(10)->Arg(1000);
+
+// 一个季度的支出总额与最值（Arg: 0 标量，1 当前 CPU 的最优指令集）
+static void BM_SummarizeAmountsQuarter(benchmark::State& state) {
+    const auto rows = MakeLedgerRows(kBatchRows, 10);
+    TransactionBatch batch;
+    for (const auto& t : rows) batch.Append(t.date, t.category_id, t.note, t.amount_cents);
+    const DateRange q2 = DateRange::Between(PackedDate(2026, 4, 1), PackedDate(2026, 6, 30));
+    const SimdLevel level = state.range(0) != 0 ? ActiveSimdLevel() : SimdLevel::kScalar;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(SummarizeAmounts(batch.packed_dates(), batch.amounts(), batch.size(), q2, level));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch.size()));
+}
+BENCHMARK(BM_SummarizeAmountsQuarter)->Arg(0)->Arg(1);
+
+// 一个分类一个月的明细行（Arg: 分类数）。Scan 为逐行比较两列，Index 走 LedgerIndex
+static void BM_SelectCategoryMonthScan(benchmark::State& state) {
+    const auto rows = MakeLedgerRows(kBatchRows * 4, static_cast<int>(state.range(0)));
+    TransactionBatch batch;
+    for (const auto& t : rows) batch.Append(t.date, t.category_id, t.note, t.amount_cents);
+    const DateRange month = DateRange::Between(PackedDate(2026, 3, 1), PackedDate(2026, 3, 31));
+    std::vector<uint32_t> out;
+    for (auto _ : state) {
+        out.clear();
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (batch.category_id(i) == 1 && month.Contains(batch.packed_dates()[i])) {
+                out.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        benchmark::DoNotOptimize(SummarizeAmounts(batch, out));
+    }
+    state.counters["matches"] = static_cast<double>(out.size());
+}
+BENCHMARK(BM_SelectCategoryMonthScan)->Arg(10)->Arg(1000);
+
+static void BM_SelectCategoryMonthIndex(benchmark::State& state) {
+    const auto rows = MakeLedgerRows(kBatchRows * 4, static_cast<int>(state.range(0)));
+    TransactionBatch batch;
+    for (const auto& t : rows) batch.Append(t.date, t.category_id, t.note, t.amount_cents);
+    const LedgerIndex index(batch);
+    const DateRange month = DateRange::Between(PackedDate(2026, 3, 1), PackedDate(2026, 3, 31));
+    std::vector<uint32_t> out;
+    for (auto _ : state) {
+        index.Select(batch, 1, month, out);
+        benchmark::DoNotOptimize(SummarizeAmounts(batch, out));
+    }
+    state.counters["matches"] = static_cast<double>(out.size());
+}
+BENCHMARK(BM_SelectCategoryMonthIndex)->Arg(10)->Arg(1000);
+
+// 并行批量（Args: {分类数, 线程数}）
+static void BM_ProcessTransactionsParallel(benchmark::State& state) {
+    const auto cats = MakeCategories(static_cast<std::size_t>(state.range(0)));
+    const auto notes = MakeNotes(cats, kBatchRows * 4, 96, 60);
+    const auto inputs = MakeInputs(notes);
+    const CategoryRecognizer cr(cats);
+    WorkStealingPool pool(static_cast<std::size_t>(state.range(1)));
+    std::vector<ProcessedTransaction> out(inputs.size());
+    for (auto _ : state) {
+        ProcessTransactions(inputs.data(), inputs.size(), cr, out.data(), pool);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * inputs.size()));
+}
+BENCHMARK(BM_ProcessTransactionsParallel)
+    ->ArgsProduct({{5, 1000}, {1, 2, 4, 8, 16}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// ===================== 并发：有界无锁队列 =====================
+// 多生产者 / 多消费者的环形队列（每个槽位带序号的经典做法）：入队、出队各用
+// 一次 CAS 领取位置，槽位序号表明它当前可写还是可读，全程不加锁、不分配。
+// 满或空时 TryPush / TryPop 立即返回 false，由调用方决定让出、休眠还是丢弃。
+//
+// 位置计数单调递增：TryPush 可返回领到的位置，只有一个消费者时出队顺序
+// 就是位置顺序，可直接当作序号使用。领取位置的 CAS 与 Empty() 都是
+// 顺序一致的，消费者可以“先登记休眠，再检查 Empty()”，生产者“先入队，
+// 再检查休眠标记”，两边至少有一方能看到对方。
+template <typename T>
+class BoundedQueue {
+ public:
+    // 容量向上取 2 的幂，至少为 2
+    explicit BoundedQueue(std::size_t capacity) : mask_(RoundUp(capacity) - 1), slots_(new Slot[mask_ + 1]) {
+        for (std::size_t i = 0; i <= mask_; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // 满时返回 false，value 不被移走
+    bool TryPush(T&& value, std::size_t* position = nullptr) {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            const std::size_t seq = slot.seq.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1)) {
+                    slot.value = std::move(value);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    if (position != nullptr) *position = pos;
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 空时（或队首位置已被领取但尚未写完）返回 false
+    bool TryPop(T& out) {
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            const std::size_t seq = slot.seq.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1)) {
+                    out = std::move(slot.value);
+                    slot.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 已领取的入队位置都已出队
+    bool Empty() const { return enqueue_pos_.load() == dequeue_pos_.load(); }
+
+    // 并发下只是近似值
+    std::size_t SizeApprox() const {
+        const std::size_t pushed = enqueue_pos_.load(std::memory_order_relaxed);
+        const std::size_t popped = dequeue_pos_.load(std::memory_order_relaxed);
+        return pushed > popped ? pushed - popped : 0;
+    }
+
+ private:
+    struct Slot {
+        std::atomic<std::size_t> seq{0};
+        T value{};
+    };
+
+    static std::size_t RoundUp(std::size_t n) {
+        std::size_t c = 2;
+        while (c < n) c <<= 1;
+        return c;
+    }
+
+    const std::size_t mask_;
+    const std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<std::size_t> enqueue_pos_{0};  // 生产者与消费者各占一条缓存行
+    alignas(64) std::atomic<std::size_t> dequeue_pos_{0};
+};
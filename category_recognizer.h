@@ -0,0 +1,513 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "keyword_prefilter.h"
+#include "metrics.h"
+
+// ===================== 组件B：分类识别 =====================
+struct CategoryOverlay;
+
+struct Category {
+    int id;
+    std::string name;
+    std::string description;
+    int priority = 0;  // 仅 MatchPolicy::kPriority 使用，越大越优先
+    // 同义词 / 商户别名（如 餐饮：午饭、外卖、美团），与 name 一起命中本分类
+    std::vector<std::string> keywords{};
+};
+
+// 两张分类表是否编译出同一个识别器（description 不参与匹配，不比较）
+inline bool SameMatchingCategories(const std::vector<Category>& a, const std::vector<Category>& b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (a[i].id != b[i].id || a[i].priority != b[i].priority || a[i].name != b[i].name ||
+            a[i].keywords != b[i].keywords) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 备注命中多个关键词时如何选出唯一结果。所有策略都在同一次线性扫描中求值。
+enum class MatchPolicy {
+    kByteOrder,        // 名字字节序最小者（历史行为，即旧 std::map 的遍历顺序）
+    kFirstOccurrence,  // 在备注中起始位置最靠前者；同一起点取更长者
+    kLongestKeyword,   // 最长关键词；等长取先出现者
+    kPriority,         // Category::priority 最大者；相同时取先出现者
+};
+
+// 关键词匹配基于 Aho-Corasick 自动机，构造时把所有分类的名字与别名一次性编译进
+// 同一个自动机，RecognizeCategory 只对 note 做一次线性扫描：多加别名只多几个
+// 状态，不会多一遍扫描。
+//
+// 自动机按 UTF-8 字节工作：UTF-8 是自同步编码，合法关键词在合法文本中的
+// 字节级命中必然落在码点边界上，因此无需逐码点解码。从未在任何关键词中
+// 出现的字节被归入 0 号字节类，直接回到根状态。
+//
+// 每个状态预先记录“在该处结束的关键词中，按当前策略最优的一个”，
+// 扫描时只需与当前最优比较；未命中时的回退 id 在构造时确定，O(1) 返回。
+//
+// 自动机回到根状态时，由 KeywordPrefilter 用 SIMD 直接跳到下一个可能开始匹配的
+// 位置，长备注里大段不含关键词的文字不再逐字节走转移表。
+//
+// 编译好的表不可变，由 owner_ 持有：拷贝识别器只共享表、不复制；从二进制快照
+// 加载时表直接指向快照内存（见 recognizer_snapshot.h）。
+//
+// 识别器还可以叠加一层 CategoryOverlay：底版中属于被修改分类的关键词作废，
+// 这些分类的当前版本另编译成一个小自动机，两边的命中按同一策略比较。结果与
+// 用修改后的分类表整体重建完全一致，而修改只需编译被改动的那几个分类
+// （见 live_recognizer.h）。
+class CategoryRecognizer {
+ public:
+    explicit CategoryRecognizer(const std::vector<Category>& categories,
+                                MatchPolicy policy = MatchPolicy::kByteOrder)
+        : policy_(policy) {
+        ScopedLatency timer(MetricHistogram::kRecognizerBuild);
+        ResolveFallback(categories);
+        Build(categories);
+    }
+
+    // 以 base 的表为底、叠加 overlay，不重新编译。base 须由分类表编译（不能来自快照）
+    // 且自身没有叠加层，否则抛 std::invalid_argument；overlay->changed 须与 base 使用同一策略
+    CategoryRecognizer(const CategoryRecognizer& base, std::shared_ptr<const CategoryOverlay> overlay);
+
+    MatchPolicy policy() const { return policy_; }
+
+    // 带叠加层的识别器不能存为快照（快照只有底版的表）
+    bool layered() const { return overlay_ != nullptr; }
+
+    // 非拥有视图：可直接传入 mmap/网络缓冲区中的备注，无需先构造 std::string
+    int RecognizeCategory(std::string_view note) const {
+        return RecognizeCategory(note.data(), note.size());
+    }
+
+    // 指针 + 长度形式，供 C 风格缓冲区调用方使用；note 不要求以 '\0' 结尾
+    int RecognizeCategory(const char* note, std::size_t len) const {
+        ScopedLatency timer(MetricHistogram::kClassify);
+        int id = 0;
+        if (Match(note, len, &id)) {
+            CountMetric(MetricCounter::kKeywordHits);
+            return id;
+        }
+
+        // 默认“其他”；无“其他”则返回第一个；无分类返回 0（构造时已解析）
+        CountMetric(fallback_metric_);
+        return fallback_id_;
+    }
+
+    // 只在命中关键词时返回 true 并写入 *id；未命中时不回退、不计指标，
+    // 供 FuzzyCategoryRecognizer 判断是否需要近似找回
+    bool TryRecognizeCategory(std::string_view note, int* id) const {
+        return Match(note.data(), note.size(), id);
+    }
+
+    // 未命中时返回的 id，以及计入的指标
+    int fallback_id() const { return fallback_id_; }
+    MetricCounter fallback_metric() const { return fallback_metric_; }
+
+    // 编译时由关键词、分类 id、优先级、策略与回退 id 算出的 64 位指纹：拷贝及用同一
+    // 分类表编译的识别器指纹相同，分类集合一变指纹就变（叠加层一并计入；快照加载的
+    // 识别器由快照校验和派生）。供 NoteMemoCache 等按识别器缓存结果的调用方作键
+    uint64_t fingerprint() const { return fingerprint_; }
+
+ private:
+    friend class RecognizerSnapshotCodec;
+    friend class CategoryRegistry;  // Compile()：沿用注册表已解析的回退 id
+
+    static constexpr uint32_t kNoMatch = UINT32_MAX;
+
+    // Build() 编译出的表
+    struct Tables {
+        std::vector<int32_t> next;
+        std::vector<uint32_t> output;
+        std::vector<uint32_t> own;   // 以该状态为终点的关键词（未沿失败链合并）
+        std::vector<int32_t> link;   // 失败链上下一个 own 非空的状态，0 表示没有
+        std::vector<int32_t> keyword_id;
+        std::vector<int32_t> keyword_len;
+        std::vector<int32_t> keyword_priority;
+    };
+
+    // 一次关键词命中；跨两个自动机比较时按策略排序用
+    struct Hit {
+        std::size_t end;  // 命中末尾在备注中的偏移
+        int32_t len;
+        int32_t priority;
+        int32_t id;
+    };
+
+    CategoryRecognizer() = default;
+
+    bool Match(const char* note, std::size_t len, int* id) const {
+        const uint32_t best = Scan(note, len);
+        if (overlay_ != nullptr) return MatchLayered(note, len, best, id);
+        if (best == kNoMatch) return false;
+        *id = keyword_id_[best];
+        return true;
+    }
+
+    // 定义在 CategoryOverlay 之后
+    bool MatchLayered(const char* note, std::size_t len, uint32_t best, int* id) const;
+
+    // 按扫描顺序枚举全部命中，包括同一位置被更优者遮住的，fn(关键词下标, 末尾偏移)。
+    // 空名字只在位置 0 报告一次。own_/link_ 只有 Build() 编出的表才有
+    template <typename Fn>
+    void ForEachHit(const char* note, std::size_t len, Fn&& fn) const {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(note);
+        if (own_[0] != kNoMatch) fn(own_[0], std::size_t{0});
+        int32_t state = 0;
+        for (std::size_t i = 0; i < len; ++i) {
+            if (!SkipAtRoot(state, p, i, len)) break;
+            state = Step(state, p[i]);
+            for (int32_t s = own_[state] != kNoMatch ? state : link_[state]; s != 0; s = link_[s]) fn(own_[s], i + 1);
+        }
+    }
+
+    // 与各 Scan* 的取舍规则一致的全序：a 是否优于 b
+    bool HitBetter(const Hit& a, const Hit& b, const char* note) const {
+        switch (policy_) {
+            case MatchPolicy::kByteOrder:
+                return std::string_view(note + a.end - a.len, static_cast<std::size_t>(a.len)) <
+                       std::string_view(note + b.end - b.len, static_cast<std::size_t>(b.len));
+            case MatchPolicy::kFirstOccurrence: {
+                const std::size_t a_start = a.end - static_cast<std::size_t>(a.len);
+                const std::size_t b_start = b.end - static_cast<std::size_t>(b.len);
+                if (a_start != b_start) return a_start < b_start;
+                if ((a.len == 0) != (b.len == 0)) return a.len == 0;  // 空名字直接胜出，同 ScanFirstOccurrence
+                return a.len > b.len;
+            }
+            case MatchPolicy::kLongestKeyword:
+                if (a.len != b.len) return a.len > b.len;
+                return a.end < b.end;
+            case MatchPolicy::kPriority:
+                if (a.priority != b.priority) return a.priority > b.priority;
+                if (a.end != b.end) return a.end < b.end;
+                return a.len > b.len;
+        }
+        return false;
+    }
+
+    // 按策略扫描一遍，返回最优关键词下标；未命中为 kNoMatch
+    uint32_t Scan(const char* note, std::size_t len) const {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(note);
+        switch (policy_) {
+            case MatchPolicy::kByteOrder: return ScanByteOrder(p, len);
+            case MatchPolicy::kFirstOccurrence: return ScanFirstOccurrence(p, len);
+            case MatchPolicy::kLongestKeyword: return ScanMaxScore(p, len, keyword_len_, max_len_);
+            case MatchPolicy::kPriority: return ScanMaxScore(p, len, keyword_priority_, max_priority_);
+        }
+        return kNoMatch;
+    }
+
+    int32_t Step(int32_t state, unsigned char ch) const {
+        return next_[static_cast<std::size_t>(state) * static_cast<std::size_t>(num_classes_) +
+                     byte_class_[ch]];
+    }
+
+    // 在根状态时跳过不可能开始匹配的位置；返回 false 表示扫描已到末尾
+    bool SkipAtRoot(int32_t state, const unsigned char* p, std::size_t& i, std::size_t len) const {
+        if (state != 0) return true;
+        i = prefilter_.Next(p, i, len);
+        return i < len;
+    }
+
+    // 关键词下标即字节序 rank：取最小者，命中 rank 0 即可提前结束
+    uint32_t ScanByteOrder(const unsigned char* p, std::size_t len) const {
+        uint32_t best = output_[0];
+        int32_t state = 0;
+        for (std::size_t i = 0; i < len && best != 0; ++i) {
+            if (!SkipAtRoot(state, p, i, len)) break;
+            state = Step(state, p[i]);
+            if (output_[state] < best) best = output_[state];
+        }
+        return best;
+    }
+
+    // 取 score 最大者，等分保留先出现者；达到全局最大分即提前结束
+    uint32_t ScanMaxScore(const unsigned char* p, std::size_t len,
+                          const int32_t* score, int max_score) const {
+        uint32_t best = output_[0];
+        int32_t state = 0;
+        for (std::size_t i = 0; i < len; ++i) {
+            if (best != kNoMatch && score[best] == max_score) break;
+            if (!SkipAtRoot(state, p, i, len)) break;
+            state = Step(state, p[i]);
+            const uint32_t kw = output_[state];
+            if (kw != kNoMatch && (best == kNoMatch || score[kw] > score[best])) best = kw;
+        }
+        return best;
+    }
+
+    // 每个状态记录最长的结束关键词，于是该处可能的最早起点为 i + 1 - len。
+    // 当后续任何匹配的起点都不可能更早时提前结束。
+    uint32_t ScanFirstOccurrence(const unsigned char* p, std::size_t len) const {
+        uint32_t best = output_[0];
+        if (best != kNoMatch) return best;  // 空名字在位置 0 命中
+        std::size_t best_start = 0;
+        int32_t state = 0;
+        for (std::size_t i = 0; i < len; ++i) {
+            if (best != kNoMatch && i + 1 > best_start + static_cast<std::size_t>(max_len_)) break;
+            if (!SkipAtRoot(state, p, i, len)) break;
+            state = Step(state, p[i]);
+            const uint32_t kw = output_[state];
+            if (kw == kNoMatch) continue;
+            const std::size_t start = i + 1 - static_cast<std::size_t>(keyword_len_[kw]);
+            if (best == kNoMatch || start < best_start ||
+                (start == best_start && keyword_len_[kw] > keyword_len_[best])) {
+                best = kw;
+                best_start = start;
+            }
+        }
+        return best;
+    }
+
+    // 同一状态上多个结束关键词之间的取舍（own 为该状态自身的关键词）
+    bool StateBetter(uint32_t a, uint32_t b) const {
+        if (b == kNoMatch) return a != kNoMatch;
+        if (a == kNoMatch) return false;
+        switch (policy_) {
+            case MatchPolicy::kByteOrder:
+                return a < b;
+            case MatchPolicy::kPriority:
+                if (keyword_priority_[a] != keyword_priority_[b]) {
+                    return keyword_priority_[a] > keyword_priority_[b];
+                }
+                return keyword_len_[a] > keyword_len_[b];
+            case MatchPolicy::kFirstOccurrence:
+            case MatchPolicy::kLongestKeyword:
+                return keyword_len_[a] > keyword_len_[b];
+        }
+        return false;
+    }
+
+    static uint64_t MixFingerprint(uint64_t h, uint64_t v) {
+        h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebull;
+        h ^= h >> 31;
+        return h;
+    }
+
+    // 未命中时的回退规则：“其他” → 第一个分类 → 0。CategoryRegistry 以同样规则预先解析好
+    void ResolveFallback(const std::vector<Category>& categories) {
+        fallback_id_ = categories.empty() ? 0 : categories[0].id;
+        fallback_metric_ = categories.empty() ? MetricCounter::kNoCategories : MetricCounter::kFallbackFirst;
+        for (const auto& c : categories) {
+            if (c.name == "其他") {
+                fallback_id_ = c.id;
+                fallback_metric_ = MetricCounter::kFallbackOther;
+                break;
+            }
+        }
+    }
+
+    void Build(const std::vector<Category>& categories) {
+        // 同一关键词（名字或别名）出现在多个分类中时以最后出现者为准，与原
+        // keyword_map[c.name] = c.id 一致；std::map 的遍历顺序即关键词的字节序 rank。
+        // 空别名会命中任何备注，视为误配置忽略（空名字保持原语义）。
+        std::map<std::string, const Category*> keyword_map;
+        for (const auto& c : categories) {
+            keyword_map[c.name] = &c;
+            for (const auto& k : c.keywords) {
+                if (!k.empty()) keyword_map[k] = &c;
+            }
+        }
+
+        // 字节类压缩：只有关键词中出现过的字节拥有独立的类
+        byte_class_.fill(0);
+        num_classes_ = 1;
+        for (const auto& kv : keyword_map) {
+            for (unsigned char ch : kv.first) {
+                if (byte_class_[ch] == 0) byte_class_[ch] = static_cast<uint16_t>(num_classes_++);
+            }
+        }
+
+        std::vector<std::string_view> keywords;
+        keywords.reserve(keyword_map.size());
+        for (const auto& kv : keyword_map) keywords.push_back(kv.first);
+        prefilter_.Build(keywords);
+
+        // 1) 构建 trie；未定义的转移暂记为 -1
+        auto tables = std::make_shared<Tables>();
+        std::vector<int32_t>& next = tables->next;
+        std::vector<uint32_t>& output = tables->output;
+        const std::size_t width = static_cast<std::size_t>(num_classes_);
+        next.assign(width, -1);
+        output.assign(1, kNoMatch);
+        max_len_ = 0;
+        max_priority_ = 0;
+        uint64_t fingerprint = MixFingerprint(static_cast<uint64_t>(policy_), static_cast<uint64_t>(fallback_id_));
+        for (const auto& kv : keyword_map) {
+            const uint32_t kw = static_cast<uint32_t>(tables->keyword_id.size());
+            const int32_t len = static_cast<int32_t>(kv.first.size());
+            const int32_t priority = kv.second->priority;
+            fingerprint = MixFingerprint(fingerprint, std::hash<std::string_view>()(kv.first));
+            fingerprint = MixFingerprint(fingerprint, static_cast<uint64_t>(static_cast<uint32_t>(kv.second->id)) << 32 |
+                                                          static_cast<uint32_t>(priority));
+            tables->keyword_id.push_back(kv.second->id);
+            tables->keyword_len.push_back(len);
+            tables->keyword_priority.push_back(priority);
+            if (kw == 0 || len > max_len_) max_len_ = len;
+            if (kw == 0 || priority > max_priority_) max_priority_ = priority;
+
+            int32_t state = 0;
+            for (unsigned char ch : kv.first) {
+                const std::size_t slot = static_cast<std::size_t>(state) * width + byte_class_[ch];
+                if (next[slot] < 0) {
+                    next[slot] = static_cast<int32_t>(output.size());
+                    next.resize(next.size() + width, -1);
+                    output.push_back(kNoMatch);
+                }
+                state = next[slot];
+            }
+            output[state] = kw;
+        }
+        tables->own = output;
+        std::vector<int32_t>& link = tables->link;
+        link.assign(output.size(), 0);
+
+        keyword_id_ = tables->keyword_id.data();
+        keyword_len_ = tables->keyword_len.data();
+        keyword_priority_ = tables->keyword_priority.data();  // StateBetter 需要
+
+        // 2) BFS 计算失败链接，同时补全为 DFA 并沿失败链合并输出
+        std::vector<int32_t> fail(output.size(), 0);
+        std::deque<int32_t> queue;
+        for (std::size_t c = 0; c < width; ++c) {
+            int32_t& to = next[c];
+            if (to < 0) {
+                to = 0;
+            } else {
+                fail[to] = 0;
+                queue.push_back(to);
+            }
+        }
+        while (!queue.empty()) {
+            const int32_t state = queue.front();
+            queue.pop_front();
+            const uint32_t inherited = output[fail[state]];
+            if (StateBetter(inherited, output[state])) output[state] = inherited;
+
+            const std::size_t base = static_cast<std::size_t>(state) * width;
+            const std::size_t fail_base = static_cast<std::size_t>(fail[state]) * width;
+            for (std::size_t c = 0; c < width; ++c) {
+                int32_t& to = next[base + c];
+                if (to < 0) {
+                    to = next[fail_base + c];
+                } else {
+                    const int32_t f = next[fail_base + c];
+                    fail[to] = f;
+                    link[to] = f != 0 && tables->own[f] != kNoMatch ? f : link[f];
+                    queue.push_back(to);
+                }
+            }
+        }
+
+        next_ = next.data();
+        output_ = output.data();
+        own_ = tables->own.data();
+        link_ = link.data();
+        num_states_ = output.size();
+        num_keywords_ = tables->keyword_id.size();
+        fingerprint_ = fingerprint;
+        owner_ = std::move(tables);
+    }
+
+    MatchPolicy policy_ = MatchPolicy::kByteOrder;
+    std::array<uint16_t, 256> byte_class_{};
+    int32_t num_classes_ = 1;
+    std::size_t num_states_ = 0;
+    std::size_t num_keywords_ = 0;
+    // 以下表由 owner_ 持有（Tables 或快照的内存映射）
+    std::shared_ptr<const void> owner_;
+    const int32_t* next_ = nullptr;             // 稠密转移表：state * num_classes_ + class
+    const uint32_t* output_ = nullptr;          // 每个状态按策略最优的结束关键词
+    const int32_t* keyword_id_ = nullptr;       // 关键词下标（= 字节序 rank）→ 分类 id
+    const int32_t* keyword_len_ = nullptr;
+    const int32_t* keyword_priority_ = nullptr;
+    const uint32_t* own_ = nullptr;             // 仅 Build()：快照不保存，加载后为空
+    const int32_t* link_ = nullptr;
+    int max_len_ = 0;
+    int max_priority_ = 0;
+    int fallback_id_ = 0;
+    MetricCounter fallback_metric_ = MetricCounter::kNoCategories;  // 回退时计入哪一项
+    uint64_t fingerprint_ = 0;
+    KeywordPrefilter prefilter_;
+    std::shared_ptr<const CategoryOverlay> overlay_;
+};
+
+// 叠加在底版识别器上的修改（由 LiveCategoryRecognizer 生成）。底版中 id 属于
+// dirty_ids 的关键词一律作废；这些分类若仍存在，其当前版本按当前分类表的顺序
+// 编译在 changed 里。与未改动分类共用某个关键词的分类也须列入 dirty_ids，
+// 同名关键词“以最后出现者为准”才能只在 changed 内部决出。
+struct CategoryOverlay {
+    std::vector<int> dirty_ids;  // 升序
+    CategoryRecognizer changed;
+    int fallback_id = 0;  // 按修改后的分类表解析
+    MetricCounter fallback_metric = MetricCounter::kNoCategories;
+
+    bool Dirty(int id) const { return std::binary_search(dirty_ids.begin(), dirty_ids.end(), id); }
+};
+
+inline CategoryRecognizer::CategoryRecognizer(const CategoryRecognizer& base,
+                                              std::shared_ptr<const CategoryOverlay> overlay)
+    : CategoryRecognizer(base) {
+    if (base.own_ == nullptr || base.layered() || overlay == nullptr) {
+        throw std::invalid_argument("CategoryRecognizer: overlay needs a compiled, unlayered base");
+    }
+    overlay_ = std::move(overlay);
+    fallback_id_ = overlay_->fallback_id;
+    fallback_metric_ = overlay_->fallback_metric;
+    fingerprint_ = MixFingerprint(MixFingerprint(base.fingerprint_, overlay_->changed.fingerprint_),
+                                  static_cast<uint64_t>(fallback_id_));
+    for (int id : overlay_->dirty_ids) fingerprint_ = MixFingerprint(fingerprint_, static_cast<uint64_t>(id));
+}
+
+// 底版最优命中不属于被改分类、叠加层又没有命中时（绝大多数备注）直接采用底版结果；
+// 否则枚举两边的全部命中，跳过作废的关键词后按策略取最优
+inline bool CategoryRecognizer::MatchLayered(const char* note, std::size_t len, uint32_t best, int* id) const {
+    const CategoryOverlay& overlay = *overlay_;
+    const CategoryRecognizer& changed = overlay.changed;
+    const uint32_t top = changed.Scan(note, len);
+    if (best == kNoMatch && top == kNoMatch) return false;
+    if (best == kNoMatch) {  // 底版什么都没命中，结果只取决于叠加层
+        *id = changed.keyword_id_[top];
+        return true;
+    }
+    if (top == kNoMatch && !overlay.Dirty(keyword_id_[best])) {
+        *id = keyword_id_[best];
+        return true;
+    }
+
+    Hit winner{};
+    bool found = false;
+    auto offer = [&](const Hit& hit) {
+        if (!found || HitBetter(hit, winner, note)) {
+            winner = hit;
+            found = true;
+        }
+    };
+    ForEachHit(note, len, [&](uint32_t kw, std::size_t end) {
+        if (!overlay.Dirty(keyword_id_[kw])) offer(Hit{end, keyword_len_[kw], keyword_priority_[kw], keyword_id_[kw]});
+    });
+    if (top != kNoMatch) {
+        changed.ForEachHit(note, len, [&](uint32_t kw, std::size_t end) {
+            offer(Hit{end, changed.keyword_len_[kw], changed.keyword_priority_[kw], changed.keyword_id_[kw]});
+        });
+    }
+    if (!found) return false;
+    *id = winner.id;
+    return true;
+}
@@ -0,0 +1,240 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "category_recognizer.h"
+#include "metrics.h"
+
+// ===================== 组件B：分类注册表 =====================
+// 按 id 查分类、按名字查 id、取回退分类原本都要线性扫描 std::vector<Category>，
+// 上万个分类时每次查找都走一遍整张表。注册表在构造时一次建好两张索引：
+//
+// - id → 下标：id 的跨度不大（不超过分类数的 4 倍加 64）时是以 id - 最小 id
+//   为下标的稠密数组，一次数组访问；跨度过大时退化为开放寻址哈希表。
+// - 名字 → 下标：开放寻址哈希表（线性探测，负载不超过 1/2），槽位里存 32 位
+//   哈希值，只有哈希相同时才比较名字。
+//
+// 所有名字另外拼接在一块连续内存里，槽位、下标数组和名字都是紧凑的平铺数组，
+// 上万个分类时也基本留在缓存里，不必逐个解引用 std::string。
+//
+// 注册表构造后不可变，可在线程间共享。同一 id 或同一名字出现多次时以第一个
+// 为准（识别器匹配关键词时同名以最后出现者为准，这是两回事）。
+namespace category_registry_detail {
+
+constexpr uint32_t kEmptySlot = UINT32_MAX;
+
+// FNV-1a 32，对分类名这样的短串足够均匀
+inline uint32_t HashName(std::string_view s) {
+    uint32_t h = 2166136261u;
+    for (unsigned char ch : s) {
+        h ^= ch;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+inline uint32_t HashId(int32_t id) {
+    uint32_t h = static_cast<uint32_t>(id) * 0x9E3779B1u;
+    return h ^ (h >> 16);
+}
+
+// 2 的幂，至少为 2n，至少为 8
+inline std::size_t TableSize(std::size_t n) {
+    std::size_t c = 8;
+    while (c < 2 * n) c <<= 1;
+    return c;
+}
+
+}  // namespace category_registry_detail
+
+class CategoryRegistry {
+ public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    CategoryRegistry() : CategoryRegistry(std::vector<Category>{}) {}
+
+    explicit CategoryRegistry(std::vector<Category> categories)
+        : categories_(std::move(categories)), serial_(NextSerial()) {
+        BuildNames();
+        BuildIds();
+        ResolveFallback();
+    }
+
+    // 构造时分配的全局序号，拷贝保留。注册表不可变，序号相同即内容相同，
+    // 调用方可据此判断缓存的识别器是否过期（内容相同的两个注册表序号不同）
+    uint64_t serial() const { return serial_; }
+
+    std::size_t size() const { return categories_.size(); }
+    bool empty() const { return categories_.empty(); }
+    const std::vector<Category>& categories() const { return categories_; }
+
+    // 在 categories() 中的下标；未知 id 返回 npos
+    std::size_t IndexOf(int id) const {
+        if (dense_) {
+            const uint64_t slot = static_cast<uint64_t>(static_cast<int64_t>(id) - id_min_);
+            if (slot >= id_index_.size()) return npos;
+            const uint32_t index = id_index_[static_cast<std::size_t>(slot)];
+            return index == category_registry_detail::kEmptySlot ? npos : index;
+        }
+        const std::size_t mask = id_slots_.size() - 1;
+        for (std::size_t s = category_registry_detail::HashId(id) & mask;; s = (s + 1) & mask) {
+            const IdSlot& slot = id_slots_[s];
+            if (slot.index == category_registry_detail::kEmptySlot) return npos;
+            if (slot.id == id) return slot.index;
+        }
+    }
+
+    bool Contains(int id) const { return IndexOf(id) != npos; }
+
+    const Category* Find(int id) const {
+        const std::size_t index = IndexOf(id);
+        return index == npos ? nullptr : &categories_[index];
+    }
+
+    // 报表用：未知 id 返回空串。视图指向注册表内部，注册表存活期间有效
+    std::string_view Name(int id) const {
+        const std::size_t index = IndexOf(id);
+        return index == npos ? std::string_view() : NameAt(index);
+    }
+
+    // 名字在 categories() 中的下标；未知名字返回 npos
+    std::size_t IndexOfName(std::string_view name) const {
+        const uint32_t hash = category_registry_detail::HashName(name);
+        const std::size_t mask = name_slots_.size() - 1;
+        for (std::size_t s = hash & mask;; s = (s + 1) & mask) {
+            const NameSlot& slot = name_slots_[s];
+            if (slot.index == category_registry_detail::kEmptySlot) return npos;
+            if (slot.hash == hash && NameAt(slot.index) == name) return slot.index;
+        }
+    }
+
+    const Category* FindByName(std::string_view name) const {
+        const std::size_t index = IndexOfName(name);
+        return index == npos ? nullptr : &categories_[index];
+    }
+
+    // 与 CategoryRecognizer 相同的回退规则：“其他” → 第一个分类 → 0
+    int fallback_id() const { return fallback_id_; }
+    MetricCounter fallback_metric() const { return fallback_metric_; }
+
+    // 用注册表的分类编译识别器，回退 id 直接取已解析好的，不再扫一遍找“其他”
+    CategoryRecognizer Compile(MatchPolicy policy = MatchPolicy::kByteOrder) const {
+        ScopedLatency timer(MetricHistogram::kRecognizerBuild);
+        CategoryRecognizer cr;
+        cr.policy_ = policy;
+        cr.fallback_id_ = fallback_id_;
+        cr.fallback_metric_ = fallback_metric_;
+        cr.Build(categories_);
+        return cr;
+    }
+
+ private:
+    struct NameSlot {
+        uint32_t hash = 0;
+        uint32_t index = category_registry_detail::kEmptySlot;
+    };
+
+    struct IdSlot {
+        int32_t id = 0;
+        uint32_t index = category_registry_detail::kEmptySlot;
+    };
+
+    static uint64_t NextSerial() {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::string_view NameAt(std::size_t index) const {
+        const uint32_t begin = index == 0 ? 0 : name_end_[index - 1];
+        return std::string_view(names_.data() + begin, name_end_[index] - begin);
+    }
+
+    void BuildNames() {
+        std::size_t total = 0;
+        for (const auto& c : categories_) total += c.name.size();
+        names_.reserve(total);
+        name_end_.reserve(categories_.size());
+        for (const auto& c : categories_) {
+            names_ += c.name;
+            name_end_.push_back(static_cast<uint32_t>(names_.size()));
+        }
+
+        name_slots_.assign(category_registry_detail::TableSize(categories_.size()), NameSlot{});
+        const std::size_t mask = name_slots_.size() - 1;
+        for (std::size_t i = 0; i < categories_.size(); ++i) {
+            const std::string_view name = NameAt(i);
+            const uint32_t hash = category_registry_detail::HashName(name);
+            for (std::size_t s = hash & mask;; s = (s + 1) & mask) {
+                NameSlot& slot = name_slots_[s];
+                if (slot.index == category_registry_detail::kEmptySlot) {
+                    slot = {hash, static_cast<uint32_t>(i)};
+                    break;
+                }
+                if (slot.hash == hash && NameAt(slot.index) == name) break;  // 同名保留第一个
+            }
+        }
+    }
+
+    void BuildIds() {
+        int64_t id_min = 0;
+        int64_t id_max = -1;
+        for (std::size_t i = 0; i < categories_.size(); ++i) {
+            const int64_t id = categories_[i].id;
+            if (i == 0 || id < id_min) id_min = id;
+            if (i == 0 || id > id_max) id_max = id;
+        }
+        const uint64_t span = static_cast<uint64_t>(id_max - id_min + 1);
+        dense_ = span <= 4 * static_cast<uint64_t>(categories_.size()) + 64;
+        if (dense_) {
+            id_min_ = id_min;
+            id_index_.assign(static_cast<std::size_t>(span), category_registry_detail::kEmptySlot);
+            for (std::size_t i = categories_.size(); i-- > 0;) {  // 倒序写入，重复 id 留下第一个
+                id_index_[static_cast<std::size_t>(categories_[i].id - id_min)] = static_cast<uint32_t>(i);
+            }
+            return;
+        }
+
+        id_slots_.assign(category_registry_detail::TableSize(categories_.size()), IdSlot{});
+        const std::size_t mask = id_slots_.size() - 1;
+        for (std::size_t i = 0; i < categories_.size(); ++i) {
+            const int32_t id = categories_[i].id;
+            for (std::size_t s = category_registry_detail::HashId(id) & mask;; s = (s + 1) & mask) {
+                IdSlot& slot = id_slots_[s];
+                if (slot.index == category_registry_detail::kEmptySlot) {
+                    slot = {id, static_cast<uint32_t>(i)};
+                    break;
+                }
+                if (slot.id == id) break;
+            }
+        }
+    }
+
+    void ResolveFallback() {
+        const std::size_t other = IndexOfName("其他");
+        if (other != npos) {
+            fallback_id_ = categories_[other].id;
+            fallback_metric_ = MetricCounter::kFallbackOther;
+        } else if (!categories_.empty()) {
+            fallback_id_ = categories_[0].id;
+            fallback_metric_ = MetricCounter::kFallbackFirst;
+        }
+    }
+
+    std::vector<Category> categories_;
+    uint64_t serial_ = 0;
+    std::string names_;               // 全部名字首尾相接
+    std::vector<uint32_t> name_end_;  // 第 i 个名字为 names_[name_end_[i - 1], name_end_[i])
+    std::vector<NameSlot> name_slots_;
+    bool dense_ = true;
+    int64_t id_min_ = 0;
+    std::vector<uint32_t> id_index_;  // 稠密模式：id - id_min_ → 下标
+    std::vector<IdSlot> id_slots_;    // 稀疏模式
+    int fallback_id_ = 0;
+    MetricCounter fallback_metric_ = MetricCounter::kNoCategories;
+};
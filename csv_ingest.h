@@ -0,0 +1,312 @@
+﻿#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "simd_support.h"
+#include "transaction_batch.h"
+
+// ===================== 导入：SIMD 分隔符扫描 =====================
+// 返回 [p, end) 中第一个等于 a 或 b 的位置，找不到返回 end。
+// 每次比较 16 字节；没有 SSE2/NEON 时退化为逐字节扫描。
+inline const char* FindEither(const char* p, const char* end, char a, char b) {
+#if defined(ACCOUNT_BOOK_HAVE_SSE2)
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const int mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)));
+        if (mask != 0) return p + CountTrailingZeros(static_cast<unsigned>(mask));
+        p += 16;
+    }
+#elif defined(ACCOUNT_BOOK_HAVE_NEON)
+    const uint8x16_t va = vdupq_n_u8(static_cast<uint8_t>(a));
+    const uint8x16_t vb = vdupq_n_u8(static_cast<uint8_t>(b));
+    while (end - p >= 16) {
+        const uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        const uint8x16_t hit = vorrq_u8(vceqq_u8(chunk, va), vceqq_u8(chunk, vb));
+        if (vmaxvq_u8(hit) != 0) break;  // 块内有命中，交给下面的标量循环定位
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == a || *p == b) return p;
+    }
+    return end;
+}
+
+// ===================== 导入：CSV/TSV 记录切分 =====================
+// 支持 RFC 4180 引号字段（"" 转义、字段内换行）、CRLF 行尾、UTF-8 BOM 和空行。
+// 字段以视图形式指向原始缓冲区；只有含 "" 转义的字段需要反转义，
+// 这类字段写入调用方提供的 scratch（deque 追加时不移动已有元素，视图保持有效）。
+class CsvRecordScanner {
+ public:
+    CsvRecordScanner(std::string_view data, char delimiter)
+        : p_(data.data()), end_(data.data() + data.size()), delim_(delimiter) {
+        if (end_ - p_ >= 3 && std::memcmp(p_, "\xEF\xBB\xBF", 3) == 0) p_ += 3;
+    }
+
+    bool done() const { return p_ >= end_; }
+    const char* position() const { return p_; }
+
+    // 读取下一条非空记录；没有更多记录时返回 false
+    bool Next(std::vector<std::string_view>& fields, std::deque<std::string>& scratch) {
+        while (p_ < end_) {
+            fields.clear();
+            if (ParseRecord(fields, scratch)) return true;
+        }
+        return false;
+    }
+
+ private:
+    // 返回 false 表示这是一个空行
+    bool ParseRecord(std::vector<std::string_view>& fields, std::deque<std::string>& scratch) {
+        for (;;) {
+            std::string_view field;
+            const char* q;
+            if (p_ < end_ && *p_ == '"') {
+                field = ParseQuoted(scratch);
+                q = FindEither(p_, end_, delim_, '\n');  // 跳过右引号后的多余字符
+            } else {
+                q = FindEither(p_, end_, delim_, '\n');
+                const char* field_end = q;
+                if ((q == end_ || *q == '\n') && field_end > p_ && field_end[-1] == '\r') --field_end;
+                field = std::string_view(p_, static_cast<std::size_t>(field_end - p_));
+            }
+            fields.push_back(field);
+
+            if (q == end_) {
+                p_ = end_;
+                break;
+            }
+            p_ = q + 1;
+            if (*q == '\n') break;
+        }
+        return !(fields.size() == 1 && fields[0].empty());
+    }
+
+    std::string_view ParseQuoted(std::deque<std::string>& scratch) {
+        const char* start = ++p_;
+        bool escaped = false;
+        for (;;) {
+            const char* q = static_cast<const char*>(
+                std::memchr(p_, '"', static_cast<std::size_t>(end_ - p_)));
+            if (q == nullptr) {  // 未闭合的引号：取到文件末尾
+                p_ = end_;
+                return Unescape(start, end_, escaped, scratch);
+            }
+            if (q + 1 < end_ && q[1] == '"') {
+                escaped = true;
+                p_ = q + 2;
+                continue;
+            }
+            p_ = q + 1;
+            return Unescape(start, q, escaped, scratch);
+        }
+    }
+
+    static std::string_view Unescape(const char* begin, const char* end, bool escaped,
+                                     std::deque<std::string>& scratch) {
+        if (!escaped) return std::string_view(begin, static_cast<std::size_t>(end - begin));
+        scratch.emplace_back();
+        std::string& s = scratch.back();
+        s.reserve(static_cast<std::size_t>(end - begin));
+        for (const char* c = begin; c < end; ++c) {
+            s.push_back(*c);
+            if (*c == '"' && c + 1 < end && c[1] == '"') ++c;
+        }
+        return s;
+    }
+
+    const char* p_;
+    const char* end_;
+    char delim_;
+};
+
+// ===================== 导入：流水线 =====================
+struct CsvIngestOptions {
+    char delimiter = ',';            // TSV 用 '\t'
+    std::size_t note_column = 0;
+    std::size_t date_column = 1;     // 缺失或为空时自动填当天
+    std::size_t amount_column = 2;   // 缺失或为空时记为 0
+    bool has_header = false;
+    std::size_t chunk_rows = 64 * 1024;  // 每块行数上限，决定常驻内存
+    WorkStealingPool* pool = nullptr;    // 非空时每块在线程池上并行分类
+};
+
+struct IngestStats {
+    bool ok = true;
+    std::string error;
+    std::size_t rows = 0;
+    std::size_t bytes = 0;
+    std::size_t chunks = 0;
+    double seconds = 0.0;
+
+    double RowsPerSecond() const { return seconds > 0.0 ? static_cast<double>(rows) / seconds : 0.0; }
+};
+
+// 每处理完一块就以 TransactionBatch 回调一次；回调返回后该批被复用
+using IngestSink = std::function<void(const TransactionBatch&)>;
+
+namespace csv_ingest_detail {
+
+// 每块回调之后以 data 中已不再引用的前缀长度调用一次，供调用方释放这部分输入
+using ConsumedFn = std::function<void(std::size_t)>;
+
+inline IngestStats Ingest(std::string_view data,
+                          const CategoryRecognizer& cr,
+                          const CsvIngestOptions& options,
+                          const IngestSink& sink,
+                          const ConsumedFn& consumed) {
+    struct Chunk {
+        std::vector<TransactionInput> inputs;
+        std::deque<std::string> scratch;
+        std::size_t end = 0;  // 本块最后一条记录之后在 data 中的偏移
+    };
+
+    const auto started = std::chrono::steady_clock::now();
+    IngestStats stats;
+    stats.bytes = data.size();
+    const std::size_t chunk_rows = options.chunk_rows == 0 ? 1 : options.chunk_rows;
+
+    Chunk slots[2];
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<Chunk*> free_slots = {&slots[0], &slots[1]};
+    std::deque<Chunk*> full_slots;
+    bool producer_done = false;
+    bool cancelled = false;
+    std::exception_ptr producer_error;
+
+    auto produce = [&] {
+        CsvRecordScanner scanner(data, options.delimiter);
+        std::vector<std::string_view> fields;
+        bool skip_header = options.has_header;
+        for (;;) {
+            Chunk* chunk = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mu);
+                cv.wait(lock, [&] { return cancelled || !free_slots.empty(); });
+                if (cancelled) break;
+                chunk = free_slots.front();
+                free_slots.pop_front();
+            }
+            chunk->inputs.clear();
+            chunk->scratch.clear();
+            while (chunk->inputs.size() < chunk_rows && scanner.Next(fields, chunk->scratch)) {
+                if (skip_header) {
+                    skip_header = false;
+                    continue;
+                }
+                TransactionInput in;
+                if (options.note_column < fields.size()) in.note = fields[options.note_column];
+                if (options.date_column < fields.size()) in.date = fields[options.date_column];
+                if (options.amount_column < fields.size()) in.amount = fields[options.amount_column];
+                chunk->inputs.push_back(in);
+            }
+            chunk->end = static_cast<std::size_t>(scanner.position() - data.data());
+            const bool last = scanner.done();
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                if (!chunk->inputs.empty()) {
+                    full_slots.push_back(chunk);
+                } else {
+                    free_slots.push_back(chunk);
+                }
+                if (last) producer_done = true;
+            }
+            cv.notify_all();
+            if (last) break;
+        }
+    };
+    // 解析线程里的异常（如 bad_alloc）不能逃出 std::thread：记下来，join 后在调用线程重新抛出
+    std::thread producer([&] {
+        try {
+            produce();
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                producer_error = std::current_exception();
+                producer_done = true;
+            }
+            cv.notify_all();
+        }
+    });
+
+    TransactionBatch batch;
+    std::exception_ptr error;
+    for (;;) {
+        Chunk* chunk = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mu);
+            cv.wait(lock, [&] { return producer_done || !full_slots.empty(); });
+            if (producer_error || full_slots.empty()) break;
+            chunk = full_slots.front();
+            full_slots.pop_front();
+        }
+        try {
+            batch.Clear();
+            batch.AppendClassified(chunk->inputs.data(), chunk->inputs.size(), cr, options.pool);
+            stats.rows += batch.size();
+            ++stats.chunks;
+            if (sink) sink(batch);
+            if (consumed) consumed(chunk->end);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            free_slots.push_back(chunk);
+            if (error) cancelled = true;
+        }
+        cv.notify_all();
+        if (error) break;
+    }
+    producer.join();
+    if (error) std::rethrow_exception(error);
+    if (producer_error) std::rethrow_exception(producer_error);
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return stats;
+}
+
+}  // namespace csv_ingest_detail
+
+// 解析线程切分下一块的同时，调用线程分类并回调上一块（双缓冲），
+// 因此解析与分类重叠，且任何时刻最多两块在内存中。
+// 分类或回调抛出的异常、解析线程里的异常都在两个线程收尾后从这里重新抛出
+inline IngestStats IngestCsvBuffer(std::string_view data,
+                                   const CategoryRecognizer& cr,
+                                   const CsvIngestOptions& options,
+                                   const IngestSink& sink) {
+    return csv_ingest_detail::Ingest(data, cr, options, sink, nullptr);
+}
+
+// mmap 整个文件后按块导入；每块处理完就把已消费的整页交还内核（MappedFile::DiscardPrefix），
+// 常驻的文件页只有正在解析与分类的两块左右，不随文件大小增长
+inline IngestStats IngestCsvFile(const std::string& path,
+                                 const CategoryRecognizer& cr,
+                                 const CsvIngestOptions& options,
+                                 const IngestSink& sink) {
+    MappedFile file;
+    IngestStats stats;
+    if (!file.Open(path, &stats.error)) {
+        stats.ok = false;
+        return stats;
+    }
+    return csv_ingest_detail::Ingest(file.view(), cr, options, sink,
+                                     [&file](std::size_t consumed) { file.DiscardPrefix(consumed); });
+}
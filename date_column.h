@@ -0,0 +1,198 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "date_utils.h"
+#include "simd_support.h"
+#include "transaction.h"
+
+// ===================== 导入：批量日期解析与校验 =====================
+// 一列手工日期文本一次解析成打包日期，同一遍扫描里把格式或日历不合法的行
+// 记入错误位图，结果与逐行 PackedDate::Parse 完全一致，不用正则。
+//
+// 每行长度为 10 时读成两个整数：a = "YYYY-MM-"（8 字节）、b = "DD"；把日的
+// 两位填进 a 中两个 '-' 的位置，10 个字符就成了一个 64 位字里的 8 位数字，
+// 数字校验、'-' 校验都是整字运算。AVX2 路径每次处理 4 行：逐字节减 '0'，
+// 字节重排成 YYYYMMDD，再用两次乘加得到年与 (月 << 5 | 日)，月份天数查
+// 16 字节表；只有 2 月 29 日才回到标量判断闰年。所有按字节的读法假定小端
+// 主机，与快照、日志的文件格式一致。
+//
+// 空串表示“自动填当天”，写入 today，不算错误。
+namespace date_column_detail {
+
+constexpr uint64_t kDashMask = 0xFF0000FF00000000ull;  // 第 4、7 字节
+constexpr uint64_t kDashes = 0x2D00002D00000000ull;
+
+// 第 i 月天数 + 1（2 月按 30，即允许 29 日，闰年另判）；下标 0 与 13..15 为 0
+constexpr uint8_t kDaysPlusOne[16] = {0, 32, 30, 32, 31, 32, 31, 32, 32, 31, 32, 31, 32, 0, 0, 0};
+
+// 长度不为 10 时返回全 0，之后的校验必然失败
+inline void LoadWords(std::string_view s, uint64_t& a, uint64_t& b) {
+    uint16_t day = 0;
+    a = 0;
+    if (s.size() == 10) {
+        std::memcpy(&a, s.data(), 8);
+        std::memcpy(&day, s.data() + 8, 2);
+    }
+    b = day;
+}
+
+// 把日的两位放进两个 '-' 的位置：Y Y Y Y D M M D
+inline uint64_t MergeDay(uint64_t a, uint64_t b) {
+    return (a & ~kDashMask) | ((b & 0xFF) << 32) | ((b >> 8) << 56);
+}
+
+// 每个字节都在 '0'..'9'：高半字节为 3，且加 6 后高半字节仍为 3
+inline bool AllDigits(uint64_t x) {
+    return ((x & 0xF0F0F0F0F0F0F0F0ull) | (((x + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+           0x3333333333333333ull;
+}
+
+inline uint32_t ParseWordsScalar(uint64_t a, uint64_t b) {
+    const uint64_t x = MergeDay(a, b);
+    const bool syntax = ((a & kDashMask) == kDashes) & AllDigits(x);
+    const uint64_t v = x - 0x3030303030303030ull;
+    const auto digit = [v](int i) { return static_cast<uint32_t>((v >> (8 * i)) & 0xFF); };
+    const uint32_t year = digit(0) * 1000 + digit(1) * 100 + digit(2) * 10 + digit(3);
+    const uint32_t month = digit(5) * 10 + digit(6);
+    const uint32_t day = digit(4) * 10 + digit(7);
+    const bool feb29 = month == 2 && day == 29;
+    const bool calendar = year >= 1 && month - 1 < 12u && day - 1 < kDaysPlusOne[month & 15] - 1u &&
+                          (!feb29 || PackedDate::IsLeapYear(static_cast<int>(year)));
+    return syntax && calendar ? (year << 9) | (month << 5) | day : 0u;
+}
+
+#if defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH)
+// 4 行：a[i]、b[i] 见 LoadWords；out 写 4 个打包日期（无效为 0），返回有效行的位掩码
+ACCOUNT_BOOK_TARGET("avx2")
+inline unsigned ParseWords4Avx2(const uint64_t* a, const uint64_t* b, uint32_t* out) {
+    // 逐个插入而不是整块读回：刚写下的 4 个 64 位值整块读会卡在存储转发上
+    const __m256i A = _mm256_set_epi64x(static_cast<long long>(a[3]), static_cast<long long>(a[2]),
+                                        static_cast<long long>(a[1]), static_cast<long long>(a[0]));
+    const __m256i B = _mm256_set_epi64x(static_cast<long long>(b[3]), static_cast<long long>(b[2]),
+                                        static_cast<long long>(b[1]), static_cast<long long>(b[0]));
+    const __m256i dash_mask = _mm256_set1_epi64x(static_cast<long long>(kDashMask));
+    const __m256i low_byte = _mm256_set1_epi64x(0xFF);
+    const __m256i dash_ok =
+        _mm256_cmpeq_epi64(_mm256_and_si256(A, dash_mask), _mm256_set1_epi64x(static_cast<long long>(kDashes)));
+    const __m256i X = _mm256_or_si256(
+        _mm256_andnot_si256(dash_mask, A),
+        _mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256(B, low_byte), 32),
+                        _mm256_slli_epi64(_mm256_and_si256(_mm256_srli_epi64(B, 8), low_byte), 56)));
+
+    const __m256i V = _mm256_sub_epi8(X, _mm256_set1_epi8('0'));
+    const __m256i digits_ok = _mm256_cmpeq_epi8(_mm256_min_epu8(V, _mm256_set1_epi8(9)), V);
+
+    // YYYY D MM D -> YYYYMMDD，再乘加成 16 位 [年前两位, 年后两位, 月, 日]，32 位 [年, 月 * 32 + 日]
+    const __m256i order = _mm256_setr_epi8(0, 1, 2, 3, 5, 6, 4, 7, 8, 9, 10, 11, 13, 14, 12, 15,
+                                           0, 1, 2, 3, 5, 6, 4, 7, 8, 9, 10, 11, 13, 14, 12, 15);
+    const __m256i P = _mm256_maddubs_epi16(_mm256_shuffle_epi8(V, order), _mm256_set1_epi16(0x010A));
+    const __m256i Q = _mm256_madd_epi16(P, _mm256_setr_epi16(100, 1, 32, 1, 100, 1, 32, 1, 100, 1, 32, 1,
+                                                             100, 1, 32, 1));
+
+    // 月在 [1, 12]，日在 [1, 当月天数]；月份天数按前移到日所在 16 位的月查表
+    const __m128i table128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDaysPlusOne));
+    const __m256i table = _mm256_broadcastsi128_si256(table128);
+    const __m256i day_lane = _mm256_set1_epi64x(static_cast<long long>(0xFFFF000000000000ull));
+    const __m256i dim = _mm256_and_si256(_mm256_shuffle_epi8(table, _mm256_slli_epi64(P, 16)), day_lane);
+    const __m256i lower = _mm256_set1_epi64x(static_cast<long long>(0x00000000FFFFFFFFull));  // [-1, -1, 0, 0]
+    const __m256i upper = _mm256_or_si256(_mm256_set1_epi64x(static_cast<long long>(0x0000000D00640064ull)), dim);
+    const __m256i fields_ok = _mm256_and_si256(_mm256_cmpgt_epi16(P, lower), _mm256_cmpgt_epi16(upper, P));
+    const __m256i year_ok = _mm256_cmpgt_epi32(Q, _mm256_set1_epi64x(static_cast<long long>(0xFFFFFFFF00000000ull)));
+
+    const __m256i all = _mm256_and_si256(_mm256_and_si256(dash_ok, digits_ok), _mm256_and_si256(fields_ok, year_ok));
+    const __m256i valid = _mm256_cmpeq_epi64(all, _mm256_set1_epi64x(-1));
+
+    const __m256i packed = _mm256_add_epi64(
+        _mm256_slli_epi64(_mm256_and_si256(Q, _mm256_set1_epi64x(0xFFFFFFFF)), 9), _mm256_srli_epi64(Q, 32));
+    const __m256i narrowed =
+        _mm256_permutevar8x32_epi32(_mm256_and_si256(packed, valid), _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(narrowed));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(valid)));
+
+    // 2 月 29 日：只有闰年有效
+    const __m256i feb29 = _mm256_cmpeq_epi64(
+        _mm256_and_si256(P, _mm256_set1_epi64x(static_cast<long long>(0xFFFFFFFF00000000ull))),
+        _mm256_set1_epi64x(static_cast<long long>(0x001D000200000000ull)));
+    unsigned check = mask & static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(feb29)));
+    while (check != 0) {
+        const unsigned i = CountTrailingZeros(check);
+        check &= check - 1;
+        if (!PackedDate::IsLeapYear(static_cast<int>(out[i] >> 9))) {
+            out[i] = 0;
+            mask &= ~(1u << i);
+        }
+    }
+    return mask;
+}
+#endif
+
+// view(i) 返回第 i 行的日期文本
+template <typename View>
+std::size_t ParseColumn(View view, std::size_t n, PackedDate today, uint32_t* out, uint64_t* errors,
+                        SimdLevel level) {
+    std::size_t bad = 0;
+    for (std::size_t block = 0; block < n; block += 64) {
+        const std::size_t end = block + 64 < n ? block + 64 : n;
+        uint64_t word = 0;
+        std::size_t i = block;
+#if defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH)
+        if (level == SimdLevel::kAvx2) {
+            for (; i + 4 <= end; i += 4) {
+                uint64_t a[4];
+                uint64_t b[4];
+                unsigned empty = 0;
+                for (unsigned k = 0; k < 4; ++k) {
+                    const std::string_view s = view(i + k);
+                    LoadWords(s, a[k], b[k]);
+                    empty |= static_cast<unsigned>(s.empty()) << k;
+                }
+                const unsigned ok = ParseWords4Avx2(a, b, out + i);
+                for (unsigned k = 0; k < 4; ++k) {
+                    if ((empty >> k) & 1) out[i + k] = today.value();
+                }
+                word |= static_cast<uint64_t>(~(ok | empty) & 0xF) << (i - block);
+            }
+        }
+#else
+        (void)level;
+#endif
+        for (; i < end; ++i) {
+            const std::string_view s = view(i);
+            uint64_t a;
+            uint64_t b;
+            LoadWords(s, a, b);
+            const uint32_t v = ParseWordsScalar(a, b);
+            out[i] = s.empty() ? today.value() : v;
+            word |= static_cast<uint64_t>(v == 0 && !s.empty()) << (i - block);
+        }
+        bad += PopCount(word);
+        if (errors != nullptr) errors[block / 64] = word;
+    }
+    return bad;
+}
+
+}  // namespace date_column_detail
+
+// n 行的错误位图所需的 64 位字数
+inline std::size_t DateErrorWords(std::size_t n) { return (n + 63) / 64; }
+
+inline bool IsDateError(const uint64_t* errors, std::size_t row) { return ((errors[row / 64] >> (row % 64)) & 1) != 0; }
+
+// 解析 n 个日期文本写入 out（PackedDate::value()）：空串写 today；其余不合法的行写 0，
+// 并在 errors（可为 nullptr，否则须有 DateErrorWords(n) 个字）中置位。返回不合法的行数
+inline std::size_t ParseDateColumn(const std::string_view* dates, std::size_t n, PackedDate today, uint32_t* out,
+                                   uint64_t* errors = nullptr, SimdLevel level = ActiveSimdLevel()) {
+    return date_column_detail::ParseColumn([dates](std::size_t i) { return dates[i]; }, n, today, out, errors,
+                                           level);
+}
+
+// 直接读批量输入的 date 字段
+inline std::size_t ParseDateColumn(const TransactionInput* inputs, std::size_t n, PackedDate today, uint32_t* out,
+                                   uint64_t* errors = nullptr, SimdLevel level = ActiveSimdLevel()) {
+    return date_column_detail::ParseColumn([inputs](std::size_t i) { return inputs[i].date; }, n, today, out,
+                                           errors, level);
+}
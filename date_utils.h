@@ -0,0 +1,254 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// ===================== 组件A：日期 =====================
+// "YYYY-MM-DD"，恰好 10 个字符，不含结尾的 '\0'
+using DateChars = std::array<char, 10>;
+
+inline std::string_view ToStringView(const DateChars& d) {
+    return std::string_view(d.data(), d.size());
+}
+
+// 按本地时区把 t 格式化为 "YYYY-MM-DD"（原 GetCurrentDate 的实现）
+inline DateChars FormatLocalDate(std::time_t t, std::tm* out_tm = nullptr) {
+    std::tm ltm{};
+#if defined(_WIN32)
+    localtime_s(&ltm, &t);
+#else
+    localtime_r(&t, &ltm);
+#endif
+    if (out_tm != nullptr) *out_tm = ltm;
+
+    DateChars d{};
+    unsigned year = static_cast<unsigned>(1900 + ltm.tm_year) % 10000u;
+    unsigned month = static_cast<unsigned>(1 + ltm.tm_mon);
+    unsigned day = static_cast<unsigned>(ltm.tm_mday);
+    d[0] = static_cast<char>('0' + year / 1000);
+    d[1] = static_cast<char>('0' + year / 100 % 10);
+    d[2] = static_cast<char>('0' + year / 10 % 10);
+    d[3] = static_cast<char>('0' + year % 10);
+    d[4] = '-';
+    d[5] = static_cast<char>('0' + month / 10);
+    d[6] = static_cast<char>('0' + month % 10);
+    d[7] = '-';
+    d[8] = static_cast<char>('0' + day / 10);
+    d[9] = static_cast<char>('0' + day % 10);
+    return d;
+}
+
+// 当天日期的缓存提供者：每个本地日（最多每 kMaxCacheSeconds 秒）才调用一次
+// localtime 并格式化，结果经 seqlock 发布。读路径无锁：一次 time()，
+// 一次序号读取和秒数比较，再拷贝 10 个字节。
+//
+// 缓存窗口为 [当天 00:00, min(次日 00:00, 刷新时刻 + kMaxCacheSeconds))，
+// 因此跨零点立即翻日；刷新时会重新读取 TZ（tzset），时区变更最多滞后
+// kMaxCacheSeconds 秒，需要立刻生效时调用 Invalidate()。
+class DateProvider {
+ public:
+    using Clock = std::time_t (*)();
+
+    static constexpr std::time_t kMaxCacheSeconds = 60;
+
+    explicit DateProvider(Clock clock = &SystemNow) : clock_(clock) {}
+
+    DateChars Today() {
+        const std::time_t now = clock_();
+        for (;;) {
+            const uint32_t s1 = seq_.load(std::memory_order_acquire);
+            const int64_t from = valid_from_.load(std::memory_order_relaxed);
+            const int64_t until = valid_until_.load(std::memory_order_relaxed);
+            const uint64_t lo = text_lo_.load(std::memory_order_relaxed);
+            const uint16_t hi = text_hi_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint32_t s2 = seq_.load(std::memory_order_relaxed);
+            if ((s1 & 1u) != 0 || s1 != s2) continue;  // 写者正在更新，重读
+
+            if (now >= from && now < until) {
+                DateChars d;
+                std::memcpy(d.data(), &lo, sizeof(lo));
+                std::memcpy(d.data() + sizeof(lo), &hi, sizeof(hi));
+                return d;
+            }
+            return Refresh(now);
+        }
+    }
+
+    // 强制下一次 Today() 重新计算（例如进程内修改了 TZ）
+    void Invalidate() {
+        std::lock_guard<std::mutex> lock(refresh_mu_);
+        seq_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        valid_until_.store(INT64_MIN, std::memory_order_relaxed);
+        seq_.fetch_add(1, std::memory_order_release);
+    }
+
+ private:
+    static std::time_t SystemNow() { return std::time(nullptr); }
+
+    static std::time_t LocalMidnight(std::tm day, int day_offset) {
+        day.tm_mday += day_offset;
+        day.tm_hour = 0;
+        day.tm_min = 0;
+        day.tm_sec = 0;
+        day.tm_isdst = -1;
+        return std::mktime(&day);
+    }
+
+    DateChars Refresh(std::time_t now) {
+        std::lock_guard<std::mutex> lock(refresh_mu_);
+#if defined(_WIN32)
+        _tzset();
+#else
+        tzset();
+#endif
+        std::tm ltm{};
+        const DateChars d = FormatLocalDate(now, &ltm);
+        const std::time_t day_start = LocalMidnight(ltm, 0);
+        std::time_t until = LocalMidnight(ltm, 1);
+        if (until > now + kMaxCacheSeconds) until = now + kMaxCacheSeconds;
+
+        uint64_t lo = 0;
+        uint16_t hi = 0;
+        std::memcpy(&lo, d.data(), sizeof(lo));
+        std::memcpy(&hi, d.data() + sizeof(lo), sizeof(hi));
+
+        seq_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        valid_from_.store(static_cast<int64_t>(day_start), std::memory_order_relaxed);
+        valid_until_.store(static_cast<int64_t>(until), std::memory_order_relaxed);
+        text_lo_.store(lo, std::memory_order_relaxed);
+        text_hi_.store(hi, std::memory_order_relaxed);
+        seq_.fetch_add(1, std::memory_order_release);
+        return d;
+    }
+
+    Clock clock_;
+    std::mutex refresh_mu_;  // 只串行化写者；读者从不加锁
+    std::atomic<uint32_t> seq_{0};
+    std::atomic<int64_t> valid_from_{0};
+    std::atomic<int64_t> valid_until_{INT64_MIN};
+    std::atomic<uint64_t> text_lo_{0};   // 日期字符 [0, 8)
+    std::atomic<uint16_t> text_hi_{0};   // 日期字符 [8, 10)
+};
+
+inline DateProvider& DefaultDateProvider() {
+    static DateProvider provider;
+    return provider;
+}
+
+inline std::string GetCurrentDate() {
+    const DateChars d = DefaultDateProvider().Today();
+    return std::string(d.data(), d.size());
+}
+
+// ===================== 紧凑日期：PackedDate =====================
+// 32 位 y/m/d 位域：year << 9 | month << 5 | day。整数大小关系与日期先后一致，
+// 排序、区间查询只需整数比较；value() >> 5 即“年月”键，可直接按月分组。
+// 值 0 表示无效日期。
+class PackedDate {
+ public:
+    constexpr PackedDate() = default;
+    constexpr PackedDate(int year, int month, int day)
+        : value_(IsValidYmd(year, month, day)
+                     ? (static_cast<uint32_t>(year) << 9) | (static_cast<uint32_t>(month) << 5) |
+                           static_cast<uint32_t>(day)
+                     : 0u) {}
+
+    static constexpr PackedDate FromValue(uint32_t value) {
+        PackedDate d;
+        d.value_ = value;
+        return d;
+    }
+
+    // 严格解析 "YYYY-MM-DD"；任何格式或日历错误都返回无效日期
+    static constexpr PackedDate Parse(std::string_view s) {
+        if (s.size() != 10 || s[4] != '-' || s[7] != '-') return PackedDate();
+        int fields[3] = {0, 0, 0};
+        constexpr int kStart[3] = {0, 5, 8};
+        constexpr int kLen[3] = {4, 2, 2};
+        for (int f = 0; f < 3; ++f) {
+            for (int i = 0; i < kLen[f]; ++i) {
+                const char c = s[static_cast<std::size_t>(kStart[f] + i)];
+                if (c < '0' || c > '9') return PackedDate();
+                fields[f] = fields[f] * 10 + (c - '0');
+            }
+        }
+        return PackedDate(fields[0], fields[1], fields[2]);
+    }
+
+    static constexpr PackedDate FromChars(const DateChars& d) {
+        return Parse(std::string_view(d.data(), d.size()));
+    }
+
+    static constexpr bool IsLeapYear(int year) {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    static constexpr int DaysInMonth(int year, int month) {
+        constexpr int kDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        return month == 2 && IsLeapYear(year) ? 29 : kDays[month - 1];
+    }
+
+    static constexpr bool IsValidYmd(int year, int month, int day) {
+        return year >= 1 && year <= 9999 && month >= 1 && month <= 12 && day >= 1 &&
+               day <= DaysInMonth(year, month);
+    }
+
+    constexpr bool valid() const { return value_ != 0; }
+    constexpr uint32_t value() const { return value_; }
+    constexpr int year() const { return static_cast<int>(value_ >> 9); }
+    constexpr int month() const { return static_cast<int>((value_ >> 5) & 0xF); }
+    constexpr int day() const { return static_cast<int>(value_ & 0x1F); }
+
+    constexpr DateChars Format() const {
+        DateChars d{};
+        const int y = year();
+        const int m = month();
+        const int dd = day();
+        d[0] = static_cast<char>('0' + y / 1000);
+        d[1] = static_cast<char>('0' + y / 100 % 10);
+        d[2] = static_cast<char>('0' + y / 10 % 10);
+        d[3] = static_cast<char>('0' + y % 10);
+        d[4] = '-';
+        d[5] = static_cast<char>('0' + m / 10);
+        d[6] = static_cast<char>('0' + m % 10);
+        d[7] = '-';
+        d[8] = static_cast<char>('0' + dd / 10);
+        d[9] = static_cast<char>('0' + dd % 10);
+        return d;
+    }
+
+    std::string ToString() const {
+        const DateChars d = Format();
+        return std::string(d.data(), d.size());
+    }
+
+    friend constexpr bool operator==(PackedDate a, PackedDate b) { return a.value_ == b.value_; }
+    friend constexpr bool operator!=(PackedDate a, PackedDate b) { return a.value_ != b.value_; }
+    friend constexpr bool operator<(PackedDate a, PackedDate b) { return a.value_ < b.value_; }
+    friend constexpr bool operator<=(PackedDate a, PackedDate b) { return a.value_ <= b.value_; }
+    friend constexpr bool operator>(PackedDate a, PackedDate b) { return a.value_ > b.value_; }
+    friend constexpr bool operator>=(PackedDate a, PackedDate b) { return a.value_ >= b.value_; }
+
+ private:
+    uint32_t value_ = 0;
+};
+
+static_assert(sizeof(PackedDate) == 4, "PackedDate must stay 32-bit");
+static_assert(PackedDate::Parse("2026-01-31").Format()[9] == '1', "constexpr round trip");
+static_assert(PackedDate::Parse("2024-02-29").valid() && !PackedDate::Parse("2026-02-29").valid(),
+              "leap year handling");
+static_assert(PackedDate(2026, 1, 31) < PackedDate(2026, 2, 1), "integer order matches date order");
+
+inline PackedDate GetCurrentPackedDate() {
+    return PackedDate::FromChars(DefaultDateProvider().Today());
+}
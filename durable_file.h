@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ===================== 公共：落盘写入 =====================
+// 只 fsync 文件本身不够：新建或改名产生的目录项记在父目录里，掉电后要父目录也
+// 落盘才保证文件还在、还叫这个名字。快照整体替换与新建日志都经过这里。
+namespace durable_file_detail {
+
+inline bool Fail(const std::string& message, std::string* error) {
+    if (error != nullptr) *error = message;
+    return false;
+}
+
+inline std::string ParentDirectory(const std::string& path) {
+    const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    return parent.empty() ? std::string(".") : parent.string();
+}
+
+// 同目录下的临时文件名：进程号 + 进程内计数，并发写同一 path 的写者互不覆盖
+inline std::string TempPath(const std::string& path) {
+    static std::atomic<uint64_t> counter{0};
+#if defined(_WIN32)
+    const unsigned long pid = GetCurrentProcessId();
+#else
+    const long pid = static_cast<long>(::getpid());
+#endif
+    return path + ".tmp." + std::to_string(pid) + "." + std::to_string(counter.fetch_add(1));
+}
+
+}  // namespace durable_file_detail
+
+// fsync path 所在的目录，使其中刚创建或改名的目录项落盘。
+// Windows 上目录项随 NTFS 元数据日志落盘，没有对应操作，直接返回 true
+inline bool SyncParentDirectory(const std::string& path, std::string* error = nullptr) {
+#if !defined(_WIN32)
+    const std::string dir = durable_file_detail::ParentDirectory(path);
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return durable_file_detail::Fail("cannot open directory " + dir, error);
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok) return durable_file_detail::Fail("cannot sync directory " + dir, error);
+#else
+    (void)path;
+    (void)error;
+#endif
+    return true;
+}
+
+// 原子且持久地替换 path 的内容：写入同目录下唯一命名的临时文件并 fsync，改名覆盖
+// path，再 fsync 目录。返回 true 后掉电也只会看到完整的新内容；返回前任何时刻
+// path 要么是旧内容要么是完整的新内容。并发替换同一 path 时最后改名者胜出
+inline bool ReplaceFileDurably(const std::string& path, std::string_view data, std::string* error = nullptr) {
+    namespace d = durable_file_detail;
+    const std::string tmp = d::TempPath(path);
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(tmp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return d::Fail("cannot create " + tmp, error);
+    bool ok = true;
+    for (std::size_t at = 0; ok && at < data.size();) {
+        DWORD written = 0;
+        const DWORD chunk = static_cast<DWORD>(std::min<std::size_t>(data.size() - at, 1u << 30));
+        ok = WriteFile(file, data.data() + at, chunk, &written, nullptr) != 0;
+        at += written;
+    }
+    ok = ok && FlushFileBuffers(file) != 0;
+    ok = CloseHandle(file) != 0 && ok;
+    if (!ok) {
+        DeleteFileA(tmp.c_str());
+        return d::Fail("cannot write " + tmp, error);
+    }
+    if (!MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileA(tmp.c_str());
+        return d::Fail("cannot replace " + path, error);
+    }
+    return true;
+#else
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) return d::Fail("cannot create " + tmp, error);
+    bool ok = true;
+    for (std::size_t at = 0; ok && at < data.size();) {
+        const ssize_t written = ::write(fd, data.data() + at, data.size() - at);
+        if (written < 0) {
+            ok = errno == EINTR;
+            continue;
+        }
+        at += static_cast<std::size_t>(written);
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok) {
+        ::unlink(tmp.c_str());
+        return d::Fail("cannot write " + tmp, error);
+    }
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return d::Fail("cannot replace " + path, error);
+    }
+    return SyncParentDirectory(path, error);
+#endif
+}
@@ -0,0 +1,376 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "category_recognizer.h"
+#include "metrics.h"
+
+// ===================== 组件B：近似分类识别 =====================
+// 商户备注常写成“餐 饮”、繁体“餐飲”，或少打 / 错打一个字，精确匹配全部落到
+// “其他”。FuzzyCategoryRecognizer 在精确未命中时按代价递增依次找回：
+//
+// 1. 折叠：按码点把繁体字映射为简体、全角 ASCII 映射为半角、大写字母映射为
+//    小写，并去掉所有空白（含全角空格、不换行空格、零宽空格）。关键词同样
+//    折叠后编译进第二个 Aho-Corasick 自动机，折叠后的备注扫描一遍即可。
+// 2. 编辑距离：对折叠后不少于 min_fuzzy_length 个码点的关键词，允许备注中某
+//    一段与它相差至多 max_edits 次插入 / 删除 / 替换。先用单字倒排表筛候选——
+//    编辑 k 次后，关键词里至少还有“不同字数 - k”个字出现在备注中——再对候选
+//    做子串编辑距离的动态规划验算。
+//
+// 每条备注的代价有硬上限：只看折叠后的前 max_note_codepoints 个码点，倒排表
+// 最多访问 max_posting_visits 个条目，最多验算 max_candidates 个候选。超出
+// 预算时只在已收集的候选里挑，不会因为长备注或常用字而失控。
+//
+// 近似命中取编辑次数最少者，其次取更长的关键词，再次取字节序最小者；未命中
+// 时的回退规则与 CategoryRecognizer 相同。内置的繁简对照只覆盖记账备注中的
+// 常用字，可用 extra_folds 补充。识别器构造后不可变，可在线程间共享；热路径
+// 请为每个线程准备一个 Scratch 反复传入，预热后不再分配。
+struct FuzzyOptions {
+    MatchPolicy policy = MatchPolicy::kByteOrder;  // 精确与折叠两级沿用的策略
+    int max_edits = 1;                             // 0 表示只折叠、不做编辑距离
+    std::size_t min_fuzzy_length = 3;              // 更短的关键词只参与精确与折叠匹配
+    std::size_t max_note_codepoints = 256;
+    std::size_t max_posting_visits = 4096;
+    std::size_t max_candidates = 32;
+    std::vector<std::pair<char32_t, char32_t>> extra_folds{};  // 额外的 繁 → 简 / 异体字映射，优先于内置表
+};
+
+enum class FuzzyMatchKind {
+    kExact,        // 原文精确命中
+    kFolded,       // 折叠、去空白后精确命中
+    kApproximate,  // 编辑距离内命中
+    kFallback,     // 未命中，回退
+};
+
+struct FuzzyMatch {
+    int category_id = 0;
+    FuzzyMatchKind kind = FuzzyMatchKind::kFallback;
+    int edits = 0;  // 仅 kApproximate 时可能非 0
+};
+
+namespace fuzzy_detail {
+
+// 关键词超过该码点数时不参与编辑距离匹配（验算代价与长度成正比）
+constexpr std::size_t kMaxFuzzyKeyword = 64;
+
+// 繁体 → 简体，按繁体码点升序
+constexpr std::pair<char32_t, char32_t> kDefaultFolds[] = {
+    {U'來', U'来'}, {U'個', U'个'}, {U'們', U'们'}, {U'備', U'备'}, {U'傢', U'家'}, {U'傳', U'传'},
+    {U'債', U'债'}, {U'價', U'价'}, {U'億', U'亿'}, {U'優', U'优'}, {U'兒', U'儿'}, {U'劇', U'剧'},
+    {U'動', U'动'}, {U'務', U'务'}, {U'勞', U'劳'}, {U'勵', U'励'}, {U'區', U'区'}, {U'員', U'员'},
+    {U'單', U'单'}, {U'園', U'园'}, {U'圖', U'图'}, {U'報', U'报'}, {U'場', U'场'}, {U'壽', U'寿'},
+    {U'娛', U'娱'}, {U'學', U'学'}, {U'實', U'实'}, {U'寫', U'写'}, {U'寬', U'宽'}, {U'寵', U'宠'},
+    {U'對', U'对'}, {U'帳', U'帐'}, {U'帶', U'带'}, {U'幣', U'币'}, {U'廠', U'厂'}, {U'廣', U'广'},
+    {U'廳', U'厅'}, {U'後', U'后'}, {U'從', U'从'}, {U'憑', U'凭'}, {U'戲', U'戏'}, {U'戶', U'户'},
+    {U'掛', U'挂'}, {U'據', U'据'}, {U'數', U'数'}, {U'時', U'时'}, {U'書', U'书'}, {U'會', U'会'},
+    {U'東', U'东'}, {U'業', U'业'}, {U'樂', U'乐'}, {U'標', U'标'}, {U'橋', U'桥'}, {U'機', U'机'},
+    {U'檢', U'检'}, {U'權', U'权'}, {U'歲', U'岁'}, {U'氣', U'气'}, {U'準', U'准'}, {U'漢', U'汉'},
+    {U'潤', U'润'}, {U'濟', U'济'}, {U'為', U'为'}, {U'燈', U'灯'}, {U'燒', U'烧'}, {U'營', U'营'},
+    {U'獎', U'奖'}, {U'現', U'现'}, {U'產', U'产'}, {U'當', U'当'}, {U'療', U'疗'}, {U'發', U'发'},
+    {U'碼', U'码'}, {U'禮', U'礼'}, {U'稅', U'税'}, {U'種', U'种'}, {U'積', U'积'}, {U'筆', U'笔'},
+    {U'糧', U'粮'}, {U'紅', U'红'}, {U'納', U'纳'}, {U'紙', U'纸'}, {U'絡', U'络'}, {U'給', U'给'},
+    {U'經', U'经'}, {U'維', U'维'}, {U'網', U'网'}, {U'線', U'线'}, {U'練', U'练'}, {U'總', U'总'},
+    {U'繳', U'缴'}, {U'續', U'续'}, {U'習', U'习'}, {U'聯', U'联'}, {U'腦', U'脑'}, {U'膚', U'肤'},
+    {U'臺', U'台'}, {U'與', U'与'}, {U'萬', U'万'}, {U'藝', U'艺'}, {U'藥', U'药'}, {U'處', U'处'},
+    {U'號', U'号'}, {U'蝦', U'虾'}, {U'衛', U'卫'}, {U'補', U'补'}, {U'裝', U'装'}, {U'襪', U'袜'},
+    {U'見', U'见'}, {U'視', U'视'}, {U'觀', U'观'}, {U'訂', U'订'}, {U'計', U'计'}, {U'訊', U'讯'},
+    {U'訓', U'训'}, {U'託', U'托'}, {U'記', U'记'}, {U'診', U'诊'}, {U'話', U'话'}, {U'誌', U'志'},
+    {U'認', U'认'}, {U'語', U'语'}, {U'說', U'说'}, {U'課', U'课'}, {U'請', U'请'}, {U'謝', U'谢'},
+    {U'證', U'证'}, {U'識', U'识'}, {U'護', U'护'}, {U'讀', U'读'}, {U'貓', U'猫'}, {U'貨', U'货'},
+    {U'買', U'买'}, {U'貸', U'贷'}, {U'費', U'费'}, {U'貼', U'贴'}, {U'資', U'资'}, {U'賣', U'卖'},
+    {U'質', U'质'}, {U'賬', U'账'}, {U'購', U'购'}, {U'車', U'车'}, {U'軟', U'软'}, {U'轉', U'转'},
+    {U'辦', U'办'}, {U'這', U'这'}, {U'遊', U'游'}, {U'運', U'运'}, {U'過', U'过'}, {U'遞', U'递'},
+    {U'選', U'选'}, {U'還', U'还'}, {U'郵', U'邮'}, {U'醫', U'医'}, {U'醬', U'酱'}, {U'銀', U'银'},
+    {U'錄', U'录'}, {U'錢', U'钱'}, {U'鐵', U'铁'}, {U'門', U'门'}, {U'開', U'开'}, {U'間', U'间'},
+    {U'閱', U'阅'}, {U'關', U'关'}, {U'際', U'际'}, {U'險', U'险'}, {U'雜', U'杂'}, {U'雞', U'鸡'},
+    {U'電', U'电'}, {U'頭', U'头'}, {U'頻', U'频'}, {U'額', U'额'}, {U'類', U'类'}, {U'飛', U'飞'},
+    {U'飯', U'饭'}, {U'飲', U'饮'}, {U'飾', U'饰'}, {U'養', U'养'}, {U'餘', U'余'}, {U'館', U'馆'},
+    {U'體', U'体'}, {U'髮', U'发'}, {U'魚', U'鱼'}, {U'鴨', U'鸭'}, {U'鹽', U'盐'}, {U'麥', U'麦'},
+    {U'麵', U'面'}, {U'點', U'点'},
+};
+
+inline bool IsSpace(char32_t c) {
+    return c == U' ' || (c >= U'\t' && c <= U'\r') || c == 0x00A0 || c == 0x3000 || c == 0x200B || c == 0xFEFF;
+}
+
+// 非法字节映射到孤立代理区 U+DC80..U+DCFF：合法关键词里不会出现，也就永远不会误配
+inline char32_t DecodeOne(const unsigned char* p, std::size_t len, std::size_t& i) {
+    const unsigned char b = p[i];
+    auto cont = [&](std::size_t k) { return i + k < len && (p[i + k] & 0xC0) == 0x80; };
+    if (b < 0x80) {
+        ++i;
+        return b;
+    }
+    if (b >= 0xC2 && b < 0xE0 && cont(1)) {
+        const char32_t c = (char32_t(b & 0x1F) << 6) | (p[i + 1] & 0x3F);
+        i += 2;
+        return c;
+    }
+    if (b >= 0xE0 && b < 0xF0 && cont(1) && cont(2)) {
+        const char32_t c = (char32_t(b & 0x0F) << 12) | (char32_t(p[i + 1] & 0x3F) << 6) | (p[i + 2] & 0x3F);
+        if (c >= 0x800) {
+            i += 3;
+            return c;
+        }
+    } else if (b >= 0xF0 && b < 0xF5 && cont(1) && cont(2) && cont(3)) {
+        const char32_t c = (char32_t(b & 0x07) << 18) | (char32_t(p[i + 1] & 0x3F) << 12) |
+                           (char32_t(p[i + 2] & 0x3F) << 6) | (p[i + 3] & 0x3F);
+        if (c >= 0x10000 && c <= 0x10FFFF) {
+            i += 4;
+            return c;
+        }
+    }
+    ++i;
+    return 0xDC00 + b;
+}
+
+inline void AppendUtf8(char32_t c, std::string& out) {
+    if (c < 0x80) {
+        out += static_cast<char>(c);
+    } else if (c < 0x800) {
+        out += static_cast<char>(0xC0 | (c >> 6));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        out += static_cast<char>(0xE0 | (c >> 12));
+        out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (c >> 18));
+        out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    }
+}
+
+// 备注某一段与 kw 的最小编辑距离（子串匹配：备注中的起止位置不计代价）。
+// 超过 limit 时返回 limit + 1；column 为调用方提供的 m + 1 个元素的缓冲
+inline int SubstringDistance(const char32_t* note, std::size_t n, const char32_t* kw, std::size_t m, int limit,
+                             int* column) {
+    for (std::size_t i = 0; i <= m; ++i) column[i] = static_cast<int>(i);
+    int best = column[m];
+    for (std::size_t j = 0; j < n && best > 0; ++j) {
+        int diagonal = column[0];  // 上一列的 column[i - 1]
+        column[0] = 0;
+        for (std::size_t i = 1; i <= m; ++i) {
+            const int up = column[i];
+            column[i] = std::min({diagonal + (kw[i - 1] != note[j]), up + 1, column[i - 1] + 1});
+            diagonal = up;
+        }
+        best = std::min(best, column[m]);
+    }
+    return best > limit ? limit + 1 : best;
+}
+
+}  // namespace fuzzy_detail
+
+class FuzzyCategoryRecognizer {
+ public:
+    // 每线程一份的临时缓冲
+    struct Scratch {
+        std::u32string note;
+        std::string folded;
+        std::vector<char32_t> distinct;
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> touched;
+        std::vector<uint32_t> candidates;
+        std::vector<int> column;
+    };
+
+    explicit FuzzyCategoryRecognizer(const std::vector<Category>& categories, FuzzyOptions options = FuzzyOptions())
+        : options_(std::move(options)), exact_(categories, options_.policy),
+          folded_(FoldCategories(categories), options_.policy) {
+        BuildKeywords(categories);
+    }
+
+    const FuzzyOptions& options() const { return options_; }
+
+    int RecognizeCategory(std::string_view note) const {
+        Scratch scratch;
+        return Match(note, scratch).category_id;
+    }
+
+    int RecognizeCategory(std::string_view note, Scratch& scratch) const { return Match(note, scratch).category_id; }
+
+    FuzzyMatch Match(std::string_view note, Scratch& scratch) const {
+        FuzzyMatch m;
+        if (exact_.TryRecognizeCategory(note, &m.category_id)) {
+            CountMetric(MetricCounter::kKeywordHits);
+            m.kind = FuzzyMatchKind::kExact;
+            return m;
+        }
+        Fold(note, scratch.note);
+        if (scratch.note.size() > options_.max_note_codepoints) scratch.note.resize(options_.max_note_codepoints);
+        scratch.folded.clear();
+        for (char32_t c : scratch.note) fuzzy_detail::AppendUtf8(c, scratch.folded);
+        if (folded_.TryRecognizeCategory(scratch.folded, &m.category_id)) {
+            CountMetric(MetricCounter::kFuzzyHits);
+            m.kind = FuzzyMatchKind::kFolded;
+            return m;
+        }
+        if (options_.max_edits > 0 && Approximate(scratch, m)) {
+            CountMetric(MetricCounter::kFuzzyHits);
+            m.kind = FuzzyMatchKind::kApproximate;
+            return m;
+        }
+        CountMetric(exact_.fallback_metric());
+        m.category_id = exact_.fallback_id();
+        return m;
+    }
+
+    // 与匹配时相同的折叠：码点映射 + 去空白，结果为码点序列
+    void Fold(std::string_view text, std::u32string& out) const {
+        out.clear();
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+        for (std::size_t i = 0; i < text.size();) {
+            const char32_t c = FoldCodepoint(fuzzy_detail::DecodeOne(p, text.size(), i));
+            if (!fuzzy_detail::IsSpace(c)) out += c;
+        }
+    }
+
+    char32_t FoldCodepoint(char32_t c) const {
+        if (c < 0x80) return c >= U'A' && c <= U'Z' ? c + 32 : c;
+        if (c >= 0xFF01 && c <= 0xFF5E) return FoldCodepoint(c - 0xFEE0);  // 全角 ASCII
+        const auto it = std::lower_bound(folds_.begin(), folds_.end(), c, [](const std::pair<char32_t, char32_t>& f,
+                                                                             char32_t v) { return f.first < v; });
+        return it != folds_.end() && it->first == c ? it->second : c;
+    }
+
+ private:
+    // 折叠后的关键词表交给第二个自动机；折叠成空串的非空名字保留原文，避免命中一切备注
+    std::vector<Category> FoldCategories(const std::vector<Category>& categories) {
+        folds_.assign(options_.extra_folds.begin(), options_.extra_folds.end());
+        for (const auto& f : fuzzy_detail::kDefaultFolds) folds_.push_back(f);
+        std::stable_sort(folds_.begin(), folds_.end(),
+                         [](const std::pair<char32_t, char32_t>& a, const std::pair<char32_t, char32_t>& b) {
+                             return a.first < b.first;
+                         });
+        folds_.erase(std::unique(folds_.begin(), folds_.end(),
+                                 [](const std::pair<char32_t, char32_t>& a, const std::pair<char32_t, char32_t>& b) {
+                                     return a.first == b.first;
+                                 }),
+                     folds_.end());
+
+        std::vector<Category> folded = categories;
+        std::u32string cps;
+        auto fold = [&](std::string& s) {
+            Fold(s, cps);
+            if (cps.empty() && !s.empty()) return;
+            s.clear();
+            for (char32_t c : cps) fuzzy_detail::AppendUtf8(c, s);
+        };
+        for (auto& c : folded) {
+            fold(c.name);
+            for (auto& k : c.keywords) fold(k);
+        }
+        return folded;
+    }
+
+    // 与 CategoryRecognizer 相同：同一关键词以最后出现者为准，std::map 的顺序即字节序 rank
+    void BuildKeywords(const std::vector<Category>& categories) {
+        std::map<std::string, int> keyword_map;
+        std::u32string cps;
+        std::string key;
+        auto add = [&](const std::string& s, int id) {
+            Fold(s, cps);
+            if (cps.size() < options_.min_fuzzy_length || cps.size() > fuzzy_detail::kMaxFuzzyKeyword) return;
+            key.clear();
+            for (char32_t c : cps) fuzzy_detail::AppendUtf8(c, key);
+            keyword_map[key] = id;
+        };
+        for (const auto& c : categories) {
+            add(c.name, c.id);
+            for (const auto& k : c.keywords) add(k, c.id);
+        }
+
+        keyword_begin_.push_back(0);
+        std::vector<char32_t> distinct;
+        for (const auto& kv : keyword_map) {
+            const uint32_t kw = static_cast<uint32_t>(keyword_id_.size());
+            Fold(kv.first, cps);
+            keyword_chars_.insert(keyword_chars_.end(), cps.begin(), cps.end());
+            keyword_begin_.push_back(static_cast<uint32_t>(keyword_chars_.size()));
+            keyword_id_.push_back(kv.second);
+            distinct.assign(cps.begin(), cps.end());
+            std::sort(distinct.begin(), distinct.end());
+            distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+            keyword_distinct_.push_back(static_cast<uint32_t>(distinct.size()));
+            for (char32_t c : distinct) postings_[c].push_back(kw);
+        }
+    }
+
+    std::size_t KeywordLength(uint32_t kw) const { return keyword_begin_[kw + 1] - keyword_begin_[kw]; }
+
+    bool Approximate(Scratch& s, FuzzyMatch& m) const {
+        const std::size_t keywords = keyword_id_.size();
+        if (keywords == 0 || s.note.empty()) return false;
+        if (s.counts.size() < keywords) s.counts.assign(keywords, 0);
+
+        // 1) 单字倒排表计数：每个关键词有多少个不同的字出现在备注中
+        s.distinct.assign(s.note.begin(), s.note.end());
+        std::sort(s.distinct.begin(), s.distinct.end());
+        s.distinct.erase(std::unique(s.distinct.begin(), s.distinct.end()), s.distinct.end());
+        s.touched.clear();
+        std::size_t visits = 0;
+        for (std::size_t d = 0; d < s.distinct.size() && visits < options_.max_posting_visits; ++d) {
+            const auto it = postings_.find(s.distinct[d]);
+            if (it == postings_.end()) continue;
+            for (uint32_t kw : it->second) {
+                if (visits++ == options_.max_posting_visits) break;
+                if (s.counts[kw]++ == 0) s.touched.push_back(kw);
+            }
+        }
+
+        // 2) 缺字数不超过 max_edits 的才是候选，缺得少的先验算
+        const uint32_t edits = static_cast<uint32_t>(options_.max_edits);
+        s.candidates.clear();
+        for (uint32_t kw : s.touched) {
+            if (s.counts[kw] + edits >= keyword_distinct_[kw]) s.candidates.push_back(kw);
+        }
+        auto missing = [&](uint32_t kw) { return keyword_distinct_[kw] - s.counts[kw]; };
+        std::sort(s.candidates.begin(), s.candidates.end(), [&](uint32_t a, uint32_t b) {
+            return missing(a) != missing(b) ? missing(a) < missing(b) : a < b;
+        });
+        for (uint32_t kw : s.touched) s.counts[kw] = 0;
+        if (s.candidates.size() > options_.max_candidates) s.candidates.resize(options_.max_candidates);
+
+        // 3) 子串编辑距离验算
+        s.column.resize(fuzzy_detail::kMaxFuzzyKeyword + 1);
+        int best_edits = options_.max_edits + 1;
+        uint32_t best = 0;
+        for (uint32_t kw : s.candidates) {
+            const int d = fuzzy_detail::SubstringDistance(s.note.data(), s.note.size(),
+                                                          keyword_chars_.data() + keyword_begin_[kw],
+                                                          KeywordLength(kw), options_.max_edits, s.column.data());
+            if (d < best_edits || (d == best_edits && d <= options_.max_edits &&
+                                   (KeywordLength(kw) > KeywordLength(best) ||
+                                    (KeywordLength(kw) == KeywordLength(best) && kw < best)))) {
+                best_edits = d;
+                best = kw;
+            }
+        }
+        if (best_edits > options_.max_edits) return false;
+        m.category_id = keyword_id_[best];
+        m.edits = best_edits;
+        return true;
+    }
+
+    FuzzyOptions options_;
+    std::vector<std::pair<char32_t, char32_t>> folds_;  // 按源码点升序，须先于 folded_ 初始化
+    CategoryRecognizer exact_;
+    CategoryRecognizer folded_;
+
+    // 参与编辑距离匹配的关键词（折叠后），下标即字节序 rank
+    std::vector<char32_t> keyword_chars_;
+    std::vector<uint32_t> keyword_begin_;  // 第 k 个关键词为 keyword_chars_[begin[k], begin[k + 1])
+    std::vector<int32_t> keyword_id_;
+    std::vector<uint32_t> keyword_distinct_;  // 不同的字数
+    std::unordered_map<char32_t, std::vector<uint32_t>> postings_;  // 字 → 含该字的关键词
+};
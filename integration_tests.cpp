@@ -1,76 +1,32 @@
 #include <gtest/gtest.h>
 
+#include "csv_ingest.h"
+#include "ledger_aggregate.h"
+#include "ledger_index.h"
+#include "micro_batch_classifier.h"
+#include "sharded_ledger.h"
+#include "stream_classifier.h"
+#include "transaction.h"
+#include "transaction_log.h"
+#include "transaction_batch.h"
+
+#include <atomic>
 #include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <ctime>
+#include <future>
 #include <map>
+#include <mutex>
+#include <new>
 #include <regex>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
-// 组件A：日期
-static std::string GetCurrentDate() {
-    std::time_t now = std::time(nullptr);
-    std::tm ltm{};
-#if defined(_WIN32)
-    localtime_s(&ltm, &now);
-#else
-    localtime_r(&now, &ltm);
-#endif
-    char buf[20];
-    std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d",
-                  1900 + ltm.tm_year, 1 + ltm.tm_mon, ltm.tm_mday);
-    return std::string(buf);
-}
-
-// 组件B：分类识别
-struct Category {
-    int id;
-    std::string name;
-    std::string description;
-};
-
-class CategoryRecognizer {
- public:
-    explicit CategoryRecognizer(const std::vector<Category>& categories)
-        : categories_(categories) {}
-
-    int RecognizeCategory(const std::string& note) {
-        std::map<std::string, int> keyword_map;
-        for (const auto& c : categories_) keyword_map[c.name] = c.id;
-
-        for (const auto& kv : keyword_map) {
-            if (note.find(kv.first) != std::string::npos) return kv.second;
-        }
-
-        for (const auto& c : categories_) {
-            if (c.name == "其他") return c.id;
-        }
-        return categories_.empty() ? 0 : categories_[0].id;
-    }
-
- private:
-    std::vector<Category> categories_;
-};
-
-// 集成流程：模拟“交易处理”
-struct ProcessedTransaction {
-    std::string date;
-    int category_id;
-    std::string note;
-};
-
-static ProcessedTransaction ProcessTransaction(const std::string& note,
-                                               const std::string& date_input,
-                                               const std::vector<Category>& cats) {
-    ProcessedTransaction out{};
-    out.note = note;
-    out.date = date_input.empty() ? GetCurrentDate() : date_input;
-
-    CategoryRecognizer cr(cats);
-    out.category_id = cr.RecognizeCategory(note);
-    return out;
-}
-
 static std::vector<Category> DefaultCats() {
     return {
         {1, "餐饮", "饮食相关"},
@@ -84,26 +40,26 @@ static std::vector<Category> DefaultCats() {
 // ===================== 集成测试：组1（正常流程组合） =====================
 TEST(Integration_Group1_NormalFlow, AutoFillDateAndRecognizeCategory) {
     auto out = ProcessTransaction("餐饮 午饭", "", DefaultCats());
-    EXPECT_TRUE(std::regex_match(out.date, std::regex(R"(^\d{4}-\d{2}-\d{2}$)")));
+    EXPECT_TRUE(std::regex_match(out.date.ToString(), std::regex(R"(^\d{4}-\d{2}-\d{2}$)")));
     EXPECT_EQ(out.category_id, 1);
 }
 
 TEST(Integration_Group1_NormalFlow, KeepManualDateAndRecognizeCategory) {
     auto out = ProcessTransaction("工资 发放", "2026-01-01", DefaultCats());
-    EXPECT_EQ(out.date, "2026-01-01");
+    EXPECT_EQ(out.date.ToString(), "2026-01-01");
     EXPECT_EQ(out.category_id, 4);
 }
 
 // ===================== 集成测试：组2（边界/回退组合） =====================
 TEST(Integration_Group2_Fallbacks, NoKeywordFallsBackToOther) {
     auto out = ProcessTransaction("买书", "", DefaultCats());
-    EXPECT_TRUE(std::regex_match(out.date, std::regex(R"(^\d{4}-\d{2}-\d{2}$)")));
+    EXPECT_TRUE(std::regex_match(out.date.ToString(), std::regex(R"(^\d{4}-\d{2}-\d{2}$)")));
     EXPECT_EQ(out.category_id, 5);
 }
 
 TEST(Integration_Group2_Fallbacks, EmptyNoteFallsBackToOther) {
     auto out = ProcessTransaction("", "2026-01-02", DefaultCats());
-    EXPECT_EQ(out.date, "2026-01-02");
+    EXPECT_EQ(out.date.ToString(), "2026-01-02");
     EXPECT_EQ(out.category_id, 5);
 }
 
@@ -119,10 +75,1338 @@ TEST(Integration_Group2_Fallbacks, NoOtherCategoryFallsBackToFirst) {
 TEST(Integration_Group2_Fallbacks, EmptyCategoryListReturns0) {
     std::vector<Category> cats;
     auto out = ProcessTransaction("任意", "", cats);
-    EXPECT_TRUE(std::regex_match(out.date, std::regex(R"(^\d{4}-\d{2}-\d{2}$)")));
+    EXPECT_TRUE(std::regex_match(out.date.ToString(), std::regex(R"(^\d{4}-\d{2}-\d{2}$)")));
     EXPECT_EQ(out.category_id, 0);
 }
 
+TEST(Integration_Group2_Fallbacks, InvalidManualDateIsFlaggedInvalid) {
+    auto out = ProcessTransaction("餐饮 午饭", "2026-02-30", DefaultCats());
+    EXPECT_FALSE(out.date.valid());
+    EXPECT_EQ(out.category_id, 1);
+}
+
+TEST(Integration_Group2_Fallbacks, ManualDateOrdersAsInteger) {
+    auto a = ProcessTransaction("餐饮", "2025-12-31", DefaultCats());
+    auto b = ProcessTransaction("餐饮", "2026-01-01", DefaultCats());
+    EXPECT_LT(a.date.value(), b.date.value());
+}
+
+TEST(Integration_Group2_Fallbacks, CachedTenantPathMatchesUncached) {
+    RecognizerCache cache;
+    for (int round = 0; round < 3; ++round) {
+        for (const char* note : {"餐饮 午饭", "工资 发放", "买书", ""}) {
+            auto cached = ProcessTransaction(note, "2026-01-01", DefaultCats(), cache);
+            auto plain = ProcessTransaction(note, "2026-01-01", DefaultCats());
+            EXPECT_EQ(cached.category_id, plain.category_id);
+            EXPECT_EQ(cached.date, plain.date);
+            EXPECT_EQ(cached.note, plain.note);
+        }
+    }
+    EXPECT_EQ(cache.Stats().misses, 1u);
+    EXPECT_EQ(cache.Stats().hits, 11u);
+    auto out = ProcessTransaction("买书", "", DefaultCats(), cache);
+    EXPECT_EQ(out.date, GetCurrentPackedDate());
+}
+
+// ===================== 集成测试：组3（批量处理） =====================
+TEST(Integration_Group3_Batch, BatchMatchesPerRowProcessing) {
+    std::vector<TransactionInput> inputs = {
+        {"餐饮 午饭", ""},
+        {"工资 发放", "2026-01-01"},
+        {"买书", "2026-01-03"},
+        {"", ""},
+    };
+    std::vector<ProcessedTransaction> out;
+    ProcessTransactions(inputs, DefaultCats(), out);
+    ASSERT_EQ(out.size(), inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        auto single = ProcessTransaction(inputs[i].note, inputs[i].date, DefaultCats());
+        EXPECT_EQ(out[i].category_id, single.category_id);
+        EXPECT_EQ(out[i].note, single.note);
+        EXPECT_EQ(out[i].date, single.date);
+    }
+}
+
+TEST(Integration_Group3_Batch, ReusedOutputBufferKeepsStringCapacity) {
+    std::vector<TransactionInput> inputs = {{"水电费 1月账单 国家电网自动扣款", "2026-01-05"}};
+    CategoryRecognizer cr(DefaultCats());
+    std::vector<ProcessedTransaction> out(1);
+    ProcessTransactions(inputs.data(), inputs.size(), cr, out.data());
+    const char* note_buf = out[0].note.data();
+    ProcessTransactions(inputs.data(), inputs.size(), cr, out.data());
+    EXPECT_EQ(out[0].note.data(), note_buf);
+    EXPECT_EQ(out[0].category_id, 3);
+}
+
+TEST(Integration_Group3_Batch, EmptyBatchIsNoop) {
+    std::vector<ProcessedTransaction> out;
+    ProcessTransactions(std::vector<TransactionInput>{}, DefaultCats(), out);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(Integration_Group3_Batch, ViewsIntoSharedBufferAreZeroCopy) {
+    // 模拟解析后的 CSV 缓冲区：备注与日期都是其中的切片，不以 '\0' 结尾
+    const std::string buffer = "餐饮 午饭,2026-01-05\n工资 发放,\n";
+    const std::size_t comma1 = buffer.find(',');
+    const std::size_t nl1 = buffer.find('\n');
+    const std::size_t comma2 = buffer.find(',', nl1);
+    std::string_view view(buffer);
+    std::vector<TransactionInput> inputs = {
+        {view.substr(0, comma1), view.substr(comma1 + 1, nl1 - comma1 - 1)},
+        {view.substr(nl1 + 1, comma2 - nl1 - 1), view.substr(comma2 + 1, 0)},
+    };
+    CategoryRecognizer cr(DefaultCats());
+    std::vector<ProcessedTransaction> out(inputs.size());
+    ProcessTransactions(inputs.data(), inputs.size(), cr, out.data(), NoteCopy::kSkip);
+    EXPECT_EQ(out[0].category_id, 1);
+    EXPECT_EQ(out[0].date.ToString(), "2026-01-05");
+    EXPECT_TRUE(out[0].note.empty());
+    EXPECT_EQ(out[1].category_id, 4);
+    EXPECT_TRUE(out[1].date.valid());
+}
+
+// ===================== 集成测试：组4（并行批量处理） =====================
+// inputs 只是视图，notes 持有底层字符串
+struct MixedBatch {
+    std::vector<std::string> notes;
+    std::vector<TransactionInput> inputs;
+};
+
+static MixedBatch MakeMixedBatch(std::size_t n) {
+    static const char* kNotes[] = {"餐饮 午饭", "娱乐 电影票", "水电费 1月账单", "工资 发放", "买书", ""};
+    MixedBatch b;
+    b.notes.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) b.notes.push_back(kNotes[i % 6] + std::to_string(i));
+    b.inputs.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        b.inputs.push_back({b.notes[i], i % 3 == 0 ? "" : "2026-02-01"});
+    }
+    return b;
+}
+
+TEST(Integration_Group4_Parallel, ParallelMatchesSerialForAnyThreadCount) {
+    auto batch = MakeMixedBatch(10007);
+    const auto& inputs = batch.inputs;
+    std::vector<ProcessedTransaction> serial;
+    ProcessTransactions(inputs, DefaultCats(), serial);
+    for (std::size_t threads : {1u, 2u, 3u, 8u}) {
+        std::vector<ProcessedTransaction> parallel;
+        ProcessTransactionsParallel(inputs, DefaultCats(), parallel, threads, 97);
+        ASSERT_EQ(parallel.size(), serial.size());
+        for (std::size_t i = 0; i < serial.size(); ++i) {
+            ASSERT_EQ(parallel[i].category_id, serial[i].category_id) << "row " << i;
+            ASSERT_EQ(parallel[i].note, serial[i].note) << "row " << i;
+            ASSERT_EQ(parallel[i].date, serial[i].date) << "row " << i;
+        }
+    }
+}
+
+TEST(Integration_Group4_Parallel, PoolRunsEveryTaskExactlyOnceAcrossRounds) {
+    WorkStealingPool pool(4);
+    for (int round = 0; round < 20; ++round) {
+        std::vector<std::atomic<int>> hits(513);
+        pool.ParallelFor(hits.size(), [&](std::size_t i) { hits[i].fetch_add(1); });
+        for (auto& h : hits) ASSERT_EQ(h.load(), 1);
+    }
+}
+
+TEST(Integration_Group4_Parallel, PoolPropagatesTaskException) {
+    WorkStealingPool pool(3);
+    EXPECT_THROW(pool.ParallelFor(64, [](std::size_t i) {
+        if (i == 42) throw std::runtime_error("boom");
+    }), std::runtime_error);
+    std::atomic<int> ran{0};
+    pool.ParallelFor(8, [&](std::size_t) { ran.fetch_add(1); });
+    EXPECT_EQ(ran.load(), 8);
+}
+
+// ===================== 集成测试：组5（列式批量结果） =====================
+TEST(Integration_Group5_ArenaBatch, MatchesProcessedTransactionArray) {
+    auto batch = MakeMixedBatch(3001);
+    CategoryRecognizer cr(DefaultCats());
+    std::vector<ProcessedTransaction> expected(batch.inputs.size());
+    ProcessTransactions(batch.inputs.data(), batch.inputs.size(), cr, expected.data());
+
+    TransactionBatch serial;
+    ProcessTransactions(batch.inputs.data(), batch.inputs.size(), cr, serial);
+    WorkStealingPool pool(3);
+    TransactionBatch parallel;
+    ProcessTransactions(batch.inputs.data(), batch.inputs.size(), cr, parallel, pool, 64);
+
+    ASSERT_EQ(serial.size(), expected.size());
+    ASSERT_EQ(parallel.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(serial.note(i), expected[i].note);
+        ASSERT_EQ(serial.category_id(i), expected[i].category_id);
+        ASSERT_EQ(serial.date(i), expected[i].date);
+        ASSERT_EQ(parallel.note(i), expected[i].note);
+        ASSERT_EQ(parallel.category_id(i), expected[i].category_id);
+    }
+}
+
+TEST(Integration_Group5_ArenaBatch, AppendAccumulatesAndClearKeepsCapacity) {
+    std::vector<TransactionInput> inputs = {{"餐饮 午饭", "2026-01-01"}, {"", ""}};
+    CategoryRecognizer cr(DefaultCats());
+    TransactionBatch batch;
+    ProcessTransactions(inputs.data(), inputs.size(), cr, batch);
+    ProcessTransactions(inputs.data(), inputs.size(), cr, batch);
+    ASSERT_EQ(batch.size(), 4u);
+    EXPECT_EQ(batch.note(2), "餐饮 午饭");
+    EXPECT_EQ(batch.note(3), "");
+    EXPECT_EQ(batch.ToProcessed(2).date.ToString(), "2026-01-01");
+    EXPECT_EQ(batch.category_id(3), 5);
+
+    const std::size_t bytes = batch.note_bytes();
+    batch.Clear();
+    EXPECT_TRUE(batch.empty());
+    batch.Append(PackedDate(2026, 1, 2), 1, "手工追加");
+    EXPECT_EQ(batch.note(0), "手工追加");
+    EXPECT_LT(batch.note_bytes(), bytes);
+}
+
+TEST(Integration_Group5_ArenaBatch, ColumnsAreContiguousAndMatchAccessors) {
+    auto mixed = MakeMixedBatch(100);
+    CategoryRecognizer cr(DefaultCats());
+    TransactionBatch batch;
+    ProcessTransactions(mixed.inputs.data(), mixed.inputs.size(), cr, batch);
+    ASSERT_EQ(batch.note_offsets()[0], 0u);
+    ASSERT_EQ(batch.note_offsets()[batch.size()], batch.note_bytes());
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        EXPECT_EQ(batch.category_ids()[i], batch.category_id(i));
+        EXPECT_EQ(batch.packed_dates()[i], batch.date(i).value());
+        const std::string_view note(batch.note_data() + batch.note_offsets()[i],
+                                    batch.note_offsets()[i + 1] - batch.note_offsets()[i]);
+        EXPECT_EQ(note, mixed.notes[i]);
+    }
+}
+
+// ===================== 集成测试：组6（CSV 导入流水线） =====================
+// 替换全局 operator new：不小于 g_fail_allocations_from 字节的分配抛 bad_alloc（0 表示不注入），
+// 用来在解析线程里制造分配失败
+static std::atomic<std::size_t> g_fail_allocations_from{0};
+
+void* operator new(std::size_t size) {
+    const std::size_t limit = g_fail_allocations_from.load(std::memory_order_relaxed);
+    if (limit != 0 && size >= limit) throw std::bad_alloc();
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// 把所有回调批次收集成 ProcessedTransaction，便于断言
+static std::vector<ProcessedTransaction> IngestAll(std::string_view data, const CsvIngestOptions& opt,
+                                                   IngestStats* stats_out = nullptr) {
+    CategoryRecognizer cr(DefaultCats());
+    std::vector<ProcessedTransaction> rows;
+    IngestStats stats = IngestCsvBuffer(data, cr, opt, [&](const TransactionBatch& b) {
+        for (std::size_t i = 0; i < b.size(); ++i) rows.push_back(b.ToProcessed(i));
+    });
+    if (stats_out != nullptr) *stats_out = stats;
+    return rows;
+}
+
+TEST(Integration_Group6_CsvIngest, FindEitherLocatesBytesAcrossVectorBlocks) {
+    std::string s(100, 'x');
+    for (std::size_t pos : {0u, 15u, 16u, 17u, 31u, 64u, 99u}) {
+        std::string t = s;
+        t[pos] = ',';
+        EXPECT_EQ(FindEither(t.data(), t.data() + t.size(), ',', '\n') - t.data(),
+                  static_cast<std::ptrdiff_t>(pos));
+    }
+    EXPECT_EQ(FindEither(s.data(), s.data() + s.size(), ',', '\n'), s.data() + s.size());
+}
+
+TEST(Integration_Group6_CsvIngest, ParsesQuotedFieldsBomAndCrlf) {
+    const std::string data =
+        "\xEF\xBB\xBFnote,date,amount\r\n"
+        "餐饮 午饭,2026-01-01,-23.5\r\n"
+        "\"工资, \"\"一月\"\"\",2026-01-02\r\n"
+        "\r\n"
+        "\"多行\n买书\",\r\n"
+        "娱乐 电影票,2026-01-03";
+    CsvIngestOptions opt;
+    opt.has_header = true;
+    IngestStats stats;
+    auto rows = IngestAll(data, opt, &stats);
+    EXPECT_TRUE(stats.ok);
+    ASSERT_EQ(rows.size(), 4u);
+    EXPECT_EQ(stats.rows, 4u);
+    EXPECT_EQ(rows[0].note, "餐饮 午饭");
+    EXPECT_EQ(rows[0].category_id, 1);
+    EXPECT_EQ(rows[0].amount_cents, -2350);
+    EXPECT_EQ(rows[1].note, "工资, \"一月\"");
+    EXPECT_EQ(rows[1].amount_cents, 0);  // 缺少金额列
+    EXPECT_EQ(rows[1].category_id, 4);
+    EXPECT_EQ(rows[1].date.ToString(), "2026-01-02");
+    EXPECT_EQ(rows[2].note, "多行\n买书");
+    EXPECT_EQ(rows[2].category_id, 5);
+    EXPECT_EQ(rows[2].date, GetCurrentPackedDate());
+    EXPECT_EQ(rows[3].category_id, 2);
+}
+
+TEST(Integration_Group6_CsvIngest, TsvWithCustomColumnsInSmallChunks) {
+    std::string data;
+    for (int i = 0; i < 1000; ++i) data += "2026-02-01\t" + std::to_string(i) + "\t水电费 账单\n";
+    CsvIngestOptions opt;
+    opt.delimiter = '\t';
+    opt.date_column = 0;
+    opt.note_column = 2;
+    opt.amount_column = 1;
+    opt.chunk_rows = 37;
+    IngestStats stats;
+    auto rows = IngestAll(data, opt, &stats);
+    ASSERT_EQ(rows.size(), 1000u);
+    EXPECT_EQ(stats.chunks, (1000u + 36u) / 37u);
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        ASSERT_EQ(rows[i].category_id, 3);
+        ASSERT_EQ(rows[i].date.ToString(), "2026-02-01");
+        ASSERT_EQ(rows[i].amount_cents, static_cast<int64_t>(i) * 100);
+    }
+    EXPECT_GT(stats.RowsPerSecond(), 0.0);
+}
+
+TEST(Integration_Group6_CsvIngest, ParallelChunksMatchSerial) {
+    auto batch = MakeMixedBatch(5000);
+    std::string data;
+    for (const auto& in : batch.inputs) {
+        data.append(in.note.data(), in.note.size()).append(",").append(in.date.data(), in.date.size()).append("\n");
+    }
+    CsvIngestOptions opt;
+    opt.chunk_rows = 512;
+    auto serial = IngestAll(data, opt);
+    WorkStealingPool pool(3);
+    opt.pool = &pool;
+    auto parallel = IngestAll(data, opt);
+    ASSERT_EQ(serial.size(), parallel.size());
+    for (std::size_t i = 0; i < serial.size(); ++i) {
+        ASSERT_EQ(serial[i].note, parallel[i].note);
+        ASSERT_EQ(serial[i].category_id, parallel[i].category_id);
+        ASSERT_EQ(serial[i].date, parallel[i].date);
+    }
+}
+
+TEST(Integration_Group6_CsvIngest, ProducerAllocationFailureIsRethrownAfterJoin) {
+    std::string data;
+    for (int i = 0; i < 100000; ++i) data += "餐饮 午饭\n";
+    CategoryRecognizer cr(DefaultCats());
+    CsvIngestOptions opt;
+    opt.chunk_rows = 100000;
+    std::size_t rows = 0;
+    bool threw = false;
+    // 解析线程的 inputs 增长到约 50000 行时失败；调用线程此前没有这么大的分配
+    g_fail_allocations_from.store(sizeof(TransactionInput) * 50000);
+    try {
+        IngestCsvBuffer(data, cr, opt, [&](const TransactionBatch& b) { rows += b.size(); });
+    } catch (const std::bad_alloc&) {
+        threw = true;
+    }
+    g_fail_allocations_from.store(0);
+    EXPECT_TRUE(threw);
+    EXPECT_EQ(rows, 0u);
+
+    // 之后照常可用
+    opt.chunk_rows = 4096;
+    const IngestStats stats = IngestCsvBuffer(data, cr, opt, [&](const TransactionBatch& b) { rows += b.size(); });
+    EXPECT_EQ(stats.rows, 100000u);
+    EXPECT_EQ(rows, 100000u);
+}
+
+TEST(Integration_Group6_CsvIngest, MappedFileDiscardsConsumedPagesAndMatchesBuffer) {
+    const auto path = std::filesystem::temp_directory_path() / "account_book_ingest_pages.csv";
+    auto batch = MakeMixedBatch(20000);
+    std::string data;
+    for (const auto& in : batch.inputs) {
+        data.append(in.note.data(), in.note.size()).append(",").append(in.date.data(), in.date.size()).append("\n");
+    }
+    {
+        std::ofstream f(path, std::ios::binary);
+        f << data;
+    }
+    CsvIngestOptions opt;
+    opt.chunk_rows = 300;  // 每块几页，块边界多数不在页边界上
+    const auto expected = IngestAll(data, opt);
+    CategoryRecognizer cr(DefaultCats());
+    std::vector<ProcessedTransaction> rows;
+    const IngestStats stats = IngestCsvFile(path.string(), cr, opt, [&](const TransactionBatch& b) {
+        for (std::size_t i = 0; i < b.size(); ++i) rows.push_back(b.ToProcessed(i));
+    });
+    ASSERT_TRUE(stats.ok) << stats.error;
+    ASSERT_EQ(rows.size(), expected.size());
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        ASSERT_EQ(rows[i].note, expected[i].note);
+        ASSERT_EQ(rows[i].category_id, expected[i].category_id);
+        ASSERT_EQ(rows[i].date, expected[i].date);
+    }
+
+    // 丢弃后的页再读会从文件重新载入
+    MappedFile file;
+    ASSERT_TRUE(file.Open(path.string(), nullptr));
+    file.DiscardPrefix(data.size() / 2);
+    file.DiscardPrefix(data.size() + 100);
+    EXPECT_EQ(file.view(), data);
+    file.Close();
+    std::filesystem::remove(path);
+}
+
+TEST(Integration_Group6_CsvIngest, MappedFileIngestAndErrors) {
+    const auto path = std::filesystem::temp_directory_path() / "account_book_ingest_test.csv";
+    {
+        std::ofstream f(path, std::ios::binary);
+        f << "餐饮 午饭,2026-01-01\n工资 发放,2026-01-02\n";
+    }
+    CategoryRecognizer cr(DefaultCats());
+    std::vector<int> ids;
+    IngestStats stats = IngestCsvFile(path.string(), cr, CsvIngestOptions{}, [&](const TransactionBatch& b) {
+        for (std::size_t i = 0; i < b.size(); ++i) ids.push_back(b.category_id(i));
+    });
+    EXPECT_TRUE(stats.ok);
+    EXPECT_EQ(ids, (std::vector<int>{1, 4}));
+
+    { std::ofstream f(path, std::ios::binary | std::ios::trunc); }
+    stats = IngestCsvFile(path.string(), cr, CsvIngestOptions{}, nullptr);
+    EXPECT_TRUE(stats.ok);
+    EXPECT_EQ(stats.rows, 0u);
+    std::filesystem::remove(path);
+
+    stats = IngestCsvFile(path.string(), cr, CsvIngestOptions{}, nullptr);
+    EXPECT_FALSE(stats.ok);
+    EXPECT_FALSE(stats.error.empty());
+}
+
+// ===================== 集成测试：组7（列式分组聚合） =====================
+// 逐行用 std::map 聚合的参照实现
+static std::vector<GroupTotal> GroupByMap(const TransactionBatch& batch, DateGrain grain,
+                                          DateRange range = DateRange()) {
+    struct Acc {
+        uint64_t count = 0;
+        int64_t sum = 0;
+        bool any = false;
+        int64_t min = 0;
+        int64_t max = 0;
+    };
+    std::map<std::pair<int, uint32_t>, Acc> groups;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        const PackedDate d = batch.date(i);
+        if (!range.Contains(d.value())) continue;
+        uint32_t bucket = 0;
+        if (d.valid() && grain == DateGrain::kDay) bucket = d.value();
+        if (d.valid() && grain == DateGrain::kMonth) bucket = PackedDate(d.year(), d.month(), 1).value();
+        auto& g = groups[{batch.category_id(i), bucket}];
+        g.count += 1;
+        const int64_t v = batch.amount_cents(i);
+        if (v == kInvalidAmount) continue;
+        g.sum += v;
+        g.min = g.any ? std::min(g.min, v) : v;
+        g.max = g.any ? std::max(g.max, v) : v;
+        g.any = true;
+    }
+    std::vector<GroupTotal> out;
+    for (const auto& kv : groups) {
+        const Acc& g = kv.second;
+        out.push_back({kv.first.first, PackedDate::FromValue(kv.first.second), g.count, g.sum, g.min, g.max});
+    }
+    return out;
+}
+
+static void ExpectSameGroups(const std::vector<GroupTotal>& actual, const std::vector<GroupTotal>& expected) {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (std::size_t i = 0; i < actual.size(); ++i) {
+        EXPECT_EQ(actual[i].category_id, expected[i].category_id) << i;
+        EXPECT_EQ(actual[i].bucket, expected[i].bucket) << i;
+        EXPECT_EQ(actual[i].count, expected[i].count) << i;
+        EXPECT_EQ(actual[i].sum, expected[i].sum) << i;
+        EXPECT_EQ(actual[i].min, expected[i].min) << i;
+        EXPECT_EQ(actual[i].max, expected[i].max) << i;
+    }
+}
+
+static std::vector<SimdLevel> AvailableLevels() {
+    std::vector<SimdLevel> levels{SimdLevel::kScalar};
+    if (ActiveSimdLevel() != SimdLevel::kScalar) levels.push_back(ActiveSimdLevel());
+    return levels;
+}
+
+// 约两个月的日期，另有无效日期与无效金额
+static TransactionBatch MakeLedger(std::size_t n, const std::vector<int>& ids) {
+    TransactionBatch batch;
+    for (std::size_t i = 0; i < n; ++i) {
+        const int day = static_cast<int>(i * 7 % 59);  // 2025-12-01 起
+        const PackedDate date = i % 13 == 0 ? PackedDate()
+                                : day < 31  ? PackedDate(2025, 12, day + 1)
+                                            : PackedDate(2026, 1, day - 30);
+        const int64_t amount = i % 29 == 5 ? kInvalidAmount : static_cast<int64_t>(i % 17) * 100 - 450;
+        batch.Append(date, ids[i * 31 % ids.size()], "", amount);
+    }
+    return batch;
+}
+
+TEST(Integration_Group7_Aggregate, DenseGroupsMatchRowByRowMapForEveryGrain) {
+    const TransactionBatch batch = MakeLedger(5003, {1, 2, 3, 4, 5, -2, 40});
+    for (DateGrain grain : {DateGrain::kNone, DateGrain::kDay, DateGrain::kMonth}) {
+        const auto expected = GroupByMap(batch, grain);
+        ExpectSameGroups(GroupByCategory(batch, grain), expected);
+        for (SimdLevel level : AvailableLevels()) {
+            ExpectSameGroups(GroupByCategory(batch.category_ids(), batch.packed_dates(), batch.amounts(),
+                                             batch.size(), grain, DateRange(), level),
+                             expected);
+        }
+    }
+    // 不传 values 时只计数
+    const auto counts = GroupByCategory(batch.category_ids(), batch.packed_dates(), nullptr, batch.size(),
+                                        DateGrain::kNone);
+    uint64_t total = 0;
+    for (const auto& g : counts) {
+        EXPECT_EQ(g.sum, 0);
+        EXPECT_EQ(g.min, 0);
+        EXPECT_EQ(g.max, 0);
+        total += g.count;
+    }
+    EXPECT_EQ(total, batch.size());
+}
+
+TEST(Integration_Group7_Aggregate, DateRangeFiltersRowsBeforeGrouping) {
+    const TransactionBatch batch = MakeLedger(5003, {1, 2, 3, 4, 5, -2, 40});
+    const DateRange ranges[] = {
+        DateRange::Between(PackedDate(2025, 12, 10), PackedDate(2026, 1, 3)),
+        DateRange::Between(PackedDate(2026, 1, 1), PackedDate(2026, 1, 1)),
+        DateRange::Between(PackedDate(2024, 1, 1), PackedDate(2024, 12, 31)),  // 无数据
+    };
+    for (const DateRange& range : ranges) {
+        EXPECT_FALSE(range.Contains(PackedDate().value()));  // 有界范围不含无效日期
+        for (DateGrain grain : {DateGrain::kNone, DateGrain::kDay, DateGrain::kMonth}) {
+            const auto expected = GroupByMap(batch, grain, range);
+            for (SimdLevel level : AvailableLevels()) {
+                ExpectSameGroups(GroupByCategory(batch.category_ids(), batch.packed_dates(), batch.amounts(),
+                                                 batch.size(), grain, range, level),
+                                 expected);
+            }
+        }
+    }
+    EXPECT_TRUE(GroupByCategory(batch, DateGrain::kMonth, ranges[2]).empty());
+}
+
+TEST(Integration_Group7_Aggregate, SummarizeAmountsSkipsInvalidAndOutOfRangeRows) {
+    const TransactionBatch batch = MakeLedger(5003, {1, 2, 3});
+    const DateRange ranges[] = {
+        DateRange(),
+        DateRange::Between(PackedDate(2025, 12, 10), PackedDate(2026, 1, 3)),
+        DateRange::Between(PackedDate(2024, 1, 1), PackedDate(2024, 12, 31)),
+    };
+    for (const DateRange& range : ranges) {
+        AmountSummary expected;
+        bool any = false;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            const int64_t v = batch.amount_cents(i);
+            if (!range.Contains(batch.date(i).value()) || v == kInvalidAmount) continue;
+            ++expected.count;
+            expected.sum += v;
+            expected.min = any ? std::min(expected.min, v) : v;
+            expected.max = any ? std::max(expected.max, v) : v;
+            any = true;
+        }
+        // 每种长度都覆盖向量主循环之后的标量尾部
+        for (std::size_t n : {batch.size(), std::size_t{7}}) {
+            const AmountSummary whole = SummarizeAmounts(batch.packed_dates(), batch.amounts(), n, range,
+                                                         SimdLevel::kScalar);
+            for (SimdLevel level : AvailableLevels()) {
+                const AmountSummary r = SummarizeAmounts(batch.packed_dates(), batch.amounts(), n, range, level);
+                EXPECT_EQ(r.count, whole.count);
+                EXPECT_EQ(r.sum, whole.sum);
+                EXPECT_EQ(r.min, whole.min);
+                EXPECT_EQ(r.max, whole.max);
+            }
+        }
+        const AmountSummary r = SummarizeAmounts(batch, range);
+        EXPECT_EQ(r.count, expected.count);
+        EXPECT_EQ(r.sum, expected.sum);
+        EXPECT_EQ(r.min, expected.min);
+        EXPECT_EQ(r.max, expected.max);
+    }
+}
+
+TEST(Integration_Group7_Aggregate, WideIdRangeFallsBackToSparseGroups) {
+    const TransactionBatch batch = MakeLedger(301, {1, 1 << 30, -(1 << 30)});
+    const DateRange december = DateRange::Between(PackedDate(2025, 12, 1), PackedDate(2025, 12, 31));
+    for (DateGrain grain : {DateGrain::kNone, DateGrain::kDay, DateGrain::kMonth}) {
+        ExpectSameGroups(GroupByCategory(batch, grain), GroupByMap(batch, grain));
+        ExpectSameGroups(GroupByCategory(batch, grain, december), GroupByMap(batch, grain, december));
+    }
+    EXPECT_TRUE(GroupByCategory(TransactionBatch(), DateGrain::kDay).empty());
+}
+
+TEST(Integration_Group7_Aggregate, ClassifiedBatchCarriesParsedAmounts) {
+    CategoryRecognizer cr(DefaultCats());
+    const std::vector<TransactionInput> inputs = {
+        {"午餐", "2026-01-02", "-35.50"},
+        {"工资", "2026-01-05", "8000"},
+        {"午餐", "2026-01-09", "12.3"},
+        {"打车", "2026-01-09", "1,000"},
+        {"打车", "", ""},
+    };
+    TransactionBatch batch;
+    ProcessTransactions(inputs.data(), inputs.size(), cr, batch);
+    ASSERT_EQ(batch.size(), inputs.size());
+    EXPECT_EQ(batch.amount_cents(0), -3550);
+    EXPECT_EQ(batch.amount_cents(1), 800000);
+    EXPECT_EQ(batch.amount_cents(2), 1230);
+    EXPECT_EQ(batch.amount_cents(3), kInvalidAmount);
+    EXPECT_EQ(batch.amount_cents(4), 0);
+    EXPECT_EQ(batch.ToProcessed(0).amount_cents, -3550);
+
+    const AmountSummary january =
+        SummarizeAmounts(batch, DateRange::Between(PackedDate(2026, 1, 1), PackedDate(2026, 1, 31)));
+    EXPECT_EQ(january.count, 3u);
+    EXPECT_EQ(january.sum, 800000 - 3550 + 1230);
+    EXPECT_EQ(january.min, -3550);
+    EXPECT_EQ(january.max, 800000);
+    EXPECT_EQ(FormatAmountCents(january.sum), "7976.80");
+    EXPECT_EQ(FormatAmountCents(-5), "-0.05");
+    EXPECT_EQ(FormatAmountCents(kInvalidAmount), "");
+}
+
+// ===================== 集成测试：组8（异步微批处理） =====================
+TEST(Integration_Group8_MicroBatch, ConcurrentFuturesMatchSynchronousResults) {
+    auto cr = std::make_shared<const CategoryRecognizer>(DefaultCats());
+    MicroBatchOptions opt;
+    opt.max_batch = 32;
+    opt.max_delay = std::chrono::microseconds(500);
+    MicroBatchClassifier classifier(cr, opt);
+
+    const std::vector<std::string> notes = {"餐饮 午饭", "工资 发放", "水电费 账单", "买书", ""};
+    constexpr int kThreads = 8;
+    constexpr int kPerThread = 200;
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{0};
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<std::future<ProcessedTransaction>> pending;
+            for (int i = 0; i < kPerThread; ++i) {
+                const std::string& note = notes[static_cast<std::size_t>(t + i) % notes.size()];
+                pending.push_back(classifier.Submit({note, i % 2 == 0 ? "2026-03-04" : "", std::to_string(i)}));
+            }
+            for (int i = 0; i < kPerThread; ++i) {
+                const ProcessedTransaction out = pending[static_cast<std::size_t>(i)].get();
+                const std::string& note = notes[static_cast<std::size_t>(t + i) % notes.size()];
+                const PackedDate date = i % 2 == 0 ? PackedDate(2026, 3, 4) : GetCurrentPackedDate();
+                if (out.note != note || out.category_id != cr->RecognizeCategory(note) || out.date != date ||
+                    out.amount_cents != i * 100) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(mismatches.load(), 0);
+    const MicroBatchStats stats = classifier.Stats();
+    EXPECT_EQ(stats.requests, static_cast<uint64_t>(kThreads * kPerThread));
+    EXPECT_GE(stats.batches, stats.requests / opt.max_batch);
+    EXPECT_LE(stats.AverageBatch(), static_cast<double>(opt.max_batch));
+}
+
+TEST(Integration_Group8_MicroBatch, FullBatchDoesNotWaitForDelay) {
+    MicroBatchOptions opt;
+    opt.max_batch = 8;
+    opt.max_delay = std::chrono::seconds(30);  // 只有积满才会提前处理
+    MicroBatchClassifier classifier(std::make_shared<const CategoryRecognizer>(DefaultCats()), opt);
+    std::vector<std::future<ProcessedTransaction>> pending;
+    for (int i = 0; i < 8; ++i) pending.push_back(classifier.Submit({"娱乐 电影", "2026-01-01", ""}));
+    for (auto& f : pending) {
+        ASSERT_EQ(f.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+        EXPECT_EQ(f.get().category_id, 2);
+    }
+    EXPECT_EQ(classifier.Stats().batches, 1u);
+    EXPECT_EQ(classifier.Stats().requests, 8u);
+}
+
+TEST(Integration_Group8_MicroBatch, LoneRequestFlushesAfterMaxDelay) {
+    MicroBatchOptions opt;
+    opt.max_delay = std::chrono::milliseconds(2);
+    MicroBatchClassifier classifier(std::make_shared<const CategoryRecognizer>(DefaultCats()), opt);
+    auto f = classifier.Submit({"工资", "", "8000.5"});
+    ASSERT_EQ(f.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    const ProcessedTransaction out = f.get();
+    EXPECT_EQ(out.category_id, 4);
+    EXPECT_EQ(out.amount_cents, 800050);
+}
+
+TEST(Integration_Group8_MicroBatch, CallbacksAndDestructorDrainPendingRequests) {
+    std::atomic<int> delivered{0};
+    {
+        MicroBatchOptions opt;
+        opt.max_delay = std::chrono::seconds(30);
+        MicroBatchClassifier classifier(std::make_shared<const CategoryRecognizer>(DefaultCats()), opt);
+        for (int i = 0; i < 5; ++i) {
+            classifier.Submit({"餐饮", "", ""}, [&delivered](ProcessedTransaction out) {
+                if (out.category_id == 1) ++delivered;
+                throw std::runtime_error("ignored");  // 不影响同批其他请求
+            });
+        }
+    }
+    EXPECT_EQ(delivered.load(), 5);
+}
+
+TEST(Integration_Group8_MicroBatch, EmptyCallbackIsRejectedAtSubmit) {
+    MicroBatchClassifier classifier(std::make_shared<const CategoryRecognizer>(DefaultCats()));
+    EXPECT_THROW(classifier.Submit({"餐饮", "", ""}, MicroBatchClassifier::Callback()), std::invalid_argument);
+    EXPECT_EQ(classifier.Submit({"餐饮", "", ""}).get().category_id, 1);
+    EXPECT_EQ(classifier.Stats().requests, 1u);
+}
+
+TEST(Integration_Group8_MicroBatch, LiveRecognizerUpdatesApplyToLaterBatches) {
+    LiveCategoryRecognizer live(DefaultCats());
+    MicroBatchOptions opt;
+    opt.max_delay = std::chrono::microseconds(0);
+    MicroBatchClassifier classifier(live, opt);
+    EXPECT_EQ(classifier.Submit({"咖啡", "", ""}).get().category_id, 5);
+    ASSERT_TRUE(live.AddCategory({9, "咖啡", ""}));
+    EXPECT_EQ(classifier.Submit({"咖啡", "", ""}).get().category_id, 9);
+}
+
+// ===================== 集成测试：组9（指标默认关闭） =====================
+static_assert(!ACCOUNT_BOOK_METRICS, "integration tests exercise the default build");
+
+TEST(Integration_Group9_Metrics, DisabledBuildRecordsNothing) {
+    CategoryRecognizer cr(DefaultCats());
+    std::vector<TransactionInput> inputs = {{"餐饮 午饭", ""}, {"买书", "2026-01-01"}};
+    TransactionBatch batch;
+    ProcessTransactions(inputs.data(), inputs.size(), cr, batch);
+    const MetricsSnapshot s = TakeMetricsSnapshot();
+    for (uint64_t c : s.counters) EXPECT_EQ(c, 0u);
+    EXPECT_EQ(s.histogram(MetricHistogram::kClassify).count(), 0u);
+    const std::string text = FormatPrometheus(s);
+    EXPECT_NE(text.find("account_book_transactions_total 0\n"), std::string::npos);
+    EXPECT_NE(text.find("account_book_classify_seconds_count 0\n"), std::string::npos);
+}
+
+// ===================== 集成测试：组10（分片追加账本） =====================
+static ProcessedTransaction LedgerRow(int writer, int64_t seq, PackedDate date) {
+    return ProcessedTransaction{date, writer, "备注" + std::to_string(seq), seq};
+}
+
+static std::vector<const ProcessedTransaction*> DrainByDate(const LedgerView& view, DateRange range = DateRange()) {
+    std::vector<const ProcessedTransaction*> rows;
+    LedgerView::DateOrderedCursor cursor = view.ByDate(range);
+    while (const ProcessedTransaction* row = cursor.Next()) rows.push_back(row);
+    return rows;
+}
+
+TEST(Integration_Group10_ShardedLedger, SingleWriterSpansSegmentsWithoutMovingRows) {
+    ShardedLedger ledger;
+    ShardedLedger::Writer writer = ledger.AcquireWriter();
+    ASSERT_TRUE(writer.valid());
+    writer.Append(LedgerRow(0, 0, PackedDate(2026, 1, 1)));
+    const ProcessedTransaction* first = nullptr;
+    ledger.View().ForEach([&](const ProcessedTransaction& row) { first = &row; });
+
+    constexpr int64_t kRows = 1024 + 2048 + 100;  // 跨过两个分段边界
+    for (int64_t i = 1; i < kRows; ++i) writer.Append(LedgerRow(0, i, PackedDate(2026, 1, 1 + static_cast<int>(i % 28))));
+    const LedgerView view = ledger.View();
+    ASSERT_EQ(view.size(), static_cast<std::size_t>(kRows));
+    int64_t expected = 0;
+    view.ForEach([&](const ProcessedTransaction& row) {
+        if (expected == 0) {
+            EXPECT_EQ(&row, first);
+        }
+        EXPECT_EQ(row.amount_cents, expected);
+        EXPECT_EQ(row.note, "备注" + std::to_string(expected));
+        ++expected;
+    });
+
+    // 分片内日期不单调：归并前按日期稳定排序
+    const std::vector<const ProcessedTransaction*> rows = DrainByDate(view);
+    ASSERT_EQ(rows.size(), static_cast<std::size_t>(kRows));
+    for (std::size_t i = 1; i < rows.size(); ++i) {
+        ASSERT_LE(rows[i - 1]->date, rows[i]->date);
+        if (rows[i - 1]->date == rows[i]->date) {
+            ASSERT_LT(rows[i - 1]->amount_cents, rows[i]->amount_cents);
+        }
+    }
+}
+
+TEST(Integration_Group10_ShardedLedger, ByDateMergesShardsWithinRange) {
+    ShardedLedger ledger;
+    {
+        ShardedLedger::Writer a = ledger.AcquireWriter();
+        ShardedLedger::Writer b = ledger.AcquireWriter();
+        for (int d = 1; d <= 20; ++d) a.Append(LedgerRow(1, d, PackedDate(2026, 3, d)));   // 按日期追加
+        for (int d = 20; d >= 1; d -= 2) b.Append(LedgerRow(2, d, PackedDate(2026, 3, d)));  // 逆序追加
+        const ProcessedTransaction batch[] = {LedgerRow(1, 100, PackedDate()), LedgerRow(1, 101, PackedDate(2026, 4, 1))};
+        ShardedLedger::Writer c = std::move(a);
+        c.Append(batch, 2);
+        EXPECT_FALSE(a.valid());
+    }
+    EXPECT_EQ(ledger.num_shards(), 2u);
+    const LedgerView view = ledger.View();
+    EXPECT_EQ(view.size(), 32u);
+
+    const std::vector<const ProcessedTransaction*> all = DrainByDate(view);
+    ASSERT_EQ(all.size(), 32u);
+    EXPECT_FALSE(all.front()->date.valid());  // 无效日期排在最前
+    EXPECT_EQ(all.back()->date, PackedDate(2026, 4, 1));
+
+    const std::vector<const ProcessedTransaction*> mid =
+        DrainByDate(view, DateRange::Between(PackedDate(2026, 3, 5), PackedDate(2026, 3, 10)));
+    std::vector<std::pair<int, int64_t>> got;
+    for (const ProcessedTransaction* row : mid) got.emplace_back(row->category_id, row->amount_cents);
+    const std::vector<std::pair<int, int64_t>> expected = {{1, 5}, {1, 6}, {2, 6}, {1, 7}, {1, 8}, {2, 8},
+                                                           {1, 9}, {1, 10}, {2, 10}};
+    EXPECT_EQ(got, expected);  // 同日按分片顺序
+    EXPECT_TRUE(DrainByDate(view, DateRange::Between(PackedDate(2025, 1, 1), PackedDate(2025, 12, 31))).empty());
+}
+
+TEST(Integration_Group10_ShardedLedger, ReleasedShardIsReusedAndExhaustionWaits) {
+    ShardedLedger ledger(1);
+    ShardedLedger::Writer first = ledger.AcquireWriter();
+    first.Append(LedgerRow(1, 0, PackedDate(2026, 1, 1)));
+
+    std::atomic<bool> acquired{false};
+    std::thread waiter([&] {
+        ShardedLedger::Writer second = ledger.AcquireWriter();
+        acquired = true;
+        second.Append(LedgerRow(2, 1, PackedDate(2026, 1, 2)));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(acquired.load());
+    first = ShardedLedger::Writer();  // 归还分片
+    waiter.join();
+    EXPECT_TRUE(acquired.load());
+    EXPECT_EQ(ledger.num_shards(), 1u);
+    EXPECT_EQ(ledger.size(), 2u);
+}
+
+TEST(Integration_Group10_ShardedLedger, ConcurrentWritersAndReadersSeeConsistentPrefixes) {
+    ShardedLedger ledger;
+    constexpr int kWriters = 6;
+    constexpr int64_t kPerWriter = 20000;
+    std::atomic<int> done{0};
+    std::atomic<int> violations{0};
+
+    std::thread reader([&] {
+        std::size_t last = 0;
+        while (done.load() < kWriters) {
+            const LedgerView view = ledger.View();
+            if (view.size() < last) ++violations;
+            last = view.size();
+            std::map<int, int64_t> next;  // 每个写者的行必须是 0,1,2... 的连续前缀
+            view.ForEach([&](const ProcessedTransaction& row) {
+                if (row.amount_cents != next[row.category_id]++) ++violations;
+            });
+            LedgerView::DateOrderedCursor cursor = view.ByDate();
+            uint32_t prev = 0;
+            std::size_t seen = 0;
+            while (const ProcessedTransaction* row = cursor.Next()) {
+                if (row->date.value() < prev) ++violations;
+                prev = row->date.value();
+                ++seen;
+            }
+            if (seen != view.size()) ++violations;
+        }
+    });
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; ++w) {
+        writers.emplace_back([&, w] {
+            ShardedLedger::Writer writer = ledger.AcquireWriter();
+            for (int64_t i = 0; i < kPerWriter; ++i) {
+                writer.Append(LedgerRow(w, i, PackedDate(2026, 1 + static_cast<int>(i * 12 / kPerWriter), 1 + w)));
+            }
+            ++done;
+        });
+    }
+    for (auto& t : writers) t.join();
+    reader.join();
+    EXPECT_EQ(violations.load(), 0);
+    EXPECT_EQ(ledger.size(), static_cast<std::size_t>(kWriters * kPerWriter));
+    EXPECT_EQ(DrainByDate(ledger.View()).size(), static_cast<std::size_t>(kWriters * kPerWriter));
+}
+
+// ===================== 集成测试：组11（日期 / 分类二级索引） =====================
+static std::vector<uint32_t> ScanRows(const TransactionBatch& batch, const int* category_id, DateRange range) {
+    std::vector<uint32_t> rows;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        if (!range.Contains(batch.date(i).value())) continue;
+        if (category_id != nullptr && batch.category_id(i) != *category_id) continue;
+        rows.push_back(static_cast<uint32_t>(i));
+    }
+    return rows;
+}
+
+static std::vector<DateRange> IndexQueryRanges() {
+    return {DateRange(),
+            DateRange::Between(PackedDate(2026, 1, 1), PackedDate(2026, 1, 31)),
+            DateRange::Between(PackedDate(2025, 12, 7), PackedDate(2025, 12, 7)),
+            DateRange::Between(PackedDate(2025, 12, 20), PackedDate(2026, 1, 5)),
+            DateRange::Between(PackedDate(2024, 1, 1), PackedDate(2024, 12, 31)),
+            DateRange{0, 0}};  // 只取日期无效的行
+}
+
+static void ExpectIndexMatchesScan(const TransactionBatch& batch, const LedgerIndex& index) {
+    std::vector<uint32_t> rows;
+    for (const DateRange& range : IndexQueryRanges()) {
+        index.Select(range, rows);
+        EXPECT_EQ(rows, ScanRows(batch, nullptr, range)) << range.from << ".." << range.to;
+        for (int id : {1, 2, 3, 4, 5, -2, 40, 99}) {
+            index.Select(batch, id, range, rows);
+            EXPECT_EQ(rows, ScanRows(batch, &id, range)) << "category " << id;
+        }
+    }
+}
+
+TEST(Integration_Group11_LedgerIndex, SelectMatchesFullScan) {
+    const TransactionBatch batch = MakeLedger(5003, {1, 2, 3, 4, 5, -2, 40});
+    const LedgerIndex index(batch);
+    EXPECT_EQ(index.indexed_rows(), batch.size());
+    EXPECT_EQ(index.num_days(), 60u);  // 59 个有效日期 + 无效日期
+    ExpectIndexMatchesScan(batch, index);
+    EXPECT_TRUE(index.CategoryPostings(99).empty());
+
+    std::vector<uint32_t> rows;
+    const DateRange january = DateRange::Between(PackedDate(2026, 1, 1), PackedDate(2026, 1, 31));
+    index.Select(batch, 1, january, rows);
+    const AmountSummary by_index = SummarizeAmounts(batch, rows);
+    AmountSummary expected;
+    expected.min = INT64_MAX;
+    expected.max = INT64_MIN;
+    for (uint32_t r : ScanRows(batch, nullptr, january)) {
+        const int64_t v = batch.amount_cents(r);
+        if (batch.category_id(r) != 1 || v == kInvalidAmount) continue;
+        ++expected.count;
+        expected.sum += v;
+        expected.min = std::min(expected.min, v);
+        expected.max = std::max(expected.max, v);
+    }
+    ASSERT_GT(expected.count, 0u);
+    EXPECT_EQ(by_index.count, expected.count);
+    EXPECT_EQ(by_index.sum, expected.sum);
+    EXPECT_EQ(by_index.min, expected.min);
+    EXPECT_EQ(by_index.max, expected.max);
+}
+
+TEST(Integration_Group11_LedgerIndex, CatchUpIndexesOnlyNewRows) {
+    const CategoryRecognizer cr(DefaultCats());
+    TransactionBatch batch;
+    LedgerIndex index;
+    const std::vector<std::vector<TransactionInput>> batches = {
+        {{"餐饮 午饭", "2026-01-03", "35"}, {"工资", "2026-01-05", "8000"}, {"娱乐", "2026-01-05", "60"}},
+        {{"餐饮 晚饭", "2026-01-05", "80"}, {"水电费", "2025-12-30", "120"}},  // 乱序日期
+        {},
+        {{"买书", "2026-01-04", "45"}, {"餐饮", "bad-date", "10"}, {"餐饮", "2026-02-01", "20"}},
+    };
+    for (const auto& inputs : batches) {
+        ProcessTransactions(inputs.data(), inputs.size(), cr, batch);
+        index.CatchUp(batch);
+        EXPECT_EQ(index.indexed_rows(), batch.size());
+        ExpectIndexMatchesScan(batch, index);
+    }
+    std::vector<uint32_t> rows;
+    index.Select(batch, 1, DateRange::Between(PackedDate(2026, 1, 1), PackedDate(2026, 1, 31)), rows);
+    EXPECT_EQ(rows, (std::vector<uint32_t>{0, 3}));
+
+    // Clear() 之后重新开始的一批：索引整体重建
+    batch.Clear();
+    const TransactionInput again[] = {{"娱乐", "2026-03-01", "5"}};
+    ProcessTransactions(again, 1, cr, batch);
+    index.CatchUp(batch);
+    EXPECT_EQ(index.num_days(), 1u);
+    index.Select(DateRange(), rows);
+    EXPECT_EQ(rows, (std::vector<uint32_t>{0}));
+    EXPECT_EQ(index.CategoryPostings(2), (std::vector<uint32_t>{0}));
+}
+
+TEST(Integration_Group11_LedgerIndex, RebuildsAfterClearAndRefillToSameSize) {
+    const CategoryRecognizer cr(DefaultCats());
+    TransactionBatch batch;
+    LedgerIndex index;
+    const TransactionInput first[] = {{"餐饮", "2026-01-03", "35"}, {"工资", "2026-01-05", "8000"}};
+    ProcessTransactions(first, 2, cr, batch);
+    index.CatchUp(batch);
+
+    // 复用同一个 batch 装一块同样行数的新数据：行号相同，内容全变
+    batch.Clear();
+    const TransactionInput second[] = {{"娱乐", "2026-02-10", "60"}, {"水电费", "2026-02-11", "120"}};
+    ProcessTransactions(second, 2, cr, batch);
+    index.CatchUp(batch);
+    EXPECT_EQ(index.indexed_rows(), 2u);
+    EXPECT_EQ(index.num_days(), 2u);
+    ExpectIndexMatchesScan(batch, index);
+
+    std::vector<uint32_t> rows;
+    index.Select(DateRange::Between(PackedDate(2026, 1, 1), PackedDate(2026, 1, 31)), rows);
+    EXPECT_TRUE(rows.empty());
+    index.Select(DateRange::Between(PackedDate(2026, 2, 1), PackedDate(2026, 2, 28)), rows);
+    EXPECT_EQ(rows, (std::vector<uint32_t>{0, 1}));
+    EXPECT_TRUE(index.CategoryPostings(1).empty());
+    EXPECT_EQ(index.CategoryPostings(3), (std::vector<uint32_t>{1}));
+
+    // 清空后填到更多行同样重建
+    batch.Clear();
+    const TransactionInput third[] = {
+        {"工资", "2026-03-01", "1"}, {"工资", "2026-03-01", "2"}, {"餐饮", "2026-03-02", "3"}};
+    ProcessTransactions(third, 3, cr, batch);
+    index.CatchUp(batch);
+    ExpectIndexMatchesScan(batch, index);
+    EXPECT_EQ(index.CategoryPostings(4), (std::vector<uint32_t>{0, 1}));
+    EXPECT_TRUE(index.CategoryPostings(2).empty());
+}
+
+TEST(Integration_Group11_LedgerIndex, RebuildsForAnotherBatchOrReassignedBatch) {
+    const CategoryRecognizer cr(DefaultCats());
+    const TransactionInput first[] = {{"餐饮", "2026-01-03", "35"}, {"工资", "2026-01-05", "8000"}};
+    const TransactionInput second[] = {{"娱乐", "2026-02-10", "60"}, {"水电费", "2026-02-11", "120"}};
+    TransactionBatch a;
+    TransactionBatch b;
+    ProcessTransactions(first, 2, cr, a);
+    ProcessTransactions(second, 2, cr, b);
+    EXPECT_NE(a.generation(), b.generation());
+
+    // 建在 a 上的索引换成同样行数的 b：整体重建，不残留 a 的行
+    LedgerIndex index(a);
+    index.CatchUp(b);
+    EXPECT_EQ(index.indexed_rows(), 2u);
+    ExpectIndexMatchesScan(b, index);
+    EXPECT_TRUE(index.CategoryPostings(1).empty());
+
+    // 整体赋值后再填回同样行数：同样重建
+    b = TransactionBatch{};
+    ProcessTransactions(first, 2, cr, b);
+    index.CatchUp(b);
+    ExpectIndexMatchesScan(b, index);
+    EXPECT_TRUE(index.CategoryPostings(2).empty());
+    EXPECT_EQ(index.CategoryPostings(1), (std::vector<uint32_t>{0}));
+
+    // 拷贝得到的 batch 也是另一代；被移走的源是空的新一代，可以继续使用
+    const TransactionBatch copy = b;
+    EXPECT_NE(copy.generation(), b.generation());
+    const uint64_t before_move = b.generation();
+    TransactionBatch moved = std::move(b);
+    EXPECT_NE(moved.generation(), before_move);
+    EXPECT_TRUE(b.empty());
+    ProcessTransactions(second, 2, cr, b);
+    EXPECT_EQ(b.note(1), "水电费");
+}
+
+// ===================== 集成测试：组12（预写日志） =====================
+static std::string LogPath(const char* name) {
+    const std::string path = (std::filesystem::temp_directory_path() / name).string();
+    std::filesystem::remove(path);
+    return path;
+}
+
+static std::vector<ProcessedTransaction> ReplayAll(const std::string& path, LogReplayResult* result = nullptr) {
+    std::vector<ProcessedTransaction> rows;
+    std::string error;
+    EXPECT_TRUE(ReplayTransactionLog(
+        path,
+        [&](const LogRecord& r) {
+            rows.push_back(ProcessedTransaction{r.date, r.category_id, std::string(r.note), r.amount_cents});
+        },
+        result, &error))
+        << error;
+    return rows;
+}
+
+TEST(Integration_Group12_TransactionLog, Crc32cMatchesReferenceVector) {
+    namespace d = transaction_log_detail;
+    const std::string check = "123456789";
+    EXPECT_EQ(d::Crc32c(check.data(), check.size(), SimdLevel::kScalar), 0xE3069283u);
+    EXPECT_EQ(d::Crc32c(check.data(), check.size()), 0xE3069283u);
+    std::string longer;
+    for (int i = 0; i < 1000; ++i) longer += static_cast<char>(i * 37);
+    for (std::size_t n : {0u, 1u, 7u, 8u, 9u, 999u}) {
+        EXPECT_EQ(d::Crc32c(longer.data(), n), d::Crc32c(longer.data(), n, SimdLevel::kScalar)) << n;
+    }
+}
+
+TEST(Integration_Group12_TransactionLog, RoundTripAndReopenContinuesLsn) {
+    const std::string path = LogPath("account_book_wal_roundtrip.log");
+    const std::vector<ProcessedTransaction> first = {
+        {PackedDate(2026, 1, 3), 1, "餐饮 午饭", 3500},
+        {PackedDate(), 5, "", kInvalidAmount},
+        {PackedDate(2026, 1, 4), 4, std::string(5000, 'x'), 800000},
+    };
+    std::string error;
+    {
+        LogReplayResult recovered;
+        auto log = TransactionLog::Open(path, TransactionLogOptions(), &error, &recovered);
+        ASSERT_NE(log, nullptr) << error;
+        EXPECT_EQ(recovered.records, 0u);
+        uint64_t lsn = 0;
+        for (const auto& row : first) lsn = log->Append(row);
+        EXPECT_EQ(lsn, 3u);
+        EXPECT_TRUE(log->WaitDurable(lsn));
+        EXPECT_GE(log->durable_lsn(), 3u);
+    }
+    {
+        LogReplayResult recovered;
+        auto log = TransactionLog::Open(path, TransactionLogOptions(), &error, &recovered);
+        ASSERT_NE(log, nullptr) << error;
+        EXPECT_EQ(recovered.records, 3u);
+        EXPECT_FALSE(recovered.torn_tail);
+        EXPECT_EQ(log->Append({PackedDate(2026, 2, 1), 2, "娱乐", 6000}), 4u);
+    }  // 析构时提交
+    LogReplayResult result;
+    const std::vector<ProcessedTransaction> rows = ReplayAll(path, &result);
+    ASSERT_EQ(rows.size(), 4u);
+    EXPECT_EQ(result.valid_bytes, std::filesystem::file_size(path));
+    for (std::size_t i = 0; i < first.size(); ++i) {
+        EXPECT_EQ(rows[i].date, first[i].date);
+        EXPECT_EQ(rows[i].category_id, first[i].category_id);
+        EXPECT_EQ(rows[i].note, first[i].note);
+        EXPECT_EQ(rows[i].amount_cents, first[i].amount_cents);
+    }
+    EXPECT_EQ(rows[3].note, "娱乐");
+
+    TransactionBatch batch;
+    ASSERT_TRUE(ReplayTransactionLog(path, batch, nullptr, &error)) << error;
+    ASSERT_EQ(batch.size(), 4u);
+    EXPECT_EQ(batch.note(0), "餐饮 午饭");
+    EXPECT_EQ(batch.amount_cents(3), 6000);
+    std::filesystem::remove(path);
+}
+
+TEST(Integration_Group12_TransactionLog, TornTailAndCorruptionStopReplay) {
+    const std::string path = LogPath("account_book_wal_torn.log");
+    std::string error;
+    {
+        auto log = TransactionLog::Open(path, TransactionLogOptions(), &error);
+        ASSERT_NE(log, nullptr) << error;
+        for (int i = 0; i < 10; ++i) log->Append({PackedDate(2026, 3, 1 + i), 1, "记录" + std::to_string(i), i});
+    }
+    const auto full = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, full - 3);  // 崩溃在最后一条记录中间
+
+    LogReplayResult result;
+    EXPECT_EQ(ReplayAll(path, &result).size(), 9u);
+    EXPECT_TRUE(result.torn_tail);
+    {
+        LogReplayResult recovered;
+        auto log = TransactionLog::Open(path, TransactionLogOptions(), &error, &recovered);
+        ASSERT_NE(log, nullptr) << error;
+        EXPECT_EQ(recovered.records, 9u);
+        EXPECT_TRUE(recovered.torn_tail);
+        EXPECT_TRUE(log->WaitDurable(log->Append({PackedDate(2026, 4, 1), 2, "恢复后", 1})));
+    }
+    std::vector<ProcessedTransaction> rows = ReplayAll(path, &result);
+    ASSERT_EQ(rows.size(), 10u);
+    EXPECT_FALSE(result.torn_tail);
+    EXPECT_EQ(rows.back().note, "恢复后");
+
+    // 中间一条记录的负载被改写：CRC 不符，重放停在它之前
+    {
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(16 + 8 + 16);  // 第一条记录的备注首字节
+        f.put('?');
+    }
+    rows = ReplayAll(path, &result);
+    EXPECT_TRUE(rows.empty());
+    EXPECT_TRUE(result.torn_tail);
+
+    {
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        f << "date,note\n2026-01-01,x\n";
+    }
+    EXPECT_EQ(TransactionLog::Open(path, TransactionLogOptions(), &error), nullptr);
+    EXPECT_EQ(error, "not a transaction log");
+    std::filesystem::remove(path);
+}
+
+TEST(Integration_Group12_TransactionLog, OversizeNoteIsRejectedNotTruncatedOnReopen) {
+    const std::string path = LogPath("account_book_wal_oversize.log");
+    std::string error;
+    {
+        auto log = TransactionLog::Open(path, TransactionLogOptions(), &error);
+        ASSERT_NE(log, nullptr) << error;
+        EXPECT_EQ(log->Append({PackedDate(2026, 7, 1), 1, "之前", 1}), 1u);
+        EXPECT_EQ(log->Append({PackedDate(2026, 7, 2), 1, std::string(kMaxLogNoteBytes + 1, 'x'), 2}, &error), 0u);
+        EXPECT_EQ(error, "note exceeds transaction log record limit");
+        EXPECT_EQ(log->Append({PackedDate(2026, 7, 3), 2, std::string(kMaxLogNoteBytes, 'y'), 3}), 2u);
+        const uint64_t lsn = log->Append({PackedDate(2026, 7, 4), 3, "之后", 4});
+        EXPECT_EQ(lsn, 3u);
+        EXPECT_TRUE(log->WaitDurable(lsn));
+        EXPECT_FALSE(log->failed());
+    }
+    // 重新打开不截掉任何已确认落盘的记录
+    LogReplayResult recovered;
+    {
+        auto log = TransactionLog::Open(path, TransactionLogOptions(), &error, &recovered);
+        ASSERT_NE(log, nullptr) << error;
+        EXPECT_EQ(recovered.records, 3u);
+        EXPECT_FALSE(recovered.torn_tail);
+    }
+    const std::vector<ProcessedTransaction> rows = ReplayAll(path);
+    ASSERT_EQ(rows.size(), 3u);
+    EXPECT_EQ(rows[1].note.size(), kMaxLogNoteBytes);
+    EXPECT_EQ(rows[2].note, "之后");
+    std::filesystem::remove(path);
+}
+
+TEST(Integration_Group12_TransactionLog, ConcurrentWritersShareCommits) {
+    const std::string path = LogPath("account_book_wal_concurrent.log");
+    constexpr int kWriters = 6;
+    constexpr int kPerWriter = 3000;
+    std::string error;
+    TransactionLogStats stats;
+    {
+        TransactionLogOptions opt;
+        opt.queue_capacity = 256;  // 小队列同时覆盖写者等待空位的路径
+        auto log = TransactionLog::Open(path, opt, &error);
+        ASSERT_NE(log, nullptr) << error;
+        std::vector<std::thread> writers;
+        std::atomic<int> not_durable{0};
+        for (int w = 0; w < kWriters; ++w) {
+            writers.emplace_back([&, w] {
+                uint64_t lsn = 0;
+                for (int i = 0; i < kPerWriter; ++i) {
+                    lsn = log->Append({PackedDate(2026, 5, 1 + w), w, "w" + std::to_string(w), i});
+                    if (i % 500 == 499 && !log->WaitDurable(lsn)) ++not_durable;
+                }
+                if (!log->WaitDurable(lsn)) ++not_durable;
+            });
+        }
+        for (auto& t : writers) t.join();
+        EXPECT_EQ(not_durable.load(), 0);
+        EXPECT_EQ(log->durable_lsn(), static_cast<uint64_t>(kWriters * kPerWriter));
+        EXPECT_FALSE(log->failed());
+        stats = log->Stats();
+    }
+    EXPECT_EQ(stats.records, static_cast<uint64_t>(kWriters * kPerWriter));
+    EXPECT_LT(stats.commits, stats.records);  // 至少有一部分 fsync 覆盖了多条记录
+
+    std::vector<int64_t> next(kWriters, 0);
+    int out_of_order = 0;
+    const std::vector<ProcessedTransaction> rows = ReplayAll(path);
+    ASSERT_EQ(rows.size(), static_cast<std::size_t>(kWriters * kPerWriter));
+    for (const auto& row : rows) {
+        if (row.amount_cents != next[static_cast<std::size_t>(row.category_id)]++) ++out_of_order;
+    }
+    EXPECT_EQ(out_of_order, 0);  // 同一写者的记录保持追加顺序
+    std::filesystem::remove(path);
+}
+
+TEST(Integration_Group12_TransactionLog, CommitWindowBatchesLoneWrites) {
+    const std::string path = LogPath("account_book_wal_window.log");
+    std::string error;
+    TransactionLogOptions opt;
+    opt.commit_window = std::chrono::milliseconds(200);
+    auto log = TransactionLog::Open(path, opt, &error);
+    ASSERT_NE(log, nullptr) << error;
+    uint64_t lsn = 0;
+    for (int i = 0; i < 50; ++i) lsn = log->Append({PackedDate(2026, 6, 1), 3, "水电费", i});
+    EXPECT_TRUE(log->WaitDurable(lsn));
+    EXPECT_LE(log->Stats().commits, 2u);  // 窗口内逐条到达的写入合成一两次提交
+    log.reset();
+    EXPECT_EQ(ReplayAll(path).size(), 50u);
+    std::filesystem::remove(path);
+}
+
+// ===================== 集成测试：组13（流式分类） =====================
+TEST(Integration_Group13_StreamClassifier, ConcurrentProducersGetOrderedResults) {
+    const auto cr = std::make_shared<const CategoryRecognizer>(DefaultCats());
+    const char* const notes[] = {"餐饮 午饭", "娱乐 电影", "水电费", "工资到账", "随便买点"};
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 2000;
+
+    std::vector<std::string> note_of(kProducers * kPerProducer);  // sequence → 提交的备注
+    std::mutex note_mu;
+    std::vector<ProcessedTransaction> delivered;
+    std::vector<uint64_t> sequences;
+    {
+        StreamOptions opt;
+        opt.workers = 4;
+        opt.capacity = 64;
+        StreamClassifier stream(cr, [&](uint64_t seq, ProcessedTransaction row) {
+            sequences.push_back(seq);
+            delivered.push_back(std::move(row));
+        }, opt);
+        std::vector<std::thread> producers;
+        for (int p = 0; p < kProducers; ++p) {
+            producers.emplace_back([&, p] {
+                for (int i = 0; i < kPerProducer; ++i) {
+                    const std::string note = std::string(notes[(p + i) % 5]) + " #" + std::to_string(i);
+                    const uint64_t seq = stream.Push({note, i % 3 == 0 ? "" : "2026-07-01", "12.50"});
+                    std::lock_guard<std::mutex> lock(note_mu);
+                    note_of[seq] = note;
+                }
+            });
+        }
+        for (auto& t : producers) t.join();
+        stream.Flush();
+        const StreamStats stats = stream.Stats();
+        EXPECT_EQ(stats.submitted, note_of.size());
+        EXPECT_EQ(stats.delivered, note_of.size());
+        EXPECT_EQ(stats.in_flight, 0u);
+        EXPECT_EQ(stats.classify.count, note_of.size());
+        EXPECT_EQ(stats.sink.count, note_of.size());
+    }
+
+    ASSERT_EQ(delivered.size(), note_of.size());
+    for (std::size_t i = 0; i < delivered.size(); ++i) {
+        ASSERT_EQ(sequences[i], i);
+        EXPECT_EQ(delivered[i].note, note_of[i]);
+        EXPECT_EQ(delivered[i].category_id, cr->RecognizeCategory(note_of[i]));
+        EXPECT_EQ(delivered[i].amount_cents, 1250);
+        EXPECT_TRUE(delivered[i].date.valid());
+    }
+}
+
+TEST(Integration_Group13_StreamClassifier, SlowSinkAppliesBackpressure) {
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic<int> sunk{0};
+    StreamOptions opt;
+    opt.workers = 2;
+    opt.capacity = 8;
+    StreamClassifier stream(std::make_shared<const CategoryRecognizer>(DefaultCats()),
+                            [&](uint64_t, ProcessedTransaction) {
+                                opened.wait();
+                                ++sunk;
+                            },
+                            opt);
+    ASSERT_EQ(stream.capacity(), 8u);
+
+    // sink 卡住时最多只有 capacity 条在途，其余 TryPush 被拒
+    int accepted = 0;
+    for (int i = 0; i < 20; ++i) {
+        ClassifyRequest request{"餐饮", "2026-07-01", ""};
+        if (stream.TryPush(request)) {
+            ++accepted;
+        } else {
+            EXPECT_EQ(request.note, "餐饮");  // 被拒时请求原样保留
+        }
+    }
+    EXPECT_EQ(accepted, 8);
+    EXPECT_EQ(stream.Stats().rejected, 12u);
+    EXPECT_EQ(stream.Stats().in_flight, 8u);
+
+    // 阻塞的 Push 在 sink 放行后才返回
+    std::atomic<bool> pushed{false};
+    std::thread producer([&] {
+        stream.Push({"娱乐", "", ""});
+        pushed = true;
+    });
+    while (stream.Stats().backpressure_waits == 0) std::this_thread::yield();
+    EXPECT_FALSE(pushed.load());
+    gate.set_value();
+    producer.join();
+    stream.Flush();
+    EXPECT_EQ(sunk.load(), 9);
+    EXPECT_EQ(stream.Stats().delivered, 9u);
+}
+
+TEST(Integration_Group13_StreamClassifier, LiveRecognizerAndThrowingSink) {
+    LiveCategoryRecognizer live(DefaultCats());
+    std::vector<int> ids;
+    {
+        StreamClassifier stream(live, [&](uint64_t seq, ProcessedTransaction row) {
+            ids.push_back(row.category_id);
+            if (seq % 2 == 0) throw std::runtime_error("sink failure");  // 被丢弃，不影响后续结果
+        });
+        for (int i = 0; i < 10; ++i) stream.Push({"工资 发放", "2026-07-01", ""});
+    }  // 析构时交付全部
+    EXPECT_EQ(ids, std::vector<int>(10, 4));
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
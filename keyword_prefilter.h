@@ -0,0 +1,222 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "simd_support.h"
+
+// ===================== 组件B：关键词字节对预过滤 =====================
+// 自动机处于根状态时，只有“某个关键词的前两个字节”出现的位置才可能开始一次匹配，
+// 其余位置经根状态转移后仍回到根，可以整段跳过。中文关键词的首字节（UTF-8 引导字节
+// 0xE4~0xE9）在中文备注里几乎处处出现，只看首字节筛不掉什么，所以按字节对过滤。
+//
+// Next() 返回下一个候选位置：
+//   - 精确判定用 64Ki 位的字节对位图；长度为 1 的关键词对任意后继字节置位；
+//   - 字节对不多时先做 Teddy 式半字节查表粗筛，一次检查 16（SSSE3/NEON）或
+//     32（AVX2）个位置，只把粗筛通过的位置交给位图复核；
+//   - 字节对太多时粗筛几乎全过，直接逐位置查位图。
+// 只有 SSE2 的 CPU 没有字节查表指令，走位图的标量路径。
+class KeywordPrefilter {
+ public:
+    static constexpr std::size_t kMaxSimdEntries = 64;
+
+    KeywordPrefilter() = default;
+
+    explicit KeywordPrefilter(const std::vector<std::string_view>& keywords,
+                              SimdLevel level = ActiveSimdLevel()) {
+        Build(keywords, level);
+    }
+
+    // 空关键词在根状态本身命中，与跳过无关，忽略
+    void Build(const std::vector<std::string_view>& keywords, SimdLevel level = ActiveSimdLevel()) {
+        pairs_.fill(0);
+        singles_.fill(0);
+        lo1_.fill(0);
+        hi1_.fill(0);
+        lo2_.fill(0);
+        hi2_.fill(0);
+
+        // 粗筛条目：(首字节, 次字节)，次字节为 -1 表示任意（单字节关键词）
+        std::vector<std::pair<int, int>> entries;
+        for (std::string_view k : keywords) {
+            if (k.empty()) continue;
+            const unsigned char b1 = static_cast<unsigned char>(k[0]);
+            if (k.size() == 1) {
+                SetBit(singles_.data(), b1);
+                for (unsigned b2 = 0; b2 < 256; ++b2) SetBit(pairs_.data(), b1 << 8 | b2);
+                entries.emplace_back(b1, -1);
+            } else {
+                const unsigned char b2 = static_cast<unsigned char>(k[1]);
+                SetBit(pairs_.data(), static_cast<unsigned>(b1) << 8 | b2);
+                entries.emplace_back(b1, b2);
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+        entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+        num_entries_ = static_cast<uint32_t>(entries.size());
+        level_ = num_entries_ <= kMaxSimdEntries ? level : SimdLevel::kScalar;
+        // 按首字节排序后连续分入 8 个桶：同一首字节落在同一桶，减少半字节交叉带来的误报
+        for (std::size_t e = 0; e < entries.size(); ++e) {
+            const uint8_t bucket = static_cast<uint8_t>(1u << (e * 8 / entries.size()));
+            const int b1 = entries[e].first;
+            const int b2 = entries[e].second;
+            lo1_[b1 & 15] |= bucket;
+            hi1_[b1 >> 4] |= bucket;
+            for (int n = 0; n < 16; ++n) {
+                if (b2 < 0 || (b2 & 15) == n) lo2_[n] |= bucket;
+                if (b2 < 0 || (b2 >> 4) == n) hi2_[n] |= bucket;
+            }
+        }
+    }
+
+    SimdLevel level() const { return level_; }
+
+    // 返回 [i, len) 中第一个可能开始匹配的位置，没有则返回 len
+    std::size_t Next(const unsigned char* p, std::size_t i, std::size_t len) const {
+        // 误报回到根后常常紧接着又是候选：先查当前位置，免去一次向量化开销
+        if (i + 1 < len && PairHit(p[i], p[i + 1])) return i;
+        switch (level_) {
+#if defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH)
+            case SimdLevel::kAvx2:
+                if (NextAvx2(p, i, len)) return i;
+                if (NextSsse3(p, i, len)) return i;  // 不足 33 字节的尾部
+                break;
+            case SimdLevel::kSsse3:
+                if (NextSsse3(p, i, len)) return i;
+                break;
+#endif
+#if defined(ACCOUNT_BOOK_HAVE_NEON)
+            case SimdLevel::kNeon:
+                if (NextNeon(p, i, len)) return i;
+                break;
+#endif
+            default:
+                break;
+        }
+        return NextScalar(p, i, len);
+    }
+
+ private:
+    friend class RecognizerSnapshotCodec;
+
+    static void SetBit(uint64_t* bits, unsigned index) { bits[index >> 6] |= uint64_t{1} << (index & 63); }
+
+    static bool TestBit(const uint64_t* bits, unsigned index) {
+        return ((bits[index >> 6] >> (index & 63)) & 1) != 0;
+    }
+
+    bool PairHit(unsigned char a, unsigned char b) const {
+        return TestBit(pairs_.data(), static_cast<unsigned>(a) << 8 | b);
+    }
+
+    std::size_t NextScalar(const unsigned char* p, std::size_t i, std::size_t len) const {
+        for (; i + 1 < len; ++i) {
+            if (PairHit(p[i], p[i + 1])) return i;
+        }
+        if (i < len && TestBit(singles_.data(), p[i])) return i;  // 最后一个字节只能开始单字节关键词
+        return len;
+    }
+
+    // 粗筛通过的位置逐个用位图复核；找到时把 i 设为该位置
+    bool Verify(const unsigned char* p, std::size_t& i, uint64_t mask) const {
+        while (mask != 0) {
+            const std::size_t at = i + CountTrailingZeros(mask);
+            if (PairHit(p[at], p[at + 1])) {
+                i = at;
+                return true;
+            }
+            mask &= mask - 1;
+        }
+        return false;
+    }
+
+#if defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH)
+    // 每轮读 p[i..i+16]，即需要 17 字节；返回 false 时 i 停在尾部起点
+    ACCOUNT_BOOK_TARGET("ssse3")
+    bool NextSsse3(const unsigned char* p, std::size_t& i, std::size_t len) const {
+        const __m128i lo1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo1_.data()));
+        const __m128i hi1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi1_.data()));
+        const __m128i lo2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo2_.data()));
+        const __m128i hi2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi2_.data()));
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 17 <= len; i += 16) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 1));
+            __m128i m = _mm_and_si128(_mm_shuffle_epi8(lo1, _mm_and_si128(a, nibble)),
+                                      _mm_shuffle_epi8(hi1, _mm_and_si128(_mm_srli_epi16(a, 4), nibble)));
+            m = _mm_and_si128(m, _mm_shuffle_epi8(lo2, _mm_and_si128(b, nibble)));
+            m = _mm_and_si128(m, _mm_shuffle_epi8(hi2, _mm_and_si128(_mm_srli_epi16(b, 4), nibble)));
+            const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero))) & 0xFFFFu;
+            if (mask != 0 && Verify(p, i, mask)) return true;
+        }
+        return false;
+    }
+
+    ACCOUNT_BOOK_TARGET("avx2")
+    bool NextAvx2(const unsigned char* p, std::size_t& i, std::size_t len) const {
+        const __m256i lo1 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo1_.data())));
+        const __m256i hi1 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hi1_.data())));
+        const __m256i lo2 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo2_.data())));
+        const __m256i hi2 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hi2_.data())));
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 33 <= len; i += 32) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 1));
+            __m256i m = _mm256_and_si256(_mm256_shuffle_epi8(lo1, _mm256_and_si256(a, nibble)),
+                                         _mm256_shuffle_epi8(hi1, _mm256_and_si256(_mm256_srli_epi16(a, 4), nibble)));
+            m = _mm256_and_si256(m, _mm256_shuffle_epi8(lo2, _mm256_and_si256(b, nibble)));
+            m = _mm256_and_si256(m, _mm256_shuffle_epi8(hi2, _mm256_and_si256(_mm256_srli_epi16(b, 4), nibble)));
+            const uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(m, zero)));
+            if (mask != 0 && Verify(p, i, mask)) return true;
+        }
+        return false;
+    }
+#endif
+
+#if defined(ACCOUNT_BOOK_HAVE_NEON)
+    bool NextNeon(const unsigned char* p, std::size_t& i, std::size_t len) const {
+        const uint8x16_t lo1 = vld1q_u8(lo1_.data());
+        const uint8x16_t hi1 = vld1q_u8(hi1_.data());
+        const uint8x16_t lo2 = vld1q_u8(lo2_.data());
+        const uint8x16_t hi2 = vld1q_u8(hi2_.data());
+        const uint8x16_t nibble = vdupq_n_u8(0x0F);
+        for (; i + 17 <= len; i += 16) {
+            const uint8x16_t a = vld1q_u8(p + i);
+            const uint8x16_t b = vld1q_u8(p + i + 1);
+            uint8x16_t m = vandq_u8(vqtbl1q_u8(lo1, vandq_u8(a, nibble)), vqtbl1q_u8(hi1, vshrq_n_u8(a, 4)));
+            m = vandq_u8(m, vqtbl1q_u8(lo2, vandq_u8(b, nibble)));
+            m = vandq_u8(m, vqtbl1q_u8(hi2, vshrq_n_u8(b, 4)));
+            // 每个通过的字节压成 4 位：得到 64 位掩码，位置 = 位号 / 4
+            const uint8x16_t hit = vtstq_u8(m, m);
+            uint64_t nibbles =
+                vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+            while (nibbles != 0) {
+                const std::size_t at = i + CountTrailingZeros(nibbles) / 4;
+                if (PairHit(p[at], p[at + 1])) {
+                    i = at;
+                    return true;
+                }
+                nibbles &= ~(uint64_t{0xF} << ((at - i) * 4));
+            }
+        }
+        return false;
+    }
+#endif
+
+    SimdLevel level_ = SimdLevel::kScalar;
+    uint32_t num_entries_ = 0;            // 去重后的粗筛条目数
+    std::array<uint64_t, 1024> pairs_{};  // (首字节 << 8 | 次字节) 的位图
+    std::array<uint64_t, 4> singles_{};   // 单字节关键词
+    // Teddy 粗筛表：首 / 次字节的低、高半字节 → 8 个桶的位掩码
+    std::array<uint8_t, 16> lo1_{};
+    std::array<uint8_t, 16> hi1_{};
+    std::array<uint8_t, 16> lo2_{};
+    std::array<uint8_t, 16> hi2_{};
+};
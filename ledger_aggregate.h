@@ -0,0 +1,465 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "amount_utils.h"
+#include "date_utils.h"
+#include "simd_support.h"
+#include "transaction_batch.h"
+
+// ===================== 报表：按分类 / 日期分组聚合 =====================
+// 直接扫描 TransactionBatch 的分类、日期与金额列，不物化任何行对象，
+// “每月各分类支出”之类的报表是一次流式扫描，不必再与另一份金额数组做连接。
+//
+// 做法：先一遍向量化扫描求出 id 与日期的取值范围；范围不大时把 (分类, 日期桶)
+// 映射到稠密下标，向量化地逐块算出每行的下标（日期区间外的行落入丢弃格），
+// 再按下标累加计数、金额和与最值（小表用 4 份交错的累加器，避免相邻行落在
+// 同一格时的写后读依赖）。id 或日期跨度过大时退化为哈希表，结果相同。
+// 金额为 kInvalidAmount 的行计入 count，但不参与 sum/min/max。
+enum class DateGrain {
+    kNone,   // 只按分类
+    kDay,    // 分类 × 日
+    kMonth,  // 分类 × 月
+};
+
+// 打包日期的闭区间 [from, to]；默认不限，包括日期无效的行
+struct DateRange {
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+
+    static DateRange Between(PackedDate first, PackedDate last) { return {first.value(), last.value()}; }
+    bool Contains(uint32_t date) const { return from <= date && date <= to; }
+};
+
+struct GroupTotal {
+    int category_id;
+    PackedDate bucket;  // kDay：当天；kMonth：当月 1 日；kNone 或日期无效的行：无效日期
+    uint64_t count;
+    int64_t sum;
+    int64_t min;  // 组内没有有效金额时 min、max 为 0
+    int64_t max;
+};
+
+// 不分组的区间汇总；count 只计有效金额
+struct AmountSummary {
+    uint64_t count = 0;
+    int64_t sum = 0;
+    int64_t min = 0;
+    int64_t max = 0;
+};
+
+namespace ledger_aggregate_detail {
+
+constexpr std::size_t kMaxDenseSlots = std::size_t{1} << 20;
+constexpr std::size_t kInterleaveSlots = 1024;  // 不超过该格数时使用 4 份累加器
+constexpr std::size_t kBlockRows = 2048;
+
+// 有效日期的最小值按 (date - 1) 的无符号最小值求得：无效日期 0 回绕成最大值，不参与
+struct ColumnRanges {
+    int32_t id_min = INT32_MAX;
+    int32_t id_max = INT32_MIN;
+    uint32_t date_min_minus1 = UINT32_MAX;
+    uint32_t date_max = 0;
+};
+
+inline void ScanRangesScalar(const int32_t* ids, const uint32_t* dates, std::size_t begin,
+                             std::size_t n, ColumnRanges& r) {
+    for (std::size_t i = begin; i < n; ++i) {
+        r.id_min = std::min(r.id_min, ids[i]);
+        r.id_max = std::max(r.id_max, ids[i]);
+        r.date_min_minus1 = std::min(r.date_min_minus1, dates[i] - 1u);
+        r.date_max = std::max(r.date_max, dates[i]);
+    }
+}
+
+// 每行的稠密下标：(id - id_min) * buckets + 日期桶；日期桶 0 留给无效日期。
+// date_mask 为 0 时（kNone）日期桶恒为 0；区间外的行记为 discard。
+struct SlotParams {
+    int32_t id_min;
+    uint32_t key_min;
+    uint32_t shift;
+    uint32_t buckets;
+    uint32_t date_mask;
+    uint32_t discard;
+    DateRange range;
+};
+
+inline void ComputeSlotsScalar(const int32_t* ids, const uint32_t* dates, std::size_t begin,
+                               std::size_t n, const SlotParams& s, uint32_t* slots) {
+    for (std::size_t i = begin; i < n; ++i) {
+        const uint32_t d = dates[i];
+        const uint32_t bucket = d == 0 ? 0 : ((d >> s.shift) - s.key_min + 1) & s.date_mask;
+        slots[i] = s.range.Contains(d) ? static_cast<uint32_t>(ids[i] - s.id_min) * s.buckets + bucket
+                                       : s.discard;
+    }
+}
+
+inline void SummarizeScalar(const uint32_t* dates, const int64_t* amounts, std::size_t begin,
+                            std::size_t n, DateRange range, AmountSummary& r) {
+    for (std::size_t i = begin; i < n; ++i) {
+        const int64_t v = amounts[i];
+        if (v == kInvalidAmount || !range.Contains(dates[i])) continue;
+        ++r.count;
+        r.sum += v;
+        r.min = std::min(r.min, v);
+        r.max = std::max(r.max, v);
+    }
+}
+
+#if defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH)
+ACCOUNT_BOOK_TARGET("avx2")
+inline void ScanRangesAvx2(const int32_t* ids, const uint32_t* dates, std::size_t n, ColumnRanges& r) {
+    __m256i id_min = _mm256_set1_epi32(INT32_MAX);
+    __m256i id_max = _mm256_set1_epi32(INT32_MIN);
+    __m256i d_min = _mm256_set1_epi32(-1);
+    __m256i d_max = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i id = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i));
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dates + i));
+        id_min = _mm256_min_epi32(id_min, id);
+        id_max = _mm256_max_epi32(id_max, id);
+        d_min = _mm256_min_epu32(d_min, _mm256_sub_epi32(d, one));
+        d_max = _mm256_max_epu32(d_max, d);
+    }
+    alignas(32) int32_t lanes[4][8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[0]), id_min);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[1]), id_max);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[2]), d_min);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[3]), d_max);
+    for (int k = 0; k < 8; ++k) {
+        r.id_min = std::min(r.id_min, lanes[0][k]);
+        r.id_max = std::max(r.id_max, lanes[1][k]);
+        r.date_min_minus1 = std::min(r.date_min_minus1, static_cast<uint32_t>(lanes[2][k]));
+        r.date_max = std::max(r.date_max, static_cast<uint32_t>(lanes[3][k]));
+    }
+    ScanRangesScalar(ids, dates, i, n, r);
+}
+
+ACCOUNT_BOOK_TARGET("avx2")
+inline void ComputeSlotsAvx2(const int32_t* ids, const uint32_t* dates, std::size_t n,
+                             const SlotParams& s, uint32_t* slots) {
+    const __m256i id_min = _mm256_set1_epi32(s.id_min);
+    const __m256i bias = _mm256_set1_epi32(static_cast<int32_t>(1u - s.key_min));
+    const __m256i buckets = _mm256_set1_epi32(static_cast<int32_t>(s.buckets));
+    const __m256i mask = _mm256_set1_epi32(static_cast<int32_t>(s.date_mask));
+    const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(s.shift));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i from = _mm256_set1_epi32(static_cast<int32_t>(s.range.from));
+    const __m256i to = _mm256_set1_epi32(static_cast<int32_t>(s.range.to));
+    const __m256i discard = _mm256_set1_epi32(static_cast<int32_t>(s.discard));
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i id = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i));
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dates + i));
+        __m256i bucket = _mm256_and_si256(_mm256_add_epi32(_mm256_srl_epi32(d, shift), bias), mask);
+        bucket = _mm256_andnot_si256(_mm256_cmpeq_epi32(d, zero), bucket);
+        const __m256i slot =
+            _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(id, id_min), buckets), bucket);
+        const __m256i in_range = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_max_epu32(d, from), d),
+                                                  _mm256_cmpeq_epi32(_mm256_min_epu32(d, to), d));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(slots + i), _mm256_blendv_epi8(discard, slot, in_range));
+    }
+    ComputeSlotsScalar(ids, dates, i, n, s, slots);
+}
+
+// 每次 4 行：日期区间掩码扩展到 64 位后与“金额有效”相与，再做带掩码的和与最值
+ACCOUNT_BOOK_TARGET("avx2")
+inline void SummarizeAvx2(const uint32_t* dates, const int64_t* amounts, std::size_t n, DateRange range,
+                          AmountSummary& r) {
+    const __m128i from = _mm_set1_epi32(static_cast<int32_t>(range.from));
+    const __m128i to = _mm_set1_epi32(static_cast<int32_t>(range.to));
+    const __m256i invalid = _mm256_set1_epi64x(kInvalidAmount);
+    const __m256i max_fill = _mm256_set1_epi64x(INT64_MAX);
+    __m256i count = _mm256_setzero_si256();
+    __m256i sum = _mm256_setzero_si256();
+    __m256i lo = max_fill;
+    __m256i hi = invalid;  // kInvalidAmount 即 INT64_MIN，本身就是最大值的单位元
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dates + i));
+        const __m128i in_range = _mm_and_si128(_mm_cmpeq_epi32(_mm_max_epu32(d, from), d),
+                                               _mm_cmpeq_epi32(_mm_min_epu32(d, to), d));
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(amounts + i));
+        const __m256i keep = _mm256_andnot_si256(_mm256_cmpeq_epi64(v, invalid), _mm256_cvtepi32_epi64(in_range));
+        count = _mm256_sub_epi64(count, keep);
+        sum = _mm256_add_epi64(sum, _mm256_and_si256(v, keep));
+        const __m256i for_min = _mm256_blendv_epi8(max_fill, v, keep);
+        lo = _mm256_blendv_epi8(lo, for_min, _mm256_cmpgt_epi64(lo, for_min));
+        const __m256i for_max = _mm256_blendv_epi8(invalid, v, keep);
+        hi = _mm256_blendv_epi8(hi, for_max, _mm256_cmpgt_epi64(for_max, hi));
+    }
+    alignas(32) int64_t lanes[4][4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[0]), count);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[1]), sum);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[2]), lo);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[3]), hi);
+    for (int k = 0; k < 4; ++k) {
+        r.count += static_cast<uint64_t>(lanes[0][k]);
+        r.sum += lanes[1][k];
+        r.min = std::min(r.min, lanes[2][k]);
+        r.max = std::max(r.max, lanes[3][k]);
+    }
+    SummarizeScalar(dates, amounts, i, n, range, r);
+}
+#endif
+
+#if defined(ACCOUNT_BOOK_HAVE_NEON)
+inline void ScanRangesNeon(const int32_t* ids, const uint32_t* dates, std::size_t n, ColumnRanges& r) {
+    int32x4_t id_min = vdupq_n_s32(INT32_MAX);
+    int32x4_t id_max = vdupq_n_s32(INT32_MIN);
+    uint32x4_t d_min = vdupq_n_u32(UINT32_MAX);
+    uint32x4_t d_max = vdupq_n_u32(0);
+    const uint32x4_t one = vdupq_n_u32(1);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const int32x4_t id = vld1q_s32(ids + i);
+        const uint32x4_t d = vld1q_u32(dates + i);
+        id_min = vminq_s32(id_min, id);
+        id_max = vmaxq_s32(id_max, id);
+        d_min = vminq_u32(d_min, vsubq_u32(d, one));
+        d_max = vmaxq_u32(d_max, d);
+    }
+    r.id_min = std::min(r.id_min, vminvq_s32(id_min));
+    r.id_max = std::max(r.id_max, vmaxvq_s32(id_max));
+    r.date_min_minus1 = std::min(r.date_min_minus1, vminvq_u32(d_min));
+    r.date_max = std::max(r.date_max, vmaxvq_u32(d_max));
+    ScanRangesScalar(ids, dates, i, n, r);
+}
+
+inline void ComputeSlotsNeon(const int32_t* ids, const uint32_t* dates, std::size_t n,
+                             const SlotParams& s, uint32_t* slots) {
+    const uint32x4_t id_min = vdupq_n_u32(static_cast<uint32_t>(s.id_min));
+    const uint32x4_t bias = vdupq_n_u32(1u - s.key_min);
+    const uint32x4_t buckets = vdupq_n_u32(s.buckets);
+    const uint32x4_t mask = vdupq_n_u32(s.date_mask);
+    const int32x4_t shift = vdupq_n_s32(-static_cast<int32_t>(s.shift));
+    const uint32x4_t from = vdupq_n_u32(s.range.from);
+    const uint32x4_t to = vdupq_n_u32(s.range.to);
+    const uint32x4_t discard = vdupq_n_u32(s.discard);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const uint32x4_t id = vreinterpretq_u32_s32(vld1q_s32(ids + i));
+        const uint32x4_t d = vld1q_u32(dates + i);
+        uint32x4_t bucket = vandq_u32(vaddq_u32(vshlq_u32(d, shift), bias), mask);
+        bucket = vbicq_u32(bucket, vceqq_u32(d, vdupq_n_u32(0)));
+        const uint32x4_t slot = vmlaq_u32(bucket, vsubq_u32(id, id_min), buckets);
+        const uint32x4_t in_range = vandq_u32(vcgeq_u32(d, from), vcleq_u32(d, to));
+        vst1q_u32(slots + i, vbslq_u32(in_range, slot, discard));
+    }
+    ComputeSlotsScalar(ids, dates, i, n, s, slots);
+}
+
+inline void SummarizeNeon(const uint32_t* dates, const int64_t* amounts, std::size_t n, DateRange range,
+                          AmountSummary& r) {
+    const uint32x2_t from = vdup_n_u32(range.from);
+    const uint32x2_t to = vdup_n_u32(range.to);
+    const int64x2_t invalid = vdupq_n_s64(kInvalidAmount);
+    const int64x2_t max_fill = vdupq_n_s64(INT64_MAX);
+    uint64x2_t count = vdupq_n_u64(0);
+    int64x2_t sum = vdupq_n_s64(0);
+    int64x2_t lo = max_fill;
+    int64x2_t hi = invalid;
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const uint32x2_t d = vld1_u32(dates + i);
+        const uint64x2_t in_range = vmovl_u32(vand_u32(vcge_u32(d, from), vcle_u32(d, to)));
+        const uint64x2_t wide = vorrq_u64(in_range, vshlq_n_u64(in_range, 32));  // 0xFFFFFFFF → 全 1
+        const int64x2_t v = vld1q_s64(amounts + i);
+        const uint64x2_t keep = vbicq_u64(wide, vceqq_s64(v, invalid));
+        count = vsubq_u64(count, keep);
+        sum = vaddq_s64(sum, vandq_s64(v, vreinterpretq_s64_u64(keep)));
+        const int64x2_t for_min = vbslq_s64(keep, v, max_fill);
+        lo = vbslq_s64(vcgtq_s64(lo, for_min), for_min, lo);
+        const int64x2_t for_max = vbslq_s64(keep, v, invalid);
+        hi = vbslq_s64(vcgtq_s64(for_max, hi), for_max, hi);
+    }
+    r.count += vgetq_lane_u64(count, 0) + vgetq_lane_u64(count, 1);
+    r.sum += vgetq_lane_s64(sum, 0) + vgetq_lane_s64(sum, 1);
+    r.min = std::min({r.min, vgetq_lane_s64(lo, 0), vgetq_lane_s64(lo, 1)});
+    r.max = std::max({r.max, vgetq_lane_s64(hi, 0), vgetq_lane_s64(hi, 1)});
+    SummarizeScalar(dates, amounts, i, n, range, r);
+}
+#endif
+
+inline ColumnRanges ScanRanges(const int32_t* ids, const uint32_t* dates, std::size_t n, SimdLevel level) {
+    ColumnRanges r;
+#if defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH)
+    if (level == SimdLevel::kAvx2) {
+        ScanRangesAvx2(ids, dates, n, r);
+        return r;
+    }
+#elif defined(ACCOUNT_BOOK_HAVE_NEON)
+    if (level == SimdLevel::kNeon) {
+        ScanRangesNeon(ids, dates, n, r);
+        return r;
+    }
+#endif
+    (void)level;
+    ScanRangesScalar(ids, dates, 0, n, r);
+    return r;
+}
+
+inline void ComputeSlots(const int32_t* ids, const uint32_t* dates, std::size_t n, const SlotParams& s,
+                         uint32_t* slots, SimdLevel level) {
+#if defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH)
+    if (level == SimdLevel::kAvx2) return ComputeSlotsAvx2(ids, dates, n, s, slots);
+#elif defined(ACCOUNT_BOOK_HAVE_NEON)
+    if (level == SimdLevel::kNeon) return ComputeSlotsNeon(ids, dates, n, s, slots);
+#endif
+    (void)level;
+    ComputeSlotsScalar(ids, dates, 0, n, s, slots);
+}
+
+inline void Summarize(const uint32_t* dates, const int64_t* amounts, std::size_t n, DateRange range,
+                      AmountSummary& r, SimdLevel level) {
+#if defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH)
+    if (level == SimdLevel::kAvx2) return SummarizeAvx2(dates, amounts, n, range, r);
+#elif defined(ACCOUNT_BOOK_HAVE_NEON)
+    if (level == SimdLevel::kNeon) return SummarizeNeon(dates, amounts, n, range, r);
+#endif
+    (void)level;
+    SummarizeScalar(dates, amounts, 0, n, range, r);
+}
+
+inline PackedDate BucketDate(uint32_t key, DateGrain grain) {
+    switch (grain) {
+        case DateGrain::kDay: return PackedDate::FromValue(key);
+        case DateGrain::kMonth: return PackedDate::FromValue(key << 5 | 1);
+        case DateGrain::kNone: break;
+    }
+    return PackedDate();
+}
+
+inline uint32_t DateKey(uint32_t date, DateGrain grain) {
+    if (date == 0 || grain == DateGrain::kNone) return 0;
+    return grain == DateGrain::kMonth ? date >> 5 : date;
+}
+
+struct Acc {
+    uint64_t count = 0;
+    int64_t sum = 0;
+    int64_t min = INT64_MAX;
+    int64_t max = INT64_MIN;
+
+    void Add(const int64_t* values, std::size_t i) {
+        ++count;
+        if (values == nullptr || values[i] == kInvalidAmount) return;
+        sum += values[i];
+        min = std::min(min, values[i]);
+        max = std::max(max, values[i]);
+    }
+
+    void Merge(const Acc& o) {
+        count += o.count;
+        sum += o.sum;
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+    }
+
+    GroupTotal ToTotal(int category_id, PackedDate bucket) const {
+        const bool any = min <= max;
+        return {category_id, bucket, count, sum, any ? min : 0, any ? max : 0};
+    }
+};
+
+// id 或日期跨度过大时的退化路径
+inline std::vector<GroupTotal> GroupSparse(const int32_t* ids, const uint32_t* dates, const int64_t* values,
+                                           std::size_t n, DateGrain grain, DateRange range) {
+    std::unordered_map<uint64_t, Acc> groups;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!range.Contains(dates[i])) continue;
+        const uint64_t key = static_cast<uint64_t>(static_cast<uint32_t>(ids[i])) << 32 | DateKey(dates[i], grain);
+        groups[key].Add(values, i);
+    }
+    std::vector<GroupTotal> out;
+    out.reserve(groups.size());
+    for (const auto& kv : groups) {
+        const uint32_t date_key = static_cast<uint32_t>(kv.first);
+        out.push_back(kv.second.ToTotal(static_cast<int32_t>(static_cast<uint32_t>(kv.first >> 32)),
+                                        date_key == 0 ? PackedDate() : BucketDate(date_key, grain)));
+    }
+    std::sort(out.begin(), out.end(), [](const GroupTotal& a, const GroupTotal& b) {
+        return a.category_id != b.category_id ? a.category_id < b.category_id : a.bucket < b.bucket;
+    });
+    return out;
+}
+
+}  // namespace ledger_aggregate_detail
+
+// 按 (分类, 日期桶) 分组，统计 range 内的行数与 values 的和、最小、最大值
+// （values 可为 nullptr，此时只计数）。结果只含非空分组，按分类 id、日期桶升序；
+// 日期无效的行归入各分类的无效日期桶。
+inline std::vector<GroupTotal> GroupByCategory(const int32_t* ids, const uint32_t* dates,
+                                               const int64_t* values, std::size_t n, DateGrain grain,
+                                               DateRange range = DateRange(),
+                                               SimdLevel level = ActiveSimdLevel()) {
+    namespace d = ledger_aggregate_detail;
+    if (n == 0) return {};
+    const d::ColumnRanges r = d::ScanRanges(ids, dates, n, level);
+
+    d::SlotParams s{r.id_min, 0, 0, 1, 0, 0, range};
+    if (grain != DateGrain::kNone) {
+        s.shift = grain == DateGrain::kMonth ? 5 : 0;
+        s.date_mask = UINT32_MAX;
+        if (r.date_max != 0) {
+            s.key_min = (r.date_min_minus1 + 1) >> s.shift;
+            s.buckets = (r.date_max >> s.shift) - s.key_min + 2;
+        }
+    }
+    const uint64_t num_ids = static_cast<uint64_t>(static_cast<int64_t>(r.id_max) - r.id_min) + 1;
+    const uint64_t num_slots = num_ids * s.buckets;
+    if (num_slots > d::kMaxDenseSlots) return d::GroupSparse(ids, dates, values, n, grain, range);
+
+    const std::size_t slots_total = static_cast<std::size_t>(num_slots);
+    s.discard = static_cast<uint32_t>(slots_total);
+    const std::size_t copies = slots_total <= d::kInterleaveSlots ? 4 : 1;
+    std::vector<d::Acc> acc((slots_total + 1) * copies);
+    uint32_t slot_buf[d::kBlockRows];
+    for (std::size_t begin = 0; begin < n; begin += d::kBlockRows) {
+        const std::size_t m = std::min(d::kBlockRows, n - begin);
+        d::ComputeSlots(ids + begin, dates + begin, m, s, slot_buf, level);
+        const int64_t* block_values = values != nullptr ? values + begin : nullptr;
+        for (std::size_t i = 0; i < m; ++i) acc[slot_buf[i] * copies + (i & (copies - 1))].Add(block_values, i);
+    }
+
+    std::vector<GroupTotal> out;
+    for (std::size_t slot = 0; slot < slots_total; ++slot) {
+        d::Acc total;
+        for (std::size_t c = 0; c < copies; ++c) total.Merge(acc[slot * copies + c]);
+        if (total.count == 0) continue;
+        const uint32_t bucket = static_cast<uint32_t>(slot % s.buckets);
+        const int category_id = static_cast<int>(static_cast<int64_t>(r.id_min) + static_cast<int64_t>(slot / s.buckets));
+        out.push_back(total.ToTotal(category_id,
+                                    bucket == 0 ? PackedDate() : d::BucketDate(bucket - 1 + s.key_min, grain)));
+    }
+    return out;
+}
+
+// 例：每月各分类支出 GroupByCategory(batch, DateGrain::kMonth)；
+// 某段时间各分类支出 GroupByCategory(batch, DateGrain::kNone, DateRange::Between(a, b))
+inline std::vector<GroupTotal> GroupByCategory(const TransactionBatch& batch, DateGrain grain,
+                                               DateRange range = DateRange()) {
+    return GroupByCategory(batch.category_ids(), batch.packed_dates(), batch.amounts(), batch.size(), grain,
+                           range);
+}
+
+// range 内所有有效金额的笔数、总和与最值，一次向量化扫描
+inline AmountSummary SummarizeAmounts(const uint32_t* dates, const int64_t* amounts, std::size_t n,
+                                      DateRange range = DateRange(), SimdLevel level = ActiveSimdLevel()) {
+    AmountSummary r;
+    r.min = INT64_MAX;
+    r.max = INT64_MIN;
+    ledger_aggregate_detail::Summarize(dates, amounts, n, range, r, level);
+    if (r.count == 0) r.min = r.max = 0;
+    return r;
+}
+
+inline AmountSummary SummarizeAmounts(const TransactionBatch& batch, DateRange range = DateRange()) {
+    return SummarizeAmounts(batch.packed_dates(), batch.amounts(), batch.size(), range);
+}
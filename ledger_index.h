@@ -0,0 +1,155 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ledger_aggregate.h"
+#include "transaction_batch.h"
+
+// ===================== 报表：日期 / 分类二级索引 =====================
+// “2026-01 的所有餐饮行”这类查询原本要扫完整个 TransactionBatch。索引为每个
+// 打包日期保存一段行号（按日期排好序的日桶），为每个分类保存一份行号倒排
+// 表。单一条件的筛选只访问命中的行；分类 + 区间的组合从两者中较短的候选
+// 列表出发逐行过滤，耗时与候选行数而不是与总行数成正比。
+//
+// 索引只追加：每批结果追加到 batch 后调一次 CatchUp()，只为新行建索引。日期
+// 通常按时间顺序到达，新行几乎总是落在最后一个日桶；乱序的日期才做一次有序
+// 插入。行号为 uint32_t，batch 不超过 UINT32_MAX 行。
+class LedgerIndex {
+ public:
+    LedgerIndex() = default;
+
+    explicit LedgerIndex(const TransactionBatch& batch) { CatchUp(batch); }
+
+    std::size_t indexed_rows() const { return indexed_rows_; }
+    std::size_t num_days() const { return day_keys_.size(); }
+
+    // 为 [indexed_rows(), batch.size()) 建索引。换了一个 batch，或 batch 自上次以来被
+    // Clear()/Release()/赋值过时（generation 变了，即使行数不少于已建的行）整体重建
+    void CatchUp(const TransactionBatch& batch) {
+        if (batch.generation() != generation_ || batch.size() < indexed_rows_) Reset();
+        generation_ = batch.generation();
+        const uint32_t* dates = batch.packed_dates();
+        const int32_t* ids = batch.category_ids();
+        std::vector<uint32_t>* postings = nullptr;  // 相邻行常属同一分类，先看上一次命中的倒排表
+        int32_t postings_id = 0;
+        for (std::size_t row = indexed_rows_; row < batch.size(); ++row) {
+            const uint32_t r = static_cast<uint32_t>(row);
+            DayRows(dates[row]).push_back(r);
+            if (postings == nullptr || postings_id != ids[row]) {
+                postings = &categories_[ids[row]];  // unordered_map 的元素地址在 rehash 后不变
+                postings_id = ids[row];
+            }
+            postings->push_back(r);
+        }
+        indexed_rows_ = batch.size();
+    }
+
+    void Reset() {
+        day_keys_.clear();
+        day_rows_.clear();
+        categories_.clear();
+        last_day_ = 0;
+        indexed_rows_ = 0;
+    }
+
+    // range 内的行号，升序写入 rows（先清空）
+    void Select(DateRange range, std::vector<uint32_t>& rows) const {
+        rows.clear();
+        const auto [lo, hi] = DaySpan(range);
+        for (std::size_t d = lo; d < hi; ++d) rows.insert(rows.end(), day_rows_[d].begin(), day_rows_[d].end());
+        if (hi - lo > 1) std::sort(rows.begin(), rows.end());
+    }
+
+    // category_id 且在 range 内的行号，升序写入 rows（先清空）。从分类倒排表与
+    // 区间日桶中较短的一边出发，逐行用 batch 的另一列过滤；batch 须是建索引的那一批。
+    void Select(const TransactionBatch& batch, int category_id, DateRange range,
+                std::vector<uint32_t>& rows) const {
+        rows.clear();
+        const auto it = categories_.find(category_id);
+        if (it == categories_.end()) return;
+        const std::vector<uint32_t>& postings = it->second;
+        const uint32_t* dates = batch.packed_dates();
+        if (range.from == 0 && range.to == UINT32_MAX) {
+            rows = postings;
+            return;
+        }
+
+        const auto [lo, hi] = DaySpan(range);
+        std::size_t in_range = 0;
+        for (std::size_t d = lo; d < hi; ++d) in_range += day_rows_[d].size();
+        if (postings.size() <= in_range) {
+            std::copy_if(postings.begin(), postings.end(), std::back_inserter(rows),
+                         [&](uint32_t r) { return range.Contains(dates[r]); });
+            return;
+        }
+        const int32_t* ids = batch.category_ids();
+        for (std::size_t d = lo; d < hi; ++d) {
+            std::copy_if(day_rows_[d].begin(), day_rows_[d].end(), std::back_inserter(rows),
+                         [&](uint32_t r) { return ids[r] == category_id; });
+        }
+        if (hi - lo > 1) std::sort(rows.begin(), rows.end());
+    }
+
+    // 某分类的全部行号（升序）；没有该分类时为空
+    const std::vector<uint32_t>& CategoryPostings(int category_id) const {
+        static const std::vector<uint32_t> kEmpty;
+        const auto it = categories_.find(category_id);
+        return it == categories_.end() ? kEmpty : it->second;
+    }
+
+ private:
+    std::vector<uint32_t>& DayRows(uint32_t date) {
+        if (!day_keys_.empty() && day_keys_[last_day_] == date) return day_rows_[last_day_];
+        if (day_keys_.empty() || day_keys_.back() < date) {
+            day_keys_.push_back(date);
+            day_rows_.emplace_back();
+            last_day_ = day_keys_.size() - 1;
+            return day_rows_.back();
+        }
+        const auto pos = std::lower_bound(day_keys_.begin(), day_keys_.end(), date);
+        last_day_ = static_cast<std::size_t>(pos - day_keys_.begin());
+        if (pos == day_keys_.end() || *pos != date) {
+            day_keys_.insert(pos, date);
+            day_rows_.emplace(day_rows_.begin() + static_cast<std::ptrdiff_t>(last_day_));
+        }
+        return day_rows_[last_day_];
+    }
+
+    // range 覆盖的日桶下标区间 [first, second)
+    std::pair<std::size_t, std::size_t> DaySpan(DateRange range) const {
+        const auto lo = std::lower_bound(day_keys_.begin(), day_keys_.end(), range.from);
+        const auto hi = std::upper_bound(lo, day_keys_.end(), range.to);
+        return {static_cast<std::size_t>(lo - day_keys_.begin()), static_cast<std::size_t>(hi - day_keys_.begin())};
+    }
+
+    std::vector<uint32_t> day_keys_;               // 升序的打包日期
+    std::vector<std::vector<uint32_t>> day_rows_;  // 与 day_keys_ 一一对应，各段行号升序
+    std::unordered_map<int32_t, std::vector<uint32_t>> categories_;
+    std::size_t last_day_ = 0;
+    std::size_t indexed_rows_ = 0;
+    uint64_t generation_ = 0;  // 建索引时 batch 的 generation()
+};
+
+// 只汇总 rows 指定的行（通常来自 LedgerIndex::Select）；语义同 SummarizeAmounts(batch, range)
+inline AmountSummary SummarizeAmounts(const TransactionBatch& batch, const std::vector<uint32_t>& rows) {
+    AmountSummary r;
+    r.min = INT64_MAX;
+    r.max = INT64_MIN;
+    const int64_t* amounts = batch.amounts();
+    for (uint32_t row : rows) {
+        const int64_t v = amounts[row];
+        if (v == kInvalidAmount) continue;
+        ++r.count;
+        r.sum += v;
+        r.min = std::min(r.min, v);
+        r.max = std::max(r.max, v);
+    }
+    if (r.count == 0) r.min = r.max = 0;
+    return r;
+}
@@ -0,0 +1,416 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "category_recognizer.h"
+#include "category_registry.h"
+
+// ===================== 组件B：运行时可更新的分类识别 =====================
+// 分类在运行时增删改名时无需调用方重建识别器。每个版本由两部分组成：
+//
+// - 底版：最近一次合并时的完整分类表，编译成注册表 + 识别器，多个版本共享；
+// - 待合并的修改：被改动（含新增、删除）的分类只记 id 和当前版本，编译成一个
+//   只含这些分类的小自动机，作为 CategoryOverlay 叠加在底版识别器上。
+//
+// 一次 Add/Remove/Rename/SetKeywords 只拷贝、编译待合并的那部分，分类结果与
+// 整体重建完全一致（见 CategoryRecognizer 的叠加层说明）。待合并的分类超过
+// sqrt(2n)（至少 64 个）时并入底版整体重建一次：每次修改编译 O(sqrt n) 个分类，
+// 摊到每次修改上的重建也是 O(sqrt n)。Update() 需要完整的分类表，总是直接重建。
+//
+// 写者在锁内生成新版本，再以 RCU 方式原子替换快照指针：读者只做一次
+// std::atomic_load，不会等待写者编译，也不会看到半成品索引；仍持有旧快照的
+// 读者在用完后自动释放旧版本。注意这次 load 未必无锁——libstdc++ 用按地址
+// 分片的全局互斥锁保护 shared_ptr 的原子操作，临界区只有一次引用计数递增。
+namespace live_recognizer_detail {
+
+// 底版：完整分类表及为增量修改预先建好的索引
+struct Base {
+    Base(std::vector<Category> categories, MatchPolicy policy)
+        : registry(std::move(categories)), recognizer(registry.Compile(policy)) {
+        const std::vector<Category>& all = registry.categories();
+        for (std::size_t i = 0; i < all.size(); ++i) {
+            const Category& c = all[i];
+            const uint32_t index = static_cast<uint32_t>(i);
+            holders[c.name].push_back(index);
+            for (const auto& k : c.keywords) {
+                if (!k.empty()) holders[k].push_back(index);
+            }
+            if (registry.IndexOf(c.id) != i) duplicate_ids[c.id].push_back(index);
+            if (c.name == "其他") others.push_back(index);
+        }
+    }
+
+    CategoryRegistry registry;
+    CategoryRecognizer recognizer;
+    // 关键词（名字与非空别名）→ 含它的分类下标；视图指向 registry 中的分类
+    std::unordered_map<std::string_view, std::vector<uint32_t>> holders;
+    std::unordered_map<int, std::vector<uint32_t>> duplicate_ids;  // 重复的 id → 第一个之后的下标
+    std::vector<uint32_t> others;                                  // 名为“其他”的下标，升序
+};
+
+// 底版之后的修改。dirty_ids 中的 id 在底版里的条目全部作废，仍存在的以 entries
+// 里的当前版本为准
+struct Delta {
+    struct Entry {
+        uint64_t order;  // 在当前分类表中的次序：底版下标，新增的排在底版之后
+        Category category;
+    };
+
+    bool Dirty(int id) const { return std::binary_search(dirty_ids.begin(), dirty_ids.end(), id); }
+
+    std::vector<Entry> entries;  // 按 order 升序
+    std::vector<int> dirty_ids;  // 升序
+    std::vector<std::pair<int, uint32_t>> by_id;  // (id, entries 下标)，按 id、次序升序
+    uint64_t next_order = 0;
+    std::size_t size = 0;  // 当前分类总数
+    std::shared_ptr<const CategoryOverlay> overlay;
+};
+
+// 基于上一版的修改生成下一版；不提交时直接丢弃即可
+class DeltaEditor {
+ public:
+    DeltaEditor(const Base& base, const Delta* previous) : base_(base) {
+        if (previous != nullptr) {
+            delta_ = *previous;
+        } else {
+            delta_.next_order = base.registry.size();
+        }
+    }
+
+    // id 在当前分类表中的第一个分类，可原地修改；不存在时为 nullptr。
+    // 调用后 id 即视为已修改
+    Category* Touch(int id) {
+        MarkDirty(id);
+        for (auto& e : delta_.entries) {
+            if (e.category.id == id) return &e.category;
+        }
+        return nullptr;
+    }
+
+    void Add(Category category) {
+        MarkDirty(category.id);
+        PullSharers(category);
+        delta_.entries.push_back({delta_.next_order++, std::move(category)});
+    }
+
+    // 删除 id 的第一个分类；须先 Touch(id) 确认存在
+    void Erase(int id) {
+        for (auto it = delta_.entries.begin(); it != delta_.entries.end(); ++it) {
+            if (it->category.id == id) {
+                delta_.entries.erase(it);
+                return;
+            }
+        }
+    }
+
+    // 原地改过名字或别名后调用：与新关键词相同的底版分类也要列入修改
+    void Claim(const Category& category) { PullSharers(category); }
+
+    std::size_t pending() const { return delta_.entries.size(); }
+    const Delta& delta() const { return delta_; }
+
+    // 编译叠加层并解析回退分类
+    std::shared_ptr<const Delta> Finish(MatchPolicy policy) {
+        Delta& d = delta_;
+        const std::vector<Category>& all = base_.registry.categories();
+        std::vector<Category> changed;
+        changed.reserve(d.entries.size());
+        d.by_id.clear();
+        for (std::size_t i = 0; i < d.entries.size(); ++i) {
+            changed.push_back(d.entries[i].category);
+            d.by_id.emplace_back(d.entries[i].category.id, static_cast<uint32_t>(i));
+        }
+        std::sort(d.by_id.begin(), d.by_id.end());
+
+        std::size_t stale = 0;  // 底版中作废的条目
+        for (int id : d.dirty_ids) stale += BasePositions(id).size();
+        d.size = all.size() - stale + d.entries.size();
+
+        auto overlay = std::make_shared<CategoryOverlay>(
+            CategoryOverlay{d.dirty_ids, CategoryRecognizer(changed, policy), 0, MetricCounter::kNoCategories});
+        ResolveFallback(*overlay);
+        d.overlay = std::move(overlay);
+        return std::make_shared<const Delta>(std::move(d));
+    }
+
+ private:
+    // id 在底版中的全部下标（升序）
+    std::vector<uint32_t> BasePositions(int id) const {
+        std::vector<uint32_t> positions;
+        const std::size_t first = base_.registry.IndexOf(id);
+        if (first == CategoryRegistry::npos) return positions;
+        positions.push_back(static_cast<uint32_t>(first));
+        const auto dup = base_.duplicate_ids.find(id);
+        if (dup != base_.duplicate_ids.end()) positions.insert(positions.end(), dup->second.begin(), dup->second.end());
+        return positions;
+    }
+
+    // 标记 id 已修改：底版条目移入 entries，并传递给与它们共用关键词的分类
+    void MarkDirty(int id) {
+        std::vector<int> pending{id};
+        while (!pending.empty()) {
+            const int next = pending.back();
+            pending.pop_back();
+            auto& dirty = delta_.dirty_ids;
+            const auto pos = std::lower_bound(dirty.begin(), dirty.end(), next);
+            if (pos != dirty.end() && *pos == next) continue;
+            dirty.insert(pos, next);
+            for (uint32_t index : BasePositions(next)) {
+                const Category& c = base_.registry.categories()[index];
+                auto& entries = delta_.entries;
+                const auto at = std::lower_bound(entries.begin(), entries.end(), uint64_t{index},
+                                                 [](const Delta::Entry& e, uint64_t order) { return e.order < order; });
+                entries.insert(at, {index, c});
+                ForEachSharer(c, [&](int sharer) { pending.push_back(sharer); });
+            }
+        }
+    }
+
+    void PullSharers(const Category& category) {
+        std::vector<int> sharers;
+        ForEachSharer(category, [&](int id) { sharers.push_back(id); });
+        for (int id : sharers) MarkDirty(id);
+    }
+
+    // 底版中与 category 共用某个关键词、尚未标记的分类 id
+    template <typename Fn>
+    void ForEachSharer(const Category& category, Fn&& fn) const {
+        auto visit = [&](std::string_view keyword) {
+            const auto it = base_.holders.find(keyword);
+            if (it == base_.holders.end()) return;
+            for (uint32_t index : it->second) {
+                const int id = base_.registry.categories()[index].id;
+                if (!delta_.Dirty(id)) fn(id);
+            }
+        };
+        visit(category.name);
+        for (const auto& k : category.keywords) {
+            if (!k.empty()) visit(k);
+        }
+    }
+
+    // “其他” → 第一个分类 → 0，按当前分类表的顺序；只看作废条目与 entries，不扫底版全表
+    void ResolveFallback(CategoryOverlay& overlay) const {
+        const std::vector<Category>& all = base_.registry.categories();
+        const Delta& d = delta_;
+        const Category* other = nullptr;
+        uint64_t other_order = UINT64_MAX;
+        for (uint32_t index : base_.others) {
+            if (!d.Dirty(all[index].id)) {
+                other = &all[index];
+                other_order = index;
+                break;
+            }
+        }
+        for (const auto& e : d.entries) {
+            if (e.order >= other_order) break;
+            if (e.category.name == "其他") {
+                other = &e.category;
+                break;
+            }
+        }
+        if (other != nullptr) {
+            overlay.fallback_id = other->id;
+            overlay.fallback_metric = MetricCounter::kFallbackOther;
+            return;
+        }
+
+        std::size_t first = 0;
+        while (first < all.size() && d.Dirty(all[first].id)) ++first;
+        const Category* head = first < all.size() ? &all[first] : nullptr;
+        if (!d.entries.empty() && (head == nullptr || d.entries.front().order < first)) {
+            head = &d.entries.front().category;
+        }
+        if (head != nullptr) {
+            overlay.fallback_id = head->id;
+            overlay.fallback_metric = MetricCounter::kFallbackFirst;
+        }
+    }
+
+    const Base& base_;
+    Delta delta_;
+};
+
+// 按当前顺序拼出完整分类表，O(分类数)
+inline std::vector<Category> Materialize(const Base& base, const Delta* delta) {
+    const std::vector<Category>& all = base.registry.categories();
+    if (delta == nullptr) return all;
+    std::vector<Category> out;
+    out.reserve(all.size() + delta->entries.size());
+    auto e = delta->entries.begin();
+    const auto end = delta->entries.end();
+    for (std::size_t i = 0; i < all.size(); ++i) {
+        for (; e != end && e->order <= i; ++e) out.push_back(e->category);
+        if (!delta->Dirty(all[i].id)) out.push_back(all[i]);
+    }
+    for (; e != end; ++e) out.push_back(e->category);
+    return out;
+}
+
+}  // namespace live_recognizer_detail
+
+// 一个不可变版本，发布后从不修改。recognizer 已叠加待合并的修改，可直接用于分类；
+// 报表按 id 取名字用 snapshot->Name(id)。
+struct RecognizerSnapshot {
+    RecognizerSnapshot(uint64_t v, std::shared_ptr<const live_recognizer_detail::Base> base,
+                       std::shared_ptr<const live_recognizer_detail::Delta> delta)
+        : version(v),
+          recognizer(delta != nullptr ? CategoryRecognizer(base->recognizer, delta->overlay) : base->recognizer),
+          base_(std::move(base)),
+          delta_(std::move(delta)) {}
+
+    std::size_t size() const { return delta_ != nullptr ? delta_->size : base_->registry.size(); }
+
+    // 尚未并入底版的分类数；为 0 时 recognizer 就是整体编译的识别器
+    std::size_t pending_edits() const { return delta_ != nullptr ? delta_->entries.size() : 0; }
+
+    // id 的第一个分类；未知 id 返回 nullptr。指针在快照存活期间有效
+    const Category* Find(int id) const {
+        if (delta_ == nullptr || !delta_->Dirty(id)) return base_->registry.Find(id);
+        const auto& by_id = delta_->by_id;
+        const auto it = std::lower_bound(by_id.begin(), by_id.end(), std::make_pair(id, uint32_t{0}));
+        return it != by_id.end() && it->first == id ? &delta_->entries[it->second].category : nullptr;
+    }
+
+    // 未知 id 返回空串
+    std::string_view Name(int id) const {
+        const Category* c = Find(id);
+        return c == nullptr ? std::string_view() : std::string_view(c->name);
+    }
+
+    // 当前完整分类表（按顺序拼出一份拷贝，O(分类数)）
+    std::vector<Category> categories() const { return live_recognizer_detail::Materialize(*base_, delta_.get()); }
+
+    uint64_t version;
+    CategoryRecognizer recognizer;
+
+ private:
+    friend class LiveCategoryRecognizer;
+
+    std::shared_ptr<const live_recognizer_detail::Base> base_;
+    std::shared_ptr<const live_recognizer_detail::Delta> delta_;  // 无待合并修改时为空
+};
+
+class LiveCategoryRecognizer {
+ public:
+    explicit LiveCategoryRecognizer(std::vector<Category> categories = {},
+                                    MatchPolicy policy = MatchPolicy::kByteOrder)
+        : policy_(policy) {
+        Rebuild(std::move(categories));
+    }
+
+    // 取当前版本；批处理时每批取一次，之后直接用 snapshot->recognizer
+    std::shared_ptr<const RecognizerSnapshot> Snapshot() const {
+        return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+    }
+
+    uint64_t version() const { return Snapshot()->version; }
+
+    int RecognizeCategory(std::string_view note) const {
+        return Snapshot()->recognizer.RecognizeCategory(note);
+    }
+
+    // id 已存在时返回 false，不发布新版本
+    bool AddCategory(Category category) {
+        return Edit([&](live_recognizer_detail::DeltaEditor& editor) {
+            if (editor.Touch(category.id) != nullptr) return false;
+            editor.Add(std::move(category));
+            return true;
+        });
+    }
+
+    bool RemoveCategory(int id) {
+        return Edit([&](live_recognizer_detail::DeltaEditor& editor) {
+            if (editor.Touch(id) == nullptr) return false;
+            editor.Erase(id);
+            return true;
+        });
+    }
+
+    bool RenameCategory(int id, std::string new_name) {
+        return Edit([&](live_recognizer_detail::DeltaEditor& editor) {
+            Category* c = editor.Touch(id);
+            if (c == nullptr || c->name == new_name) return false;
+            c->name = std::move(new_name);
+            editor.Claim(*c);
+            return true;
+        });
+    }
+
+    // 替换某个分类的全部别名；与原别名相同时不发布
+    bool SetKeywords(int id, std::vector<std::string> keywords) {
+        return Edit([&](live_recognizer_detail::DeltaEditor& editor) {
+            Category* c = editor.Touch(id);
+            if (c == nullptr || c->keywords == keywords) return false;
+            c->keywords = std::move(keywords);
+            editor.Claim(*c);
+            return true;
+        });
+    }
+
+    // 批量修改：edit(std::vector<Category>&) 返回 true 时才整体编译并发布新版本
+    template <typename Edit>
+    bool Update(Edit&& edit) {
+        std::lock_guard<std::mutex> lock(write_mu_);
+        std::vector<Category> cats = Snapshot()->categories();
+        if (!edit(cats)) return false;
+        Rebuild(std::move(cats));
+        return true;
+    }
+
+    // 把待合并的修改并入底版（整体重建一次）；没有待合并修改时不发布新版本
+    bool Compact() {
+        std::lock_guard<std::mutex> lock(write_mu_);
+        const std::shared_ptr<const RecognizerSnapshot> current = Snapshot();
+        if (current->delta_ == nullptr) return false;
+        Rebuild(current->categories());
+        return true;
+    }
+
+ private:
+    static constexpr std::size_t kMinFoldEdits = 64;
+
+    static std::size_t FoldThreshold(std::size_t base_size) {
+        return std::max(kMinFoldEdits, static_cast<std::size_t>(std::sqrt(2.0 * static_cast<double>(base_size))));
+    }
+
+    // edit(DeltaEditor&) 返回 true 时发布；待合并的分类过多时顺带并入底版
+    template <typename EditFn>
+    bool Edit(EditFn&& edit) {
+        std::lock_guard<std::mutex> lock(write_mu_);
+        const std::shared_ptr<const RecognizerSnapshot> current = Snapshot();
+        const live_recognizer_detail::Base& base = *current->base_;
+        live_recognizer_detail::DeltaEditor editor(base, current->delta_.get());
+        if (!edit(editor)) return false;
+        if (editor.pending() > FoldThreshold(base.registry.size())) {
+            Rebuild(live_recognizer_detail::Materialize(base, &editor.delta()));
+            return true;
+        }
+        auto next = std::make_shared<const RecognizerSnapshot>(next_version_++, current->base_, editor.Finish(policy_));
+        std::atomic_store_explicit(&current_, std::move(next), std::memory_order_release);
+        return true;
+    }
+
+    // 调用方持有 write_mu_（构造函数除外）
+    void Rebuild(std::vector<Category> cats) {
+        auto base = std::make_shared<const live_recognizer_detail::Base>(std::move(cats), policy_);
+        auto next = std::make_shared<const RecognizerSnapshot>(next_version_++, std::move(base), nullptr);
+        std::atomic_store_explicit(&current_, std::move(next), std::memory_order_release);
+    }
+
+    const MatchPolicy policy_;
+    std::mutex write_mu_;  // 只串行化写者
+    uint64_t next_version_ = 1;
+    std::shared_ptr<const RecognizerSnapshot> current_;
+};
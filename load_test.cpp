@@ -0,0 +1,579 @@
+﻿// ===================== 压测：端到端吞吐与伸缩 =====================
+// 生成可复现的合成账本，依次经串行、批量、并行、流式四条路径分类，输出一份
+// JSON 汇总（吞吐、延迟分位、峰值 RSS、每行堆分配次数），便于在不同构建与
+// 主机之间直接比较。只依赖本仓库的头文件与标准库：
+//
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread load_test.cpp -o load_test
+//   ./load_test --rows=10000000 --categories=1000 --threads=16 --output=summary.json
+//
+// 账本按块生成、按块处理，每块由种子与块号决定，各路径看到完全相同的行；
+// 常驻内存只有商户池与一块输入，与总行数无关，1 亿行也能跑。生成时间不计入
+// 各路径的耗时。商户（备注）按 Zipf 分布重复出现，命中率与分类偏斜可配。
+//
+// 延迟口径：serial 为单行处理耗时；batch / parallel 为整块耗时（块内每行都要
+// 等到整块完成）；stream 为 Push 到 sink 收到结果的耗时。各路径按输出顺序
+// 计算的分类 id 校验和应当相同，不同即结果或顺序有误。
+//
+// 内存口径：process_peak_rss_bytes 是该路径跑完时整个进程的峰值 RSS，包含之前
+// 各路径留下的高水位，只会单调不减。要比较单条路径的内存，用 --paths=<one>
+// 分别运行。
+#include "category_recognizer.h"
+#include "metrics.h"
+#include "simd_support.h"
+#include "stream_classifier.h"
+#include "thread_pool.h"
+#include "transaction.h"
+#include "transaction_batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// ===================== 压测：堆分配计数 =====================
+// 替换全局 operator new，统计所有线程的分配次数；只在路径前后取差值
+static std::atomic<uint64_t> g_allocations{0};
+
+static void* CountedAlloc(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+static void* CountedAlignedAlloc(std::size_t size, std::align_val_t align) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t a = static_cast<std::size_t>(align);
+    const std::size_t rounded = (size + a - 1) / a * a;
+#if defined(_WIN32)
+    if (void* p = _aligned_malloc(rounded == 0 ? a : rounded, a)) return p;
+#else
+    if (void* p = std::aligned_alloc(a, rounded == 0 ? a : rounded)) return p;
+#endif
+    throw std::bad_alloc();
+}
+
+static void AlignedFree(void* p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void* operator new(std::size_t size) { return CountedAlloc(size); }
+void* operator new[](std::size_t size) { return CountedAlloc(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return CountedAlignedAlloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return CountedAlignedAlloc(size, align); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { AlignedFree(p); }
+
+// 进程至今的峰值常驻内存（字节）
+static uint64_t PeakRssBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss);  // macOS 以字节计
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // Linux 以 KB 计
+#endif
+#endif
+}
+
+// ===================== 压测：参数 =====================
+struct LoadConfig {
+    uint64_t rows = 1000000;
+    std::size_t categories = 100;
+    int hit_percent = 80;          // 备注含某个分类名的比例
+    double category_zipf = 0.0;    // 命中备注里选哪个分类的偏斜，0 为均匀
+    std::size_t merchants = 100000;  // 不同备注的个数
+    double merchant_zipf = 1.1;    // 商户重复出现的偏斜，0 为均匀
+    std::size_t note_bytes = 48;
+    int empty_date_percent = 25;
+    std::size_t threads = 0;       // parallel / stream 的线程数，0 为硬件线程数
+    std::size_t chunk_rows = 65536;
+    std::size_t stream_capacity = 4096;
+    uint64_t seed = 42;
+    std::string paths = "serial,batch,parallel,stream";
+    std::string output;  // 为空时写标准输出
+};
+
+static const char kUsage[] =
+    "usage: load_test [--rows=N] [--categories=N] [--hit-percent=P] [--category-zipf=S]\n"
+    "                 [--merchants=N] [--merchant-zipf=S] [--note-bytes=N] [--empty-date-percent=P]\n"
+    "                 [--threads=N] [--chunk-rows=N] [--stream-capacity=N] [--seed=N]\n"
+    "                 [--paths=serial,batch,parallel,stream] [--output=FILE]\n";
+
+static bool ParseArgs(int argc, char** argv, LoadConfig& cfg, std::string* error) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const std::size_t eq = arg.find('=');
+        if (arg.substr(0, 2) != "--" || eq == std::string_view::npos) {
+            *error = "bad argument: " + std::string(arg);
+            return false;
+        }
+        const std::string key(arg.substr(2, eq - 2));
+        const std::string value(arg.substr(eq + 1));
+        char* end = nullptr;
+        const unsigned long long u = std::strtoull(value.c_str(), &end, 10);
+        const bool is_uint = !value.empty() && *end == '\0';
+        const double d = std::strtod(value.c_str(), &end);
+        const bool is_double = !value.empty() && *end == '\0' && d >= 0.0;
+        bool ok = is_uint;
+        if (key == "rows") {
+            cfg.rows = u;
+        } else if (key == "categories") {
+            cfg.categories = static_cast<std::size_t>(u);
+            ok = ok && u >= 1;
+        } else if (key == "hit-percent") {
+            cfg.hit_percent = static_cast<int>(u);
+            ok = ok && u <= 100;
+        } else if (key == "category-zipf") {
+            cfg.category_zipf = d;
+            ok = is_double;
+        } else if (key == "merchants") {
+            cfg.merchants = static_cast<std::size_t>(u);
+            ok = ok && u >= 1;
+        } else if (key == "merchant-zipf") {
+            cfg.merchant_zipf = d;
+            ok = is_double;
+        } else if (key == "note-bytes") {
+            cfg.note_bytes = static_cast<std::size_t>(u);
+        } else if (key == "empty-date-percent") {
+            cfg.empty_date_percent = static_cast<int>(u);
+            ok = ok && u <= 100;
+        } else if (key == "threads") {
+            cfg.threads = static_cast<std::size_t>(u);
+        } else if (key == "chunk-rows") {
+            cfg.chunk_rows = static_cast<std::size_t>(u);
+            ok = ok && u >= 1;
+        } else if (key == "stream-capacity") {
+            cfg.stream_capacity = static_cast<std::size_t>(u);
+            ok = ok && u >= 1;
+        } else if (key == "seed") {
+            cfg.seed = u;
+        } else if (key == "paths") {
+            cfg.paths = value;
+            ok = true;
+        } else if (key == "output") {
+            cfg.output = value;
+            ok = true;
+        } else {
+            *error = "unknown option: --" + key;
+            return false;
+        }
+        if (!ok) {
+            *error = "bad value for --" + key + ": " + value;
+            return false;
+        }
+    }
+    if (cfg.threads == 0) cfg.threads = std::max(1u, std::thread::hardware_concurrency());
+    return true;
+}
+
+// ===================== 压测：合成账本 =====================
+// 分类名与备注填充用两组不相交的常用汉字，填充不会意外拼出关键词
+static const char* const kNameChars[] = {
+    "餐", "饮", "娱", "乐", "水", "电", "费", "工", "资", "交", "通", "房", "租", "医", "疗",
+    "教", "育", "购", "物", "旅", "游", "话", "网", "络", "保", "险", "投", "宠", "服", "装",
+    "美", "容", "运", "动", "书", "籍", "数", "码", "家", "具", "维", "修", "快", "递",
+};
+static const char* const kFillerChars[] = {
+    "今", "天", "在", "的", "了", "和", "去", "我", "们", "一", "个", "上", "下", "午",
+    "晚", "中", "心", "店", "里", "用", "卡", "支", "付", "元", "号", "月", "日", "笔",
+};
+
+// P(k) ∝ 1 / (k + 1)^s 的累积分布，按 [0, 1) 均匀数二分取样；s = 0 为均匀分布
+class ZipfSampler {
+ public:
+    ZipfSampler(std::size_t n, double s) : cdf_(n) {
+        double total = 0.0;
+        for (std::size_t k = 0; k < n; ++k) cdf_[k] = total += 1.0 / std::pow(static_cast<double>(k + 1), s);
+        for (double& c : cdf_) c /= total;
+    }
+
+    template <typename Rng>
+    std::size_t operator()(Rng& rng) const {
+        const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        const auto it = std::upper_bound(cdf_.begin(), cdf_.end(), u);
+        return it == cdf_.end() ? cdf_.size() - 1 : static_cast<std::size_t>(it - cdf_.begin());
+    }
+
+ private:
+    std::vector<double> cdf_;
+};
+
+class SyntheticLedger {
+ public:
+    explicit SyntheticLedger(const LoadConfig& cfg) : cfg_(cfg), merchant_pick_(cfg.merchants, cfg.merchant_zipf) {
+        std::mt19937_64 rng(cfg.seed);
+        BuildCategories(rng);
+        BuildMerchants(rng);
+        for (int month = 1; month <= 12; ++month) {
+            for (int day = 1; day <= PackedDate::DaysInMonth(2025, month); ++day) {
+                dates_.push_back(PackedDate(2025, month, day).ToString());
+            }
+        }
+        for (int i = 0; i < 1024; ++i) {
+            const unsigned cents = static_cast<unsigned>(rng() % 500000);
+            amounts_.push_back(std::to_string(cents / 100) + "." + std::to_string(cents % 100 / 10) +
+                               std::to_string(cents % 10));
+        }
+    }
+
+    const std::vector<Category>& categories() const { return categories_; }
+    uint64_t chunks() const { return (cfg_.rows + cfg_.chunk_rows - 1) / cfg_.chunk_rows; }
+
+    // 第 chunk 块的输入写入 out；视图指向本对象内部的池
+    void FillChunk(uint64_t chunk, std::vector<TransactionInput>& out) const {
+        const uint64_t first = chunk * cfg_.chunk_rows;
+        const uint64_t rows = std::min<uint64_t>(cfg_.chunk_rows, cfg_.rows - first);
+        std::mt19937_64 rng(cfg_.seed ^ (0x9E3779B97F4A7C15ull * (chunk + 1)));
+        out.resize(static_cast<std::size_t>(rows));
+        for (TransactionInput& in : out) {
+            in.note = merchants_[merchant_pick_(rng)];
+            const uint64_t r = rng();
+            in.date = static_cast<int>(r % 100) < cfg_.empty_date_percent ? std::string_view()
+                                                                          : std::string_view(dates_[(r >> 8) % dates_.size()]);
+            in.amount = amounts_[(r >> 20) % amounts_.size()];
+        }
+    }
+
+ private:
+    void BuildCategories(std::mt19937_64& rng) {
+        std::uniform_int_distribution<std::size_t> pick(0, std::size(kNameChars) - 1);
+        while (categories_.size() + 1 < cfg_.categories) {
+            std::string name;
+            for (int i = 2 + static_cast<int>(rng() % 3); i > 0; --i) name += kNameChars[pick(rng)];
+            categories_.push_back({static_cast<int>(categories_.size()) + 1, name, ""});
+        }
+        categories_.push_back({static_cast<int>(categories_.size()) + 1, "其他", "其他"});
+    }
+
+    void BuildMerchants(std::mt19937_64& rng) {
+        const std::size_t named = categories_.size() - 1;  // 不选“其他”
+        const ZipfSampler category_pick(named == 0 ? 1 : named, cfg_.category_zipf);
+        std::uniform_int_distribution<std::size_t> filler(0, std::size(kFillerChars) - 1);
+        merchants_.reserve(cfg_.merchants);
+        for (std::size_t m = 0; m < cfg_.merchants; ++m) {
+            std::string note;
+            const bool hit = named > 0 && static_cast<int>(rng() % 100) < cfg_.hit_percent;
+            const std::size_t keyword_at = cfg_.note_bytes == 0 ? 0 : rng() % cfg_.note_bytes;
+            bool placed = false;
+            while (note.size() < cfg_.note_bytes || (hit && !placed)) {
+                if (hit && !placed && note.size() >= keyword_at) {
+                    note += categories_[category_pick(rng)].name;
+                    placed = true;
+                } else {
+                    note += kFillerChars[filler(rng)];
+                }
+            }
+            merchants_.push_back(std::move(note));
+        }
+    }
+
+    const LoadConfig& cfg_;
+    std::vector<Category> categories_;
+    std::vector<std::string> merchants_;
+    ZipfSampler merchant_pick_;
+    std::vector<std::string> dates_;
+    std::vector<std::string> amounts_;
+};
+
+// ===================== 压测：各路径 =====================
+struct PathResult {
+    std::string name;
+    const char* latency_kind = "row";
+    uint64_t rows = 0;
+    double seconds = 0.0;
+    LatencyHistogram latency;
+    uint64_t allocations = 0;
+    uint64_t process_peak_rss_bytes = 0;  // 累计值，含之前各路径
+    uint64_t checksum = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t Nanos(Clock::duration d) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+// 与顺序相关的校验和：各路径按输出顺序混入分类 id
+static uint64_t MixChecksum(uint64_t h, int category_id) {
+    return (h ^ static_cast<uint32_t>(category_id)) * 0x100000001B3ull;
+}
+
+// 单行：ClassificationContext 上逐条 Process，结果缓冲复用
+static void RunSerial(const SyntheticLedger& ledger, const CategoryRecognizer& cr, PathResult& r) {
+    ClassificationContext ctx(256);
+    std::vector<TransactionInput> inputs;
+    for (uint64_t c = 0; c < ledger.chunks(); ++c) {
+        ledger.FillChunk(c, inputs);
+        const Clock::time_point chunk_start = Clock::now();
+        Clock::time_point t0 = chunk_start;
+        for (const TransactionInput& in : inputs) {
+            const int id = ctx.Process(cr, in).category_id;
+            const Clock::time_point t1 = Clock::now();
+            r.latency.Record(Nanos(t1 - t0));
+            t0 = t1;
+            r.checksum = MixChecksum(r.checksum, id);
+        }
+        r.seconds += std::chrono::duration<double>(t0 - chunk_start).count();
+        r.rows += inputs.size();
+    }
+}
+
+// 批量（pool 为空）或并行：每块一次 ProcessTransactions，写入复用的 TransactionBatch
+static void RunBatch(const SyntheticLedger& ledger, const CategoryRecognizer& cr, WorkStealingPool* pool,
+                     PathResult& r) {
+    r.latency_kind = "chunk";
+    TransactionBatch batch;
+    std::vector<TransactionInput> inputs;
+    for (uint64_t c = 0; c < ledger.chunks(); ++c) {
+        ledger.FillChunk(c, inputs);
+        const Clock::time_point t0 = Clock::now();
+        batch.Clear();
+        if (pool != nullptr) {
+            ProcessTransactions(inputs.data(), inputs.size(), cr, batch, *pool);
+        } else {
+            ProcessTransactions(inputs.data(), inputs.size(), cr, batch);
+        }
+        const Clock::time_point t1 = Clock::now();
+        r.latency.Record(Nanos(t1 - t0));
+        r.seconds += std::chrono::duration<double>(t1 - t0).count();
+        r.rows += batch.size();
+        const int32_t* ids = batch.category_ids();
+        for (std::size_t i = 0; i < batch.size(); ++i) r.checksum = MixChecksum(r.checksum, ids[i]);
+    }
+}
+
+// 流式：单个生产者 Push，sink 记录 Push 到交付的耗时。提交时间存在 2 × capacity
+// 的环里：能 Push 第 i 条说明第 i - 2 × capacity 条早已交付，不会被覆盖
+static void RunStream(const SyntheticLedger& ledger, const std::shared_ptr<const CategoryRecognizer>& cr,
+                      const LoadConfig& cfg, PathResult& r) {
+    StreamOptions opt;
+    opt.workers = cfg.threads;
+    opt.capacity = cfg.stream_capacity;
+    std::vector<Clock::time_point> pushed;
+    std::size_t mask = 0;
+    LatencyHistogram& latency = r.latency;
+    uint64_t& checksum = r.checksum;
+    StreamClassifier stream(
+        cr,
+        [&](uint64_t seq, ProcessedTransaction row) {
+            latency.Record(Nanos(Clock::now() - pushed[seq & mask]));
+            checksum = MixChecksum(checksum, row.category_id);
+        },
+        opt);
+    pushed.resize(2 * stream.capacity());
+    mask = pushed.size() - 1;
+
+    std::vector<TransactionInput> inputs;
+    uint64_t seq = 0;
+    for (uint64_t c = 0; c < ledger.chunks(); ++c) {
+        ledger.FillChunk(c, inputs);
+        const Clock::time_point t0 = Clock::now();
+        for (const TransactionInput& in : inputs) {
+            pushed[seq++ & mask] = Clock::now();
+            stream.Push({std::string(in.note), std::string(in.date), std::string(in.amount)});
+        }
+        stream.Flush();
+        r.seconds += std::chrono::duration<double>(Clock::now() - t0).count();
+        r.rows += inputs.size();
+    }
+}
+
+// ===================== 压测：JSON 汇总 =====================
+static std::string JsonString(std::string_view s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+static std::string JsonNumber(double v) {
+    std::ostringstream os;
+    os.precision(6);
+    os << std::fixed << v;
+    return os.str();
+}
+
+static const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::kScalar: return "scalar";
+        case SimdLevel::kSsse3: return "ssse3";
+        case SimdLevel::kAvx2: return "avx2";
+        case SimdLevel::kNeon: return "neon";
+    }
+    return "unknown";
+}
+
+static const char* CompilerName() {
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc";
+#else
+    return "unknown";
+#endif
+}
+
+static std::string FormatSummary(const LoadConfig& cfg, double build_seconds, const std::vector<PathResult>& results) {
+    bool consistent = true;
+    for (const PathResult& r : results) consistent = consistent && r.checksum == results.front().checksum;
+
+    std::string out = "{\n";
+    out += "  \"config\": {\"rows\": " + std::to_string(cfg.rows) + ", \"categories\": " +
+           std::to_string(cfg.categories) + ", \"hit_percent\": " + std::to_string(cfg.hit_percent) +
+           ", \"category_zipf\": " + JsonNumber(cfg.category_zipf) + ", \"merchants\": " +
+           std::to_string(cfg.merchants) + ", \"merchant_zipf\": " + JsonNumber(cfg.merchant_zipf) +
+           ", \"note_bytes\": " + std::to_string(cfg.note_bytes) + ", \"empty_date_percent\": " +
+           std::to_string(cfg.empty_date_percent) + ", \"threads\": " + std::to_string(cfg.threads) +
+           ", \"chunk_rows\": " + std::to_string(cfg.chunk_rows) + ", \"stream_capacity\": " +
+           std::to_string(cfg.stream_capacity) + ", \"seed\": " + std::to_string(cfg.seed) + "},\n";
+#if defined(NDEBUG)
+    const bool ndebug = true;
+#else
+    const bool ndebug = false;
+#endif
+    out += "  \"host\": {\"hardware_threads\": " + std::to_string(std::thread::hardware_concurrency()) +
+           ", \"simd\": " + JsonString(SimdLevelName(ActiveSimdLevel())) + ", \"compiler\": " +
+           JsonString(CompilerName()) + ", \"ndebug\": " + (ndebug ? "true" : "false") +
+           ", \"metrics\": " + (ACCOUNT_BOOK_METRICS ? "true" : "false") + "},\n";
+    out += "  \"recognizer_build_seconds\": " + JsonNumber(build_seconds) + ",\n";
+    out += "  \"checksums_consistent\": " + std::string(consistent ? "true" : "false") + ",\n";
+    out += "  \"paths\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const PathResult& r = results[i];
+        const double per_second = r.seconds > 0.0 ? static_cast<double>(r.rows) / r.seconds : 0.0;
+        const double per_row = r.rows == 0 ? 0.0 : static_cast<double>(r.allocations) / static_cast<double>(r.rows);
+        char checksum[24];
+        std::snprintf(checksum, sizeof(checksum), "%016llx", static_cast<unsigned long long>(r.checksum));
+        out += i == 0 ? "\n" : ",\n";
+        out += "    {\"name\": " + JsonString(r.name) + ", \"rows\": " + std::to_string(r.rows) +
+               ", \"seconds\": " + JsonNumber(r.seconds) + ", \"rows_per_second\": " + JsonNumber(per_second) +
+               ",\n     \"latency_ns\": {\"kind\": " + JsonString(r.latency_kind) +
+               ", \"samples\": " + std::to_string(r.latency.count()) +
+               ", \"mean\": " + JsonNumber(r.latency.Mean()) +
+               ", \"p50\": " + std::to_string(r.latency.Quantile(0.5)) +
+               ", \"p99\": " + std::to_string(r.latency.Quantile(0.99)) +
+               ", \"p999\": " + std::to_string(r.latency.Quantile(0.999)) + "},\n" +
+               "     \"allocations\": " + std::to_string(r.allocations) +
+               ", \"allocations_per_row\": " + JsonNumber(per_row) +
+               ", \"process_peak_rss_bytes\": " + std::to_string(r.process_peak_rss_bytes) +
+               ", \"checksum\": " + JsonString(checksum) + "}";
+    }
+    out += "\n  ]\n}\n";
+    return out;
+}
+
+int main(int argc, char** argv) {
+    LoadConfig cfg;
+    std::string error;
+    if (!ParseArgs(argc, argv, cfg, &error)) {
+        std::cerr << error << "\n" << kUsage;
+        return 2;
+    }
+
+    std::cerr << "generating merchants and categories...\n";
+    const SyntheticLedger ledger(cfg);
+    const Clock::time_point build_start = Clock::now();
+    const auto cr = std::make_shared<const CategoryRecognizer>(ledger.categories());
+    const double build_seconds = std::chrono::duration<double>(Clock::now() - build_start).count();
+
+    std::vector<PathResult> results;
+    std::stringstream paths(cfg.paths);
+    std::string name;
+    while (std::getline(paths, name, ',')) {
+        if (name.empty()) continue;
+        PathResult r;
+        r.name = name;
+        std::cerr << "running " << name << "...\n";
+        const uint64_t allocations_before = g_allocations.load();
+        if (name == "serial") {
+            RunSerial(ledger, *cr, r);
+        } else if (name == "batch") {
+            RunBatch(ledger, *cr, nullptr, r);
+        } else if (name == "parallel") {
+            WorkStealingPool pool(cfg.threads);
+            RunBatch(ledger, *cr, &pool, r);
+        } else if (name == "stream") {
+            RunStream(ledger, cr, cfg, r);
+        } else {
+            std::cerr << "unknown path: " << name << "\n" << kUsage;
+            return 2;
+        }
+        r.allocations = g_allocations.load() - allocations_before;
+        r.process_peak_rss_bytes = PeakRssBytes();
+        results.push_back(std::move(r));
+    }
+    if (results.empty()) {
+        std::cerr << "no paths selected\n" << kUsage;
+        return 2;
+    }
+
+    const std::string summary = FormatSummary(cfg, build_seconds, results);
+    if (cfg.output.empty()) {
+        std::cout << summary;
+    } else {
+        std::ofstream file(cfg.output, std::ios::binary);
+        file << summary;
+        if (!file) {
+            std::cerr << "cannot write " << cfg.output << "\n";
+            return 1;
+        }
+    }
+    bool consistent = true;
+    for (const PathResult& r : results) consistent = consistent && r.checksum == results.front().checksum;
+    return consistent ? 0 : 3;
+}
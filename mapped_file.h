@@ -0,0 +1,129 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ===================== 公共：只读内存映射文件 =====================
+// CSV 导入按顺序扫描整个文件；识别器快照按转移表随机访问
+enum class MapAccess {
+    kSequential,
+    kRandom,
+};
+
+class MappedFile {
+ public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 失败时返回 false 并写入 error；空文件视为成功且 view() 为空
+    bool Open(const std::string& path, std::string* error, MapAccess access = MapAccess::kSequential) {
+        Close();
+#if defined(_WIN32)
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            access == MapAccess::kSequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS,
+                            nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return Fail("cannot open " + path, error);
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file_, &size)) return Fail("cannot stat " + path, error);
+        size_ = static_cast<std::size_t>(size.QuadPart);
+        if (size_ == 0) return true;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr) return Fail("cannot map " + path, error);
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (data_ == nullptr) return Fail("cannot map " + path, error);
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return Fail("cannot open " + path, error);
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0) return Fail("cannot stat " + path, error);
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ == 0) return true;
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (p == MAP_FAILED) return Fail("cannot map " + path, error);
+        data_ = static_cast<const char*>(p);
+        ::madvise(p, size_, access == MapAccess::kSequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+#endif
+        return true;
+    }
+
+    void Close() {
+#if defined(_WIN32)
+        if (data_ != nullptr) UnmapViewOfFile(data_);
+        if (mapping_ != nullptr) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_ != nullptr) ::munmap(const_cast<char*>(data_), size_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+        discarded_ = 0;
+    }
+
+    std::string_view view() const { return std::string_view(data_, data_ == nullptr ? 0 : size_); }
+
+    // 声明 view() 的前 bytes 字节不再访问：其中的整页从进程常驻内存中移除（之后若再读，
+    // 会从文件重新载入）。顺序处理大文件时随进度调用，常驻页就不随文件大小增长
+    void DiscardPrefix(std::size_t bytes) {
+        if (data_ == nullptr) return;
+        const std::size_t page = PageSize();
+        const std::size_t end = (bytes < size_ ? bytes : size_) / page * page;
+        if (end <= discarded_) return;
+        char* begin = const_cast<char*>(data_) + discarded_;
+#if defined(_WIN32)
+        ::VirtualUnlock(begin, end - discarded_);  // 对未锁定的页：把它们移出工作集
+#else
+        ::madvise(begin, end - discarded_, MADV_DONTNEED);
+#endif
+        discarded_ = end;
+    }
+
+ private:
+    static std::size_t PageSize() {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    bool Fail(const std::string& message, std::string* error) {
+        if (error != nullptr) *error = message;
+        Close();
+        return false;
+    }
+
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t discarded_ = 0;  // DiscardPrefix 已归还的前缀，按页对齐
+#if defined(_WIN32)
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
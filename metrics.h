@@ -0,0 +1,324 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "simd_support.h"
+
+// ===================== 公共：热路径指标 =====================
+// 编译期开关：以 -DACCOUNT_BOOK_METRICS=1 编译时启用。默认关闭，此时 CountMetric、
+// ScopedLatency 等埋点都是空的内联函数，不读时钟、不碰 thread_local，开销为零；
+// TakeMetricsSnapshot() 返回全 0。
+//
+// 启用时每个线程写自己的一块计数（单写者，relaxed 读改写，无锁无 CAS），快照时
+// 把所有线程的块加总；线程退出时它的计数并入“已退出”块，不会丢失。
+#ifndef ACCOUNT_BOOK_METRICS
+#define ACCOUNT_BOOK_METRICS 0
+#endif
+
+enum class MetricCounter : std::size_t {
+    kTransactions,   // 处理的交易行数
+    kKeywordHits,    // 命中关键词
+    kFallbackOther,  // 未命中，回退到“其他”
+    kFallbackFirst,  // 未命中且没有“其他”，回退到第一个分类
+    kNoCategories,   // 分类表为空，返回 0
+    kDateAutofills,  // 日期为空、自动填当天
+    kFuzzyHits,      // 精确未命中，经 FuzzyCategoryRecognizer 折叠或近似匹配找回
+    kCount,
+};
+
+enum class MetricHistogram : std::size_t {
+    kRecognizerBuild,  // 构建一个 CategoryRecognizer
+    kClassify,         // 一次 RecognizeCategory
+    kStreamQueueWait,    // StreamClassifier：Push 到被分类线程取出
+    kStreamReorderWait,  // StreamClassifier：分类完成到轮到它交付
+    kStreamSink,         // StreamClassifier：一次 sink 回调
+    kCount,
+};
+
+constexpr std::size_t kMetricCounters = static_cast<std::size_t>(MetricCounter::kCount);
+constexpr std::size_t kMetricHistograms = static_cast<std::size_t>(MetricHistogram::kCount);
+
+// HDR 式对数-线性直方图（纳秒）：每个 2 的幂区间再均分 16 个子桶，相对误差不超过 1/16。
+// 小于 32 的值精确记录；值域 [0, 2^44) ns（约 4.9 小时），更大的值记入最后一桶。
+class LatencyHistogram {
+ public:
+    static constexpr unsigned kSubBits = 4;
+    static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBits;
+    static constexpr unsigned kMaxBits = 44;
+    static constexpr std::size_t kBuckets = (kMaxBits - kSubBits + 1) * kSubBuckets;
+
+    static std::size_t BucketIndex(uint64_t value) {
+        if (value >= uint64_t{1} << kMaxBits) value = (uint64_t{1} << kMaxBits) - 1;
+        if (value < kSubBuckets) return static_cast<std::size_t>(value);
+        const unsigned top = HighestSetBit(value);
+        const uint64_t sub = (value >> (top - kSubBits)) - kSubBuckets;
+        return static_cast<std::size_t>((top - kSubBits + 1) * kSubBuckets + sub);
+    }
+
+    // 桶内最小值；桶 i 覆盖 [BucketLowerBound(i), BucketLowerBound(i + 1))
+    static uint64_t BucketLowerBound(std::size_t index) {
+        const uint64_t group = index / kSubBuckets;
+        const uint64_t sub = index % kSubBuckets;
+        if (group == 0) return sub;
+        return (kSubBuckets + sub) << (group - 1);
+    }
+
+    void Record(uint64_t value, uint64_t times = 1) {
+        buckets_[BucketIndex(value)] += times;
+        count_ += times;
+        sum_ += value * times;
+    }
+
+    // 直接累加已分好桶的计数（汇总各线程的原始桶时使用）
+    void AddToBucket(std::size_t index, uint64_t n) {
+        buckets_[index] += n;
+        count_ += n;
+    }
+    void AddToSum(uint64_t nanos) { sum_ += nanos; }
+
+    void Merge(const LatencyHistogram& other) {
+        for (std::size_t i = 0; i < kBuckets; ++i) buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t bucket(std::size_t index) const { return buckets_[index]; }
+    double Mean() const { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_); }
+
+    // 第 q 分位（0 < q <= 1）所在桶的最大值；没有记录时返回 0
+    uint64_t Quantile(double q) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count_) + 0.999999);
+        if (rank == 0) rank = 1;
+        if (rank > count_) rank = count_;
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) return BucketLowerBound(i + 1) - 1;
+        }
+        return BucketLowerBound(kBuckets) - 1;
+    }
+
+ private:
+    std::array<uint64_t, kBuckets> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;  // 纳秒总和
+};
+
+struct MetricsSnapshot {
+    std::array<uint64_t, kMetricCounters> counters{};
+    std::array<LatencyHistogram, kMetricHistograms> histograms{};
+
+    uint64_t counter(MetricCounter c) const { return counters[static_cast<std::size_t>(c)]; }
+    const LatencyHistogram& histogram(MetricHistogram h) const { return histograms[static_cast<std::size_t>(h)]; }
+};
+
+#if ACCOUNT_BOOK_METRICS
+
+namespace metrics_detail {
+
+// 只有所属线程写入；快照线程并发读取，故仍用 atomic
+struct ThreadBlock {
+    std::array<std::atomic<uint64_t>, kMetricCounters> counters{};
+    std::array<std::array<std::atomic<uint64_t>, LatencyHistogram::kBuckets>, kMetricHistograms> buckets{};
+    std::array<std::atomic<uint64_t>, kMetricHistograms> sums{};
+};
+
+inline void Bump(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+class Registry {
+ public:
+    void Register(ThreadBlock* block) {
+        std::lock_guard<std::mutex> lock(mu_);
+        live_.push_back(block);
+    }
+
+    void Retire(ThreadBlock* block) {
+        std::lock_guard<std::mutex> lock(mu_);
+        AddTo(*block, retired_);
+        for (auto& b : live_) {
+            if (b == block) {
+                b = live_.back();
+                live_.pop_back();
+                break;
+            }
+        }
+    }
+
+    MetricsSnapshot Snapshot() const {
+        std::lock_guard<std::mutex> lock(mu_);
+        MetricsSnapshot s = retired_;
+        for (const ThreadBlock* b : live_) AddTo(*b, s);
+        return s;
+    }
+
+ private:
+    static void AddTo(const ThreadBlock& b, MetricsSnapshot& s) {
+        for (std::size_t c = 0; c < kMetricCounters; ++c) {
+            s.counters[c] += b.counters[c].load(std::memory_order_relaxed);
+        }
+        for (std::size_t h = 0; h < kMetricHistograms; ++h) {
+            LatencyHistogram& out = s.histograms[h];
+            for (std::size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+                out.AddToBucket(i, b.buckets[h][i].load(std::memory_order_relaxed));
+            }
+            out.AddToSum(b.sums[h].load(std::memory_order_relaxed));
+        }
+    }
+
+    mutable std::mutex mu_;
+    std::vector<ThreadBlock*> live_;
+    MetricsSnapshot retired_;
+};
+
+// 有意泄漏：线程可能在静态析构之后才退出
+inline Registry& GlobalRegistry() {
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+struct ThreadSlot {
+    ThreadSlot() : block(new ThreadBlock()) { GlobalRegistry().Register(block); }
+    ~ThreadSlot() {
+        GlobalRegistry().Retire(block);
+        delete block;
+    }
+    ThreadBlock* block;
+};
+
+inline ThreadBlock& LocalBlock() {
+    thread_local ThreadSlot slot;
+    return *slot.block;
+}
+
+}  // namespace metrics_detail
+
+inline void CountMetric(MetricCounter c, uint64_t n = 1) {
+    metrics_detail::Bump(metrics_detail::LocalBlock().counters[static_cast<std::size_t>(c)], n);
+}
+
+inline void RecordLatency(MetricHistogram h, uint64_t nanos) {
+    metrics_detail::ThreadBlock& b = metrics_detail::LocalBlock();
+    const std::size_t i = static_cast<std::size_t>(h);
+    metrics_detail::Bump(b.buckets[i][LatencyHistogram::BucketIndex(nanos)], 1);
+    metrics_detail::Bump(b.sums[i], nanos);
+}
+
+// 作用域计时：析构时把耗时记入直方图
+class ScopedLatency {
+ public:
+    explicit ScopedLatency(MetricHistogram h) : histogram_(h), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        const auto elapsed = std::chrono::steady_clock::now() - start_;
+        RecordLatency(histogram_, static_cast<uint64_t>(
+                                      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+ private:
+    MetricHistogram histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+inline MetricsSnapshot TakeMetricsSnapshot() { return metrics_detail::GlobalRegistry().Snapshot(); }
+
+#else
+
+inline void CountMetric(MetricCounter, uint64_t = 1) {}
+inline void RecordLatency(MetricHistogram, uint64_t) {}
+
+class ScopedLatency {
+ public:
+    explicit ScopedLatency(MetricHistogram) {}
+};
+
+inline MetricsSnapshot TakeMetricsSnapshot() { return MetricsSnapshot(); }
+
+#endif
+
+// ===================== 公共：Prometheus 文本格式 =====================
+namespace metrics_detail {
+
+inline void AppendSample(std::string& out, const char* name, const char* labels, uint64_t value) {
+    out += name;
+    out += labels;
+    out += ' ';
+    out += std::to_string(value);
+    out += '\n';
+}
+
+// 纳秒 → 秒，保留 9 位小数
+inline std::string Seconds(uint64_t nanos) {
+    std::string frac = std::to_string(nanos % 1000000000u);
+    frac.insert(0, 9 - frac.size(), '0');
+    return std::to_string(nanos / 1000000000u) + "." + frac;
+}
+
+// 只按 2 的幂划分（与子桶边界对齐，累计值精确），避免每个直方图输出上百行。Prometheus 的
+// le 是“<=”，而累计的是 < 2^k ns 的样本，样本为整数纳秒，故边界写成 2^k - 1 ns
+inline void AppendHistogram(std::string& out, const char* name, const char* help, const LatencyHistogram& h) {
+    out += std::string("# HELP ") + name + " " + help + "\n";
+    out += std::string("# TYPE ") + name + " histogram\n";
+    uint64_t cumulative = 0;
+    std::size_t next = 0;
+    for (unsigned bits = LatencyHistogram::kSubBits; bits <= LatencyHistogram::kMaxBits; ++bits) {
+        const uint64_t bound = uint64_t{1} << bits;  // 计入 < bound，即 <= bound - 1 的样本
+        while (next < LatencyHistogram::kBuckets && LatencyHistogram::BucketLowerBound(next) < bound) {
+            cumulative += h.bucket(next++);
+        }
+        out += std::string(name) + "_bucket{le=\"" + Seconds(bound - 1) + "\"} " + std::to_string(cumulative) + "\n";
+    }
+    out += std::string(name) + "_bucket{le=\"+Inf\"} " + std::to_string(h.count()) + "\n";
+    out += std::string(name) + "_sum " + Seconds(h.sum()) + "\n";
+    out += std::string(name) + "_count " + std::to_string(h.count()) + "\n";
+}
+
+}  // namespace metrics_detail
+
+// 供 /metrics 端点直接返回的文本（text/plain; version=0.0.4）
+inline std::string FormatPrometheus(const MetricsSnapshot& s) {
+    namespace d = metrics_detail;
+    std::string out;
+    out += "# HELP account_book_transactions_total Transactions processed.\n";
+    out += "# TYPE account_book_transactions_total counter\n";
+    d::AppendSample(out, "account_book_transactions_total", "", s.counter(MetricCounter::kTransactions));
+    out += "# HELP account_book_classifications_total Classification results by outcome.\n";
+    out += "# TYPE account_book_classifications_total counter\n";
+    d::AppendSample(out, "account_book_classifications_total", "{result=\"keyword\"}",
+                    s.counter(MetricCounter::kKeywordHits));
+    d::AppendSample(out, "account_book_classifications_total", "{result=\"fallback_other\"}",
+                    s.counter(MetricCounter::kFallbackOther));
+    d::AppendSample(out, "account_book_classifications_total", "{result=\"fallback_first\"}",
+                    s.counter(MetricCounter::kFallbackFirst));
+    d::AppendSample(out, "account_book_classifications_total", "{result=\"no_categories\"}",
+                    s.counter(MetricCounter::kNoCategories));
+    d::AppendSample(out, "account_book_classifications_total", "{result=\"fuzzy\"}",
+                    s.counter(MetricCounter::kFuzzyHits));
+    out += "# HELP account_book_date_autofills_total Rows whose empty date was filled with today.\n";
+    out += "# TYPE account_book_date_autofills_total counter\n";
+    d::AppendSample(out, "account_book_date_autofills_total", "", s.counter(MetricCounter::kDateAutofills));
+    d::AppendHistogram(out, "account_book_recognizer_build_seconds", "CategoryRecognizer build latency.",
+                       s.histogram(MetricHistogram::kRecognizerBuild));
+    d::AppendHistogram(out, "account_book_classify_seconds", "RecognizeCategory latency.",
+                       s.histogram(MetricHistogram::kClassify));
+    d::AppendHistogram(out, "account_book_stream_queue_wait_seconds", "Stream request wait before classification.",
+                       s.histogram(MetricHistogram::kStreamQueueWait));
+    d::AppendHistogram(out, "account_book_stream_reorder_wait_seconds", "Stream result wait for in-order delivery.",
+                       s.histogram(MetricHistogram::kStreamReorderWait));
+    d::AppendHistogram(out, "account_book_stream_sink_seconds", "Stream sink callback latency.",
+                       s.histogram(MetricHistogram::kStreamSink));
+    return out;
+}
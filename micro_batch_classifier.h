@@ -0,0 +1,203 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "live_recognizer.h"
+#include "transaction.h"
+
+// ===================== 集成流程：异步微批处理 =====================
+// 请求服务路径的异步入口：前端线程 Submit() 后立即返回，由一个调度线程把
+// 相近时间到达的请求攒成微批，在共享识别器上一次处理完，再通过回调或 future
+// 交回结果。调用方不必为每个请求占一个线程阻塞等待。
+//
+// 批首请求到达后最多再等 max_delay：期间积满 max_batch 立即处理，否则到时
+// 处理已有的请求。每批只取一次识别器快照与当天日期。
+struct ClassifyRequest {
+    std::string note;
+    std::string date;    // 为空时填当天
+    std::string amount;  // 为空时记为 0
+};
+
+struct MicroBatchOptions {
+    std::size_t max_batch = 256;
+    std::chrono::microseconds max_delay{200};
+};
+
+struct MicroBatchStats {
+    uint64_t requests = 0;
+    uint64_t batches = 0;
+
+    double AverageBatch() const { return batches == 0 ? 0.0 : static_cast<double>(requests) / batches; }
+};
+
+class MicroBatchClassifier {
+ public:
+    // 在调度线程上调用，应尽快返回；抛出的异常被丢弃，不影响同批其他请求
+    using Callback = std::function<void(ProcessedTransaction)>;
+
+    explicit MicroBatchClassifier(std::shared_ptr<const CategoryRecognizer> recognizer,
+                                  MicroBatchOptions options = MicroBatchOptions())
+        : options_(Normalize(options)), fixed_(std::move(recognizer)) {
+        Start();
+    }
+
+    // 每批取一次 live 的当前版本；live 须比本对象活得久
+    explicit MicroBatchClassifier(const LiveCategoryRecognizer& live,
+                                  MicroBatchOptions options = MicroBatchOptions())
+        : options_(Normalize(options)), live_(&live) {
+        Start();
+    }
+
+    // 处理完所有已提交的请求后返回
+    ~MicroBatchClassifier() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_ = true;
+        }
+        ready_.notify_one();
+        dispatcher_.join();
+    }
+
+    MicroBatchClassifier(const MicroBatchClassifier&) = delete;
+    MicroBatchClassifier& operator=(const MicroBatchClassifier&) = delete;
+
+    // done 为空时抛 std::invalid_argument，不入队
+    void Submit(ClassifyRequest request, Callback done) {
+        if (!done) throw std::invalid_argument("MicroBatchClassifier::Submit: empty callback");
+        Pending p;
+        p.request = std::move(request);
+        p.done = std::move(done);
+        Enqueue(std::move(p));
+    }
+
+    std::future<ProcessedTransaction> Submit(ClassifyRequest request) {
+        Pending p;
+        p.request = std::move(request);
+        std::future<ProcessedTransaction> result = p.promise.emplace().get_future();
+        Enqueue(std::move(p));
+        return result;
+    }
+
+    MicroBatchStats Stats() const {
+        MicroBatchStats s;
+        s.requests = requests_.load(std::memory_order_relaxed);
+        s.batches = batches_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    const MicroBatchOptions& options() const { return options_; }
+
+ private:
+    using Clock = std::chrono::steady_clock;
+
+    // 二者恰有其一；promise 用 optional 包装，回调请求不分配 future 的共享状态
+    struct Pending {
+        ClassifyRequest request;
+        Callback done;
+        std::optional<std::promise<ProcessedTransaction>> promise;
+        Clock::time_point arrival;
+    };
+
+    static MicroBatchOptions Normalize(MicroBatchOptions options) {
+        if (options.max_batch == 0) options.max_batch = 1;
+        if (options.max_delay.count() < 0) options.max_delay = std::chrono::microseconds(0);
+        return options;
+    }
+
+    void Start() {
+        dispatcher_ = std::thread([this] { Run(); });
+    }
+
+    // 只在队列由空变非空（开始计时）或积满一批时唤醒调度线程，其余提交不触发上下文切换
+    void Enqueue(Pending p) {
+        p.arrival = Clock::now();
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            queue_.push_back(std::move(p));
+            wake = queue_.size() == 1 || queue_.size() == options_.max_batch;
+        }
+        if (wake) ready_.notify_one();
+    }
+
+    std::shared_ptr<const CategoryRecognizer> Current() const {
+        if (live_ == nullptr) return fixed_;
+        std::shared_ptr<const RecognizerSnapshot> snapshot = live_->Snapshot();
+        const CategoryRecognizer* cr = &snapshot->recognizer;
+        return std::shared_ptr<const CategoryRecognizer>(std::move(snapshot), cr);
+    }
+
+    void Run() {
+        std::vector<Pending> batch;
+        batch.reserve(options_.max_batch);
+        std::unique_lock<std::mutex> lock(mu_);
+        for (;;) {
+            ready_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) return;  // 已停止且排空
+            const Clock::time_point deadline = queue_.front().arrival + options_.max_delay;
+            ready_.wait_until(lock, deadline, [this] { return stop_ || queue_.size() >= options_.max_batch; });
+
+            const std::size_t n = std::min(queue_.size(), options_.max_batch);
+            batch.assign(std::make_move_iterator(queue_.begin()),
+                         std::make_move_iterator(queue_.begin() + static_cast<std::ptrdiff_t>(n)));
+            queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(n));
+            lock.unlock();
+            ProcessBatch(batch);
+            batch.clear();
+            lock.lock();
+        }
+    }
+
+    // 备注直接从请求移入结果，不再拷贝
+    void ProcessBatch(std::vector<Pending>& batch) {
+        requests_.fetch_add(batch.size(), std::memory_order_relaxed);
+        batches_.fetch_add(1, std::memory_order_relaxed);
+        const std::shared_ptr<const CategoryRecognizer> cr = Current();
+        PackedDate today;
+        for (Pending& p : batch) {
+            const TransactionInput in{p.request.note, p.request.date, p.request.amount};
+            if (in.date.empty() && !today.valid()) today = GetCurrentPackedDate();
+            ProcessedTransaction out;
+            ProcessTransactionInto(*cr, in, today, out, NoteCopy::kSkip);
+            out.note = std::move(p.request.note);
+            if (p.promise) {
+                p.promise->set_value(std::move(out));
+                continue;
+            }
+            try {
+                p.done(std::move(out));
+            } catch (...) {
+            }
+        }
+    }
+
+    const MicroBatchOptions options_;
+    const std::shared_ptr<const CategoryRecognizer> fixed_;
+    const LiveCategoryRecognizer* const live_ = nullptr;
+
+    std::mutex mu_;
+    std::condition_variable ready_;
+    std::deque<Pending> queue_;
+    bool stop_ = false;
+    std::thread dispatcher_;
+
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> batches_{0};
+};
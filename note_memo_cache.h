@@ -0,0 +1,168 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#include "category_recognizer.h"
+#include "live_recognizer.h"
+
+// ===================== 组件B：备注级记忆化缓存 =====================
+// 64 位备注哈希：每次吃 8 字节、一次乘法混合，比逐字节的 DFA 扫描便宜一个数量级。
+inline uint64_t NoteHash(std::string_view note, uint64_t seed = 0) {
+    constexpr uint64_t k1 = 0x9e3779b97f4a7c15ull;
+    constexpr uint64_t k2 = 0xc2b2ae3d27d4eb4full;
+    const char* p = note.data();
+    std::size_t n = note.size();
+    uint64_t h = seed ^ (static_cast<uint64_t>(n) * k1);
+    while (n >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        h ^= v * k2;
+        h = ((h << 31) | (h >> 33)) * k1;
+        p += 8;
+        n -= 8;
+    }
+    if (n > 0) {
+        uint64_t v = 0;
+        std::memcpy(&v, p, n);
+        h ^= v * k2;
+        h = ((h << 31) | (h >> 33)) * k1;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+struct NoteMemoStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    double HitRate() const {
+        const uint64_t total = hits + misses;
+        return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+    }
+};
+
+// 备注哈希 → 分类 id 的定长并发缓存，放在识别器前面吸收重复商户备注。
+// 固定容量（2 的幂），2 路组相联，无锁：每个槽的 key 兼作序号，写者先 CAS
+// 占槽再写值，读者读 key/值/key 并核对，因此不会读到拼接出的结果。
+//
+// 识别器指纹（CategoryRecognizer::fingerprint()）混入 key：换了识别器或分类变更后
+// 旧条目自然全部失配并逐步被覆盖，无需显式清空，也不靠调用方维护版本号。
+// 命中依赖 64 位哈希，碰撞概率可忽略。
+class NoteMemoCache {
+ public:
+    // capacity 向上取整到 2 的幂，至少 2 个槽
+    explicit NoteMemoCache(std::size_t capacity = 1 << 16) {
+        std::size_t n = 2;
+        while (n < capacity) n <<= 1;
+        mask_ = n - 1;
+        slots_ = std::make_unique<Slot[]>(n);
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    int Recognize(const CategoryRecognizer& cr, std::string_view note) {
+        const uint64_t key = MakeKey(note, cr.fingerprint());
+        int id = 0;
+        if (Lookup(key, id)) {
+            Count(true);
+            return id;
+        }
+        Count(false);
+        id = cr.RecognizeCategory(note);
+        Insert(key, id);
+        return id;
+    }
+
+    // 运行时可更新的识别器：取当前快照识别（快照在调用期间保持存活）
+    int Recognize(const LiveCategoryRecognizer& live, std::string_view note) {
+        const auto snapshot = live.Snapshot();
+        return Recognize(snapshot->recognizer, note);
+    }
+
+    NoteMemoStats Stats() const {
+        NoteMemoStats s;
+        for (const auto& c : counters_) {
+            s.hits += c.hits.load(std::memory_order_relaxed);
+            s.misses += c.misses.load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+ private:
+    static constexpr uint64_t kEmpty = 0;
+    static constexpr uint64_t kBusy = 1;
+    static constexpr std::size_t kCounterStripes = 16;
+
+    struct Slot {
+        std::atomic<uint64_t> key{kEmpty};
+        std::atomic<int32_t> id{0};
+    };
+
+    // 按线程分条的计数器，避免多核同时更新同一缓存行
+    struct alignas(64) Counter {
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+    };
+
+    static uint64_t MakeKey(std::string_view note, uint64_t fingerprint) {
+        const uint64_t key = NoteHash(note, fingerprint);
+        return key <= kBusy ? key + 2 : key;
+    }
+
+    bool Lookup(uint64_t key, int& id) const {
+        const std::size_t base = static_cast<std::size_t>(key) & mask_ & ~std::size_t{1};
+        for (std::size_t way = 0; way < 2; ++way) {
+            const Slot& slot = slots_[base + way];
+            if (slot.key.load(std::memory_order_acquire) != key) continue;
+            const int32_t value = slot.id.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.key.load(std::memory_order_relaxed) != key) continue;
+            id = value;
+            return true;
+        }
+        return false;
+    }
+
+    void Insert(uint64_t key, int id) {
+        const std::size_t base = static_cast<std::size_t>(key) & mask_ & ~std::size_t{1};
+        // 优先空槽；否则按 key 的高位选一路覆盖
+        std::size_t way = (key >> 63) & 1;
+        if (slots_[base].key.load(std::memory_order_relaxed) == kEmpty) {
+            way = 0;
+        } else if (slots_[base + 1].key.load(std::memory_order_relaxed) == kEmpty) {
+            way = 1;
+        }
+        Slot& slot = slots_[base + way];
+        uint64_t expected = slot.key.load(std::memory_order_relaxed);
+        if (expected == kBusy ||
+            !slot.key.compare_exchange_strong(expected, kBusy, std::memory_order_acquire)) {
+            return;  // 另一个写者正占用该槽，放弃本次缓存即可
+        }
+        // seqlock 写端：kBusy 先于新 id 可见。读端读到新 id 后的 acquire 栅栏与此配对，
+        // 复查 key 时必然看到 kBusy 或新 key，不会把旧 key 与新 id 拼在一起
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.id.store(static_cast<int32_t>(id), std::memory_order_relaxed);
+        slot.key.store(key, std::memory_order_release);
+    }
+
+    void Count(bool hit) {
+        static std::atomic<std::size_t> next_stripe{0};
+        thread_local const std::size_t stripe =
+            next_stripe.fetch_add(1, std::memory_order_relaxed) % kCounterStripes;
+        Counter& c = counters_[stripe];
+        (hit ? c.hits : c.misses).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::size_t mask_ = 0;
+    std::unique_ptr<Slot[]> slots_;
+    Counter counters_[kCounterStripes];
+};
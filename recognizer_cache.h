@@ -0,0 +1,160 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "category_recognizer.h"
+
+// ===================== 组件B：按分类集合缓存识别器 =====================
+// 分类集合的 64 位指纹：依次混入 id、名字、优先级（kPriority 依赖它）、别名与匹配策略。
+// 名字与别名带长度前缀，避免 {"ab","c"} 与 {"a","bc"} 混淆。
+inline uint64_t CategoryFingerprint(const std::vector<Category>& categories,
+                                    MatchPolicy policy = MatchPolicy::kByteOrder) {
+    uint64_t h = 14695981039346656037ull;  // FNV-1a 64
+    auto mix_bytes = [&h](const void* data, std::size_t n) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < n; ++i) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+    };
+    auto mix_int = [&](int64_t v) { mix_bytes(&v, sizeof(v)); };
+    mix_int(static_cast<int64_t>(policy));
+    mix_int(static_cast<int64_t>(categories.size()));
+    for (const auto& c : categories) {
+        mix_int(c.id);
+        mix_int(static_cast<int64_t>(c.name.size()));
+        mix_bytes(c.name.data(), c.name.size());
+        mix_int(c.priority);
+        mix_int(static_cast<int64_t>(c.keywords.size()));
+        for (const auto& k : c.keywords) {
+            mix_int(static_cast<int64_t>(k.size()));
+            mix_bytes(k.data(), k.size());
+        }
+    }
+    // 末尾再做一次 splitmix 混合，让低位也足够均匀（用于选分片）
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+struct RecognizerCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    std::size_t size = 0;
+
+    double HitRate() const {
+        const uint64_t total = hits + misses;
+        return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+    }
+};
+
+// 多租户场景下按分类集合复用已构建的识别器：有界、分片的 LRU。
+// 命中时只需计算指纹并核对分类表（防止指纹碰撞把别的租户的识别器拿来用），
+// 跳过整个构建过程。构建在分片锁之外进行，慢构建不会阻塞同分片的命中。
+// 返回的 shared_ptr 在条目被淘汰后依然有效。
+class RecognizerCache {
+ public:
+    explicit RecognizerCache(std::size_t capacity = 1024, std::size_t shards = 16)
+        : shards_(shards == 0 ? 1 : shards) {
+        const std::size_t per_shard = (capacity + shards_.size() - 1) / shards_.size();
+        for (auto& s : shards_) s.capacity = per_shard == 0 ? 1 : per_shard;
+    }
+
+    std::shared_ptr<const CategoryRecognizer> Get(const std::vector<Category>& categories,
+                                                  MatchPolicy policy = MatchPolicy::kByteOrder) {
+        const uint64_t key = CategoryFingerprint(categories, policy);
+        Shard& shard = shards_[key % shards_.size()];
+        {
+            std::lock_guard<std::mutex> lock(shard.mu);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end() && it->second->built->recognizer.policy() == policy &&
+                SameMatchingCategories(it->second->built->categories, categories)) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return Alias(it->second->built);
+            }
+        }
+
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        auto built = std::make_shared<const Built>(categories, policy);
+
+        std::lock_guard<std::mutex> lock(shard.mu);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            // 并发未命中时别的线程可能已插入同一 key（或碰撞的另一集合）：以新构建者为准
+            it->second->built = built;
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        } else {
+            shard.lru.push_front(Entry{key, built});
+            shard.index.emplace(key, shard.lru.begin());
+            if (shard.lru.size() > shard.capacity) {
+                shard.index.erase(shard.lru.back().key);
+                shard.lru.pop_back();
+                evictions_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        return Alias(built);
+    }
+
+    RecognizerCacheStats Stats() const {
+        RecognizerCacheStats s;
+        s.hits = hits_.load(std::memory_order_relaxed);
+        s.misses = misses_.load(std::memory_order_relaxed);
+        s.evictions = evictions_.load(std::memory_order_relaxed);
+        for (const auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mu);
+            s.size += shard.lru.size();
+        }
+        return s;
+    }
+
+    void Clear() {
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mu);
+            shard.index.clear();
+            shard.lru.clear();
+        }
+    }
+
+ private:
+    struct Built {
+        Built(const std::vector<Category>& cats, MatchPolicy policy)
+            : categories(cats), recognizer(categories, policy) {}
+        std::vector<Category> categories;
+        CategoryRecognizer recognizer;
+    };
+
+    struct Entry {
+        uint64_t key;
+        std::shared_ptr<const Built> built;
+    };
+
+    struct Shard {
+        mutable std::mutex mu;
+        std::size_t capacity = 1;
+        std::list<Entry> lru;  // 头部最近使用
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    };
+
+    static std::shared_ptr<const CategoryRecognizer> Alias(const std::shared_ptr<const Built>& built) {
+        return std::shared_ptr<const CategoryRecognizer>(built, &built->recognizer);
+    }
+
+    std::vector<Shard> shards_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
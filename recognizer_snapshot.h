@@ -0,0 +1,319 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "category_recognizer.h"
+#include "durable_file.h"
+#include "mapped_file.h"
+
+// ===================== 组件B：识别器二进制快照 =====================
+// 把编译好的 CategoryRecognizer 存成一块二进制，冷启动时 mmap 后直接使用，
+// 不再从 std::vector<Category> 重建自动机。
+//
+// 格式（版本 3）：64 字节头部，随后各表按 64 字节对齐依次排列，
+//   byte_class | 预过滤位图 | Teddy 表 | 转移表 | 状态输出 | 关键词 id / 长度 / 优先级
+// 各表位置只由头部里的计数决定，块内没有指针，可以放在任意地址（要求 8 字节对齐，
+// mmap 与堆内存天然满足）。整数按写出机器的字节序存放，字节序不同的机器拒绝加载。
+// 校验和覆盖整个快照（含头部，checksum 字段本身按 0 计；版本 3 起，此前只覆盖头部之后）。
+//
+// 加载时转移表、状态输出、关键词表直接指向快照内存；只有 256 项的字节类表和约 8KB 的
+// 预过滤表拷进识别器（热路径上按值访问），预过滤的 SIMD 级别按加载机器的 CPU 重新选择。
+constexpr uint32_t kRecognizerSnapshotVersion = 3;
+
+enum class SnapshotCheck {
+    kFull,    // 校验和 + 逐项范围检查，O(快照大小)；来源不可信时使用
+    kLayout,  // 只检查头部与布局，O(1)；表内容损坏会导致越界读，仅用于可信文件
+};
+
+namespace recognizer_snapshot_detail {
+
+constexpr char kMagic[8] = {'A', 'B', 'R', 'E', 'C', 'O', 'G', '\0'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr std::size_t kAlign = 64;
+
+struct Header {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t byte_order;
+    uint64_t total_size;
+    uint64_t checksum;  // 整个快照，本字段按 0 计，见 Checksum()
+    uint16_t policy;
+    uint16_t fallback_kind;  // 版本 2 起，见 FallbackKind
+    int32_t num_classes;
+    uint32_t num_states;
+    uint32_t num_keywords;
+    int32_t max_len;
+    int32_t max_priority;
+    int32_t fallback_id;
+    uint32_t prefilter_entries;
+};
+
+static_assert(sizeof(Header) == kAlign, "snapshot header must stay 64 bytes");
+constexpr std::size_t kChecksumOffset = offsetof(Header, checksum);
+static_assert(kChecksumOffset % 8 == 0, "checksum field must be one whole word");
+
+// 回退 id 的来源（决定计入哪个指标）；写入文件的取值固定，不随 MetricCounter 重排而变
+enum FallbackKind : uint16_t { kFallbackOther = 0, kFallbackFirst = 1, kNoCategories = 2 };
+
+inline uint16_t ToFallbackKind(MetricCounter c) {
+    if (c == MetricCounter::kFallbackOther) return kFallbackOther;
+    return c == MetricCounter::kFallbackFirst ? kFallbackFirst : kNoCategories;
+}
+
+inline MetricCounter FromFallbackKind(uint16_t kind) {
+    if (kind == kFallbackOther) return MetricCounter::kFallbackOther;
+    return kind == kFallbackFirst ? MetricCounter::kFallbackFirst : MetricCounter::kNoCategories;
+}
+
+// 各表相对快照起点的偏移
+struct Layout {
+    uint64_t byte_class;
+    uint64_t pairs;
+    uint64_t singles;
+    uint64_t teddy;  // lo1 | hi1 | lo2 | hi2，各 16 字节
+    uint64_t next;
+    uint64_t output;
+    uint64_t keyword_id;
+    uint64_t keyword_len;
+    uint64_t keyword_priority;
+    uint64_t total;
+};
+
+constexpr uint64_t AlignUp(uint64_t n) { return (n + kAlign - 1) / kAlign * kAlign; }
+
+// 调用方保证计数有界（状态、关键词 < 2^31，字节类 <= 257），乘积不会溢出
+inline Layout ComputeLayout(uint64_t num_states, uint64_t num_classes, uint64_t num_keywords) {
+    Layout l{};
+    uint64_t at = sizeof(Header);
+    auto take = [&at](uint64_t bytes) {
+        const uint64_t offset = at;
+        at = AlignUp(at + bytes);
+        return offset;
+    };
+    l.byte_class = take(256 * sizeof(uint16_t));
+    l.pairs = take(1024 * sizeof(uint64_t));
+    l.singles = take(4 * sizeof(uint64_t));
+    l.teddy = take(64);
+    l.next = take(num_states * num_classes * sizeof(int32_t));
+    l.output = take(num_states * sizeof(uint32_t));
+    l.keyword_id = take(num_keywords * sizeof(int32_t));
+    l.keyword_len = take(num_keywords * sizeof(int32_t));
+    l.keyword_priority = take(num_keywords * sizeof(int32_t));
+    l.total = at;
+    return l;
+}
+
+// 按 8 字节字做 FNV 式混合，4 路独立累加避免乘法链串行；快照长度恒为 64 的倍数。
+// p 指向快照起点，头部里的 checksum 字段按 0 计，写入前后算出的值相同
+inline uint64_t Checksum(const char* p, std::size_t n) {
+    uint64_t h[4] = {0xcbf29ce484222325ull, 0x84222325cbf29ce4ull, 0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full};
+    for (std::size_t i = 0; i + 32 <= n; i += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t w;
+            std::memcpy(&w, p + i + lane * 8, 8);
+            if (i + lane * 8 == kChecksumOffset) w = 0;
+            h[lane] = (h[lane] ^ w) * 0x100000001b3ull;
+            h[lane] ^= h[lane] >> 29;
+        }
+    }
+    uint64_t out = n;
+    for (uint64_t lane : h) out = (out ^ lane) * 0x100000001b3ull;
+    return out ^ (out >> 31);
+}
+
+inline bool Fail(const char* message, std::string* error) {
+    if (error != nullptr) *error = message;
+    return false;
+}
+
+}  // namespace recognizer_snapshot_detail
+
+// CategoryRecognizer / KeywordPrefilter 的友元，负责表与快照之间的读写
+class RecognizerSnapshotCodec {
+ public:
+    static std::string Save(const CategoryRecognizer& cr) {
+        namespace d = recognizer_snapshot_detail;
+        const d::Layout l = d::ComputeLayout(cr.num_states_, static_cast<uint64_t>(cr.num_classes_),
+                                             cr.num_keywords_);
+        std::string blob(static_cast<std::size_t>(l.total), '\0');
+        char* base = &blob[0];
+
+        d::Header h{};
+        std::memcpy(h.magic, d::kMagic, sizeof(h.magic));
+        h.format_version = kRecognizerSnapshotVersion;
+        h.byte_order = d::kByteOrderMark;
+        h.total_size = l.total;
+        h.policy = static_cast<uint16_t>(cr.policy_);
+        h.fallback_kind = d::ToFallbackKind(cr.fallback_metric_);
+        h.num_classes = cr.num_classes_;
+        h.num_states = static_cast<uint32_t>(cr.num_states_);
+        h.num_keywords = static_cast<uint32_t>(cr.num_keywords_);
+        h.max_len = cr.max_len_;
+        h.max_priority = cr.max_priority_;
+        h.fallback_id = cr.fallback_id_;
+
+        const KeywordPrefilter& pf = cr.prefilter_;
+        h.prefilter_entries = pf.num_entries_;
+        std::memcpy(base + l.byte_class, cr.byte_class_.data(), sizeof(cr.byte_class_));
+        std::memcpy(base + l.pairs, pf.pairs_.data(), sizeof(pf.pairs_));
+        std::memcpy(base + l.singles, pf.singles_.data(), sizeof(pf.singles_));
+        std::memcpy(base + l.teddy, pf.lo1_.data(), 16);
+        std::memcpy(base + l.teddy + 16, pf.hi1_.data(), 16);
+        std::memcpy(base + l.teddy + 32, pf.lo2_.data(), 16);
+        std::memcpy(base + l.teddy + 48, pf.hi2_.data(), 16);
+        const std::size_t k = cr.num_keywords_;
+        std::memcpy(base + l.next, cr.next_, cr.num_states_ * static_cast<std::size_t>(cr.num_classes_) * 4);
+        std::memcpy(base + l.output, cr.output_, cr.num_states_ * 4);
+        if (k != 0) {
+            std::memcpy(base + l.keyword_id, cr.keyword_id_, k * 4);
+            std::memcpy(base + l.keyword_len, cr.keyword_len_, k * 4);
+            std::memcpy(base + l.keyword_priority, cr.keyword_priority_, k * 4);
+        }
+
+        std::memcpy(base, &h, sizeof(h));
+        h.checksum = d::Checksum(base, blob.size());
+        std::memcpy(base + d::kChecksumOffset, &h.checksum, sizeof(h.checksum));
+        return blob;
+    }
+
+    // 返回的识别器引用 blob 内存：blob 须在 owner 或调用方的管理下保持有效
+    static std::shared_ptr<const CategoryRecognizer> Load(std::string_view blob, std::shared_ptr<const void> owner,
+                                                          SnapshotCheck check, std::string* error) {
+        namespace d = recognizer_snapshot_detail;
+        if (blob.size() < sizeof(d::Header)) return Reject("snapshot truncated", error);
+        if (reinterpret_cast<uintptr_t>(blob.data()) % 8 != 0) return Reject("snapshot not 8-byte aligned", error);
+        d::Header h;
+        std::memcpy(&h, blob.data(), sizeof(h));
+        if (std::memcmp(h.magic, d::kMagic, sizeof(h.magic)) != 0) return Reject("not a recognizer snapshot", error);
+        if (h.format_version != kRecognizerSnapshotVersion) return Reject("unsupported snapshot version", error);
+        if (h.byte_order != d::kByteOrderMark) return Reject("snapshot byte order mismatch", error);
+        if (h.total_size != blob.size()) return Reject("snapshot size mismatch", error);
+        if (h.policy > static_cast<uint16_t>(MatchPolicy::kPriority) || h.fallback_kind > d::kNoCategories ||
+            h.num_classes < 1 || h.num_classes > 257 || h.num_states < 1 || h.num_states > INT32_MAX ||
+            h.num_keywords > INT32_MAX) {
+            return Reject("snapshot header corrupt", error);
+        }
+        const d::Layout l = d::ComputeLayout(h.num_states, static_cast<uint64_t>(h.num_classes), h.num_keywords);
+        if (l.total != h.total_size) return Reject("snapshot layout mismatch", error);
+
+        const char* base = blob.data();
+        if (check == SnapshotCheck::kFull) {
+            if (d::Checksum(base, blob.size()) != h.checksum) {
+                return Reject("snapshot checksum mismatch", error);
+            }
+        }
+
+        std::shared_ptr<CategoryRecognizer> cr(new CategoryRecognizer());
+        cr->policy_ = static_cast<MatchPolicy>(h.policy);
+        cr->num_classes_ = h.num_classes;
+        cr->num_states_ = h.num_states;
+        cr->num_keywords_ = h.num_keywords;
+        cr->max_len_ = h.max_len;
+        cr->max_priority_ = h.max_priority;
+        cr->fallback_id_ = h.fallback_id;
+        cr->fallback_metric_ = d::FromFallbackKind(h.fallback_kind);
+        // kLayout 不验证校验和，策略与回退 id 另行混入，头部被改过的快照不会与原快照共用指纹
+        cr->fingerprint_ = CategoryRecognizer::MixFingerprint(
+            CategoryRecognizer::MixFingerprint(h.checksum, h.policy), static_cast<uint64_t>(h.fallback_id));
+        std::memcpy(cr->byte_class_.data(), base + l.byte_class, sizeof(cr->byte_class_));
+        cr->next_ = reinterpret_cast<const int32_t*>(base + l.next);
+        cr->output_ = reinterpret_cast<const uint32_t*>(base + l.output);
+        cr->keyword_id_ = reinterpret_cast<const int32_t*>(base + l.keyword_id);
+        cr->keyword_len_ = reinterpret_cast<const int32_t*>(base + l.keyword_len);
+        cr->keyword_priority_ = reinterpret_cast<const int32_t*>(base + l.keyword_priority);
+        cr->owner_ = std::move(owner);
+
+        KeywordPrefilter& pf = cr->prefilter_;
+        std::memcpy(pf.pairs_.data(), base + l.pairs, sizeof(pf.pairs_));
+        std::memcpy(pf.singles_.data(), base + l.singles, sizeof(pf.singles_));
+        std::memcpy(pf.lo1_.data(), base + l.teddy, 16);
+        std::memcpy(pf.hi1_.data(), base + l.teddy + 16, 16);
+        std::memcpy(pf.lo2_.data(), base + l.teddy + 32, 16);
+        std::memcpy(pf.hi2_.data(), base + l.teddy + 48, 16);
+        pf.num_entries_ = h.prefilter_entries;
+        pf.level_ = pf.num_entries_ <= KeywordPrefilter::kMaxSimdEntries ? ActiveSimdLevel() : SimdLevel::kScalar;
+
+        if (check == SnapshotCheck::kFull) {
+            if (!TablesInRange(*cr)) return Reject("snapshot tables corrupt", error);
+            if (!BoundsMatchKeywords(*cr)) return Reject("snapshot header corrupt", error);
+        }
+        return cr;
+    }
+
+ private:
+    static std::shared_ptr<const CategoryRecognizer> Reject(const char* message, std::string* error) {
+        recognizer_snapshot_detail::Fail(message, error);
+        return nullptr;
+    }
+
+    // 校验和只防意外损坏；这里保证扫描时每次下标都落在表内
+    static bool TablesInRange(const CategoryRecognizer& cr) {
+        for (uint16_t c : cr.byte_class_) {
+            if (c >= cr.num_classes_) return false;
+        }
+        const std::size_t cells = cr.num_states_ * static_cast<std::size_t>(cr.num_classes_);
+        for (std::size_t i = 0; i < cells; ++i) {
+            if (cr.next_[i] < 0 || static_cast<std::size_t>(cr.next_[i]) >= cr.num_states_) return false;
+        }
+        for (std::size_t s = 0; s < cr.num_states_; ++s) {
+            if (cr.output_[s] != CategoryRecognizer::kNoMatch && cr.output_[s] >= cr.num_keywords_) return false;
+        }
+        return true;
+    }
+
+    // max_len / max_priority 决定扫描的提前退出，须与关键词表按构建时的规则算出的一致
+    static bool BoundsMatchKeywords(const CategoryRecognizer& cr) {
+        int max_len = 0;
+        int max_priority = 0;
+        for (std::size_t kw = 0; kw < cr.num_keywords_; ++kw) {
+            if (kw == 0 || cr.keyword_len_[kw] > max_len) max_len = cr.keyword_len_[kw];
+            if (kw == 0 || cr.keyword_priority_[kw] > max_priority) max_priority = cr.keyword_priority_[kw];
+        }
+        return max_len == cr.max_len_ && max_priority == cr.max_priority_;
+    }
+};
+
+// 序列化为一块内存；带叠加层的识别器（cr.layered()）返回空串
+inline std::string SaveRecognizerSnapshot(const CategoryRecognizer& cr) {
+    return cr.layered() ? std::string() : RecognizerSnapshotCodec::Save(cr);
+}
+
+// 经 ReplaceFileDurably 整体替换：正在 mmap 旧快照的进程不受影响，不会读到写了一半
+// 的文件，返回 true 后掉电也不丢
+inline bool SaveRecognizerSnapshot(const CategoryRecognizer& cr, const std::string& path, std::string* error) {
+    if (cr.layered()) return recognizer_snapshot_detail::Fail("layered recognizer cannot be saved", error);
+    return ReplaceFileDurably(path, RecognizerSnapshotCodec::Save(cr), error);
+}
+
+// 就地使用 blob：调用方须保证 blob 比返回的识别器（及其拷贝）活得久。失败返回 nullptr
+inline std::shared_ptr<const CategoryRecognizer> LoadRecognizerSnapshot(std::string_view blob,
+                                                                        std::string* error = nullptr,
+                                                                        SnapshotCheck check = SnapshotCheck::kFull) {
+    return RecognizerSnapshotCodec::Load(blob, nullptr, check, error);
+}
+
+// 接管临时 blob（如 LoadRecognizerSnapshot(SaveRecognizerSnapshot(cr))），随识别器一起释放；
+// 否则临时串在语句结束时即被释放，识别器读到的是悬空内存
+inline std::shared_ptr<const CategoryRecognizer> LoadRecognizerSnapshot(std::string&& blob,
+                                                                        std::string* error = nullptr,
+                                                                        SnapshotCheck check = SnapshotCheck::kFull) {
+    auto owned = std::make_shared<const std::string>(std::move(blob));
+    const std::string_view view = *owned;
+    return RecognizerSnapshotCodec::Load(view, std::move(owned), check, error);
+}
+
+// mmap 快照文件并就地使用；映射随最后一个引用它的识别器一起释放
+inline std::shared_ptr<const CategoryRecognizer> MapRecognizerSnapshot(const std::string& path,
+                                                                       std::string* error = nullptr,
+                                                                       SnapshotCheck check = SnapshotCheck::kFull) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(path, error, MapAccess::kRandom)) return nullptr;
+    const std::string_view blob = file->view();
+    return RecognizerSnapshotCodec::Load(blob, std::move(file), check, error);
+}
@@ -0,0 +1,349 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "ledger_aggregate.h"
+#include "simd_support.h"
+#include "transaction.h"
+
+// ===================== 存储：分片追加账本 =====================
+// 多个分类线程并发写入、报表查询同时读取的内存账本。每个写者独占一个分片，
+// 分片是只追加的分段数组：写者先在已分配好的槽位上构造新行，再以 release
+// 语义发布长度；读者以 acquire 读长度，此前的行都已构造完成且此后不再改变。
+// 写入路径上没有任何锁，也没有跨写者共享的缓存行；只有领取、归还写者时
+// 才加锁。
+//
+// 分段按 1024、2048、4096…… 行几何增长，已发布的行从不搬移，所以读者
+// 拿到的引用一直有效，直到账本析构。View() 记下各分片当时的已发布长度，
+// 得到每个分片的一致前缀（不同分片之间没有全局先后）；ByDate() 在视图上
+// 做 k 路归并，按日期非降序输出。
+namespace sharded_ledger_detail {
+
+constexpr std::size_t kFirstSegmentRows = 1024;
+constexpr std::size_t kMaxSegments = 40;  // 单分片上限约 1024 × 2^40 行，实际不会触及
+
+static_assert((kFirstSegmentRows & (kFirstSegmentRows - 1)) == 0, "segment size must be a power of two");
+
+// 分片内第 row 行位于第 segment 段的第 offset 个槽位
+inline void LocateRow(std::size_t row, std::size_t& segment, std::size_t& offset) {
+    const std::size_t block = row / kFirstSegmentRows + 1;
+    segment = HighestSetBit(block);
+    offset = row - kFirstSegmentRows * ((std::size_t(1) << segment) - 1);
+}
+
+inline std::size_t SegmentRows(std::size_t segment) { return kFirstSegmentRows << segment; }
+
+// 单写者、多读者的只追加分段数组
+class Shard {
+ public:
+    Shard() = default;
+
+    ~Shard() {
+        const std::size_t n = size_.load(std::memory_order_relaxed);
+        for (std::size_t s = 0; s < kMaxSegments; ++s) {
+            ProcessedTransaction* seg = segments_[s].load(std::memory_order_relaxed);
+            if (seg == nullptr) break;
+            const std::size_t first = kFirstSegmentRows * ((std::size_t(1) << s) - 1);
+            const std::size_t live = n > first ? std::min(n - first, SegmentRows(s)) : 0;
+            for (std::size_t i = 0; i < live; ++i) seg[i].~ProcessedTransaction();
+            ::operator delete(seg);
+        }
+    }
+
+    Shard(const Shard&) = delete;
+    Shard& operator=(const Shard&) = delete;
+
+    // 以下两个写接口只能由持有本分片的写者调用
+    template <typename Row>
+    void Construct(std::size_t row, Row&& value) {
+        std::size_t segment = 0;
+        std::size_t offset = 0;
+        LocateRow(row, segment, offset);
+        ProcessedTransaction* seg = segments_[segment].load(std::memory_order_relaxed);
+        if (seg == nullptr) {
+            seg = static_cast<ProcessedTransaction*>(
+                ::operator new(SegmentRows(segment) * sizeof(ProcessedTransaction)));
+            segments_[segment].store(seg, std::memory_order_relaxed);  // 随后的 Publish 一并发布
+        }
+        new (seg + offset) ProcessedTransaction(std::forward<Row>(value));
+    }
+
+    void Publish(std::size_t size) { size_.store(size, std::memory_order_release); }
+
+    std::size_t unpublished_size() const { return size_.load(std::memory_order_relaxed); }
+    std::size_t published() const { return size_.load(std::memory_order_acquire); }
+
+    // row 须小于此前某次 published() 的返回值
+    const ProcessedTransaction& At(std::size_t row) const {
+        std::size_t segment = 0;
+        std::size_t offset = 0;
+        LocateRow(row, segment, offset);
+        return segments_[segment].load(std::memory_order_relaxed)[offset];
+    }
+
+ private:
+    std::atomic<ProcessedTransaction*> segments_[kMaxSegments] = {};
+    alignas(64) std::atomic<std::size_t> size_{0};  // 与其他分片的长度不共享缓存行
+};
+
+}  // namespace sharded_ledger_detail
+
+class ShardedLedger;
+
+// 某一时刻各分片已发布前缀的只读视图；引用的行在账本析构前一直有效
+class LedgerView {
+ public:
+    std::size_t size() const { return total_; }
+    bool empty() const { return total_ == 0; }
+
+    // 按分片、分片内追加顺序访问每一行
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (const Part& p : parts_) {
+            for (std::size_t i = 0; i < p.rows; ++i) fn(p.shard->At(i));
+        }
+    }
+
+    class DateOrderedCursor;
+
+    // 按日期非降序归并 range 内的行；同日的行按分片、分片内追加顺序输出。
+    // 日期无效的行打包值为 0，不限区间时排在最前。
+    DateOrderedCursor ByDate(DateRange range = DateRange()) const;
+
+ private:
+    friend class ShardedLedger;
+
+    struct Part {
+        const sharded_ledger_detail::Shard* shard;
+        std::size_t rows;
+    };
+
+    std::vector<Part> parts_;
+    std::size_t total_ = 0;
+};
+
+// 构造时为每个分片准备好有序的行序列：分片内本就按日期追加（常见的按时间
+// 导入）时直接二分出区间，否则筛出区间内的行号再稳定排序。之后每次 Next()
+// 是一次 O(log 分片数) 的堆操作。
+class LedgerView::DateOrderedCursor {
+ public:
+    // 返回下一行，读完后返回 nullptr
+    const ProcessedTransaction* Next() {
+        if (heap_.empty()) return nullptr;
+        std::pop_heap(heap_.begin(), heap_.end(), Later);
+        Head& h = heap_.back();
+        Source& s = sources_[h.source];
+        const ProcessedTransaction* row = &s.shard->At(s.Row(h.pos));
+        if (++h.pos < s.Size()) {
+            h.date = s.shard->At(s.Row(h.pos)).date.value();
+            std::push_heap(heap_.begin(), heap_.end(), Later);
+        } else {
+            heap_.pop_back();
+        }
+        return row;
+    }
+
+ private:
+    friend class LedgerView;
+
+    // 分片内的有序行：order 为空时是连续区间 [begin, end)，否则按 order 取行号
+    struct Source {
+        const sharded_ledger_detail::Shard* shard;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::vector<std::size_t> order;
+
+        std::size_t Size() const { return order.empty() ? end - begin : order.size(); }
+        std::size_t Row(std::size_t pos) const { return order.empty() ? begin + pos : order[pos]; }
+    };
+
+    struct Head {
+        uint32_t date;
+        std::size_t source;
+        std::size_t pos;
+    };
+
+    // 小顶堆：日期小的先出，同日按分片顺序
+    static bool Later(const Head& a, const Head& b) {
+        return a.date != b.date ? a.date > b.date : a.source > b.source;
+    }
+
+    DateOrderedCursor(const std::vector<Part>& parts, DateRange range) {
+        sources_.reserve(parts.size());
+        for (const Part& p : parts) {
+            Source s;
+            s.shard = p.shard;
+            const auto date_at = [&](std::size_t i) { return p.shard->At(i).date.value(); };
+            bool sorted = true;
+            for (std::size_t i = 1; i < p.rows && sorted; ++i) sorted = date_at(i - 1) <= date_at(i);
+            if (sorted) {
+                std::size_t lo = 0;
+                std::size_t hi = p.rows;
+                while (lo < hi) {
+                    const std::size_t mid = lo + (hi - lo) / 2;
+                    if (date_at(mid) < range.from) lo = mid + 1; else hi = mid;
+                }
+                s.begin = lo;
+                hi = p.rows;
+                while (lo < hi) {
+                    const std::size_t mid = lo + (hi - lo) / 2;
+                    if (date_at(mid) <= range.to) lo = mid + 1; else hi = mid;
+                }
+                s.end = lo;
+            } else {
+                for (std::size_t i = 0; i < p.rows; ++i) {
+                    if (range.Contains(date_at(i))) s.order.push_back(i);
+                }
+                std::stable_sort(s.order.begin(), s.order.end(),
+                                 [&](std::size_t a, std::size_t b) { return date_at(a) < date_at(b); });
+            }
+            if (s.Size() == 0) continue;
+            heap_.push_back(Head{date_at(s.Row(0)), sources_.size(), 0});
+            sources_.push_back(std::move(s));
+        }
+        std::make_heap(heap_.begin(), heap_.end(), Later);
+    }
+
+    std::vector<Source> sources_;
+    std::vector<Head> heap_;
+};
+
+inline LedgerView::DateOrderedCursor LedgerView::ByDate(DateRange range) const {
+    return DateOrderedCursor(parts_, range);
+}
+
+class ShardedLedger {
+ public:
+    // 某一时刻独占一个分片的追加句柄；只能在一个线程里使用，须先于账本析构
+    class Writer {
+     public:
+        Writer() = default;
+        Writer(Writer&& other) noexcept
+            : ledger_(std::exchange(other.ledger_, nullptr)), shard_(other.shard_), size_(other.size_),
+              index_(other.index_) {}
+        Writer& operator=(Writer&& other) noexcept {
+            if (this != &other) {
+                Release();
+                ledger_ = std::exchange(other.ledger_, nullptr);
+                shard_ = other.shard_;
+                size_ = other.size_;
+                index_ = other.index_;
+            }
+            return *this;
+        }
+        ~Writer() { Release(); }
+
+        bool valid() const { return ledger_ != nullptr; }
+
+        void Append(const ProcessedTransaction& row) {
+            shard_->Construct(size_, row);
+            shard_->Publish(++size_);
+        }
+
+        void Append(ProcessedTransaction&& row) {
+            shard_->Construct(size_, std::move(row));
+            shard_->Publish(++size_);
+        }
+
+        // 整批构造完后只发布一次
+        void Append(const ProcessedTransaction* rows, std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) shard_->Construct(size_ + i, rows[i]);
+            size_ += count;
+            shard_->Publish(size_);
+        }
+
+     private:
+        friend class ShardedLedger;
+
+        Writer(ShardedLedger* ledger, std::size_t shard)
+            : ledger_(ledger), shard_(ledger->shards_[shard].load(std::memory_order_relaxed)),
+              size_(shard_->unpublished_size()), index_(shard) {}
+
+        void Release() {
+            if (ledger_ != nullptr) std::exchange(ledger_, nullptr)->ReleaseShard(index_);
+        }
+
+        ShardedLedger* ledger_ = nullptr;
+        sharded_ledger_detail::Shard* shard_ = nullptr;
+        std::size_t size_ = 0;
+        std::size_t index_ = 0;
+    };
+
+    // 最多 max_shards 个写者同时存在
+    explicit ShardedLedger(std::size_t max_shards = 64)
+        : max_shards_(std::max<std::size_t>(1, max_shards)),
+          shards_(new std::atomic<sharded_ledger_detail::Shard*>[max_shards_]) {
+        for (std::size_t i = 0; i < max_shards_; ++i) shards_[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~ShardedLedger() {
+        for (std::size_t i = 0; i < num_shards_.load(std::memory_order_relaxed); ++i) {
+            delete shards_[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    ShardedLedger(const ShardedLedger&) = delete;
+    ShardedLedger& operator=(const ShardedLedger&) = delete;
+
+    // 优先复用已归还的分片，否则新建；max_shards 个写者都在用时阻塞到有写者归还。
+    // 同一线程不要在持有写者时再次领取，以免自己等自己。
+    Writer AcquireWriter() {
+        std::unique_lock<std::mutex> lock(mu_);
+        released_.wait(lock, [this] {
+            return !free_.empty() || num_shards_.load(std::memory_order_relaxed) < max_shards_;
+        });
+        std::size_t index = 0;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        } else {
+            index = num_shards_.load(std::memory_order_relaxed);
+            shards_[index].store(new sharded_ledger_detail::Shard(), std::memory_order_relaxed);
+            num_shards_.store(index + 1, std::memory_order_release);
+        }
+        return Writer(this, index);
+    }
+
+    LedgerView View() const {
+        LedgerView view;
+        const std::size_t n = num_shards_.load(std::memory_order_acquire);
+        view.parts_.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const sharded_ledger_detail::Shard* shard = shards_[i].load(std::memory_order_relaxed);
+            const std::size_t rows = shard->published();
+            if (rows == 0) continue;
+            view.parts_.push_back(LedgerView::Part{shard, rows});
+            view.total_ += rows;
+        }
+        return view;
+    }
+
+    std::size_t size() const { return View().size(); }
+    std::size_t num_shards() const { return num_shards_.load(std::memory_order_acquire); }
+
+ private:
+    void ReleaseShard(std::size_t index) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            free_.push_back(index);
+        }
+        released_.notify_one();
+    }
+
+    const std::size_t max_shards_;
+    const std::unique_ptr<std::atomic<sharded_ledger_detail::Shard*>[]> shards_;
+    std::atomic<std::size_t> num_shards_{0};
+
+    std::mutex mu_;
+    std::condition_variable released_;
+    std::vector<std::size_t> free_;
+};
@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include <cstdint>
+
+// ===================== 公共：SIMD 指令集检测与运行时分派 =====================
+// 编译期基线：x86 上的 SSE2（x86-64 必有）与 AArch64 NEON。
+// 更高的 x86 指令集（SSSE3、AVX2）不要求编译选项：相关函数用 ACCOUNT_BOOK_TARGET
+// 单独按目标指令集编译，运行时按 ActiveSimdLevel() 分派，同一个二进制在旧 CPU 上仍可运行。
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ACCOUNT_BOOK_HAVE_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ACCOUNT_BOOK_HAVE_NEON 1
+#endif
+
+#if defined(ACCOUNT_BOOK_HAVE_SSE2)
+#include <immintrin.h>
+#define ACCOUNT_BOOK_HAVE_X86_DISPATCH 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define ACCOUNT_BOOK_TARGET(isa)
+#else
+#define ACCOUNT_BOOK_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+// 由低到高排列；kNeon 只在 AArch64 上出现
+enum class SimdLevel { kScalar, kSsse3, kAvx2, kNeon };
+
+inline SimdLevel DetectSimdLevel() {
+#if defined(ACCOUNT_BOOK_HAVE_NEON)
+    return SimdLevel::kNeon;
+#elif defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    const bool ssse3 = (info[2] & (1 << 9)) != 0;
+    const bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                        (_xgetbv(0) & 6) == 6;  // OS 保存 YMM 寄存器
+    if (max_leaf >= 7 && os_avx) {
+        __cpuidex(info, 7, 0);
+        if ((info[1] & (1 << 5)) != 0) return SimdLevel::kAvx2;
+    }
+    return ssse3 ? SimdLevel::kSsse3 : SimdLevel::kScalar;
+#elif defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::kAvx2;
+    if (__builtin_cpu_supports("ssse3")) return SimdLevel::kSsse3;
+    return SimdLevel::kScalar;
+#else
+    return SimdLevel::kScalar;
+#endif
+}
+
+// 进程内只检测一次
+inline SimdLevel ActiveSimdLevel() {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+// mask 非 0
+inline unsigned CountTrailingZeros(uint64_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long bit = 0;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanForward64(&bit, mask);
+#else
+    if (!_BitScanForward(&bit, static_cast<unsigned long>(mask))) {
+        _BitScanForward(&bit, static_cast<unsigned long>(mask >> 32));
+        bit += 32;
+    }
+#endif
+    return static_cast<unsigned>(bit);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+// value 非 0；返回最高置位的位号
+inline unsigned HighestSetBit(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long bit = 0;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanReverse64(&bit, value);
+#else
+    if (_BitScanReverse(&bit, static_cast<unsigned long>(value >> 32))) {
+        bit += 32;
+    } else {
+        _BitScanReverse(&bit, static_cast<unsigned long>(value));
+    }
+#endif
+    return static_cast<unsigned>(bit);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+// 置位的位数
+inline unsigned PopCount(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    value = value - ((value >> 1) & 0x5555555555555555ull);
+    value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<unsigned>((value * 0x0101010101010101ull) >> 56);
+#else
+    return static_cast<unsigned>(__builtin_popcountll(value));
+#endif
+}
@@ -0,0 +1,179 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+// ===================== 组件B：编译期分类识别 =====================
+// 分类表在编译期已知时（例如固化在 POS 终端固件里的默认分类），
+// StaticCategoryRecognizer 在编译期就构建好与 CategoryRecognizer 相同的
+// Aho-Corasick DFA：运行时没有构造开销、不使用堆，“其他”回退 id 也是常量。
+// 匹配语义与 CategoryRecognizer 完全一致（字节序最小的命中名优先，
+// 同名取最后一个，回退“其他” → 第一个分类 → 0）。
+//
+// 用法：
+//   inline constexpr StaticCategory kTable[] = {{1, "餐饮"}, {5, "其他"}};
+//   using PosRecognizer = StaticCategoryRecognizer<kTable>;
+//   int id = PosRecognizer::RecognizeCategory(note);
+//
+// 转移表大小为 (名字总字节数 + 1) × (不同字节数 + 1)，适合几十个分类的小表；
+// 大表请用运行时的 CategoryRecognizer。
+struct StaticCategory {
+    int id;
+    std::string_view name;
+};
+
+namespace static_recognizer_detail {
+
+template <std::size_t N>
+constexpr std::size_t TotalNameBytes(const StaticCategory (&table)[N]) {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < N; ++i) total += table[i].name.size();
+    return total;
+}
+
+template <std::size_t N>
+constexpr std::size_t DistinctBytes(const StaticCategory (&table)[N]) {
+    bool seen[256] = {};
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+        for (char ch : table[i].name) {
+            const unsigned char b = static_cast<unsigned char>(ch);
+            if (!seen[b]) {
+                seen[b] = true;
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+template <std::size_t N>
+constexpr int FallbackId(const StaticCategory (&table)[N]) {
+    for (std::size_t i = 0; i < N; ++i) {
+        if (table[i].name == std::string_view("其他")) return table[i].id;
+    }
+    return N == 0 ? 0 : table[0].id;
+}
+
+template <std::size_t N, std::size_t States, std::size_t Classes>
+struct Automaton {
+    static constexpr uint32_t kNoMatch = UINT32_MAX;
+
+    std::array<uint16_t, 256> byte_class{};
+    std::array<int32_t, States * Classes> next{};
+    std::array<uint32_t, States> output{};
+    std::array<int, (N == 0 ? 1 : N)> rank_to_id{};
+    int fallback_id = 0;
+
+    constexpr int Match(std::string_view note) const {
+        int32_t state = 0;
+        uint32_t best = output[0];
+        for (std::size_t i = 0; i < note.size() && best != 0; ++i) {
+            state = next[static_cast<std::size_t>(state) * Classes +
+                         byte_class[static_cast<unsigned char>(note[i])]];
+            if (output[static_cast<std::size_t>(state)] < best) {
+                best = output[static_cast<std::size_t>(state)];
+            }
+        }
+        return best != kNoMatch ? rank_to_id[best] : fallback_id;
+    }
+};
+
+template <std::size_t States, std::size_t Classes, std::size_t N>
+constexpr Automaton<N, States, Classes> Build(const StaticCategory (&table)[N]) {
+    using A = Automaton<N, States, Classes>;
+    A a{};
+    a.fallback_id = FallbackId(table);
+
+    // 关键词按名字字节序排序（插入排序），同名只保留最后出现的 id
+    std::size_t order[N == 0 ? 1 : N] = {};
+    std::size_t unique = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+        std::size_t pos = 0;
+        while (pos < unique && table[order[pos]].name < table[i].name) ++pos;
+        if (pos < unique && table[order[pos]].name == table[i].name) {
+            order[pos] = i;
+            continue;
+        }
+        for (std::size_t k = unique; k > pos; --k) order[k] = order[k - 1];
+        order[pos] = i;
+        ++unique;
+    }
+
+    uint16_t next_class = 1;
+    for (std::size_t r = 0; r < unique; ++r) {
+        for (char ch : table[order[r]].name) {
+            const unsigned char b = static_cast<unsigned char>(ch);
+            if (a.byte_class[b] == 0) a.byte_class[b] = next_class++;
+        }
+    }
+
+    for (auto& t : a.next) t = -1;
+    for (auto& o : a.output) o = A::kNoMatch;
+    std::size_t num_states = 1;
+    for (std::size_t r = 0; r < unique; ++r) {
+        a.rank_to_id[r] = table[order[r]].id;
+        std::size_t state = 0;
+        for (char ch : table[order[r]].name) {
+            const std::size_t slot = state * Classes + a.byte_class[static_cast<unsigned char>(ch)];
+            if (a.next[slot] < 0) a.next[slot] = static_cast<int32_t>(num_states++);
+            state = static_cast<std::size_t>(a.next[slot]);
+        }
+        if (r < a.output[state]) a.output[state] = static_cast<uint32_t>(r);
+    }
+
+    // BFS：失败链接 + 补全 DFA + 沿失败链合并输出
+    std::array<int32_t, States> fail{};
+    std::array<int32_t, States> queue{};
+    std::size_t head = 0;
+    std::size_t tail = 0;
+    for (std::size_t c = 0; c < Classes; ++c) {
+        if (a.next[c] < 0) {
+            a.next[c] = 0;
+        } else {
+            fail[static_cast<std::size_t>(a.next[c])] = 0;
+            queue[tail++] = a.next[c];
+        }
+    }
+    while (head < tail) {
+        const std::size_t state = static_cast<std::size_t>(queue[head++]);
+        const std::size_t f = static_cast<std::size_t>(fail[state]);
+        if (a.output[f] < a.output[state]) a.output[state] = a.output[f];
+        for (std::size_t c = 0; c < Classes; ++c) {
+            int32_t& to = a.next[state * Classes + c];
+            if (to < 0) {
+                to = a.next[f * Classes + c];
+            } else {
+                fail[static_cast<std::size_t>(to)] = a.next[f * Classes + c];
+                queue[tail++] = to;
+            }
+        }
+    }
+    return a;
+}
+
+}  // namespace static_recognizer_detail
+
+template <const auto& Table>
+class StaticCategoryRecognizer {
+ public:
+    static constexpr std::size_t kNumCategories = std::size(Table);
+    static constexpr std::size_t kNumStates = static_recognizer_detail::TotalNameBytes(Table) + 1;
+    static constexpr std::size_t kNumClasses = static_recognizer_detail::DistinctBytes(Table) + 1;
+
+    // “其他”回退 id，编译期常量
+    static constexpr int kFallbackId = static_recognizer_detail::FallbackId(Table);
+
+    static constexpr int RecognizeCategory(std::string_view note) { return kAutomaton.Match(note); }
+
+    static constexpr int RecognizeCategory(const char* note, std::size_t len) {
+        return kAutomaton.Match(std::string_view(note, len));
+    }
+
+ private:
+    static constexpr auto kAutomaton =
+        static_recognizer_detail::Build<kNumStates, kNumClasses>(Table);
+};
@@ -0,0 +1,337 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "live_recognizer.h"
+#include "metrics.h"
+#include "micro_batch_classifier.h"
+#include "transaction.h"
+
+// ===================== 集成流程：实时流式分类 =====================
+// 实时刷卡流水的处理阶段：生产者 Push() 进有界无锁队列，若干分类线程并行
+// 取出、分类，结果按提交顺序交给一个 sink 线程回调。
+//
+// 每条请求在 Push 时领取一个序号，结果写入以序号取模的重排环：sink 线程只等
+// 下一个序号就绪，分类线程之间谁先谁后都不影响输出顺序。领序号时要求它落在
+// “已交付序号 + capacity”之内，所以排队、分类中、等待重排的请求合计不超过
+// capacity：sink 跟不上时窗口用满，Push 阻塞（TryPush 返回 false），背压一直
+// 传到生产者，内存不会随积压增长。
+//
+// 各阶段耗时（排队、分类、等待重排、sink 回调）始终计入 Stats()；以
+// ACCOUNT_BOOK_METRICS 编译时另记入对应的 MetricHistogram，随 Prometheus 输出。
+struct StreamOptions {
+    std::size_t workers = 2;      // 分类线程数，至少 1
+    std::size_t capacity = 1024;  // 在途请求上限（向上取 2 的幂）
+};
+
+// 某一阶段的累计耗时
+struct StageLatency {
+    uint64_t count = 0;
+    uint64_t total_nanos = 0;
+    uint64_t max_nanos = 0;
+
+    double MeanNanos() const { return count == 0 ? 0.0 : static_cast<double>(total_nanos) / count; }
+};
+
+struct StreamStats {
+    uint64_t submitted = 0;
+    uint64_t delivered = 0;
+    uint64_t rejected = 0;            // TryPush 因窗口已满而拒绝
+    uint64_t backpressure_waits = 0;  // Push 因窗口已满而阻塞
+    std::size_t queue_depth = 0;      // 输入队列中尚未被分类线程取走的请求（近似）
+    std::size_t in_flight = 0;        // 已提交、尚未交付
+    StageLatency queue_wait;          // Push → 分类线程取出
+    StageLatency classify;            // 分类本身
+    StageLatency reorder_wait;        // 分类完成 → 轮到它交付
+    StageLatency sink;                // sink 回调
+};
+
+namespace stream_classifier_detail {
+
+// 单写者的阶段计时，读者并发读取
+struct StageCounter {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_nanos{0};
+    std::atomic<uint64_t> max_nanos{0};
+
+    void Record(uint64_t nanos) {
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total_nanos.store(total_nanos.load(std::memory_order_relaxed) + nanos, std::memory_order_relaxed);
+        if (nanos > max_nanos.load(std::memory_order_relaxed)) max_nanos.store(nanos, std::memory_order_relaxed);
+    }
+
+    void AddTo(StageLatency& out) const {
+        out.count += count.load(std::memory_order_relaxed);
+        out.total_nanos += total_nanos.load(std::memory_order_relaxed);
+        const uint64_t m = max_nanos.load(std::memory_order_relaxed);
+        if (m > out.max_nanos) out.max_nanos = m;
+    }
+};
+
+// 每个分类线程一份，各占缓存行
+struct alignas(64) WorkerCounters {
+    StageCounter queue_wait;
+    StageCounter classify;
+};
+
+inline uint64_t Nanos(std::chrono::steady_clock::duration d) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+}  // namespace stream_classifier_detail
+
+class StreamClassifier {
+ public:
+    // 在 sink 线程上按序号顺序调用；抛出的异常被丢弃，不影响后续结果
+    using Sink = std::function<void(uint64_t sequence, ProcessedTransaction row)>;
+
+    StreamClassifier(std::shared_ptr<const CategoryRecognizer> recognizer, Sink sink,
+                     StreamOptions options = StreamOptions())
+        : options_(Normalize(options)), fixed_(std::move(recognizer)), sink_(std::move(sink)),
+          input_(options_.capacity), window_(input_.capacity()), slots_(new Slot[window_]),
+          workers_(options_.workers) {
+        Start();
+    }
+
+    // 分类线程定期取 live 的当前版本；live 须比本对象活得久
+    StreamClassifier(const LiveCategoryRecognizer& live, Sink sink, StreamOptions options = StreamOptions())
+        : options_(Normalize(options)), live_(&live), sink_(std::move(sink)), input_(options_.capacity),
+          window_(input_.capacity()), slots_(new Slot[window_]), workers_(options_.workers) {
+        Start();
+    }
+
+    // 交付所有已提交的请求后返回；析构时不得再有并发的 Push
+    ~StreamClassifier() {
+        Flush();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_.store(true);
+        }
+        work_.notify_all();
+        ready_.notify_one();
+        for (std::thread& t : threads_) t.join();
+    }
+
+    StreamClassifier(const StreamClassifier&) = delete;
+    StreamClassifier& operator=(const StreamClassifier&) = delete;
+
+    // 返回请求的序号（从 0 起，即交给 sink 的 sequence）。在途请求已达 capacity 时
+    // 阻塞到 sink 交付出空位
+    uint64_t Push(ClassifyRequest request) {
+        const uint64_t seq = admitted_.fetch_add(1);
+        if (seq >= delivered_.load(std::memory_order_acquire) + window_) {
+            backpressure_waits_.fetch_add(1, std::memory_order_relaxed);
+            WaitDelivered(seq + 1 - window_);
+        }
+        Enqueue(seq, std::move(request));
+        return seq;
+    }
+
+    // 不阻塞：窗口已满时返回 false，request 不被移走
+    bool TryPush(ClassifyRequest& request, uint64_t* sequence = nullptr) {
+        uint64_t seq = admitted_.load();
+        do {
+            if (seq >= delivered_.load(std::memory_order_acquire) + window_) {
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } while (!admitted_.compare_exchange_weak(seq, seq + 1));
+        Enqueue(seq, std::move(request));
+        if (sequence != nullptr) *sequence = seq;
+        return true;
+    }
+
+    // 阻塞到调用前提交的请求都已交给 sink（回调已返回）
+    void Flush() { WaitDelivered(admitted_.load()); }
+
+    StreamStats Stats() const {
+        StreamStats s;
+        s.submitted = admitted_.load(std::memory_order_relaxed);
+        s.delivered = delivered_.load(std::memory_order_relaxed);
+        s.rejected = rejected_.load(std::memory_order_relaxed);
+        s.backpressure_waits = backpressure_waits_.load(std::memory_order_relaxed);
+        s.queue_depth = input_.SizeApprox();
+        s.in_flight = static_cast<std::size_t>(s.submitted > s.delivered ? s.submitted - s.delivered : 0);
+        for (const auto& w : workers_) {
+            w.queue_wait.AddTo(s.queue_wait);
+            w.classify.AddTo(s.classify);
+        }
+        reorder_wait_.AddTo(s.reorder_wait);
+        sink_latency_.AddTo(s.sink);
+        return s;
+    }
+
+    const StreamOptions& options() const { return options_; }
+    std::size_t capacity() const { return window_; }
+
+ private:
+    using Clock = std::chrono::steady_clock;
+
+    // 每处理这么多条才重新取一次 live 的当前版本
+    static constexpr unsigned kSnapshotRefresh = 256;
+
+    struct Item {
+        uint64_t seq = 0;
+        ClassifyRequest request;
+        Clock::time_point enqueued;
+    };
+
+    // 重排环的一格；ready == seq + 1 表示序号 seq 的结果已写好。相邻格由不同线程写，各占缓存行
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> ready{0};
+        ProcessedTransaction row{};
+        Clock::time_point done;
+    };
+
+    static StreamOptions Normalize(StreamOptions options) {
+        if (options.workers == 0) options.workers = 1;
+        if (options.capacity == 0) options.capacity = 1;
+        return options;
+    }
+
+    void Start() {
+        for (std::size_t i = 0; i < options_.workers; ++i) threads_.emplace_back([this, i] { Work(workers_[i]); });
+        threads_.emplace_back([this] { Deliver(); });
+    }
+
+    // 序号已落在窗口内，输入队列不会真正满；短暂失败只是消费者还没写完出队的那一格
+    void Enqueue(uint64_t seq, ClassifyRequest&& request) {
+        Item item;
+        item.seq = seq;
+        item.request = std::move(request);
+        item.enqueued = Clock::now();
+        while (!input_.TryPush(std::move(item))) std::this_thread::yield();
+        if (idle_workers_.load() > 0) {
+            std::lock_guard<std::mutex> lock(mu_);
+            work_.notify_one();
+        }
+    }
+
+    // 生产者与 Flush 的等待：先登记 waiters_ 再检查，sink 推进 delivered_ 后检查 waiters_
+    void WaitDelivered(uint64_t count) {
+        if (delivered_.load(std::memory_order_acquire) >= count) return;
+        std::unique_lock<std::mutex> lock(mu_);
+        waiters_.fetch_add(1);
+        space_.wait(lock, [&] { return delivered_.load() >= count; });
+        waiters_.fetch_sub(1);
+    }
+
+    std::shared_ptr<const CategoryRecognizer> Current() const {
+        if (live_ == nullptr) return fixed_;
+        std::shared_ptr<const RecognizerSnapshot> snapshot = live_->Snapshot();
+        const CategoryRecognizer* cr = &snapshot->recognizer;
+        return std::shared_ptr<const CategoryRecognizer>(std::move(snapshot), cr);
+    }
+
+    void Work(stream_classifier_detail::WorkerCounters& counters) {
+        namespace d = stream_classifier_detail;
+        std::shared_ptr<const CategoryRecognizer> cr = Current();
+        unsigned until_refresh = kSnapshotRefresh;
+        Item item;
+        for (;;) {
+            if (!input_.TryPop(item)) {
+                std::unique_lock<std::mutex> lock(mu_);
+                idle_workers_.fetch_add(1);
+                work_.wait(lock, [&] { return stop_.load() || !input_.Empty(); });
+                idle_workers_.fetch_sub(1);
+                if (stop_.load() && input_.Empty()) return;
+                continue;
+            }
+            if (live_ != nullptr && --until_refresh == 0) {
+                cr = Current();
+                until_refresh = kSnapshotRefresh;
+            }
+
+            const Clock::time_point picked = Clock::now();
+            const TransactionInput in{item.request.note, item.request.date, item.request.amount};
+            Slot& slot = slots_[item.seq & (window_ - 1)];
+            ProcessTransactionInto(*cr, in, in.date.empty() ? GetCurrentPackedDate() : PackedDate(), slot.row,
+                                   NoteCopy::kSkip);
+            slot.row.note = std::move(item.request.note);
+            slot.done = Clock::now();
+            const uint64_t waited = d::Nanos(picked - item.enqueued);
+            const uint64_t classified = d::Nanos(slot.done - picked);
+            counters.queue_wait.Record(waited);
+            counters.classify.Record(classified);
+            RecordLatency(MetricHistogram::kStreamQueueWait, waited);
+            slot.ready.store(item.seq + 1);  // 与 sink_sleeping_ 的检查不可重排，须顺序一致
+            if (sink_sleeping_.load()) {
+                std::lock_guard<std::mutex> lock(mu_);
+                ready_.notify_one();
+            }
+        }
+    }
+
+    void Deliver() {
+        namespace d = stream_classifier_detail;
+        uint64_t next = 0;
+        for (;;) {
+            Slot& slot = slots_[next & (window_ - 1)];
+            if (slot.ready.load(std::memory_order_acquire) != next + 1) {
+                std::unique_lock<std::mutex> lock(mu_);
+                sink_sleeping_.store(true);
+                ready_.wait(lock, [&] { return stop_.load() || slot.ready.load() == next + 1; });
+                sink_sleeping_.store(false);
+                if (slot.ready.load(std::memory_order_acquire) != next + 1) return;  // 已停止且全部交付
+            }
+
+            const Clock::time_point start = Clock::now();
+            const uint64_t reordered = d::Nanos(start - slot.done);
+            try {
+                if (sink_) sink_(next, std::move(slot.row));
+            } catch (...) {
+            }
+            const uint64_t sunk = d::Nanos(Clock::now() - start);
+            reorder_wait_.Record(reordered);
+            sink_latency_.Record(sunk);
+            RecordLatency(MetricHistogram::kStreamReorderWait, reordered);
+            RecordLatency(MetricHistogram::kStreamSink, sunk);
+
+            delivered_.store(++next);
+            if (waiters_.load() > 0) {
+                std::lock_guard<std::mutex> lock(mu_);
+                space_.notify_all();
+            }
+        }
+    }
+
+    const StreamOptions options_;
+    const std::shared_ptr<const CategoryRecognizer> fixed_;
+    const LiveCategoryRecognizer* const live_ = nullptr;
+    const Sink sink_;
+
+    BoundedQueue<Item> input_;
+    const std::size_t window_;  // = input_.capacity()
+    const std::unique_ptr<Slot[]> slots_;
+
+    alignas(64) std::atomic<uint64_t> admitted_{0};   // 下一个可领的序号
+    alignas(64) std::atomic<uint64_t> delivered_{0};  // 已交付的条数（= sink 下一个要等的序号）
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> backpressure_waits_{0};
+
+    std::vector<stream_classifier_detail::WorkerCounters> workers_;
+    stream_classifier_detail::StageCounter reorder_wait_;  // 仅 sink 线程写
+    stream_classifier_detail::StageCounter sink_latency_;
+
+    // 只保护休眠与唤醒：分类线程等输入，sink 线程等下一格，生产者 / Flush 等交付
+    std::mutex mu_;
+    std::condition_variable work_;
+    std::condition_variable ready_;
+    std::condition_variable space_;
+    std::atomic<int> idle_workers_{0};
+    std::atomic<bool> sink_sleeping_{false};
+    std::atomic<int> waiters_{0};
+    std::atomic<bool> stop_{false};
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,163 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ===================== 并行执行：工作窃取线程池 =====================
+// 每个参与者（调用线程 + 后台工作线程）拥有一个任务双端队列：自己从队头取，
+// 空了就从其他队列的队尾窃取。ParallelFor 按连续区间预分配任务，所以
+// 负载均匀时几乎不发生窃取，不均匀时由窃取兜底。
+class WorkStealingPool {
+ public:
+    // threads 为参与计算的总线程数（含调用线程）；0 表示 hardware_concurrency
+    explicit WorkStealingPool(std::size_t threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        queues_.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) queues_.push_back(std::make_unique<TaskQueue>());
+        workers_.reserve(threads - 1);
+        for (std::size_t i = 1; i < threads; ++i) {
+            workers_.emplace_back([this, i] { WorkerLoop(i); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    std::size_t size() const { return queues_.size(); }
+
+    // 对 [0, tasks) 的每个下标调用一次 fn，阻塞直到全部完成。
+    // fn 抛出的第一个异常会在调用线程中重新抛出。同一时刻只允许一个 ParallelFor。
+    void ParallelFor(std::size_t tasks, const std::function<void(std::size_t)>& fn) {
+        if (tasks == 0) return;
+        if (queues_.size() == 1 || tasks == 1) {
+            for (std::size_t i = 0; i < tasks; ++i) fn(i);
+            return;
+        }
+
+        std::lock_guard<std::mutex> run_lock(run_mu_);
+        const std::size_t n = queues_.size();
+        for (std::size_t q = 0; q < n; ++q) {
+            std::lock_guard<std::mutex> lock(queues_[q]->mu);
+            for (std::size_t i = tasks * q / n; i < tasks * (q + 1) / n; ++i) {
+                queues_[q]->tasks.push_back(i);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            job_ = &fn;
+            remaining_.store(tasks, std::memory_order_relaxed);
+            error_ = nullptr;
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        RunTasks(0, fn);
+
+        // 还需等所有进入本轮的工作线程退出 RunTasks，它们持有的 fn 引用才会失效
+        std::unique_lock<std::mutex> lock(mu_);
+        done_.wait(lock, [this] {
+            return remaining_.load(std::memory_order_acquire) == 0 && active_ == 0;
+        });
+        job_ = nullptr;
+        if (error_) std::rethrow_exception(error_);
+    }
+
+ private:
+    struct TaskQueue {
+        std::mutex mu;
+        std::deque<std::size_t> tasks;
+    };
+
+    bool PopLocal(std::size_t self, std::size_t& task) {
+        TaskQueue& q = *queues_[self];
+        std::lock_guard<std::mutex> lock(q.mu);
+        if (q.tasks.empty()) return false;
+        task = q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+    }
+
+    bool Steal(std::size_t self, std::size_t& task) {
+        const std::size_t n = queues_.size();
+        for (std::size_t k = 1; k < n; ++k) {
+            TaskQueue& q = *queues_[(self + k) % n];
+            std::lock_guard<std::mutex> lock(q.mu);
+            if (q.tasks.empty()) continue;
+            task = q.tasks.back();
+            q.tasks.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    void RunTasks(std::size_t self, const std::function<void(std::size_t)>& fn) {
+        std::size_t task = 0;
+        while (PopLocal(self, task) || Steal(self, task)) {
+            try {
+                fn(task);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mu_);
+                if (!error_) error_ = std::current_exception();
+            }
+            if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(mu_);
+                done_.notify_all();
+            }
+        }
+    }
+
+    void WorkerLoop(std::size_t self) {
+        uint64_t seen = 0;
+        for (;;) {
+            const std::function<void(std::size_t)>* job = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                wake_.wait(lock, [&] { return stop_ || (generation_ != seen && job_ != nullptr); });
+                if (stop_) return;
+                seen = generation_;
+                job = job_;
+                ++active_;
+            }
+            RunTasks(self, *job);
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                --active_;
+            }
+            done_.notify_all();
+        }
+    }
+
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex run_mu_;                 // 串行化并发的 ParallelFor 调用
+    std::mutex mu_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(std::size_t)>* job_ = nullptr;
+    std::atomic<std::size_t> remaining_{0};
+    std::exception_ptr error_;
+    std::size_t active_ = 0;            // 正在执行本轮任务的后台线程数
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+};
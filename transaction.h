@@ -0,0 +1,258 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "amount_utils.h"
+#include "category_recognizer.h"
+#include "category_registry.h"
+#include "date_utils.h"
+#include "recognizer_cache.h"
+#include "thread_pool.h"
+
+// ===================== 集成流程：交易处理 =====================
+// 除 note 外均为平凡可拷贝字段；date 为 4 字节 PackedDate，手工日期解析失败时为无效值；
+// amount_cents 为定点分，解析失败时为 kInvalidAmount
+struct ProcessedTransaction {
+    PackedDate date;
+    int category_id;
+    std::string note;
+    int64_t amount_cents = 0;
+};
+
+// 批量接口的单行输入：备注 + 手工日期（为空表示自动填当天）+ 金额文本（为空记为 0）。
+// 均为非拥有视图，可直接指向 mmap 的 CSV 或网络缓冲区；
+// 调用方须保证底层内存在处理期间有效。
+struct TransactionInput {
+    std::string_view note;
+    std::string_view date;
+    std::string_view amount{};  // 为空时记为 0
+};
+
+// 结果中的 note 是否拷贝输入备注。kSkip 时 out.note 被清空（保留容量），
+// 调用方按下标回查自己的输入缓冲即可，整条流水线零拷贝。
+enum class NoteCopy { kCopy, kSkip };
+
+// 单行处理的核心：复用调用方提供的识别器与当天日期，结果写入 out。
+// out 中已有的字符串容量会被复用，重复使用同一输出缓冲时不再分配。
+inline void ProcessTransactionInto(const CategoryRecognizer& cr,
+                                   std::string_view note,
+                                   std::string_view date_input,
+                                   PackedDate today,
+                                   ProcessedTransaction& out,
+                                   NoteCopy note_copy = NoteCopy::kCopy) {
+    if (note_copy == NoteCopy::kCopy) {
+        out.note.assign(note.data(), note.size());
+    } else {
+        out.note.clear();
+    }
+    CountMetric(MetricCounter::kTransactions);
+    if (date_input.empty()) CountMetric(MetricCounter::kDateAutofills);
+    out.date = date_input.empty() ? today : PackedDate::Parse(date_input);
+    out.category_id = cr.RecognizeCategory(note);
+    out.amount_cents = 0;
+}
+
+// 带金额的整行输入
+inline void ProcessTransactionInto(const CategoryRecognizer& cr,
+                                   const TransactionInput& in,
+                                   PackedDate today,
+                                   ProcessedTransaction& out,
+                                   NoteCopy note_copy = NoteCopy::kCopy) {
+    ProcessTransactionInto(cr, in.note, in.date, today, out, note_copy);
+    out.amount_cents = ParseAmountCents(in.amount);
+}
+
+inline ProcessedTransaction ProcessTransaction(std::string_view note,
+                                               std::string_view date_input,
+                                               const std::vector<Category>& cats) {
+    ProcessedTransaction out{};
+    out.note.assign(note.data(), note.size());
+    CountMetric(MetricCounter::kTransactions);
+    if (date_input.empty()) CountMetric(MetricCounter::kDateAutofills);
+    out.date = date_input.empty() ? GetCurrentPackedDate() : PackedDate::Parse(date_input);
+
+    CategoryRecognizer cr(cats);
+    out.category_id = cr.RecognizeCategory(note);
+    return out;
+}
+
+// 多租户入口：按分类集合从缓存取识别器，同一租户的重复请求不再构建
+inline ProcessedTransaction ProcessTransaction(std::string_view note,
+                                               std::string_view date_input,
+                                               const std::vector<Category>& cats,
+                                               RecognizerCache& cache) {
+    ProcessedTransaction out{};
+    const PackedDate today = date_input.empty() ? GetCurrentPackedDate() : PackedDate();
+    ProcessTransactionInto(*cache.Get(cats), note, date_input, today, out);
+    return out;
+}
+
+// ===================== 集成流程：可复用的分类上下文 =====================
+// 逐条调用的热路径每次都要新建结果字符串、按分类表重建识别器。调用方按线程
+// 持有一个 ClassificationContext 并反复传入：结果缓冲与最近一次的识别器都留在
+// 上下文里复用，预热之后逐条分类不再有堆分配。上下文不是线程安全的。
+class ClassificationContext {
+ public:
+    ClassificationContext() = default;
+
+    // 预留备注缓冲，使首批调用也不必扩容
+    explicit ClassificationContext(std::size_t note_capacity) { result_.note.reserve(note_capacity); }
+
+    // 结果写入上下文自带的缓冲，引用在下一次 Process 前有效；备注拷贝复用已有容量
+    const ProcessedTransaction& Process(const CategoryRecognizer& cr, const TransactionInput& in) {
+        ProcessTransactionInto(cr, in, Today(in.date), result_);
+        return result_;
+    }
+
+    // 调用方已持有备注字符串时直接移入结果，不再拷贝
+    ProcessedTransaction Process(const CategoryRecognizer& cr,
+                                 std::string&& note,
+                                 std::string_view date_input,
+                                 std::string_view amount = {}) {
+        ProcessedTransaction out{};
+        ProcessTransactionInto(cr, TransactionInput{note, date_input, amount}, Today(date_input), out,
+                               NoteCopy::kSkip);
+        out.note = std::move(note);
+        return out;
+    }
+
+    // 分类表（及策略）与上次相同时复用已构建的识别器，否则重建并记住副本。
+    // 每次调用都逐个比较分类的名字与关键词，耗时与分类表大小成正比
+    const CategoryRecognizer& Recognizer(const std::vector<Category>& cats,
+                                         MatchPolicy policy = MatchPolicy::kByteOrder) {
+        if (!recognizer_ || registry_serial_ != 0 || policy != policy_ || !SameMatchingCategories(cats, categories_)) {
+            recognizer_.reset();
+            categories_ = cats;
+            policy_ = policy;
+            registry_serial_ = 0;
+            recognizer_.emplace(categories_, policy_);
+        }
+        return *recognizer_;
+    }
+
+    // 注册表不可变，按序号判断是否需要重建，不必逐个比较分类
+    const CategoryRecognizer& Recognizer(const CategoryRegistry& registry,
+                                         MatchPolicy policy = MatchPolicy::kByteOrder) {
+        if (!recognizer_ || registry_serial_ != registry.serial() || policy != policy_) {
+            recognizer_.reset();
+            categories_.clear();
+            policy_ = policy;
+            registry_serial_ = registry.serial();
+            recognizer_.emplace(registry.Compile(policy_));
+        }
+        return *recognizer_;
+    }
+
+ private:
+    // 当天日期由 DateProvider 缓存，只有空日期才去取
+    static PackedDate Today(std::string_view date_input) {
+        return date_input.empty() ? GetCurrentPackedDate() : PackedDate();
+    }
+
+    ProcessedTransaction result_{};
+    std::vector<Category> categories_;
+    uint64_t registry_serial_ = 0;  // 识别器由注册表构建时为其序号，由分类表构建时为 0
+    MatchPolicy policy_ = MatchPolicy::kByteOrder;
+    std::optional<CategoryRecognizer> recognizer_;
+};
+
+// 与 ProcessTransaction(note, date, cats) 结果相同，但识别器与结果缓冲都取自 ctx。
+// 每行都要比较整张分类表，分类多时比分类本身还贵；逐行循环里应先取一次
+// ctx.Recognizer(cats) 并使用下面传识别器的重载，或改传注册表
+inline const ProcessedTransaction& ProcessTransaction(ClassificationContext& ctx,
+                                                      std::string_view note,
+                                                      std::string_view date_input,
+                                                      const std::vector<Category>& cats) {
+    return ctx.Process(ctx.Recognizer(cats), TransactionInput{note, date_input});
+}
+
+// 同上，分类来自共享的注册表：按序号判断是否重建，每行 O(1)
+inline const ProcessedTransaction& ProcessTransaction(ClassificationContext& ctx,
+                                                      std::string_view note,
+                                                      std::string_view date_input,
+                                                      const CategoryRegistry& registry) {
+    return ctx.Process(ctx.Recognizer(registry), TransactionInput{note, date_input});
+}
+
+// 同上，直接使用调用方构建好的识别器，只复用 ctx 的结果缓冲
+inline const ProcessedTransaction& ProcessTransaction(ClassificationContext& ctx,
+                                                      std::string_view note,
+                                                      std::string_view date_input,
+                                                      const CategoryRecognizer& cr) {
+    return ctx.Process(cr, TransactionInput{note, date_input});
+}
+
+// 批量处理：每批只构建一次识别器；当天日期在首次遇到空日期时取一次，
+// 之后各行复用。out 须能容纳 count 个元素。
+inline void ProcessTransactions(const TransactionInput* inputs,
+                                std::size_t count,
+                                const CategoryRecognizer& cr,
+                                ProcessedTransaction* out,
+                                NoteCopy note_copy = NoteCopy::kCopy) {
+    PackedDate today;
+    for (std::size_t i = 0; i < count; ++i) {
+        const TransactionInput& in = inputs[i];
+        if (in.date.empty() && !today.valid()) today = GetCurrentPackedDate();
+        ProcessTransactionInto(cr, in, today, out[i], note_copy);
+    }
+}
+
+inline void ProcessTransactions(const TransactionInput* inputs,
+                                std::size_t count,
+                                const std::vector<Category>& cats,
+                                ProcessedTransaction* out) {
+    CategoryRecognizer cr(cats);
+    ProcessTransactions(inputs, count, cr, out);
+}
+
+inline void ProcessTransactions(const std::vector<TransactionInput>& inputs,
+                                const std::vector<Category>& cats,
+                                std::vector<ProcessedTransaction>& out) {
+    out.resize(inputs.size());
+    ProcessTransactions(inputs.data(), inputs.size(), cats, out.data());
+}
+
+// ===================== 集成流程：并行批量处理 =====================
+// 每个并行任务处理的行数：足够大以摊薄调度开销，又足够小以便窃取均衡负载
+constexpr std::size_t kDefaultChunkRows = 4096;
+
+// 输入切成固定大小的块，在线程池上共享同一个只读识别器；每块写入 out 中
+// 自己的下标区间，因此输出天然保持输入顺序。当天日期在开始前取一次并被
+// 所有块共用，结果与串行路径逐字节一致。
+inline void ProcessTransactions(const TransactionInput* inputs,
+                                std::size_t count,
+                                const CategoryRecognizer& cr,
+                                ProcessedTransaction* out,
+                                WorkStealingPool& pool,
+                                std::size_t chunk_rows = kDefaultChunkRows,
+                                NoteCopy note_copy = NoteCopy::kCopy) {
+    if (chunk_rows == 0) chunk_rows = kDefaultChunkRows;
+    const PackedDate today = GetCurrentPackedDate();
+    const std::size_t chunks = (count + chunk_rows - 1) / chunk_rows;
+    pool.ParallelFor(chunks, [&](std::size_t chunk) {
+        const std::size_t begin = chunk * chunk_rows;
+        const std::size_t end = std::min(count, begin + chunk_rows);
+        for (std::size_t i = begin; i < end; ++i) {
+            ProcessTransactionInto(cr, inputs[i], today, out[i], note_copy);
+        }
+    });
+}
+
+// 便捷入口：num_threads 为总线程数（0 表示 hardware_concurrency）
+inline void ProcessTransactionsParallel(const std::vector<TransactionInput>& inputs,
+                                        const std::vector<Category>& cats,
+                                        std::vector<ProcessedTransaction>& out,
+                                        std::size_t num_threads = 0,
+                                        std::size_t chunk_rows = kDefaultChunkRows) {
+    out.resize(inputs.size());
+    CategoryRecognizer cr(cats);
+    WorkStealingPool pool(num_threads);
+    ProcessTransactions(inputs.data(), inputs.size(), cr, out.data(), pool, chunk_rows);
+}
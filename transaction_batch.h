@@ -0,0 +1,212 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "date_column.h"
+#include "transaction.h"
+
+// ===================== 集成流程：列式批量结果 =====================
+// 一批结果的列式（SoA）存储：分类 id、打包日期、金额（分）各占一列连续的
+// int32/uint32/int64，所有备注顺序写入同一块连续内存（单调 arena），另用 n+1
+// 个偏移划分各行。
+// 按分类、日期聚合的报表只扫描需要的列（见 ledger_aggregate.h），不再遍历整行
+// 结构、追逐字符串指针；与 ProcessedTransaction 数组相比，每行也不再各自 malloc
+// 一次备注。Clear() 是 O(1) 且保留容量，下一批复用同一块内存时不再分配。
+class TransactionBatch {
+ public:
+    TransactionBatch() : note_offsets_(1, 0) {}
+
+    // 拷贝、移动得到的对象（以及被移走后清空的源）都取新的 generation
+    TransactionBatch(const TransactionBatch& other)
+        : category_ids_(other.category_ids_),
+          dates_(other.dates_),
+          amounts_(other.amounts_),
+          note_offsets_(other.note_offsets_),
+          notes_(other.notes_) {}
+
+    TransactionBatch(TransactionBatch&& other) noexcept
+        : category_ids_(std::move(other.category_ids_)),
+          dates_(std::move(other.dates_)),
+          amounts_(std::move(other.amounts_)),
+          note_offsets_(std::move(other.note_offsets_)),
+          notes_(std::move(other.notes_)) {
+        other.Clear();
+    }
+
+    TransactionBatch& operator=(const TransactionBatch& other) {
+        if (this == &other) return *this;
+        category_ids_ = other.category_ids_;
+        dates_ = other.dates_;
+        amounts_ = other.amounts_;
+        note_offsets_ = other.note_offsets_;
+        notes_ = other.notes_;
+        generation_ = NextGeneration();
+        return *this;
+    }
+
+    TransactionBatch& operator=(TransactionBatch&& other) noexcept {
+        if (this == &other) return *this;
+        category_ids_ = std::move(other.category_ids_);
+        dates_ = std::move(other.dates_);
+        amounts_ = std::move(other.amounts_);
+        note_offsets_ = std::move(other.note_offsets_);
+        notes_ = std::move(other.notes_);
+        generation_ = NextGeneration();
+        other.Clear();
+        return *this;
+    }
+
+    std::size_t size() const { return category_ids_.size(); }
+    bool empty() const { return category_ids_.empty(); }
+    std::size_t note_bytes() const { return notes_.size(); }
+    // 进程内全局唯一：构造、拷贝 / 移动赋值、Clear()/Release() 各取一个新值。只追加的派生
+    // 结构（如 LedgerIndex）据此判断已建的行是否还在，换了一个 batch 对象也能识别
+    uint64_t generation() const { return generation_; }
+
+    void Reserve(std::size_t rows, std::size_t bytes) {
+        category_ids_.reserve(rows);
+        dates_.reserve(rows);
+        amounts_.reserve(rows);
+        note_offsets_.reserve(rows + 1);
+        notes_.reserve(bytes);
+    }
+
+    // O(1)：只重置长度，内存留给下一批
+    void Clear() {
+        category_ids_.clear();
+        dates_.clear();
+        amounts_.clear();
+        note_offsets_.resize(1);
+        notes_.clear();
+        generation_ = NextGeneration();
+    }
+
+    // 真正归还内存（整批一次性释放）
+    void Release() {
+        std::vector<int32_t>().swap(category_ids_);
+        std::vector<uint32_t>().swap(dates_);
+        std::vector<int64_t>().swap(amounts_);
+        std::vector<uint64_t>(1, 0).swap(note_offsets_);
+        std::vector<char>().swap(notes_);
+        generation_ = NextGeneration();
+    }
+
+    void Append(PackedDate date, int category_id, std::string_view note, int64_t amount_cents = 0) {
+        notes_.insert(notes_.end(), note.begin(), note.end());
+        category_ids_.push_back(category_id);
+        dates_.push_back(date.value());
+        amounts_.push_back(amount_cents);
+        note_offsets_.push_back(notes_.size());
+    }
+
+    // 列视图：各含 size() 个元素；note_offsets() 含 size() + 1 个，
+    // 第 i 行备注为 note_data()[note_offsets()[i], note_offsets()[i + 1])
+    const int32_t* category_ids() const { return category_ids_.data(); }
+    const uint32_t* packed_dates() const { return dates_.data(); }
+    const int64_t* amounts() const { return amounts_.data(); }
+    const uint64_t* note_offsets() const { return note_offsets_.data(); }
+    const char* note_data() const { return notes_.data(); }
+
+    PackedDate date(std::size_t i) const { return PackedDate::FromValue(dates_[i]); }
+    int category_id(std::size_t i) const { return category_ids_[i]; }
+    int64_t amount_cents(std::size_t i) const { return amounts_[i]; }
+
+    // 视图在下一次 Append/Clear 之前有效
+    std::string_view note(std::size_t i) const {
+        return std::string_view(notes_.data() + note_offsets_[i],
+                                static_cast<std::size_t>(note_offsets_[i + 1] - note_offsets_[i]));
+    }
+
+    // 需要独立对象时再物化为 ProcessedTransaction
+    ProcessedTransaction ToProcessed(std::size_t i) const {
+        return ProcessedTransaction{date(i), category_ids_[i], std::string(note(i)), amounts_[i]};
+    }
+
+    // 分类 inputs 并追加到末尾（不清空已有内容）。先串行做一次备注长度的
+    // 前缀和，一次性扩好各列与 arena，随后各行写入自己的区间——pool 非空时
+    // 各块并行写入，结果与串行逐字节一致。
+    void AppendClassified(const TransactionInput* inputs,
+                          std::size_t count,
+                          const CategoryRecognizer& cr,
+                          WorkStealingPool* pool = nullptr,
+                          std::size_t chunk_rows = kDefaultChunkRows) {
+        const std::size_t first_row = size();
+        uint64_t offset = notes_.size();
+        category_ids_.resize(first_row + count);
+        dates_.resize(first_row + count);
+        amounts_.resize(first_row + count);
+        note_offsets_.resize(first_row + count + 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            offset += inputs[i].note.size();
+            note_offsets_[first_row + i + 1] = offset;
+        }
+        notes_.resize(static_cast<std::size_t>(offset));
+
+        const PackedDate today = GetCurrentPackedDate();
+        int32_t* ids = category_ids_.data() + first_row;
+        uint32_t* dates = dates_.data() + first_row;
+        int64_t* amounts = amounts_.data() + first_row;
+        const uint64_t* offsets = note_offsets_.data() + first_row;
+        char* blob = notes_.data();
+        auto run = [&](std::size_t begin, std::size_t end) {
+            uint64_t autofills = 0;
+            ParseDateColumn(inputs + begin, end - begin, today, dates + begin);
+            for (std::size_t i = begin; i < end; ++i) {
+                const TransactionInput& in = inputs[i];
+                if (!in.note.empty()) std::memcpy(blob + offsets[i], in.note.data(), in.note.size());
+                autofills += in.date.empty();
+                ids[i] = cr.RecognizeCategory(in.note);
+                amounts[i] = ParseAmountCents(in.amount);
+            }
+            CountMetric(MetricCounter::kTransactions, end - begin);
+            CountMetric(MetricCounter::kDateAutofills, autofills);
+        };
+
+        if (pool == nullptr) {
+            run(0, count);
+            return;
+        }
+        if (chunk_rows == 0) chunk_rows = kDefaultChunkRows;
+        const std::size_t chunks = (count + chunk_rows - 1) / chunk_rows;
+        pool->ParallelFor(chunks, [&](std::size_t chunk) {
+            const std::size_t begin = chunk * chunk_rows;
+            run(begin, std::min(count, begin + chunk_rows));
+        });
+    }
+
+ private:
+    static uint64_t NextGeneration() {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::vector<int32_t> category_ids_;
+    std::vector<uint32_t> dates_;         // PackedDate::value()
+    std::vector<int64_t> amounts_;        // 分；解析失败为 kInvalidAmount
+    std::vector<uint64_t> note_offsets_;  // size() + 1 个，首个恒为 0
+    std::vector<char> notes_;
+    uint64_t generation_ = NextGeneration();
+};
+
+inline void ProcessTransactions(const TransactionInput* inputs,
+                                std::size_t count,
+                                const CategoryRecognizer& cr,
+                                TransactionBatch& batch) {
+    batch.AppendClassified(inputs, count, cr);
+}
+
+inline void ProcessTransactions(const TransactionInput* inputs,
+                                std::size_t count,
+                                const CategoryRecognizer& cr,
+                                TransactionBatch& batch,
+                                WorkStealingPool& pool,
+                                std::size_t chunk_rows = kDefaultChunkRows) {
+    batch.AppendClassified(inputs, count, cr, &pool, chunk_rows);
+}
@@ -0,0 +1,530 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "bounded_queue.h"
+#include "durable_file.h"
+#include "mapped_file.h"
+#include "simd_support.h"
+#include "transaction.h"
+#include "transaction_batch.h"
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// ===================== 存储：交易预写日志（组提交） =====================
+// 处理结果的持久化日志：只追加的二进制文件，每条记录带 CRC-32C。写者调用
+// Append() 把结果交给无锁队列后立即返回，由专门的 I/O 线程编码、成组写入
+// 并 fsync——一次 fsync 覆盖这期间到达的所有记录，而不是每行一次。
+//
+// 成组方式：I/O 线程每次取走队列里已有的全部记录；上一次 fsync 期间积攒的
+// 记录自然成为下一组。commit_window > 0 时，首条待提交记录到达后再最多等
+// 这么久凑批（或凑够 max_group_bytes），用提交延迟换更大的组。需要确认落盘
+// 的写者调用 WaitDurable(lsn)。
+//
+// 文件格式（主机字节序，与识别器快照相同）：16 字节文件头（8 字节魔数 +
+// u32 版本 + u32 保留），其后每条记录为 u32 负载长度 + u32 负载的 CRC-32C +
+// 负载（u32 打包日期、i32 分类 id、i64 金额分、备注字节）。崩溃留下的半条
+// 记录由重放识别为残尾：之前的记录全部有效，Open() 会截掉残尾再继续追加。
+// 备注超过 kMaxLogNoteBytes 的行重放时会被当成残尾，Append() 直接拒收。
+struct TransactionLogOptions {
+    // 首条待提交记录到达后额外等待凑批的时间；0 表示只靠 fsync 期间的积攒成组
+    std::chrono::microseconds commit_window{0};
+    std::size_t max_group_bytes = 1 << 20;  // 凑够即提交，不再等窗口结束
+    std::size_t queue_capacity = 1 << 14;   // 写者与 I/O 线程之间的队列槽数，向上取 2 的幂
+    bool sync = true;  // false 时只 write 不 fsync：进程崩溃不丢，掉电可能丢最近的组
+};
+
+struct TransactionLogStats {
+    uint64_t records = 0;  // 本次打开后写入的记录数
+    uint64_t commits = 0;  // 写入 + fsync 的次数
+    uint64_t bytes = 0;
+
+    double AverageGroup() const { return commits == 0 ? 0.0 : static_cast<double>(records) / commits; }
+};
+
+// 重放时的一条记录；note 指向映射的日志文件，回调返回后失效
+struct LogRecord {
+    PackedDate date;
+    int category_id;
+    int64_t amount_cents;
+    std::string_view note;
+};
+
+struct LogReplayResult {
+    uint64_t records = 0;
+    uint64_t valid_bytes = 0;  // 文件头 + 全部有效记录
+    bool torn_tail = false;    // 有效记录之后还有无法校验的字节
+};
+
+// 单条记录的备注上限（负载上限 16 MiB 减去定长部分）；更长的行 Append() 拒收
+constexpr std::size_t kMaxLogNoteBytes = (std::size_t{1} << 24) - 16;
+
+namespace transaction_log_detail {
+
+constexpr char kMagic[8] = {'A', 'B', 'W', 'A', 'L', '\0', '\0', '\x1a'};
+constexpr uint32_t kVersion = 1;
+constexpr std::size_t kFileHeaderSize = 16;
+constexpr std::size_t kRecordHeaderSize = 8;
+constexpr std::size_t kFixedPayload = 16;
+constexpr uint32_t kMaxPayload = static_cast<uint32_t>(kFixedPayload + kMaxLogNoteBytes);  // 更长的长度字段视为损坏
+
+inline bool Fail(const std::string& message, std::string* error) {
+    if (error != nullptr) *error = message;
+    return false;
+}
+
+// ---- CRC-32C（Castagnoli 多项式，与 iSCSI / ext4 相同） ----
+inline const uint32_t* Crc32cTable() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) != 0 ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+inline uint32_t Crc32cScalar(uint32_t crc, const char* p, std::size_t n) {
+    const uint32_t* t = Crc32cTable();
+    for (std::size_t i = 0; i < n; ++i) crc = t[(crc ^ static_cast<unsigned char>(p[i])) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(ACCOUNT_BOOK_HAVE_X86_DISPATCH) && (defined(__x86_64__) || defined(_M_X64))
+#define ACCOUNT_BOOK_HAVE_CRC32C_SSE42 1
+ACCOUNT_BOOK_TARGET("sse4.2")
+inline uint32_t Crc32cSse42(uint32_t crc, const char* p, std::size_t n) {
+    uint64_t c = crc;
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        c = _mm_crc32_u64(c, w);
+    }
+    uint32_t c32 = static_cast<uint32_t>(c);
+    for (; n > 0; ++p, --n) c32 = _mm_crc32_u8(c32, static_cast<unsigned char>(*p));
+    return c32;
+}
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+inline uint32_t Crc32cArm(uint32_t crc, const char* p, std::size_t n) {
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        crc = __crc32cd(crc, w);
+    }
+    for (; n > 0; ++p, --n) crc = __crc32cb(crc, static_cast<uint8_t>(*p));
+    return crc;
+}
+#endif
+
+inline uint32_t Crc32c(const char* p, std::size_t n, SimdLevel level = ActiveSimdLevel()) {
+    const uint32_t init = 0xFFFFFFFFu;
+#if defined(ACCOUNT_BOOK_HAVE_CRC32C_SSE42)
+    if (level == SimdLevel::kAvx2) return ~Crc32cSse42(init, p, n);  // 支持 AVX2 的 CPU 都有 SSE4.2
+#elif defined(__ARM_FEATURE_CRC32)
+    if (level == SimdLevel::kNeon) return ~Crc32cArm(init, p, n);
+#endif
+    (void)level;
+    return ~Crc32cScalar(init, p, n);
+}
+
+// ---- 记录编解码 ----
+inline void Put32(std::string& out, uint32_t v) { out.append(reinterpret_cast<const char*>(&v), 4); }
+
+inline uint32_t Get32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline std::string FileHeader() {
+    std::string h(kMagic, sizeof(kMagic));
+    Put32(h, kVersion);
+    Put32(h, 0);
+    return h;
+}
+
+// row.note 不超过 kMaxLogNoteBytes，由 Append() 保证
+inline void EncodeRecord(const ProcessedTransaction& row, std::string& out) {
+    const uint32_t payload = static_cast<uint32_t>(kFixedPayload + row.note.size());
+    const std::size_t at = out.size();
+    out.resize(at + kRecordHeaderSize + payload);
+    char* p = &out[at];
+    const uint32_t date = row.date.value();
+    const int32_t id = row.category_id;
+    std::memcpy(p, &payload, 4);
+    std::memcpy(p + 8, &date, 4);
+    std::memcpy(p + 12, &id, 4);
+    std::memcpy(p + 16, &row.amount_cents, 8);
+    if (!row.note.empty()) std::memcpy(p + 24, row.note.data(), row.note.size());
+    const uint32_t crc = Crc32c(p + kRecordHeaderSize, payload);
+    std::memcpy(p + 4, &crc, 4);
+}
+
+// 校验文件头后逐条解码，遇到第一条长度或 CRC 不对的记录即停
+template <typename Fn>
+bool DecodeLog(std::string_view data, Fn&& fn, LogReplayResult& result, std::string* error) {
+    result = LogReplayResult();
+    const std::string header = FileHeader();
+    if (data.size() < kFileHeaderSize && header.compare(0, data.size(), data) == 0) {
+        result.torn_tail = !data.empty();  // 创建后还没写完文件头
+        return true;
+    }
+    if (data.size() < kFileHeaderSize || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+        return Fail("not a transaction log", error);
+    }
+    if (Get32(data.data() + 8) != kVersion) return Fail("unsupported transaction log version", error);
+
+    std::size_t at = kFileHeaderSize;
+    const char* base = data.data();
+    while (data.size() - at >= kRecordHeaderSize) {
+        const uint32_t payload = Get32(base + at);
+        if (payload < kFixedPayload || payload > kMaxPayload || data.size() - at - kRecordHeaderSize < payload) break;
+        const char* p = base + at + kRecordHeaderSize;
+        if (Crc32c(p, payload) != Get32(base + at + 4)) break;
+        LogRecord r;
+        int32_t id;
+        r.date = PackedDate::FromValue(Get32(p));
+        std::memcpy(&id, p + 4, 4);
+        std::memcpy(&r.amount_cents, p + 8, 8);
+        r.category_id = id;
+        r.note = std::string_view(p + kFixedPayload, payload - kFixedPayload);
+        fn(static_cast<const LogRecord&>(r));
+        ++result.records;
+        at += kRecordHeaderSize + payload;
+    }
+    result.valid_bytes = at;
+    result.torn_tail = at != data.size();
+    return true;
+}
+
+// ---- 只追加的日志文件 ----
+class AppendFile {
+ public:
+    AppendFile() = default;
+    ~AppendFile() { Close(); }
+
+    AppendFile(const AppendFile&) = delete;
+    AppendFile& operator=(const AppendFile&) = delete;
+
+    // 打开（不存在则创建）并把文件截到 keep_bytes，之后从该处追加
+    bool Open(const std::string& path, uint64_t keep_bytes, std::string* error) {
+#if defined(_WIN32)
+        file_ = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return Fail("cannot open " + path, error);
+        LARGE_INTEGER pos{};
+        pos.QuadPart = static_cast<LONGLONG>(keep_bytes);
+        if (!SetFilePointerEx(file_, pos, nullptr, FILE_BEGIN) || !SetEndOfFile(file_)) {
+            return Fail("cannot truncate " + path, error);
+        }
+#else
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+        if (fd_ < 0) return Fail("cannot open " + path, error);
+        if (::ftruncate(fd_, static_cast<off_t>(keep_bytes)) != 0 ||
+            ::lseek(fd_, static_cast<off_t>(keep_bytes), SEEK_SET) < 0) {
+            return Fail("cannot truncate " + path, error);
+        }
+#endif
+        // 截掉的残尾也要落盘：否则掉电后它可能复现，后续追加的记录被当成残尾之后的垃圾
+        if (!Sync()) return Fail("cannot sync " + path, error);
+        return true;
+    }
+
+    bool Write(const char* p, std::size_t n) {
+#if defined(_WIN32)
+        while (n > 0) {
+            DWORD written = 0;
+            const DWORD chunk = static_cast<DWORD>(std::min<std::size_t>(n, 1u << 30));
+            if (!WriteFile(file_, p, chunk, &written, nullptr)) return false;
+            p += written;
+            n -= written;
+        }
+#else
+        while (n > 0) {
+            const ssize_t written = ::write(fd_, p, n);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += written;
+            n -= static_cast<std::size_t>(written);
+        }
+#endif
+        return true;
+    }
+
+    bool Sync() {
+#if defined(_WIN32)
+        return FlushFileBuffers(file_) != 0;
+#elif defined(__APPLE__)
+        return ::fsync(fd_) == 0;
+#else
+        return ::fdatasync(fd_) == 0;
+#endif
+    }
+
+    void Close() {
+#if defined(_WIN32)
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+    }
+
+ private:
+#if defined(_WIN32)
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+};
+
+}  // namespace transaction_log_detail
+
+// 逐条重放 path 中的有效记录，fn(const LogRecord&)。文件不存在或文件头不对时返回 false；
+// 残尾不算错误，由 result->torn_tail 标出
+template <typename Fn>
+bool ReplayTransactionLog(const std::string& path, Fn&& fn, LogReplayResult* result = nullptr,
+                          std::string* error = nullptr) {
+    MappedFile file;
+    if (!file.Open(path, error, MapAccess::kSequential)) return false;
+    LogReplayResult r;
+    const bool ok = transaction_log_detail::DecodeLog(file.view(), fn, r, error);
+    if (result != nullptr) *result = r;
+    return ok;
+}
+
+// 重放并追加到列式批量结果，备注拷入 batch 的 arena
+inline bool ReplayTransactionLog(const std::string& path, TransactionBatch& batch, LogReplayResult* result = nullptr,
+                                 std::string* error = nullptr) {
+    return ReplayTransactionLog(
+        path, [&batch](const LogRecord& r) { batch.Append(r.date, r.category_id, r.note, r.amount_cents); },
+        result, error);
+}
+
+class TransactionLog {
+ public:
+    // 打开或创建日志：先校验已有记录、截掉崩溃留下的残尾，再启动 I/O 线程。新建时
+    // 文件头与父目录都落盘后才返回，之后 WaitDurable 的确认不会因目录项丢失而失效。
+    // recovered 非空时写入打开前的有效内容概况。失败返回 nullptr
+    static std::unique_ptr<TransactionLog> Open(const std::string& path,
+                                                TransactionLogOptions options = TransactionLogOptions(),
+                                                std::string* error = nullptr,
+                                                LogReplayResult* recovered = nullptr) {
+        namespace d = transaction_log_detail;
+        LogReplayResult existing;
+        std::error_code ec;
+        if (std::filesystem::exists(path, ec)) {
+            if (!ReplayTransactionLog(path, [](const LogRecord&) {}, &existing, error)) return nullptr;
+        }
+        std::unique_ptr<TransactionLog> log(new TransactionLog(options, existing.records));
+        if (!log->file_.Open(path, existing.valid_bytes, error)) return nullptr;
+        if (existing.valid_bytes == 0) {
+            const std::string header = d::FileHeader();
+            if (!log->file_.Write(header.data(), header.size()) || !log->file_.Sync()) {
+                d::Fail("cannot write " + path, error);
+                return nullptr;
+            }
+            // 新建的文件：目录项也要落盘，否则掉电后整个日志可能不见，已确认落盘的记录随之丢失
+            if (!SyncParentDirectory(path, error)) return nullptr;
+        }
+        if (recovered != nullptr) *recovered = existing;
+        log->io_ = std::thread([raw = log.get()] { raw->Run(); });
+        return log;
+    }
+
+    // 提交所有已追加的记录后返回；析构时不得再有并发的 Append
+    ~TransactionLog() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_.store(true);
+        }
+        wake_.notify_one();
+        if (io_.joinable()) io_.join();
+    }
+
+    TransactionLog(const TransactionLog&) = delete;
+    TransactionLog& operator=(const TransactionLog&) = delete;
+
+    // 交给 I/O 线程并返回记录的 LSN（从 1 起，含打开前已有的记录）。
+    // 队列满说明磁盘跟不上，此时让出 CPU 直到有空位。备注超过 kMaxLogNoteBytes
+    // 时不写入、不占 LSN，返回 0
+    uint64_t Append(ProcessedTransaction row, std::string* error = nullptr) {
+        if (row.note.size() > kMaxLogNoteBytes) {
+            transaction_log_detail::Fail("note exceeds transaction log record limit", error);
+            return 0;
+        }
+        std::size_t pos = 0;
+        while (!queue_.TryPush(std::move(row), &pos)) std::this_thread::yield();
+        if (sleeping_.load()) {
+            std::lock_guard<std::mutex> lock(mu_);
+            wake_.notify_one();
+        }
+        return base_lsn_ + pos + 1;
+    }
+
+    // 阻塞到 lsn 及之前的记录都已落盘；I/O 出错时返回 false
+    bool WaitDurable(uint64_t lsn) {
+        if (durable_lsn_.load(std::memory_order_acquire) >= lsn) return true;
+        std::unique_lock<std::mutex> lock(durable_mu_);
+        durable_.wait(lock, [&] { return failed_ || durable_lsn_.load(std::memory_order_acquire) >= lsn; });
+        return durable_lsn_.load(std::memory_order_acquire) >= lsn;
+    }
+
+    uint64_t durable_lsn() const { return durable_lsn_.load(std::memory_order_acquire); }
+
+    // 写入或 fsync 失败后不再落盘任何记录
+    bool failed() const {
+        std::lock_guard<std::mutex> lock(durable_mu_);
+        return failed_;
+    }
+
+    std::string error() const {
+        std::lock_guard<std::mutex> lock(durable_mu_);
+        return error_;
+    }
+
+    TransactionLogStats Stats() const {
+        TransactionLogStats s;
+        s.records = records_.load(std::memory_order_relaxed);
+        s.commits = commits_.load(std::memory_order_relaxed);
+        s.bytes = bytes_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    const TransactionLogOptions& options() const { return options_; }
+
+ private:
+    using Clock = std::chrono::steady_clock;
+
+    TransactionLog(const TransactionLogOptions& options, uint64_t base_lsn)
+        : options_(options), base_lsn_(base_lsn), queue_(options.queue_capacity), durable_lsn_(base_lsn) {}
+
+    // 取走队列里已就绪的记录编码进 group，直到队列空或组够大；返回取到的条数
+    std::size_t Drain(std::string& group) {
+        std::size_t n = 0;
+        while (group.size() < options_.max_group_bytes && queue_.TryPop(row_)) {
+            transaction_log_detail::EncodeRecord(row_, group);
+            ++n;
+        }
+        return n;
+    }
+
+    // 生产者入队后检查 sleeping_，这里登记 sleeping_ 后再检查队列，二者不会同时错过
+    void Idle() {
+        std::unique_lock<std::mutex> lock(mu_);
+        sleeping_.store(true);
+        if (queue_.Empty() && !stop_.load()) wake_.wait_for(lock, std::chrono::milliseconds(100));
+        sleeping_.store(false);
+    }
+
+    void Run() {
+        std::string group;
+        uint64_t pending = 0;
+        for (;;) {
+            pending += Drain(group);
+            if (pending == 0) {
+                if (stop_.load() && queue_.Empty()) return;
+                Idle();
+                continue;
+            }
+            if (options_.commit_window.count() > 0) {
+                const Clock::time_point deadline = Clock::now() + options_.commit_window;
+                while (group.size() < options_.max_group_bytes && !stop_.load()) {
+                    const Clock::time_point now = Clock::now();
+                    if (now >= deadline) break;
+                    const std::size_t got = Drain(group);
+                    pending += got;
+                    if (got == 0) {
+                        std::this_thread::sleep_for(std::min<Clock::duration>(deadline - now, std::chrono::microseconds(50)));
+                    }
+                }
+            }
+            Commit(group, pending);
+            group.clear();
+            pending = 0;
+        }
+    }
+
+    void Commit(const std::string& group, uint64_t count) {
+        bool ok = !io_failed_;
+        if (ok) ok = file_.Write(group.data(), group.size()) && (!options_.sync || file_.Sync());
+        if (ok) {  // 先记统计再发布，被唤醒的等待者看到的统计已包含本组
+            records_.fetch_add(count, std::memory_order_relaxed);
+            commits_.fetch_add(1, std::memory_order_relaxed);
+            bytes_.fetch_add(group.size(), std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock(durable_mu_);
+            if (ok) {
+                durable_lsn_.store(durable_lsn_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+            } else if (!failed_) {
+                failed_ = true;
+                error_ = "transaction log write failed";
+            }
+        }
+        io_failed_ = !ok;
+        durable_.notify_all();
+    }
+
+    const TransactionLogOptions options_;
+    const uint64_t base_lsn_;
+    transaction_log_detail::AppendFile file_;
+    BoundedQueue<ProcessedTransaction> queue_;
+    ProcessedTransaction row_{};  // 仅 I/O 线程使用的出队缓冲
+    bool io_failed_ = false;      // 仅 I/O 线程使用
+
+    std::mutex mu_;  // 只保护 I/O 线程的休眠与唤醒
+    std::condition_variable wake_;
+    std::atomic<bool> sleeping_{false};
+    std::atomic<bool> stop_{false};
+    std::thread io_;
+
+    mutable std::mutex durable_mu_;
+    std::condition_variable durable_;
+    std::atomic<uint64_t> durable_lsn_;
+    bool failed_ = false;
+    std::string error_;
+
+    std::atomic<uint64_t> records_{0};
+    std::atomic<uint64_t> commits_{0};
+    std::atomic<uint64_t> bytes_{0};
+};